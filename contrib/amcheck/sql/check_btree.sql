@@ -103,11 +103,28 @@ INSERT INTO toast_bug SELECT repeat('a', 2200);
 -- Should not get false positive report of corruption:
 SELECT bt_index_check('toasty', true);
 
+--
+-- Posting list tuples must be fingerprinted as the heap TIDs they contain,
+-- whether they were formed by CREATE INDEX, by insertions or left behind by
+-- VACUUM.
+--
+CREATE TABLE bttest_dedup(a int4, b text);
+INSERT INTO bttest_dedup SELECT i % 10, 'build' FROM generate_series(1, 10000) i;
+CREATE INDEX bttest_dedup_idx ON bttest_dedup(a);
+SELECT bt_index_check('bttest_dedup_idx', true);
+INSERT INTO bttest_dedup SELECT i % 10, 'insert' FROM generate_series(1, 10000) i;
+SELECT bt_index_check('bttest_dedup_idx', true);
+DELETE FROM bttest_dedup WHERE a = 5 AND b = 'build';
+VACUUM bttest_dedup;
+SELECT bt_index_check('bttest_dedup_idx', true);
+SELECT bt_index_parent_check('bttest_dedup_idx', true);
+
 -- cleanup
 DROP TABLE bttest_a;
 DROP TABLE bttest_b;
 DROP TABLE bttest_multi;
 DROP TABLE delete_test_table;
 DROP TABLE toast_bug;
+DROP TABLE bttest_dedup;
 DROP OWNED BY regress_bttest_role; -- permissions
 DROP ROLE regress_bttest_role;
@@ -947,17 +947,45 @@ bt_target_page_check(BtreeCheckState *state)
 		/* Build insertion scankey for current page offset */
 		skey = _bt_mkscankey(state->rel, itup);
 
-		/* Fingerprint leaf page tuples (those that point to the heap) */
+		/*
+		 * Fingerprint leaf page tuples (those that point to the heap).  A
+		 * posting list tuple is fingerprinted as the ordinary tuples it
+		 * stands in for, one per heap TID, since that's what the heap
+		 * verification pass will look for.
+		 */
 		if (state->heapallindexed && P_ISLEAF(topaque) && !ItemIdIsDead(itemid))
 		{
 			IndexTuple		norm;
 
-			norm = bt_normalize_tuple(state, itup);
-			bloom_add_element(state->filter, (unsigned char *) norm,
-							  IndexTupleSize(norm));
-			/* Be tidy */
-			if (norm != itup)
-				pfree(norm);
+			if (BTreeTupleIsPosting(itup))
+			{
+				int			i;
+
+				for (i = 0; i < BTreeTupleGetNPosting(itup); i++)
+				{
+					IndexTuple	logtuple;
+
+					logtuple = _bt_form_posting(itup,
+												BTreeTupleGetPostingN(itup, i),
+												1);
+					norm = bt_normalize_tuple(state, logtuple);
+					bloom_add_element(state->filter, (unsigned char *) norm,
+									  IndexTupleSize(norm));
+					/* Be tidy */
+					if (norm != logtuple)
+						pfree(norm);
+					pfree(logtuple);
+				}
+			}
+			else
+			{
+				norm = bt_normalize_tuple(state, itup);
+				bloom_add_element(state->filter, (unsigned char *) norm,
+								  IndexTupleSize(norm));
+				/* Be tidy */
+				if (norm != itup)
+					pfree(norm);
+			}
 		}
 
 		/*
@@ -1781,9 +1809,8 @@ bt_tuple_present_callback(Relation index, HeapTuple htup, Datum *values,
  * datums with potentially distinct representations (e.g., btree/numeric_ops
  * index datums will not get their display scale normalized-away here).
  * Normalization may need to be expanded to handle more cases in the future,
- * though.  For example, it's possible that non-pivot tuples could in the
- * future have alternative logically equivalent representations due to using
- * the INDEX_ALT_TID_MASK bit to implement intelligent deduplication.
+ * though.  Posting list tuples never get here; callers expand them into one
+ * ordinary tuple per heap TID first.
  */
 static IndexTuple
 bt_normalize_tuple(BtreeCheckState *state, IndexTuple itup)
@@ -29,8 +29,10 @@
 #include <unistd.h>
 
 #include "access/heapam.h"
+#include "access/htup_details.h"
 #include "access/xact.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_database.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -51,6 +53,7 @@
 #include "utils/rel.h"
 #include "utils/relfilenodemap.h"
 #include "utils/resowner.h"
+#include "utils/syscache.h"
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
@@ -82,11 +85,14 @@ typedef struct AutoPrewarmSharedState
 void		_PG_init(void);
 void		autoprewarm_main(Datum main_arg);
 void		autoprewarm_database_main(Datum main_arg);
+void		autoprewarm_clone_main(Datum main_arg);
 
 PG_FUNCTION_INFO_V1(autoprewarm_start_worker);
 PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 
 static void apw_load_buffers(void);
+static int	apw_prewarm_blocks(BlockInfoRecord *block_info, int start_idx,
+				   int stop_idx);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_master_worker(void);
 static void apw_start_database_worker(void);
@@ -427,11 +433,7 @@ apw_load_buffers(void)
 void
 autoprewarm_database_main(Datum main_arg)
 {
-	int			pos;
 	BlockInfoRecord *block_info;
-	Relation	rel = NULL;
-	BlockNumber nblocks = 0;
-	BlockInfoRecord *old_blk = NULL;
 	dsm_segment *seg;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
@@ -447,13 +449,140 @@ autoprewarm_database_main(Datum main_arg)
 				 errmsg("could not map dynamic shared memory segment")));
 	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
+
+	apw_state->prewarmed_blocks +=
+		apw_prewarm_blocks(block_info, apw_state->prewarm_start_idx,
+						   apw_state->prewarm_stop_idx);
+
+	dsm_detach(seg);
+}
+
+/*
+ * Prewarm a database that was just created from a template, using the
+ * template's blocks from the last dump.
+ *
+ * The template and new database OIDs are passed in bgw_extra.  Creating a
+ * database copies (or clones) the template's files, catalogs and relation
+ * mapping, so every relation of the new database has the same relfilenode as
+ * its counterpart in the template.  Only the database OID, and the tablespace
+ * of relations that live in the database's default tablespace, need to be
+ * remapped.  Blocks of shared relations are skipped; they are shared with
+ * the template and already cached.
+ */
+void
+autoprewarm_clone_main(Datum main_arg)
+{
+	Oid			template_db;
+	Oid			clone_db;
+	Oid			template_spc = InvalidOid;
+	HeapTuple	tuple;
+	FILE	   *file;
+	int			num_elements;
+	int			num_blocks = 0;
+	int			prewarmed_blocks;
+	int			i;
+	BlockInfoRecord *block_info;
+
+	memcpy(&template_db, MyBgworkerEntry->bgw_extra, sizeof(Oid));
+	memcpy(&clone_db, MyBgworkerEntry->bgw_extra + sizeof(Oid), sizeof(Oid));
+
+	/* Establish signal handlers; once that's done, unblock signals. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(clone_db, InvalidOid, 0);
+
+	/* Look up the template's default tablespace, if it still exists. */
+	StartTransactionCommand();
+	tuple = SearchSysCache1(DATABASEOID, ObjectIdGetDatum(template_db));
+	if (HeapTupleIsValid(tuple))
+	{
+		template_spc = ((Form_pg_database) GETSTRUCT(tuple))->dattablespace;
+		ReleaseSysCache(tuple);
+	}
+	CommitTransactionCommand();
+
+	/*
+	 * The dump file is replaced atomically, so it's safe to read it even if
+	 * the master worker is writing a new one.  Exit quietly if it doesn't
+	 * exist.
+	 */
+	file = AllocateFile(AUTOPREWARM_FILE, "r");
+	if (!file)
+	{
+		if (errno == ENOENT)
+			return;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						AUTOPREWARM_FILE)));
+	}
+
+	/* First line of the file is a record count. */
+	if (fscanf(file, "<<%d>>\n", &num_elements) != 1)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from file \"%s\": %m",
+						AUTOPREWARM_FILE)));
+
+	block_info = (BlockInfoRecord *)
+		palloc(sizeof(BlockInfoRecord) * Max(num_elements, 1));
+
+	/* Keep the template's records, remapped onto the new database. */
+	for (i = 0; i < num_elements; i++)
+	{
+		BlockInfoRecord *blk = &block_info[num_blocks];
+		unsigned	forknum;
+
+		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blk->database,
+				   &blk->tablespace, &blk->filenode,
+				   &forknum, &blk->blocknum) != 5)
+			ereport(ERROR,
+					(errmsg("autoprewarm block dump file is corrupted at line %d",
+							i + 1)));
+		blk->forknum = forknum;
+
+		if (blk->database != template_db)
+			continue;
+
+		blk->database = clone_db;
+		if (OidIsValid(template_spc) && blk->tablespace == template_spc)
+			blk->tablespace = MyDatabaseTableSpace;
+		num_blocks++;
+	}
+
+	FreeFile(file);
+
+	/* Sort the blocks to be loaded. */
+	pg_qsort(block_info, num_blocks, sizeof(BlockInfoRecord),
+			 apw_compare_blockinfo);
+
+	prewarmed_blocks = apw_prewarm_blocks(block_info, 0, num_blocks);
+
+	ereport(LOG,
+			(errmsg("autoprewarm prewarmed %d of %d blocks of database %u from template database %u",
+					prewarmed_blocks, num_blocks, clone_db, template_db)));
+}
+
+/*
+ * Prewarm the blocks in block_info between start_idx (inclusive) and
+ * stop_idx (exclusive), which must be sorted and belong to the database we're
+ * connected to or to global objects.  Returns the number of blocks loaded.
+ */
+static int
+apw_prewarm_blocks(BlockInfoRecord *block_info, int start_idx, int stop_idx)
+{
+	int			pos = start_idx;
+	int			prewarmed_blocks = 0;
+	Relation	rel = NULL;
+	BlockNumber nblocks = 0;
+	BlockInfoRecord *old_blk = NULL;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (pos < stop_idx && have_free_buffer())
 	{
 		BlockInfoRecord *blk = &block_info[pos++];
 		Buffer		buf;
@@ -536,21 +665,21 @@ autoprewarm_database_main(Datum main_arg)
 								 NULL);
 		if (BufferIsValid(buf))
 		{
-			apw_state->prewarmed_blocks++;
+			prewarmed_blocks++;
 			ReleaseBuffer(buf);
 		}
 
 		old_blk = blk;
 	}
 
-	dsm_detach(seg);
-
 	/* Release lock on previous relation. */
 	if (rel)
 	{
 		relation_close(rel, AccessShareLock);
 		CommitTransactionCommand();
 	}
+
+	return prewarmed_blocks;
 }
 
 /*
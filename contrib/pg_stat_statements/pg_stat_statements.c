@@ -62,7 +62,9 @@
 #include <unistd.h>
 
 #include "access/hash.h"
+#include "access/xact.h"
 #include "catalog/pg_authid.h"
+#include "commands/dbcommands.h"
 #include "executor/instrument.h"
 #include "funcapi.h"
 #include "mb/pg_wchar.h"
@@ -126,6 +128,8 @@ typedef enum pgssVersion
 /*
  * Hashtable key that defines the identity of a hashtable entry.  We separate
  * queries by user and by database even if they are otherwise identical.
+ * Databases can be grouped with pg_stat_statements.database_group, in which
+ * case dbid is the OID of the database named by that setting.
  *
  * Right now, this structure contains no padding.  If you add any, make sure
  * to teach pgss_store() to zero the padding bytes.  Otherwise, things will
@@ -270,6 +274,15 @@ static int	pgss_max;			/* max # statements to track */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_save;			/* whether to save stats across shutdown */
+static char *pgss_database_group;	/* database to record statements under */
+
+/*
+ * Cached OID of the database named by pg_stat_statements.database_group,
+ * valid if pgss_database_group_resolved is set.  Reset when the setting
+ * changes.
+ */
+static Oid	pgss_database_group_oid = InvalidOid;
+static bool pgss_database_group_resolved = false;
 
 
 #define pgss_enabled() \
@@ -307,6 +320,8 @@ static void pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 					ProcessUtilityContext context, ParamListInfo params,
 					QueryEnvironment *queryEnv,
 					DestReceiver *dest, char *completionTag);
+static void pgss_database_group_assign(const char *newval, void *extra);
+static Oid	pgss_database_id(void);
 static uint64 pgss_hash_string(const char *str, int len);
 static void pgss_store(const char *query, uint64 queryId,
 		   int query_location, int query_len,
@@ -408,6 +423,17 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomStringVariable("pg_stat_statements.database_group",
+							   "Sets the database under which pg_stat_statements records statements.",
+							   "If empty, statements are recorded under the database they were executed in.",
+							   &pgss_database_group,
+							   "",
+							   PGC_SUSET,
+							   0,
+							   NULL,
+							   pgss_database_group_assign,
+							   NULL);
+
 	EmitWarningsOnPlaceholders("pg_stat_statements");
 
 	/*
@@ -1072,6 +1098,46 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 	}
 }
 
+/*
+ * assign_hook for pg_stat_statements.database_group: forget the cached OID.
+ */
+static void
+pgss_database_group_assign(const char *newval, void *extra)
+{
+	pgss_database_group_oid = InvalidOid;
+	pgss_database_group_resolved = false;
+}
+
+/*
+ * Get the database OID statements are recorded under.
+ *
+ * Normally this is the current database.  When many databases run the same
+ * workload (for instance, databases created from one template), setting
+ * pg_stat_statements.database_group for each of them folds their statements
+ * into a single set of entries keyed by the OID of the named database.  This
+ * keeps the hash table small and saves entry_dealloc() from churning.
+ *
+ * A group naming a database that doesn't exist is ignored.
+ */
+static Oid
+pgss_database_id(void)
+{
+	if (pgss_database_group == NULL || pgss_database_group[0] == '\0')
+		return MyDatabaseId;
+
+	/* Looking up the group requires catalog access */
+	if (!pgss_database_group_resolved && IsTransactionState())
+	{
+		pgss_database_group_oid = get_database_oid(pgss_database_group, true);
+		pgss_database_group_resolved = true;
+	}
+
+	if (OidIsValid(pgss_database_group_oid))
+		return pgss_database_group_oid;
+
+	return MyDatabaseId;
+}
+
 /*
  * Given an arbitrarily long query string, produce a hash for the purposes of
  * identifying the query, without normalizing constants.  Used when hashing
@@ -1152,7 +1218,7 @@ pgss_store(const char *query, uint64 queryId,
 
 	/* Set up key for hashtable search */
 	key.userid = GetUserId();
-	key.dbid = MyDatabaseId;
+	key.dbid = pgss_database_id();
 	key.queryid = queryId;
 
 	/* Lookup the hash table entry with shared lock. */
@@ -195,4 +195,16 @@ DROP FUNCTION PLUS_TWO(INTEGER);
 
 SELECT query, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 
+--
+-- database groups
+--
+SELECT pg_stat_statements_reset();
+SET pg_stat_statements.database_group = 'template1';
+SELECT 1 AS "grouped";
+RESET pg_stat_statements.database_group;
+
+SELECT d.datname = 'template1' AS grouped, query, calls
+  FROM pg_stat_statements s JOIN pg_database d ON d.oid = s.dbid
+  ORDER BY 1, query COLLATE "C";
+
 DROP EXTENSION pg_stat_statements;
@@ -0,0 +1,974 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <libpq-fe.h>
+#include <libzfs.h>
+#include <spdlog/spdlog.h>
+
+#include <pgcow/fs.h>
+#include <pgcow/zfs/dataset.h>
+#include <pgcow/zfs/lineage.h>
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * Gets the number of milliseconds that elapsed since \paramref start.
+ */
+static double elapsed_ms(clock_type::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() -
+                                                     start)
+        .count();
+}
+
+/**
+ * Latencies of one kind of operation, safe to record from any thread.
+ */
+class latencies {
+  public:
+    void add(double ms) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        samples_.push_back(ms);
+    }
+
+    /**
+     * Prints the count, mean, p50, p99 and maximum latency, and the
+     * throughput over \paramref wall_ms if it is not zero.
+     */
+    void report(const std::string &label, const std::string &operation,
+                double wall_ms = 0) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (samples_.empty()) {
+            return;
+        }
+
+        std::vector<double> sorted = samples_;
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0;
+        for (double sample : sorted) {
+            total += sample;
+        }
+
+        std::printf("%-16s %-10s %8zu %10.2f %10.2f %10.2f %10.2f",
+                    label.c_str(), operation.c_str(), sorted.size(),
+                    total / sorted.size(), percentile(sorted, 50),
+                    percentile(sorted, 99), sorted.back());
+        if (wall_ms > 0) {
+            std::printf(" %10.1f\n", sorted.size() / (wall_ms / 1000.0));
+        } else {
+            std::printf(" %10s\n", "-");
+        }
+    }
+
+    static void print_header() {
+        std::printf("%-16s %-10s %8s %10s %10s %10s %10s %10s\n", "scenario",
+                    "operation", "count", "mean ms", "p50 ms", "p99 ms",
+                    "max ms", "ops/s");
+    }
+
+  private:
+    /**
+     * Nearest-rank percentile of sorted samples.
+     */
+    static double percentile(const std::vector<double> &sorted, int p) {
+        size_t rank = (sorted.size() * p + 99) / 100;
+        return sorted[std::max<size_t>(rank, 1) - 1];
+    }
+
+    std::mutex mutex_;
+    std::vector<double> samples_;
+};
+
+/**
+ * Number of failed checks, any failure makes the run fail.
+ */
+static int failures = 0;
+static std::mutex failures_mutex;
+
+template <typename... Args>
+static void check_failed(const char *format, const Args &... args) {
+    std::lock_guard<std::mutex> guard(failures_mutex);
+    spdlog::error(format, args...);
+    ++failures;
+}
+
+/**
+ * Parses a comma separated list of snapshot counts, like "0,100,1000".
+ */
+static std::vector<int> parse_levels(const std::string &value) {
+    std::vector<int> levels;
+    std::stringstream stream(value);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        levels.push_back(std::stoi(item));
+    }
+
+    return levels;
+}
+
+/**
+ * Adds snapshots to a dataset until it has at least \paramref count
+ * snapshots named with \paramref prefix.
+ */
+static bool grow_snapshots(const std::shared_ptr<pgcow::zfs::dataset> &dataset,
+                           const std::string &prefix, int count) {
+    int existing = 0;
+    for (const auto &snapshot : dataset->snapshots()) {
+        std::string name = pgcow::fs::path::leaf(snapshot->name());
+        if (name.find("@" + prefix) != std::string::npos) {
+            ++existing;
+        }
+    }
+
+    for (int i = existing; i < count; ++i) {
+        if (!dataset->snapshot(prefix + std::to_string(i))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Destroys the snapshots created by \see grow_snapshots.
+ */
+static void drop_snapshots(const std::shared_ptr<pgcow::zfs::dataset> &dataset,
+                           const std::string &prefix) {
+    std::string snapshot_prefix = dataset->name() + "@" + prefix;
+    for (const auto &snapshot : dataset->snapshots()) {
+        if (snapshot->name().compare(0, snapshot_prefix.size(),
+                                     snapshot_prefix) == 0) {
+            snapshot->destroy();
+        }
+    }
+}
+
+/**
+ * Does what pgcow's copydir hook does for CREATE DATABASE, without
+ * PostgreSQL: find the template's dataset by its mountpoint, snapshot
+ * it and clone the snapshot next to it.
+ */
+static std::shared_ptr<pgcow::zfs::dataset>
+emulate_copydir(libzfs_handle_t *zfs, const std::string &template_path,
+                const std::string &clone_name, latencies &lookup) {
+    auto start = clock_type::now();
+    auto dataset = pgcow::zfs::dataset::by_mountpoint(zfs, template_path);
+    lookup.add(elapsed_ms(start));
+
+    if (!dataset) {
+        check_failed("cannot find dataset mounted at '{0}'", template_path);
+        return nullptr;
+    }
+
+    uint64_t now = (uint64_t)std::chrono::duration_cast<
+                       std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    auto snapshot = dataset->snapshot(std::to_string(now));
+    if (!snapshot) {
+        check_failed("cannot snapshot '{0}'", dataset->name());
+        return nullptr;
+    }
+
+    auto clone = snapshot->clone(clone_name);
+    if (!clone) {
+        check_failed("cannot clone '{0}'", snapshot->name());
+        return nullptr;
+    }
+
+    if (clone->origin() != snapshot->name()) {
+        check_failed("clone '{0}' has origin '{1}' instead of '{2}'",
+                     clone->name(), clone->origin(), snapshot->name());
+    }
+
+    return clone;
+}
+
+/**
+ * Does what pgcow does after DROP DATABASE: destroy the database's
+ * dataset and the snapshot it was cloned from.
+ */
+static void emulate_release(libzfs_handle_t *zfs,
+                            const std::string &database_path) {
+    auto dataset = pgcow::zfs::dataset::by_mountpoint(zfs, database_path);
+    if (!dataset) {
+        check_failed("cannot find dataset mounted at '{0}'", database_path);
+        return;
+    }
+
+    std::string origin = dataset->origin();
+    if (!pgcow::zfs::destroy_promoting_clones(dataset)) {
+        check_failed("cannot destroy dataset mounted at '{0}'", database_path);
+        return;
+    }
+
+    auto origin_snapshot = pgcow::zfs::dataset::by_name(zfs, origin);
+    if (origin_snapshot && pgcow::zfs::clones(origin_snapshot).empty()) {
+        origin_snapshot->destroy();
+    }
+
+    std::error_code _;
+    std::filesystem::remove(database_path, _);
+
+    if (pgcow::zfs::dataset::by_mountpoint(zfs, database_path)) {
+        check_failed("dataset mounted at '{0}' survived its release",
+                     database_path);
+    }
+}
+
+/**
+ * Runs the copydir hook's zfs work in a loop, without a server.
+ */
+static void run_copydir(libzfs_handle_t *zfs,
+                        const cxxopts::ParseResult &args) {
+    std::string parent_name = args["dataset"].as<std::string>();
+    int iterations = args["iterations"].as<int>();
+    int files = args["files"].as<int>();
+    auto levels = parse_levels(args["snapshots"].as<std::string>());
+
+    auto parent = pgcow::zfs::dataset::by_name(zfs, parent_name);
+    if (!parent) {
+        check_failed("cannot find zfs dataset named '{0}'", parent_name);
+        return;
+    }
+
+    // stands in for the template database's directory
+    std::string template_oid = std::to_string(getpid());
+    auto template_dataset =
+        pgcow::zfs::dataset::create(zfs, parent, template_oid);
+    if (!template_dataset || !template_dataset->mount()) {
+        check_failed("cannot create template dataset under '{0}'",
+                     parent_name);
+        return;
+    }
+
+    std::string template_path = template_dataset->mountpoint();
+    std::vector<char> page(8192, 'x');
+    for (int i = 0; i < files; ++i) {
+        std::ofstream file(pgcow::fs::path::join(template_path,
+                                                 std::to_string(16384 + i)));
+        file.write(page.data(), page.size());
+    }
+
+    for (int level : levels) {
+        if (!grow_snapshots(template_dataset, "bench-", level)) {
+            check_failed("cannot grow '{0}' to {1} snapshots",
+                         template_dataset->name(), level);
+            break;
+        }
+
+        latencies lookup;
+        latencies create;
+        latencies drop;
+        latencies cycle;
+
+        auto wall_start = clock_type::now();
+        for (int i = 0; i < iterations; ++i) {
+            auto cycle_start = clock_type::now();
+            std::string clone_oid = std::to_string(1000000 + i);
+            std::string clone_path =
+                pgcow::fs::path::join(parent->mountpoint(), clone_oid);
+
+            auto start = clock_type::now();
+            auto clone =
+                emulate_copydir(zfs, template_path, clone_oid, lookup);
+            create.add(elapsed_ms(start));
+            if (!clone) {
+                break;
+            }
+
+            if (clone->mountpoint() != clone_path ||
+                !std::filesystem::exists(
+                    pgcow::fs::path::join(clone_path, "16384"))) {
+                check_failed("clone '{0}' does not have the template's files "
+                             "at '{1}'",
+                             clone->name(), clone_path);
+            }
+            clone.reset();
+
+            start = clock_type::now();
+            emulate_release(zfs, clone_path);
+            drop.add(elapsed_ms(start));
+            cycle.add(elapsed_ms(cycle_start));
+        }
+        double wall_ms = elapsed_ms(wall_start);
+
+        std::string label = "copydir/" + std::to_string(level);
+        lookup.report(label, "lookup");
+        create.report(label, "create");
+        drop.report(label, "drop");
+        cycle.report(label, "cycle", wall_ms);
+    }
+
+    drop_snapshots(template_dataset, "bench-");
+    for (const auto &snapshot : template_dataset->snapshots()) {
+        snapshot->destroy();
+    }
+    template_dataset->destroy();
+
+    std::error_code _;
+    std::filesystem::remove_all(template_path, _);
+}
+
+/**
+ * Runs a statement, records a failed check if it does not succeed.
+ */
+static bool execute(PGconn *conn, const std::string &sql) {
+    PGresult *result = PQexec(conn, sql.c_str());
+    bool ok = PQresultStatus(result) == PGRES_COMMAND_OK ||
+              PQresultStatus(result) == PGRES_TUPLES_OK;
+    if (!ok) {
+        check_failed("'{0}' failed: {1}", sql, PQerrorMessage(conn));
+    }
+
+    PQclear(result);
+    return ok;
+}
+
+/**
+ * Runs a query that returns a single value.
+ *
+ * \returns An empty string if the query failed or returned no rows.
+ */
+static std::string query_value(PGconn *conn, const std::string &sql) {
+    PGresult *result = PQexec(conn, sql.c_str());
+    std::string value;
+
+    if (PQresultStatus(result) == PGRES_TUPLES_OK && PQntuples(result) > 0) {
+        value = PQgetvalue(result, 0, 0);
+    }
+
+    PQclear(result);
+    return value;
+}
+
+static std::string quote_identifier(PGconn *conn, const std::string &name) {
+    char *quoted = PQescapeIdentifier(conn, name.c_str(), name.size());
+    std::string result = quoted ? quoted : name;
+    PQfreemem(quoted);
+    return result;
+}
+
+/**
+ * Creates and drops databases through a server, checking that every
+ * database gets its own dataset and that it is gone after the drop.
+ *
+ * \param data_directory Data directory of the server, empty to skip
+ *                       the checks against zfs.
+ */
+static void churn(const std::string &conninfo,
+                  const std::string &template_name,
+                  const std::string &data_directory, int client,
+                  int iterations, latencies &create, latencies &drop,
+                  latencies &cycle) {
+    PGconn *conn = PQconnectdb(conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        check_failed("cannot connect to '{0}': {1}", conninfo,
+                     PQerrorMessage(conn));
+        PQfinish(conn);
+        return;
+    }
+
+    std::string quoted_template = quote_identifier(conn, template_name);
+
+    // libzfs handles must not be shared between threads
+    libzfs_handle_t *zfs = libzfs_init();
+
+    for (int i = 0; i < iterations; ++i) {
+        std::string database = "pgcow_bench_" + std::to_string(getpid()) +
+                               "_" + std::to_string(client) + "_" +
+                               std::to_string(i);
+
+        auto cycle_start = clock_type::now();
+        auto start = clock_type::now();
+        if (!execute(conn, "CREATE DATABASE " + database + " TEMPLATE " +
+                               quoted_template)) {
+            break;
+        }
+        create.add(elapsed_ms(start));
+
+        std::string database_path;
+        if (zfs && !data_directory.empty()) {
+            std::string oid = query_value(
+                conn, "SELECT oid FROM pg_database WHERE datname = '" +
+                          database + "'");
+            database_path = pgcow::fs::path::join(
+                pgcow::fs::path::join(data_directory, "base"), oid);
+
+            if (!pgcow::zfs::dataset::by_mountpoint(zfs, database_path)) {
+                check_failed("database '{0}' is not a zfs dataset at '{1}'",
+                             database, database_path);
+            }
+        }
+
+        start = clock_type::now();
+        if (!execute(conn, "DROP DATABASE " + database)) {
+            break;
+        }
+        drop.add(elapsed_ms(start));
+        cycle.add(elapsed_ms(cycle_start));
+
+        if (!database_path.empty() &&
+            pgcow::zfs::dataset::by_mountpoint(zfs, database_path)) {
+            check_failed("dataset of dropped database '{0}' survived at "
+                         "'{1}'",
+                         database, database_path);
+        }
+    }
+
+    if (zfs) {
+        libzfs_fini(zfs);
+    }
+    PQfinish(conn);
+}
+
+/**
+ * Runs CREATE DATABASE/DROP DATABASE from one or more connections.
+ */
+static void run_server(libzfs_handle_t *zfs, const cxxopts::ParseResult &args,
+                       const std::string &scenario) {
+    std::string conninfo = args["dsn"].as<std::string>();
+    std::string template_name = args["template"].as<std::string>();
+    int iterations = args["iterations"].as<int>();
+    int clients = scenario == "concurrent" ? args["clients"].as<int>() : 1;
+    auto levels = parse_levels(args["snapshots"].as<std::string>());
+
+    PGconn *conn = PQconnectdb(conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        check_failed("cannot connect to '{0}': {1}", conninfo,
+                     PQerrorMessage(conn));
+        PQfinish(conn);
+        return;
+    }
+
+    // the checks need to see the server's files, skip them otherwise
+    std::string data_directory = query_value(conn, "SHOW data_directory");
+    std::string template_oid = query_value(
+        conn, "SELECT oid FROM pg_database WHERE datname = '" +
+                  template_name + "'");
+    PQfinish(conn);
+
+    std::shared_ptr<pgcow::zfs::dataset> template_dataset;
+    if (!data_directory.empty() && !template_oid.empty()) {
+        template_dataset = pgcow::zfs::dataset::by_mountpoint(
+            zfs, pgcow::fs::path::join(
+                     pgcow::fs::path::join(data_directory, "base"),
+                     template_oid));
+    }
+
+    if (!template_dataset) {
+        spdlog::warn("template '{0}' is not a zfs dataset on this host, "
+                     "skipping zfs checks and snapshot scaling",
+                     template_name);
+        data_directory.clear();
+        levels = {0};
+    }
+
+    for (int level : levels) {
+        if (template_dataset &&
+            !grow_snapshots(template_dataset, "bench-", level)) {
+            check_failed("cannot grow '{0}' to {1} snapshots",
+                         template_dataset->name(), level);
+            break;
+        }
+
+        latencies create;
+        latencies drop;
+        latencies cycle;
+        std::vector<std::thread> threads;
+
+        auto wall_start = clock_type::now();
+        for (int client = 0; client < clients; ++client) {
+            threads.emplace_back(churn, conninfo, template_name,
+                                 data_directory, client, iterations,
+                                 std::ref(create), std::ref(drop),
+                                 std::ref(cycle));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        double wall_ms = elapsed_ms(wall_start);
+
+        std::string label = scenario + "/" + std::to_string(level);
+        create.report(label, "create");
+        drop.report(label, "drop");
+        cycle.report(label, "cycle", wall_ms);
+    }
+
+    if (template_dataset) {
+        drop_snapshots(template_dataset, "bench-");
+    }
+}
+
+/**
+ * TPC-H style queries over a lineitem-like table, each run with tuple at a
+ * time and with batch at a time execution.
+ */
+static const std::vector<std::pair<std::string, std::string>> tpch_queries = {
+    {"q6", "SELECT sum(l_extendedprice * l_discount) FROM bench_lineitem "
+           "WHERE l_shipdate >= date '1994-01-01' "
+           "AND l_shipdate < date '1995-01-01' "
+           "AND l_discount BETWEEN 0.05::float8 AND 0.07::float8 "
+           "AND l_quantity < 24::float8"},
+    {"q1", "SELECT count(*), sum(l_quantity), "
+           "sum(l_extendedprice * (1 - l_discount) * (1 + l_tax)), "
+           "avg(l_extendedprice), avg(l_linenumber) FROM bench_lineitem "
+           "WHERE l_shipdate <= date '1998-09-02'"},
+};
+
+/**
+ * Runs a query, returns its result row as text.
+ */
+static std::string query_row(PGconn *conn, const std::string &sql) {
+    PGresult *result = PQexec(conn, sql.c_str());
+    std::string row;
+
+    if (PQresultStatus(result) != PGRES_TUPLES_OK || PQntuples(result) < 1) {
+        check_failed("'{0}' failed: {1}", sql, PQerrorMessage(conn));
+    } else {
+        for (int column = 0; column < PQnfields(result); ++column) {
+            row += (column > 0 ? "," : "") +
+                   std::string(PQgetvalue(result, 0, column));
+        }
+    }
+
+    PQclear(result);
+    return row;
+}
+
+/**
+ * Compares tuple at a time with batch at a time execution on TPC-H style
+ * aggregate queries.
+ */
+static void run_tpch(const cxxopts::ParseResult &args) {
+    std::string conninfo = args["dsn"].as<std::string>();
+    int iterations = args["iterations"].as<int>();
+    int rows = args["rows"].as<int>();
+
+    PGconn *conn = PQconnectdb(conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        check_failed("cannot connect to '{0}': {1}", conninfo,
+                     PQerrorMessage(conn));
+        PQfinish(conn);
+        return;
+    }
+
+    // batch mode only applies to an aggregate directly over a serial scan
+    if (!execute(conn, "SET max_parallel_workers_per_gather = 0") ||
+        !execute(conn, "DROP TABLE IF EXISTS bench_lineitem") ||
+        !execute(conn, "CREATE TABLE bench_lineitem (l_linenumber int4, "
+                       "l_quantity float8, l_extendedprice float8, "
+                       "l_discount float8, l_tax float8, l_shipdate date)") ||
+        !execute(conn, "INSERT INTO bench_lineitem SELECT i % 7 + 1, "
+                       "i % 50 + 1, (i::int8 * 7919 % 100000) / 100.0 + 900, "
+                       "i % 11 / 100.0, i % 9 / 100.0, "
+                       "date '1992-01-01' + i % 2526 "
+                       "FROM generate_series(1, " +
+                           std::to_string(rows) + ") i") ||
+        !execute(conn, "VACUUM ANALYZE bench_lineitem")) {
+        PQfinish(conn);
+        return;
+    }
+
+    for (const auto &query : tpch_queries) {
+        std::map<std::string, std::string> results;
+
+        for (std::string mode : {"tuple", "batch"}) {
+            execute(conn, std::string("SET enable_batch_execution = ") +
+                              (mode == "batch" ? "on" : "off"));
+
+            std::string plan =
+                query_value(conn, "EXPLAIN (FORMAT JSON) " + query.second);
+            if ((plan.find("\"Batch Mode\"") != std::string::npos) !=
+                (mode == "batch")) {
+                check_failed("{0} does not run in {1} mode", query.first,
+                             mode);
+            }
+
+            // one run to warm the cache, the rest are measured
+            results[mode] = query_row(conn, query.second);
+
+            latencies runs;
+            auto wall_start = clock_type::now();
+            for (int i = 0; i < iterations; ++i) {
+                auto start = clock_type::now();
+                query_row(conn, query.second);
+                runs.add(elapsed_ms(start));
+            }
+
+            runs.report("tpch/" + query.first + "/" + mode, "query",
+                        elapsed_ms(wall_start));
+        }
+
+        if (results["tuple"] != results["batch"]) {
+            check_failed("{0} returned '{1}' in tuple mode but '{2}' in "
+                         "batch mode",
+                         query.first, results["tuple"], results["batch"]);
+        }
+    }
+
+    execute(conn, "DROP TABLE bench_lineitem");
+    PQfinish(conn);
+}
+
+/**
+ * Loads rows into bench_copy with COPY FROM STDIN, \paramref rows rows per
+ * statement.
+ */
+static void copy_rows(const std::string &conninfo, int client,
+                      int iterations, int rows, latencies &copy) {
+    PGconn *conn = PQconnectdb(conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        check_failed("cannot connect to '{0}': {1}", conninfo,
+                     PQerrorMessage(conn));
+        PQfinish(conn);
+        return;
+    }
+
+    // a realistic row width, so that pages fill up at a realistic rate
+    std::string payload(100, 'x');
+
+    for (int i = 0; i < iterations; ++i) {
+        auto start = clock_type::now();
+
+        PGresult *result = PQexec(conn, "COPY bench_copy FROM STDIN");
+        bool ok = PQresultStatus(result) == PGRES_COPY_IN;
+        PQclear(result);
+        if (!ok) {
+            check_failed("COPY failed to start: {0}", PQerrorMessage(conn));
+            break;
+        }
+
+        std::string data;
+        for (int row = 0; row < rows && ok; ++row) {
+            data += std::to_string(row) + "\t" + std::to_string(client) +
+                    "\t" + payload + "\n";
+            if (data.size() >= 64 * 1024 || row == rows - 1) {
+                ok = PQputCopyData(conn, data.data(), data.size()) == 1;
+                data.clear();
+            }
+        }
+
+        ok = PQputCopyEnd(conn, ok ? nullptr : "sending data failed") == 1;
+        while ((result = PQgetResult(conn)) != nullptr) {
+            ok = ok && PQresultStatus(result) == PGRES_COMMAND_OK;
+            PQclear(result);
+        }
+        if (!ok) {
+            check_failed("COPY failed: {0}", PQerrorMessage(conn));
+            break;
+        }
+
+        copy.add(elapsed_ms(start));
+    }
+
+    PQfinish(conn);
+}
+
+/**
+ * Loads one table with COPY from one or more connections at once, which
+ * contend on extending the table.  With --partitions the table is hash
+ * partitioned, so that consecutive rows go to different partitions.
+ */
+static void run_copy(const cxxopts::ParseResult &args) {
+    std::string conninfo = args["dsn"].as<std::string>();
+    int iterations = args["iterations"].as<int>();
+    int clients = args["clients"].as<int>();
+    int partitions = args["partitions"].as<int>();
+    int rows = std::max(1, args["rows"].as<int>() / (clients * iterations));
+
+    PGconn *conn = PQconnectdb(conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        check_failed("cannot connect to '{0}': {1}", conninfo,
+                     PQerrorMessage(conn));
+        PQfinish(conn);
+        return;
+    }
+
+    std::string create = "CREATE TABLE bench_copy (id int8, client int4, "
+                         "payload text)";
+    if (partitions > 0) {
+        create += " PARTITION BY HASH (id)";
+    }
+    if (!execute(conn, "DROP TABLE IF EXISTS bench_copy") ||
+        !execute(conn, create)) {
+        PQfinish(conn);
+        return;
+    }
+
+    for (int partition = 0; partition < partitions; ++partition) {
+        std::string number = std::to_string(partition);
+        if (!execute(conn, "CREATE TABLE bench_copy_" + number +
+                               " PARTITION OF bench_copy FOR VALUES WITH "
+                               "(MODULUS " +
+                               std::to_string(partitions) + ", REMAINDER " +
+                               number + ")")) {
+            PQfinish(conn);
+            return;
+        }
+    }
+
+    latencies copy;
+    std::vector<std::thread> threads;
+
+    auto wall_start = clock_type::now();
+    for (int client = 0; client < clients; ++client) {
+        threads.emplace_back(copy_rows, conninfo, client, iterations, rows,
+                             std::ref(copy));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    double wall_ms = elapsed_ms(wall_start);
+
+    std::string label = "copy/" + std::to_string(clients);
+    if (partitions > 0) {
+        label += "/p" + std::to_string(partitions);
+    }
+    copy.report(label, "copy", wall_ms);
+
+    long long expected = (long long) clients * iterations * rows;
+    std::string count = query_value(conn, "SELECT count(*) FROM bench_copy");
+    if (failures == 0 && count != std::to_string(expected)) {
+        check_failed("bench_copy has {0} rows instead of {1}", count,
+                     expected);
+    }
+
+    std::string size = query_value(
+        conn, "SELECT pg_size_pretty(sum(pg_relation_size(oid))) "
+              "FROM pg_class WHERE oid = 'bench_copy'::regclass OR oid IN "
+              "(SELECT inhrelid FROM pg_inherits "
+              "WHERE inhparent = 'bench_copy'::regclass)");
+    std::printf("%-16s %.0f rows/s, table size %s\n", label.c_str(),
+                expected / (wall_ms / 1000.0), size.c_str());
+
+    execute(conn, "DROP TABLE bench_copy");
+    PQfinish(conn);
+}
+
+/**
+ * Builds \paramref rows rows of CSV data for the copycsv scenario, either
+ * narrow rows of a few short fields or wide rows of long text fields, some
+ * quoted with delimiters and quotes inside.
+ */
+static std::string make_csv(int rows, bool wide) {
+    std::string data;
+    std::string text(wide ? 200 : 8, 'x');
+    std::string quoted = "\"" + std::string(wide ? 200 : 8, 'y') +
+                         ", with a comma and a \"\"quote\"\"\"";
+
+    for (int row = 0; row < rows; ++row) {
+        data += std::to_string(row) + "," + std::to_string(row % 1000) + ",";
+        int fields = wide ? 8 : 2;
+        for (int field = 0; field < fields; ++field) {
+            data += field % 4 == 3 ? quoted : text;
+            data += field == fields - 1 ? "\n" : ",";
+        }
+    }
+
+    return data;
+}
+
+/**
+ * Loads the same CSV data with COPY FROM STDIN over and over, into an
+ * unlogged table so that the time goes into reading and parsing the input
+ * rather than into WAL.
+ */
+static void run_copycsv(const cxxopts::ParseResult &args) {
+    std::string conninfo = args["dsn"].as<std::string>();
+    int iterations = args["iterations"].as<int>();
+    int rows = args["rows"].as<int>();
+
+    PGconn *conn = PQconnectdb(conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        check_failed("cannot connect to '{0}': {1}", conninfo,
+                     PQerrorMessage(conn));
+        PQfinish(conn);
+        return;
+    }
+
+    for (bool wide : {false, true}) {
+        std::string shape = wide ? "wide" : "narrow";
+        std::string columns = "id int8, n int4";
+        for (int field = 0; field < (wide ? 8 : 2); ++field) {
+            columns += ", t" + std::to_string(field) + " text";
+        }
+
+        if (!execute(conn, "DROP TABLE IF EXISTS bench_copycsv") ||
+            !execute(conn, "CREATE UNLOGGED TABLE bench_copycsv (" +
+                               columns + ")")) {
+            break;
+        }
+
+        std::string data = make_csv(rows, wide);
+        latencies copy;
+        double total_ms = 0;
+
+        for (int i = 0; i < iterations; ++i) {
+            if (!execute(conn, "TRUNCATE bench_copycsv")) {
+                break;
+            }
+
+            auto start = clock_type::now();
+
+            PGresult *result = PQexec(
+                conn, "COPY bench_copycsv FROM STDIN (FORMAT csv)");
+            bool ok = PQresultStatus(result) == PGRES_COPY_IN;
+            PQclear(result);
+            if (!ok) {
+                check_failed("COPY failed to start: {0}",
+                             PQerrorMessage(conn));
+                break;
+            }
+
+            for (size_t offset = 0; offset < data.size() && ok;
+                 offset += 64 * 1024) {
+                size_t length = std::min<size_t>(64 * 1024,
+                                                 data.size() - offset);
+                ok = PQputCopyData(conn, data.data() + offset, length) == 1;
+            }
+
+            ok = PQputCopyEnd(conn, ok ? nullptr : "sending data failed") ==
+                 1;
+            while ((result = PQgetResult(conn)) != nullptr) {
+                ok = ok && PQresultStatus(result) == PGRES_COMMAND_OK;
+                PQclear(result);
+            }
+            if (!ok) {
+                check_failed("COPY failed: {0}", PQerrorMessage(conn));
+                break;
+            }
+
+            double ms = elapsed_ms(start);
+            copy.add(ms);
+            total_ms += ms;
+        }
+
+        std::string label = "copycsv/" + shape;
+        copy.report(label, "copy", total_ms);
+
+        std::string count =
+            query_value(conn, "SELECT count(*) FROM bench_copycsv");
+        if (failures == 0 && count != std::to_string(rows)) {
+            check_failed("bench_copycsv has {0} rows instead of {1}", count,
+                         rows);
+        }
+
+        if (total_ms > 0) {
+            double seconds = total_ms / 1000.0;
+            std::printf("%-16s %.0f rows/s, %.1f MB/s\n", label.c_str(),
+                        (double) rows * iterations / seconds,
+                        (double) data.size() * iterations / seconds /
+                            (1024 * 1024));
+        }
+    }
+
+    execute(conn, "DROP TABLE IF EXISTS bench_copycsv");
+    PQfinish(conn);
+}
+
+int main(int argc, char **argv) {
+    spdlog::set_level(spdlog::level::warn);
+
+    cxxopts::Options options("pgcow-bench", "PGCow Benchmark\n");
+    options.positional_help("[scenario]")
+        .show_positional_help()
+        .add_options()("scenario",
+                       "copydir (no server needed), churn, concurrent, "
+                       "tpch, copy or copycsv",
+                       cxxopts::value<std::string>())(
+            "d,dataset",
+            "ZFS dataset the copydir scenario creates its datasets in",
+            cxxopts::value<std::string>())(
+            "dsn", "Connection string of the server to benchmark",
+            cxxopts::value<std::string>()->default_value("dbname=postgres"))(
+            "t,template", "Template database to clone",
+            cxxopts::value<std::string>()->default_value("template1"))(
+            "n,iterations",
+            "Number of databases to create per client, of runs of each "
+            "tpch query, or of COPY statements per client",
+            cxxopts::value<int>()->default_value("100"))(
+            "c,clients", "Number of concurrent clients",
+            cxxopts::value<int>()->default_value("4"))(
+            "s,snapshots",
+            "Comma separated numbers of extra template snapshots to "
+            "measure with",
+            cxxopts::value<std::string>()->default_value("0"))(
+            "f,files", "Number of files in the copydir scenario's template",
+            cxxopts::value<int>()->default_value("16"))(
+            "r,rows",
+            "Number of rows in the tpch scenario's table, loaded in "
+            "total by the copy scenario, or loaded by each COPY of the "
+            "copycsv scenario",
+            cxxopts::value<int>()->default_value("1000000"))(
+            "p,partitions",
+            "Number of hash partitions of the copy scenario's table, 0 "
+            "for a plain table",
+            cxxopts::value<int>()->default_value("0"))(
+            "v,verbose", "Prints what pgcow does with zfs")(
+            "h,help", "Prints a list of options");
+
+    options.parse_positional({"scenario"});
+
+    cxxopts::ParseResult args = options.parse(argc, argv);
+    if (args.count("help") || !args.count("scenario")) {
+        std::cout << options.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    if (args.count("verbose")) {
+        spdlog::set_level(spdlog::level::debug);
+    }
+
+    std::string scenario = args["scenario"].as<std::string>();
+    if (scenario == "copydir" && !args.count("dataset")) {
+        spdlog::critical("the copydir scenario needs --dataset");
+        return 1;
+    }
+
+    auto zfs = libzfs_init();
+    if (!zfs) {
+        spdlog::critical("could not initialize libzfs");
+        return 1;
+    }
+
+    latencies::print_header();
+
+    if (scenario == "copydir") {
+        run_copydir(zfs, args);
+    } else if (scenario == "churn" || scenario == "concurrent") {
+        run_server(zfs, args, scenario);
+    } else if (scenario == "tpch") {
+        run_tpch(args);
+    } else if (scenario == "copy") {
+        run_copy(args);
+    } else if (scenario == "copycsv") {
+        run_copycsv(args);
+    } else {
+        spdlog::critical("unknown scenario '{0}'", scenario);
+        libzfs_fini(zfs);
+        return 1;
+    }
+
+    libzfs_fini(zfs);
+
+    if (failures > 0) {
+        spdlog::critical("{0} checks failed", failures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "libzfs.h"
+
+/**
+ * Minimal `zfs` command for the emulated pool, enough to set up a data
+ * directory for pgcow and to look at what pgcow did with it.
+ */
+
+static void usage() {
+    std::cerr << "usage:\n"
+              << "  fakezfs create [-o property=value]... <filesystem>\n"
+              << "  fakezfs snapshot [-r] <filesystem@snapshot>\n"
+              << "  fakezfs set <property=value> <dataset>\n"
+              << "  fakezfs destroy [-r] <dataset>\n"
+              << "  fakezfs list\n";
+}
+
+static int report(libzfs_handle_t *zfs) {
+    std::cerr << libzfs_error_action(zfs) << ": "
+              << libzfs_error_description(zfs) << std::endl;
+    return 1;
+}
+
+static int print_dataset(zfs_handle_t *handle, void *data) {
+    char mountpoint[ZFS_MAXPROPLEN] = "-";
+    char origin[ZFS_MAXPROPLEN] = "-";
+
+    zfs_prop_get(handle, ZFS_PROP_MOUNTPOINT, mountpoint, sizeof(mountpoint),
+                 nullptr, nullptr, 0, B_FALSE);
+    zfs_prop_get(handle, ZFS_PROP_ORIGIN, origin, sizeof(origin), nullptr,
+                 nullptr, 0, B_FALSE);
+
+    std::printf("%-40s %-40s %s\n", zfs_get_name(handle), mountpoint, origin);
+
+    if (zfs_get_type(handle) == ZFS_TYPE_FILESYSTEM) {
+        zfs_iter_children(handle, print_dataset, data);
+    }
+
+    zfs_close(handle);
+    return 0;
+}
+
+/**
+ * Destroys a dataset after its snapshots and descendants.
+ */
+static int destroy_recursive(zfs_handle_t *handle, void *data) {
+    int ret = 0;
+
+    if (zfs_get_type(handle) == ZFS_TYPE_FILESYSTEM) {
+        ret = zfs_iter_children(handle, destroy_recursive, data);
+    }
+
+    if (ret == 0 && zfs_get_type(handle) == ZFS_TYPE_FILESYSTEM) {
+        ret = zfs_unmount(handle, nullptr, 0);
+    }
+
+    if (ret == 0) {
+        ret = zfs_destroy(handle, B_FALSE);
+    }
+
+    if (ret != 0) {
+        report(zfs_get_handle(handle));
+    }
+
+    zfs_close(handle);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        std::cerr << "could not initialize fakezfs" << std::endl;
+        return 1;
+    }
+
+    int ret = 0;
+
+    if (command == "create") {
+        nvlist_t *props = nullptr;
+        nvlist_alloc(&props, 0, 0);
+
+        std::string name;
+        for (size_t i = 0; i < args.size(); ++i) {
+            auto equals = i + 1 < args.size() ? args[i + 1].find('=')
+                                              : std::string::npos;
+            if (args[i] == "-o" && equals != std::string::npos) {
+                nvlist_add_string(props, args[i + 1].substr(0, equals).c_str(),
+                                  args[i + 1].substr(equals + 1).c_str());
+                ++i;
+            } else {
+                name = args[i];
+            }
+        }
+
+        if (name.empty()) {
+            usage();
+            ret = 1;
+        } else if (zfs_create(zfs, name.c_str(), ZFS_TYPE_FILESYSTEM, props) !=
+                   0) {
+            ret = report(zfs);
+        } else {
+            zfs_handle_t *handle =
+                zfs_open(zfs, name.c_str(), ZFS_TYPE_FILESYSTEM);
+            if (!handle || zfs_mount(handle, nullptr, 0) != 0) {
+                ret = report(zfs);
+            }
+            if (handle) {
+                zfs_close(handle);
+            }
+        }
+
+        nvlist_free(props);
+    } else if (command == "snapshot" && !args.empty()) {
+        bool recursive = args.size() > 1 && args[0] == "-r";
+        if (zfs_snapshot(zfs, args.back().c_str(),
+                         recursive ? B_TRUE : B_FALSE, nullptr) != 0) {
+            ret = report(zfs);
+        }
+    } else if (command == "set" && args.size() == 2 &&
+               args[0].find('=') != std::string::npos) {
+        auto equals = args[0].find('=');
+        zfs_handle_t *handle =
+            zfs_open(zfs, args[1].c_str(), ZFS_TYPE_DATASET);
+        if (!handle ||
+            zfs_prop_set(handle, args[0].substr(0, equals).c_str(),
+                         args[0].substr(equals + 1).c_str()) != 0) {
+            ret = report(zfs);
+        }
+        if (handle) {
+            zfs_close(handle);
+        }
+    } else if (command == "destroy" && !args.empty()) {
+        bool recursive = args.size() > 1 && args[0] == "-r";
+        zfs_handle_t *handle =
+            zfs_open(zfs, args.back().c_str(), ZFS_TYPE_DATASET);
+        if (!handle) {
+            ret = report(zfs);
+        } else if (recursive) {
+            ret = destroy_recursive(handle, nullptr) != 0 ? 1 : 0;
+        } else {
+            if ((zfs_get_type(handle) == ZFS_TYPE_FILESYSTEM &&
+                 zfs_unmount(handle, nullptr, 0) != 0) ||
+                zfs_destroy(handle, B_FALSE) != 0) {
+                ret = report(zfs);
+            }
+            zfs_close(handle);
+        }
+    } else if (command == "list") {
+        std::printf("%-40s %-40s %s\n", "NAME", "MOUNTPOINT", "ORIGIN");
+        zfs_iter_root(zfs, print_dataset, nullptr);
+    } else {
+        usage();
+        ret = 1;
+    }
+
+    libzfs_fini(zfs);
+    return ret;
+}
@@ -0,0 +1,1350 @@
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "libzfs.h"
+
+struct libzfs_handle {
+    int error = EZFS_SUCCESS;
+    std::string action;
+    std::string description;
+};
+
+struct nvlist {
+    std::map<std::string, std::string> strings;
+    std::map<std::string, nvlist *> lists;
+
+    ~nvlist() {
+        for (auto &list : lists) {
+            delete list.second;
+        }
+    }
+};
+
+struct zfs_handle {
+    libzfs_handle_t *zfs = nullptr;
+    std::string name;
+    zfs_type_t type = ZFS_TYPE_FILESYSTEM;
+    nvlist_t *user_props = nullptr;
+};
+
+namespace fakezfs {
+
+namespace fs = std::filesystem;
+
+/**
+ * Record size of file systems that don't set one, same as ZFS.
+ */
+static const uint64_t default_record_size = 128 * 1024;
+
+/**
+ * A file system or snapshot of the emulated pool.
+ */
+struct entry {
+    /**
+     * Unique number, names the directory a snapshot's data is kept in.
+     */
+    uint64_t id = 0;
+
+    zfs_type_t type = ZFS_TYPE_FILESYSTEM;
+    std::string name;
+
+    /**
+     * Mountpoint set on this file system, empty if inherited.
+     */
+    std::string mountpoint;
+
+    /**
+     * Snapshot this file system was cloned from, empty if not a clone.
+     */
+    std::string origin;
+
+    uint64_t createtxg = 0;
+    uint64_t creation = 0;
+
+    /**
+     * Record size set on this file system, zero if inherited.
+     */
+    uint64_t record_size = 0;
+
+    bool mounted = false;
+    std::map<std::string, std::string> user_props;
+};
+
+/**
+ * All file systems and snapshots of the emulated pool, by name.
+ *
+ * Ordering by name keeps the children and snapshots of a dataset next
+ * to each other, right after the dataset itself.
+ */
+struct catalog {
+    uint64_t next_txg = 1;
+    uint64_t next_id = 1;
+    std::map<std::string, entry> datasets;
+};
+
+/**
+ * Gets the directory the state of the emulated pool is kept in.
+ */
+static std::string state_root() {
+    const char *root = std::getenv("PGCOW_FAKEZFS_ROOT");
+    if (!root || root[0] == '\0') {
+        return "/tmp/pgcow-fakezfs";
+    }
+
+    return root;
+}
+
+static std::string catalog_path() { return state_root() + "/catalog"; }
+
+static std::string snapshot_path(uint64_t id) {
+    return state_root() + "/snapshots/" + std::to_string(id);
+}
+
+/**
+ * Serializes access to the state directory across processes.
+ *
+ * Each instance opens the lock file on its own, so the lock also works
+ * between threads of the same process.
+ */
+class state_lock {
+  public:
+    explicit state_lock(bool exclusive) {
+        std::string path = state_root() + "/lock";
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ >= 0) {
+            ::flock(fd_, exclusive ? LOCK_EX : LOCK_SH);
+        }
+    }
+
+    ~state_lock() {
+        if (fd_ >= 0) {
+            ::flock(fd_, LOCK_UN);
+            ::close(fd_);
+        }
+    }
+
+    state_lock(const state_lock &) = delete;
+    state_lock &operator=(const state_lock &) = delete;
+
+  private:
+    int fd_ = -1;
+};
+
+/**
+ * Last catalog read or written by this process, reused as long as the
+ * catalog file was not replaced.
+ */
+static std::mutex cache_mutex;
+static std::shared_ptr<const catalog> cached_catalog;
+static struct stat cached_stat;
+
+static std::string escape(const std::string &value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\') {
+            escaped += "\\\\";
+        } else if (c == '\t') {
+            escaped += "\\t";
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+static std::string unescape(const std::string &value) {
+    std::string unescaped;
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            char c = value[++i];
+            unescaped += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+        } else {
+            unescaped += value[i];
+        }
+    }
+
+    return unescaped;
+}
+
+static std::vector<std::string> split_fields(const std::string &line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+
+    while (true) {
+        size_t end = line.find('\t', start);
+        fields.push_back(unescape(line.substr(start, end - start)));
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    return fields;
+}
+
+/**
+ * Parses the catalog file.
+ *
+ * The first line holds the next transaction group and id, every other
+ * line describes one dataset as tab-separated fields followed by pairs
+ * of user property names and values.
+ */
+static std::shared_ptr<catalog> parse_catalog(std::istream &input) {
+    auto result = std::make_shared<catalog>();
+    std::string line;
+
+    if (std::getline(input, line)) {
+        std::istringstream header(line);
+        std::string magic;
+        header >> magic >> result->next_txg >> result->next_id;
+    }
+
+    while (std::getline(input, line)) {
+        auto fields = split_fields(line);
+        if (fields.size() < 9) {
+            continue;
+        }
+
+        entry e;
+        e.id = std::stoull(fields[0]);
+        e.type = fields[1] == "s" ? ZFS_TYPE_SNAPSHOT : ZFS_TYPE_FILESYSTEM;
+        e.name = fields[2];
+        e.mountpoint = fields[3];
+        e.origin = fields[4];
+        e.createtxg = std::stoull(fields[5]);
+        e.creation = std::stoull(fields[6]);
+        e.record_size = std::stoull(fields[7]);
+        e.mounted = fields[8] == "1";
+        for (size_t i = 9; i + 1 < fields.size(); i += 2) {
+            e.user_props[fields[i]] = fields[i + 1];
+        }
+
+        result->datasets[e.name] = e;
+    }
+
+    return result;
+}
+
+/**
+ * Gets the current catalog, caller must hold a \see state_lock.
+ */
+static std::shared_ptr<const catalog> load_catalog() {
+    struct stat st;
+    if (::stat(catalog_path().c_str(), &st) != 0) {
+        return std::make_shared<catalog>();
+    }
+
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    // the catalog is replaced on every change, so a new inode means
+    // the cached copy is stale
+    if (cached_catalog && cached_stat.st_ino == st.st_ino &&
+        cached_stat.st_size == st.st_size &&
+        cached_stat.st_mtim.tv_sec == st.st_mtim.tv_sec &&
+        cached_stat.st_mtim.tv_nsec == st.st_mtim.tv_nsec) {
+        return cached_catalog;
+    }
+
+    std::ifstream input(catalog_path());
+    cached_catalog = parse_catalog(input);
+    cached_stat = st;
+    return cached_catalog;
+}
+
+/**
+ * Replaces the catalog, caller must hold an exclusive \see state_lock.
+ */
+static bool save_catalog(const catalog &cat) {
+    std::string temp_path = catalog_path() + ".tmp";
+
+    {
+        std::ofstream output(temp_path, std::ios::trunc);
+        output << "fakezfs " << cat.next_txg << " " << cat.next_id << "\n";
+
+        for (const auto &[name, e] : cat.datasets) {
+            output << e.id << "\t" << (e.type == ZFS_TYPE_SNAPSHOT ? "s" : "f")
+                   << "\t" << escape(e.name) << "\t" << escape(e.mountpoint)
+                   << "\t" << escape(e.origin) << "\t" << e.createtxg << "\t"
+                   << e.creation << "\t" << e.record_size << "\t"
+                   << (e.mounted ? "1" : "0");
+            for (const auto &[key, value] : e.user_props) {
+                output << "\t" << escape(key) << "\t" << escape(value);
+            }
+            output << "\n";
+        }
+
+        output.close();
+        if (output.fail()) {
+            return false;
+        }
+    }
+
+    if (::rename(temp_path.c_str(), catalog_path().c_str()) != 0) {
+        return false;
+    }
+
+    struct stat st;
+    std::lock_guard<std::mutex> guard(cache_mutex);
+    if (::stat(catalog_path().c_str(), &st) == 0) {
+        cached_catalog = std::make_shared<catalog>(cat);
+        cached_stat = st;
+    } else {
+        cached_catalog.reset();
+    }
+
+    return true;
+}
+
+static int fail(libzfs_handle_t *zfs, zfs_error_t error,
+                const std::string &action, const std::string &description) {
+    zfs->error = error;
+    zfs->action = action;
+    zfs->description = description;
+    return -1;
+}
+
+static void succeed(libzfs_handle_t *zfs) {
+    zfs->error = EZFS_SUCCESS;
+    zfs->action.clear();
+    zfs->description.clear();
+}
+
+static bool is_valid_name(const std::string &name) {
+    if (name.empty() || name.size() >= ZFS_MAX_DATASET_NAME_LEN ||
+        name.front() == '/' || name.back() == '/' ||
+        name.find("//") != std::string::npos) {
+        return false;
+    }
+
+    for (char c : name) {
+        if (!std::isalnum((unsigned char)c) &&
+            std::strchr("_-.:/@ ", c) == nullptr) {
+            return false;
+        }
+    }
+
+    auto at = name.find('@');
+    return at == std::string::npos ||
+           (at > 0 && at + 1 < name.size() &&
+            name.find('@', at + 1) == std::string::npos &&
+            name.find('/', at) == std::string::npos);
+}
+
+/**
+ * Gets the dataset a snapshot belongs to or a file system's parent,
+ * empty for a pool's root file system.
+ */
+static std::string parent_name(const std::string &name) {
+    auto at = name.find('@');
+    if (at != std::string::npos) {
+        return name.substr(0, at);
+    }
+
+    auto slash = name.rfind('/');
+    if (slash == std::string::npos) {
+        return "";
+    }
+
+    return name.substr(0, slash);
+}
+
+static std::string leaf_name(const std::string &name) {
+    auto slash = name.rfind('/');
+    return slash == std::string::npos ? name : name.substr(slash + 1);
+}
+
+static const entry *find(const catalog &cat, const std::string &name) {
+    auto it = cat.datasets.find(name);
+    return it == cat.datasets.end() ? nullptr : &it->second;
+}
+
+static std::string effective_mountpoint(const catalog &cat,
+                                        const std::string &name) {
+    const entry *e = find(cat, name);
+    if (e && !e->mountpoint.empty()) {
+        return e->mountpoint;
+    }
+
+    std::string parent = parent_name(name);
+    if (parent.empty()) {
+        return "/" + name;
+    }
+
+    return (fs::path(effective_mountpoint(cat, parent)) / leaf_name(name))
+        .string();
+}
+
+static uint64_t effective_record_size(const catalog &cat,
+                                      const std::string &name) {
+    for (std::string current = name; !current.empty();
+         current = parent_name(current)) {
+        const entry *e = find(cat, current);
+        if (e && e->record_size != 0) {
+            return e->record_size;
+        }
+    }
+
+    return default_record_size;
+}
+
+/**
+ * Gets the names of the datasets directly below a file system, either
+ * its child file systems or its snapshots.
+ */
+static std::vector<std::string> children(const catalog &cat,
+                                         const std::string &name,
+                                         zfs_type_t type) {
+    std::vector<std::string> names;
+    std::string prefix = name + (type == ZFS_TYPE_SNAPSHOT ? "@" : "/");
+
+    for (auto it = cat.datasets.lower_bound(prefix);
+         it != cat.datasets.end() &&
+         it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+        if (it->second.type == type &&
+            it->first.find_first_of("/@", prefix.size()) ==
+                std::string::npos) {
+            names.push_back(it->first);
+        }
+    }
+
+    if (type == ZFS_TYPE_SNAPSHOT) {
+        std::sort(names.begin(), names.end(),
+                  [&cat](const std::string &a, const std::string &b) {
+                      return find(cat, a)->createtxg <
+                             find(cat, b)->createtxg;
+                  });
+    }
+
+    return names;
+}
+
+/**
+ * Gets the names of a file system and all of its descendant file systems.
+ */
+static std::vector<std::string> descendants(const catalog &cat,
+                                            const std::string &name) {
+    std::vector<std::string> names = {name};
+    for (size_t i = 0; i < names.size(); ++i) {
+        auto child_names = children(cat, names[i], ZFS_TYPE_FILESYSTEM);
+        names.insert(names.end(), child_names.begin(), child_names.end());
+    }
+
+    return names;
+}
+
+/**
+ * Gets the mountpoints of all file systems other than \paramref name
+ * that are nested inside of its mountpoint.
+ */
+static std::set<fs::path> nested_mountpoints(const catalog &cat,
+                                             const std::string &name) {
+    std::set<fs::path> mountpoints;
+    std::string mountpoint = effective_mountpoint(cat, name) + "/";
+
+    for (const auto &[other_name, e] : cat.datasets) {
+        if (e.type != ZFS_TYPE_FILESYSTEM || other_name == name) {
+            continue;
+        }
+
+        std::string other = effective_mountpoint(cat, other_name);
+        if (other.compare(0, mountpoint.size(), mountpoint) == 0) {
+            mountpoints.insert(fs::path(other));
+        }
+    }
+
+    return mountpoints;
+}
+
+/**
+ * Copies a file, sharing its blocks with the original if the file
+ * system supports reflinks.
+ */
+static bool clone_file(const fs::path &from, const fs::path &to) {
+    int source = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        return false;
+    }
+
+    struct stat st;
+    ::fstat(source, &st);
+
+    int target = ::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                        st.st_mode & 07777);
+    if (target < 0) {
+        ::close(source);
+        return false;
+    }
+
+    bool cloned = false;
+#ifdef FICLONE
+    cloned = ::ioctl(target, FICLONE, source) == 0;
+#endif
+
+    ::close(target);
+    ::close(source);
+
+    if (cloned) {
+        return true;
+    }
+
+    std::error_code error;
+    fs::remove(to, error);
+    return fs::copy_file(from, to, error);
+}
+
+/**
+ * Copies a directory tree, leaving the directories in \paramref skip
+ * empty.
+ */
+static bool copy_tree(const fs::path &from, const fs::path &to,
+                      const std::set<fs::path> &skip) {
+    std::error_code error;
+
+    if (!fs::exists(to, error)) {
+        fs::create_directory(to, from, error);
+        if (error) {
+            return false;
+        }
+    }
+
+    for (const auto &item : fs::directory_iterator(from, error)) {
+        fs::path target = to / item.path().filename();
+        auto status = item.symlink_status(error);
+
+        if (fs::is_symlink(status)) {
+            fs::copy_symlink(item.path(), target, error);
+        } else if (fs::is_directory(status)) {
+            if (skip.count(item.path()) > 0) {
+                fs::create_directory(target, item.path(), error);
+            } else if (!copy_tree(item.path(), target, skip)) {
+                return false;
+            }
+        } else if (fs::is_regular_file(status)) {
+            if (!clone_file(item.path(), target)) {
+                return false;
+            }
+        }
+
+        if (error) {
+            return false;
+        }
+    }
+
+    return !error;
+}
+
+/**
+ * Removes everything inside of a directory except for the directories
+ * in \paramref skip, which are left in place.
+ */
+static void clear_tree(const fs::path &path, const std::set<fs::path> &skip) {
+    std::error_code error;
+    std::vector<fs::path> items;
+
+    for (const auto &item : fs::directory_iterator(path, error)) {
+        items.push_back(item.path());
+    }
+
+    for (const auto &item : items) {
+        bool contains_skipped = false;
+        for (const auto &skipped : skip) {
+            auto prefix = item.string() + "/";
+            if (skipped == item ||
+                skipped.string().compare(0, prefix.size(), prefix) == 0) {
+                contains_skipped = true;
+            }
+        }
+
+        if (!contains_skipped) {
+            fs::remove_all(item, error);
+        } else if (skip.count(item) == 0) {
+            clear_tree(item, skip);
+        }
+    }
+}
+
+static bool is_empty_or_missing(const fs::path &path) {
+    std::error_code error;
+    if (!fs::exists(path, error)) {
+        return true;
+    }
+
+    return fs::is_directory(path, error) && fs::is_empty(path, error);
+}
+
+static zfs_handle_t *open_handle(libzfs_handle_t *zfs, const entry &e) {
+    auto handle = new zfs_handle;
+    handle->zfs = zfs;
+    handle->name = e.name;
+    handle->type = e.type;
+    return handle;
+}
+
+/**
+ * Invokes \paramref func with a new handle for each of the datasets,
+ * without holding the state lock so \paramref func can use libzfs.
+ */
+static int iterate(libzfs_handle_t *zfs, const std::vector<std::string> &names,
+                   zfs_iter_f func, void *data) {
+    for (const auto &name : names) {
+        zfs_handle_t *handle = zfs_open(zfs, name.c_str(), ZFS_TYPE_DATASET);
+        if (!handle) {
+            // destroyed in the meantime
+            continue;
+        }
+
+        int ret = func(handle, data);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    succeed(zfs);
+    return 0;
+}
+
+} // namespace fakezfs
+
+using namespace fakezfs;
+
+extern "C" {
+
+libzfs_handle_t *libzfs_init(void) {
+    std::error_code error;
+    fs::create_directories(state_root() + "/snapshots", error);
+    if (error) {
+        return nullptr;
+    }
+
+    return new libzfs_handle;
+}
+
+void libzfs_fini(libzfs_handle_t *zfs) { delete zfs; }
+
+int libzfs_errno(libzfs_handle_t *zfs) { return zfs->error; }
+
+const char *libzfs_error_action(libzfs_handle_t *zfs) {
+    return zfs->action.c_str();
+}
+
+const char *libzfs_error_description(libzfs_handle_t *zfs) {
+    return zfs->description.c_str();
+}
+
+zfs_handle_t *zfs_open(libzfs_handle_t *zfs, const char *name, int types) {
+    state_lock lock(false);
+    auto cat = load_catalog();
+
+    const entry *e = find(*cat, name);
+    if (!e || (e->type & types) == 0) {
+        fail(zfs, EZFS_NOENT, std::string("cannot open '") + name + "'",
+             "dataset does not exist");
+        return nullptr;
+    }
+
+    succeed(zfs);
+    return open_handle(zfs, *e);
+}
+
+void zfs_close(zfs_handle_t *handle) {
+    nvlist_free(handle->user_props);
+    delete handle;
+}
+
+const char *zfs_get_name(const zfs_handle_t *handle) {
+    return handle->name.c_str();
+}
+
+zfs_type_t zfs_get_type(const zfs_handle_t *handle) { return handle->type; }
+
+libzfs_handle_t *zfs_get_handle(zfs_handle_t *handle) { return handle->zfs; }
+
+int zfs_prop_get(zfs_handle_t *handle, zfs_prop_t prop, char *buf,
+                 size_t len, zprop_source_t *source, char *statbuf,
+                 size_t statlen, boolean_t literal) {
+    state_lock lock(false);
+    auto cat = load_catalog();
+
+    const entry *e = find(*cat, handle->name);
+    if (!e) {
+        return fail(handle->zfs, EZFS_NOENT,
+                    "cannot get property of '" + handle->name + "'",
+                    "dataset does not exist");
+    }
+
+    std::string value;
+    zprop_source_t value_source = ZPROP_SRC_NONE;
+
+    switch (prop) {
+    case ZFS_PROP_MOUNTPOINT:
+        if (e->type != ZFS_TYPE_FILESYSTEM) {
+            return fail(handle->zfs, EZFS_BADPROP, "cannot get mountpoint",
+                        "property does not apply to snapshots");
+        }
+        value = effective_mountpoint(*cat, e->name);
+        value_source =
+            e->mountpoint.empty() ? ZPROP_SRC_INHERITED : ZPROP_SRC_LOCAL;
+        break;
+    case ZFS_PROP_ORIGIN:
+        if (e->origin.empty()) {
+            return fail(handle->zfs, EZFS_BADPROP, "cannot get origin",
+                        "dataset is not a clone");
+        }
+        value = e->origin;
+        break;
+    case ZFS_PROP_NAME:
+        value = e->name;
+        break;
+    case ZFS_PROP_TYPE:
+        value = e->type == ZFS_TYPE_SNAPSHOT ? "snapshot" : "filesystem";
+        break;
+    case ZFS_PROP_CREATION:
+    case ZFS_PROP_CREATETXG:
+    case ZFS_PROP_RECORDSIZE:
+        value = std::to_string(zfs_prop_get_int(handle, prop));
+        break;
+    default:
+        return fail(handle->zfs, EZFS_BADPROP, "cannot get property",
+                    "property is not emulated");
+    }
+
+    if (value.size() >= len) {
+        return fail(handle->zfs, EZFS_NOMEM, "cannot get property",
+                    "buffer too small");
+    }
+
+    std::memcpy(buf, value.c_str(), value.size() + 1);
+    if (source) {
+        *source = value_source;
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+uint64_t zfs_prop_get_int(zfs_handle_t *handle, zfs_prop_t prop) {
+    state_lock lock(false);
+    auto cat = load_catalog();
+
+    const entry *e = find(*cat, handle->name);
+    if (!e) {
+        return 0;
+    }
+
+    switch (prop) {
+    case ZFS_PROP_CREATION:
+        return e->creation;
+    case ZFS_PROP_CREATETXG:
+        return e->createtxg;
+    case ZFS_PROP_RECORDSIZE:
+        // snapshots report the record size of their file system
+        return effective_record_size(*cat, e->type == ZFS_TYPE_SNAPSHOT
+                                               ? parent_name(e->name)
+                                               : e->name);
+    default:
+        return 0;
+    }
+}
+
+int zfs_prop_set(zfs_handle_t *handle, const char *name, const char *value) {
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    auto it = cat.datasets.find(handle->name);
+    if (it == cat.datasets.end()) {
+        return fail(handle->zfs, EZFS_NOENT,
+                    "cannot set property for '" + handle->name + "'",
+                    "dataset does not exist");
+    }
+
+    entry &e = it->second;
+    std::string property = name;
+    std::string action = "cannot set property for '" + e.name + "'";
+
+    if (property.find(':') != std::string::npos) {
+        e.user_props[property] = value;
+    } else if (property == "mountpoint") {
+        if (e.type != ZFS_TYPE_FILESYSTEM || value[0] != '/') {
+            return fail(handle->zfs, EZFS_BADPROP, action,
+                        "mountpoint must be an absolute path");
+        }
+
+        fs::path old_mountpoint = effective_mountpoint(cat, e.name);
+        fs::path new_mountpoint = value;
+        std::error_code error;
+
+        // move the data along, like remounting would
+        if (e.mounted && old_mountpoint != new_mountpoint &&
+            fs::exists(old_mountpoint, error)) {
+            if (!is_empty_or_missing(new_mountpoint)) {
+                return fail(handle->zfs, EZFS_MOUNTFAILED, action,
+                            "directory is not empty");
+            }
+
+            fs::remove(new_mountpoint, error);
+            fs::create_directories(new_mountpoint.parent_path(), error);
+            fs::rename(old_mountpoint, new_mountpoint, error);
+            if (error) {
+                return fail(handle->zfs, EZFS_MOUNTFAILED, action,
+                            error.message());
+            }
+        }
+
+        e.mountpoint = value;
+    } else if (property == "recordsize") {
+        char *end = nullptr;
+        uint64_t size = std::strtoull(value, &end, 10);
+        if (*end != '\0' || size < 512 || size > 1024 * 1024 ||
+            (size & (size - 1)) != 0) {
+            return fail(handle->zfs, EZFS_BADPROP, action,
+                        "recordsize must be a power of 2 from 512B to 1M");
+        }
+        e.record_size = size;
+    } else {
+        return fail(handle->zfs, EZFS_BADPROP, action,
+                    "property is not emulated");
+    }
+
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+nvlist_t *zfs_get_user_props(zfs_handle_t *handle) {
+    state_lock lock(false);
+    auto cat = load_catalog();
+
+    nvlist_free(handle->user_props);
+    handle->user_props = new nvlist;
+
+    const entry *e = find(*cat, handle->name);
+    if (e) {
+        for (const auto &[key, value] : e->user_props) {
+            auto property = new nvlist;
+            property->strings[ZPROP_VALUE] = value;
+            property->strings[ZPROP_SOURCE] = e->name;
+            handle->user_props->lists[key] = property;
+        }
+    }
+
+    return handle->user_props;
+}
+
+int zfs_iter_root(libzfs_handle_t *zfs, zfs_iter_f func, void *data) {
+    std::vector<std::string> names;
+    {
+        state_lock lock(false);
+        auto cat = load_catalog();
+        for (const auto &[name, e] : cat->datasets) {
+            if (parent_name(name).empty()) {
+                names.push_back(name);
+            }
+        }
+    }
+
+    return iterate(zfs, names, func, data);
+}
+
+int zfs_iter_filesystems(zfs_handle_t *handle, zfs_iter_f func, void *data) {
+    std::vector<std::string> names;
+    {
+        state_lock lock(false);
+        names = children(*load_catalog(), handle->name, ZFS_TYPE_FILESYSTEM);
+    }
+
+    return iterate(handle->zfs, names, func, data);
+}
+
+int zfs_iter_snapshots(zfs_handle_t *handle, boolean_t simple,
+                       zfs_iter_f func, void *data) {
+    std::vector<std::string> names;
+    {
+        state_lock lock(false);
+        names = children(*load_catalog(), handle->name, ZFS_TYPE_SNAPSHOT);
+    }
+
+    return iterate(handle->zfs, names, func, data);
+}
+
+int zfs_iter_children(zfs_handle_t *handle, zfs_iter_f func, void *data) {
+    int ret = zfs_iter_filesystems(handle, func, data);
+    if (ret != 0) {
+        return ret;
+    }
+
+    return zfs_iter_snapshots(handle, B_FALSE, func, data);
+}
+
+int zfs_create(libzfs_handle_t *zfs, const char *name, zfs_type_t type,
+               nvlist_t *props) {
+    std::string action = std::string("cannot create '") + name + "'";
+    if (type != ZFS_TYPE_FILESYSTEM) {
+        return fail(zfs, EZFS_NOTSUP, action, "only file systems are emulated");
+    }
+
+    if (!is_valid_name(name) || std::strchr(name, '@') != nullptr) {
+        return fail(zfs, EZFS_INVALIDNAME, action, "invalid name");
+    }
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    if (find(cat, name)) {
+        return fail(zfs, EZFS_EXISTS, action, "dataset already exists");
+    }
+
+    // a name without a parent creates a new pool
+    std::string parent = parent_name(name);
+    if (!parent.empty() && !find(cat, parent)) {
+        return fail(zfs, EZFS_NOENT, action, "parent does not exist");
+    }
+
+    entry e;
+    e.id = cat.next_id++;
+    e.type = ZFS_TYPE_FILESYSTEM;
+    e.name = name;
+    e.createtxg = cat.next_txg++;
+    e.creation = (uint64_t)std::time(nullptr);
+
+    if (props) {
+        for (const auto &[key, value] : props->strings) {
+            if (key == "mountpoint") {
+                e.mountpoint = value;
+            } else if (key.find(':') != std::string::npos) {
+                e.user_props[key] = value;
+            }
+        }
+    }
+
+    cat.datasets[e.name] = e;
+    if (!save_catalog(cat)) {
+        return fail(zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(zfs);
+    return 0;
+}
+
+int zfs_destroy(zfs_handle_t *handle, boolean_t defer) {
+    std::string action = "cannot destroy '" + handle->name + "'";
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    const entry *e = find(cat, handle->name);
+    if (!e) {
+        return fail(handle->zfs, EZFS_NOENT, action, "dataset does not exist");
+    }
+
+    std::error_code error;
+
+    if (e->type == ZFS_TYPE_SNAPSHOT) {
+        for (const auto &[name, other] : cat.datasets) {
+            if (other.origin == e->name) {
+                return fail(handle->zfs, EZFS_BUSY, action,
+                            "snapshot has dependent clones");
+            }
+        }
+
+        fs::remove_all(snapshot_path(e->id), error);
+    } else {
+        if (!children(cat, e->name, ZFS_TYPE_FILESYSTEM).empty() ||
+            !children(cat, e->name, ZFS_TYPE_SNAPSHOT).empty()) {
+            return fail(handle->zfs, EZFS_EXISTS, action,
+                        "filesystem has children");
+        }
+
+        // the mountpoint itself stays behind, just like with ZFS
+        fs::path mountpoint = effective_mountpoint(cat, e->name);
+        if (fs::is_directory(mountpoint, error)) {
+            clear_tree(mountpoint, nested_mountpoints(cat, e->name));
+        }
+    }
+
+    cat.datasets.erase(handle->name);
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+int zfs_destroy_snaps(zfs_handle_t *handle, char *snapname, boolean_t defer) {
+    std::string action =
+        "cannot destroy snapshots '" + handle->name + "@" + snapname + "'";
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    std::vector<std::string> snapshots;
+    for (const auto &name : descendants(cat, handle->name)) {
+        std::string snapshot = name + "@" + snapname;
+        if (find(cat, snapshot)) {
+            snapshots.push_back(snapshot);
+        }
+    }
+
+    if (snapshots.empty()) {
+        return fail(handle->zfs, EZFS_NOENT, action,
+                    "could not find any snapshots to destroy");
+    }
+
+    for (const auto &[name, other] : cat.datasets) {
+        if (std::find(snapshots.begin(), snapshots.end(), other.origin) !=
+            snapshots.end()) {
+            return fail(handle->zfs, EZFS_BUSY, action,
+                        "snapshot has dependent clones");
+        }
+    }
+
+    std::error_code error;
+    for (const auto &snapshot : snapshots) {
+        fs::remove_all(snapshot_path(find(cat, snapshot)->id), error);
+        cat.datasets.erase(snapshot);
+    }
+
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+int zfs_clone(zfs_handle_t *handle, const char *target, nvlist_t *props) {
+    std::string action = std::string("cannot create '") + target + "'";
+    if (handle->type != ZFS_TYPE_SNAPSHOT) {
+        return fail(handle->zfs, EZFS_BADTYPE, action,
+                    "only snapshots can be cloned");
+    }
+
+    if (!is_valid_name(target) || std::strchr(target, '@') != nullptr) {
+        return fail(handle->zfs, EZFS_INVALIDNAME, action, "invalid name");
+    }
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    const entry *snapshot = find(cat, handle->name);
+    if (!snapshot) {
+        return fail(handle->zfs, EZFS_NOENT, action,
+                    "origin snapshot does not exist");
+    }
+
+    if (find(cat, target)) {
+        return fail(handle->zfs, EZFS_EXISTS, action, "dataset already exists");
+    }
+
+    std::string parent = parent_name(target);
+    if (parent.empty() || !find(cat, parent)) {
+        return fail(handle->zfs, EZFS_NOENT, action, "parent does not exist");
+    }
+
+    entry e;
+    e.id = cat.next_id++;
+    e.type = ZFS_TYPE_FILESYSTEM;
+    e.name = target;
+    e.origin = snapshot->name;
+    e.createtxg = cat.next_txg++;
+    e.creation = (uint64_t)std::time(nullptr);
+    e.mounted = true;
+
+    if (props) {
+        auto mountpoint = props->strings.find("mountpoint");
+        if (mountpoint != props->strings.end()) {
+            e.mountpoint = mountpoint->second;
+        }
+    }
+
+    cat.datasets[e.name] = e;
+
+    // the clone's data shows up at its mountpoint right away
+    fs::path mountpoint = effective_mountpoint(cat, e.name);
+    if (!is_empty_or_missing(mountpoint)) {
+        return fail(handle->zfs, EZFS_MOUNTFAILED, action,
+                    "mountpoint '" + mountpoint.string() + "' is not empty");
+    }
+
+    std::error_code error;
+    fs::create_directories(mountpoint.parent_path(), error);
+    fs::remove(mountpoint, error);
+
+    if (!copy_tree(snapshot_path(snapshot->id), mountpoint, {})) {
+        fs::remove_all(mountpoint, error);
+        return fail(handle->zfs, EZFS_IO, action,
+                    "cannot copy snapshot to '" + mountpoint.string() + "'");
+    }
+
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+int zfs_snapshot(libzfs_handle_t *zfs, const char *path, boolean_t recursive,
+                 nvlist_t *props) {
+    std::string action = std::string("cannot create snapshot '") + path + "'";
+    std::string name = path;
+
+    auto at = name.find('@');
+    if (!is_valid_name(name) || at == std::string::npos) {
+        return fail(zfs, EZFS_INVALIDNAME, action, "invalid name");
+    }
+
+    std::string dataset_name = name.substr(0, at);
+    std::string snapshot_name = name.substr(at + 1);
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    const entry *dataset = find(cat, dataset_name);
+    if (!dataset || dataset->type != ZFS_TYPE_FILESYSTEM) {
+        return fail(zfs, EZFS_NOENT, action, "dataset does not exist");
+    }
+
+    std::vector<std::string> datasets = {dataset_name};
+    if (recursive) {
+        datasets = descendants(cat, dataset_name);
+    }
+
+    for (const auto &snapshotted : datasets) {
+        if (find(cat, snapshotted + "@" + snapshot_name)) {
+            return fail(zfs, EZFS_EXISTS, action, "snapshot already exists");
+        }
+    }
+
+    // all snapshots of a recursive snapshot share a transaction group
+    uint64_t txg = cat.next_txg++;
+    std::vector<uint64_t> created;
+    std::error_code error;
+
+    for (const auto &snapshotted : datasets) {
+        entry e;
+        e.id = cat.next_id++;
+        e.type = ZFS_TYPE_SNAPSHOT;
+        e.name = snapshotted + "@" + snapshot_name;
+        e.createtxg = txg;
+        e.creation = (uint64_t)std::time(nullptr);
+
+        if (props) {
+            for (const auto &[key, value] : props->strings) {
+                if (key.find(':') != std::string::npos) {
+                    e.user_props[key] = value;
+                }
+            }
+        }
+
+        fs::path mountpoint = effective_mountpoint(cat, snapshotted);
+        fs::path storage = snapshot_path(e.id);
+        bool copied = fs::is_directory(mountpoint, error)
+                          ? copy_tree(mountpoint, storage,
+                                      nested_mountpoints(cat, snapshotted))
+                          : fs::create_directory(storage, error);
+
+        created.push_back(e.id);
+        if (!copied) {
+            for (uint64_t id : created) {
+                fs::remove_all(snapshot_path(id), error);
+            }
+            return fail(zfs, EZFS_IO, action,
+                        "cannot copy '" + mountpoint.string() + "'");
+        }
+
+        cat.datasets[e.name] = e;
+    }
+
+    if (!save_catalog(cat)) {
+        for (uint64_t id : created) {
+            fs::remove_all(snapshot_path(id), error);
+        }
+        return fail(zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(zfs);
+    return 0;
+}
+
+int zfs_promote(zfs_handle_t *handle) {
+    std::string action = "cannot promote '" + handle->name + "'";
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    const entry *clone = find(cat, handle->name);
+    if (!clone || clone->origin.empty()) {
+        return fail(handle->zfs, EZFS_BADTYPE, action,
+                    "not a cloned filesystem");
+    }
+
+    std::string origin = clone->origin;
+    std::string origin_dataset = parent_name(origin);
+    const entry *origin_snapshot = find(cat, origin);
+    const entry *origin_entry = find(cat, origin_dataset);
+    if (!origin_snapshot || !origin_entry) {
+        return fail(handle->zfs, EZFS_NOENT, action,
+                    "origin snapshot does not exist");
+    }
+
+    std::string clone_name = clone->name;
+    std::string origin_origin = origin_entry->origin;
+    uint64_t origin_txg = origin_snapshot->createtxg;
+
+    // the origin snapshot and all snapshots before it move to the clone
+    std::map<std::string, std::string> renames;
+    for (const auto &snapshot :
+         children(cat, origin_dataset, ZFS_TYPE_SNAPSHOT)) {
+        if (find(cat, snapshot)->createtxg > origin_txg) {
+            continue;
+        }
+
+        std::string renamed =
+            clone_name + snapshot.substr(snapshot.find('@'));
+        if (find(cat, renamed)) {
+            return fail(handle->zfs, EZFS_EXISTS, action,
+                        "conflicting snapshot name '" + renamed + "'");
+        }
+        renames[snapshot] = renamed;
+    }
+
+    for (const auto &[from, to] : renames) {
+        entry moved = cat.datasets[from];
+        moved.name = to;
+        cat.datasets.erase(from);
+        cat.datasets[to] = moved;
+    }
+
+    for (auto &[name, e] : cat.datasets) {
+        auto renamed = renames.find(e.origin);
+        if (renamed != renames.end()) {
+            e.origin = renamed->second;
+        }
+    }
+
+    cat.datasets[clone_name].origin = origin_origin;
+
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+int zfs_mount(zfs_handle_t *handle, const char *options, int flags) {
+    std::string action = "cannot mount '" + handle->name + "'";
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    auto it = cat.datasets.find(handle->name);
+    if (it == cat.datasets.end() || it->second.type != ZFS_TYPE_FILESYSTEM) {
+        return fail(handle->zfs, EZFS_NOENT, action,
+                    "filesystem does not exist");
+    }
+
+    std::error_code error;
+    fs::create_directories(effective_mountpoint(cat, handle->name), error);
+    if (error) {
+        return fail(handle->zfs, EZFS_MOUNTFAILED, action, error.message());
+    }
+
+    it->second.mounted = true;
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+int zfs_unmount(zfs_handle_t *handle, const char *mountpoint, int flags) {
+    std::string action = "cannot unmount '" + handle->name + "'";
+
+    state_lock lock(true);
+    catalog cat = *load_catalog();
+
+    auto it = cat.datasets.find(handle->name);
+    if (it == cat.datasets.end() || it->second.type != ZFS_TYPE_FILESYSTEM) {
+        return fail(handle->zfs, EZFS_NOENT, action,
+                    "filesystem does not exist");
+    }
+
+    it->second.mounted = false;
+    if (!save_catalog(cat)) {
+        return fail(handle->zfs, EZFS_IO, action, "cannot write catalog");
+    }
+
+    succeed(handle->zfs);
+    return 0;
+}
+
+int zfs_send(zfs_handle_t *handle, const char *fromsnap, const char *tosnap,
+             sendflags_t *flags, int outfd, snapfilter_cb_t filter_func,
+             void *cb_arg, nvlist_t **debugnvp) {
+    return fail(handle->zfs, EZFS_NOTSUP,
+                "cannot send '" + handle->name + "'",
+                "send streams are not emulated");
+}
+
+int nvlist_alloc(nvlist_t **nvl, unsigned int flag, int kmflag) {
+    *nvl = new nvlist;
+    return 0;
+}
+
+void nvlist_free(nvlist_t *nvl) { delete nvl; }
+
+int nvlist_add_string(nvlist_t *nvl, const char *name, const char *value) {
+    nvl->strings[name] = value;
+    return 0;
+}
+
+int nvlist_lookup_string(nvlist_t *nvl, const char *name, char **value) {
+    auto it = nvl->strings.find(name);
+    if (it == nvl->strings.end()) {
+        return ENOENT;
+    }
+
+    *value = const_cast<char *>(it->second.c_str());
+    return 0;
+}
+
+int nvlist_lookup_nvlist(nvlist_t *nvl, const char *name, nvlist_t **value) {
+    auto it = nvl->lists.find(name);
+    if (it == nvl->lists.end()) {
+        return ENOENT;
+    }
+
+    *value = it->second;
+    return 0;
+}
+}
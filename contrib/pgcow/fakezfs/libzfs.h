@@ -0,0 +1,157 @@
+#pragma once
+
+/**
+ * In-process stand-in for the parts of libzfs (ZFS on Linux 0.7) that
+ * pgcow uses.
+ *
+ * Datasets, snapshots and clones are emulated on a plain directory tree,
+ * so pgcow can be built, tested and benchmarked without a ZFS pool. Build
+ * with `make FAKEZFS=1` to use it instead of the real libzfs.
+ *
+ * The state of the emulated pool is kept in the directory named by the
+ * `PGCOW_FAKEZFS_ROOT` environment variable (`/tmp/pgcow-fakezfs` by
+ * default) and is shared by all processes that use the same directory:
+ *
+ *  - A file system's data is whatever is stored under its mountpoint,
+ *    except for the mountpoints of its child file systems.
+ *  - A snapshot copies the file system's data into the state directory,
+ *    with reflinks where the underlying file system supports them.
+ *  - A clone copies its origin snapshot's data to its mountpoint when it
+ *    is created.
+ *
+ * Unlike real ZFS, snapshots and clones cost time and space proportional
+ * to the amount of data without reflinks, and unmounting a file system
+ * does not hide its data.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/param.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { B_FALSE = 0, B_TRUE = 1 } boolean_t;
+
+typedef struct libzfs_handle libzfs_handle_t;
+typedef struct zfs_handle zfs_handle_t;
+typedef struct nvlist nvlist_t;
+
+typedef enum {
+    ZFS_TYPE_FILESYSTEM = (1 << 0),
+    ZFS_TYPE_SNAPSHOT = (1 << 1),
+    ZFS_TYPE_VOLUME = (1 << 2),
+    ZFS_TYPE_POOL = (1 << 3),
+    ZFS_TYPE_BOOKMARK = (1 << 4)
+} zfs_type_t;
+
+#define ZFS_TYPE_DATASET                                                       \
+    (zfs_type_t)(ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME | ZFS_TYPE_SNAPSHOT)
+
+typedef enum {
+    ZFS_PROP_TYPE,
+    ZFS_PROP_CREATION,
+    ZFS_PROP_ORIGIN,
+    ZFS_PROP_RECORDSIZE,
+    ZFS_PROP_MOUNTPOINT,
+    ZFS_PROP_CREATETXG,
+    ZFS_PROP_NAME
+} zfs_prop_t;
+
+typedef enum {
+    ZPROP_SRC_NONE = 0x1,
+    ZPROP_SRC_DEFAULT = 0x2,
+    ZPROP_SRC_TEMPORARY = 0x4,
+    ZPROP_SRC_LOCAL = 0x8,
+    ZPROP_SRC_INHERITED = 0x10,
+    ZPROP_SRC_RECEIVED = 0x20
+} zprop_source_t;
+
+typedef enum {
+    EZFS_SUCCESS = 0,
+    EZFS_NOMEM = 2000,
+    EZFS_BADPROP,
+    EZFS_PROPREADONLY,
+    EZFS_BADTYPE,
+    EZFS_BUSY,
+    EZFS_EXISTS,
+    EZFS_NOENT,
+    EZFS_INVALIDNAME,
+    EZFS_MOUNTFAILED,
+    EZFS_IO,
+    EZFS_NOTSUP,
+    EZFS_UNKNOWN
+} zfs_error_t;
+
+#define ZFS_MAXPROPLEN MAXPATHLEN
+#define ZFS_MAX_DATASET_NAME_LEN 256
+#define ZPROP_VALUE "value"
+#define ZPROP_SOURCE "source"
+
+typedef int (*zfs_iter_f)(zfs_handle_t *, void *);
+typedef boolean_t(snapfilter_cb_t)(zfs_handle_t *, void *);
+
+typedef struct sendflags {
+    boolean_t verbose;
+    boolean_t replicate;
+    boolean_t doall;
+    boolean_t fromorigin;
+    boolean_t dedup;
+    boolean_t props;
+    boolean_t dryrun;
+    boolean_t parsable;
+    boolean_t progress;
+    boolean_t largeblock;
+    boolean_t embed_data;
+    boolean_t compress;
+} sendflags_t;
+
+libzfs_handle_t *libzfs_init(void);
+void libzfs_fini(libzfs_handle_t *zfs);
+int libzfs_errno(libzfs_handle_t *zfs);
+const char *libzfs_error_action(libzfs_handle_t *zfs);
+const char *libzfs_error_description(libzfs_handle_t *zfs);
+
+zfs_handle_t *zfs_open(libzfs_handle_t *zfs, const char *name, int types);
+void zfs_close(zfs_handle_t *handle);
+const char *zfs_get_name(const zfs_handle_t *handle);
+zfs_type_t zfs_get_type(const zfs_handle_t *handle);
+libzfs_handle_t *zfs_get_handle(zfs_handle_t *handle);
+
+int zfs_prop_get(zfs_handle_t *handle, zfs_prop_t prop, char *buf,
+                 size_t len, zprop_source_t *source, char *statbuf,
+                 size_t statlen, boolean_t literal);
+uint64_t zfs_prop_get_int(zfs_handle_t *handle, zfs_prop_t prop);
+int zfs_prop_set(zfs_handle_t *handle, const char *name, const char *value);
+nvlist_t *zfs_get_user_props(zfs_handle_t *handle);
+
+int zfs_iter_root(libzfs_handle_t *zfs, zfs_iter_f func, void *data);
+int zfs_iter_children(zfs_handle_t *handle, zfs_iter_f func, void *data);
+int zfs_iter_filesystems(zfs_handle_t *handle, zfs_iter_f func, void *data);
+int zfs_iter_snapshots(zfs_handle_t *handle, boolean_t simple,
+                       zfs_iter_f func, void *data);
+
+int zfs_create(libzfs_handle_t *zfs, const char *name, zfs_type_t type,
+               nvlist_t *props);
+int zfs_destroy(zfs_handle_t *handle, boolean_t defer);
+int zfs_destroy_snaps(zfs_handle_t *handle, char *snapname, boolean_t defer);
+int zfs_clone(zfs_handle_t *handle, const char *target, nvlist_t *props);
+int zfs_snapshot(libzfs_handle_t *zfs, const char *path, boolean_t recursive,
+                 nvlist_t *props);
+int zfs_promote(zfs_handle_t *handle);
+int zfs_mount(zfs_handle_t *handle, const char *options, int flags);
+int zfs_unmount(zfs_handle_t *handle, const char *mountpoint, int flags);
+int zfs_send(zfs_handle_t *handle, const char *fromsnap, const char *tosnap,
+             sendflags_t *flags, int outfd, snapfilter_cb_t filter_func,
+             void *cb_arg, nvlist_t **debugnvp);
+
+int nvlist_alloc(nvlist_t **nvl, unsigned int flag, int kmflag);
+void nvlist_free(nvlist_t *nvl);
+int nvlist_add_string(nvlist_t *nvl, const char *name, const char *value);
+int nvlist_lookup_string(nvlist_t *nvl, const char *name, char **value);
+int nvlist_lookup_nvlist(nvlist_t *nvl, const char *name, nvlist_t **value);
+
+#ifdef __cplusplus
+}
+#endif
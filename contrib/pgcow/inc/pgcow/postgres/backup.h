@@ -0,0 +1,17 @@
+#pragma once
+
+#include <pgcow/postgres/extension.h>
+
+extern "C" {
+
+/**
+ * SQL function that takes an online backup of the cluster as a ZFS
+ * replication stream.
+ *
+ * The data directory's datasets are snapshotted recursively while the
+ * server is in backup mode. The backup directory receives the stream
+ * of that snapshot, the backup label, the WAL needed to make the
+ * snapshot consistent and a manifest describing the backup.
+ */
+PGDLLEXPORT Datum pgcow_backup(PG_FUNCTION_ARGS);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <pgcow/postgres/extension.h>
+
+extern "C" {
+
+/**
+ * Set-returning SQL function that lists the zfs dataset of every
+ * database and the snapshot it was cloned from.
+ *
+ * Backs the `pgcow_clone_lineage` view.
+ */
+PGDLLEXPORT Datum pgcow_clone_origins(PG_FUNCTION_ARGS);
+}
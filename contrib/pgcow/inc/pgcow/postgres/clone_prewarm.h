@@ -0,0 +1,27 @@
+#pragma once
+
+#include <pgcow/postgres/extension.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Defines the settings for prewarming clones and installs the
+ * transaction callback that starts the prewarm workers.
+ */
+void register_clone_prewarm();
+
+/**
+ * Prewarms a new database with the blocks its template had
+ * cached when the last autoprewarm dump was written.
+ *
+ * The prewarm worker is started once the current transaction
+ * commits, so that it can connect to the new database.
+ *
+ * \param template_database OID of the database that was cloned.
+ * \param clone_database    OID of the new database.
+ */
+void schedule_clone_prewarm(Oid template_database, Oid clone_database);
+
+} // namespace postgres
+} // namespace pgcow
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string>
 #include <tuple>
 #include <vector>
@@ -14,6 +16,8 @@ struct data_directory_paths {
     std::string tablespaces;
     std::string pid;
     std::string pgcow_version;
+    std::string auto_config;
+    std::string recovery_config;
 };
 
 /**
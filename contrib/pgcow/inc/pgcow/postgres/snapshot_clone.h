@@ -0,0 +1,161 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <pgcow/postgres/extension.h>
+#include <pgcow/zfs/dataset.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Oldest transaction and multixact IDs the files of a database can
+ * reference, as recorded in pg_database when the files were captured.
+ */
+struct snapshot_horizon {
+    /**
+     * Value of `datfrozenxid` of the database.
+     */
+    TransactionId frozen_xid;
+
+    /**
+     * Value of `datminmxid` of the database.
+     */
+    MultiXactId min_multi;
+};
+
+/**
+ * Defines the `pgcow.clone_snapshot` setting and installs the hook that
+ * lets CREATE DATABASE clone a snapshot of a template that is in use.
+ */
+void register_snapshot_clone();
+
+/**
+ * Gets the name of the snapshot CREATE DATABASE should clone the
+ * template from, as set by `pgcow.clone_snapshot`.
+ *
+ * \returns An empty string to snapshot the template's current state.
+ */
+std::string clone_snapshot_name();
+
+/**
+ * Gets the current horizon of a database from pg_database.
+ *
+ * Must be called inside a transaction. The horizon only ever advances,
+ * so reading it before taking a snapshot gives a horizon that is valid
+ * for the snapshot.
+ *
+ * \param database OID of the database.
+ */
+snapshot_horizon database_horizon(Oid database);
+
+/**
+ * Stores a horizon as user properties of a snapshot.
+ *
+ * \returns True if the properties were set.
+ */
+bool record_snapshot_horizon(const std::shared_ptr<zfs::dataset> &snapshot,
+                             const snapshot_horizon &horizon);
+
+/**
+ * Marks a snapshot as consistent by storing the redo location of the
+ * last checkpoint before it as a user property.
+ *
+ * Only snapshots taken after all of the database's changes were written
+ * out, while nothing could write to the database, are consistent. Any
+ * other snapshot can contain transactions that were only partially
+ * written.
+ *
+ * \returns True if the property was set.
+ */
+bool record_snapshot_checkpoint(const std::shared_ptr<zfs::dataset> &snapshot,
+                                XLogRecPtr redo);
+
+/**
+ * Reads the redo location stored by \see record_snapshot_checkpoint.
+ *
+ * \returns InvalidXLogRecPtr if the snapshot is not known to be
+ *          consistent.
+ */
+XLogRecPtr
+read_snapshot_checkpoint(const std::shared_ptr<zfs::dataset> &snapshot);
+
+/**
+ * Stores the WAL insert location as of which a snapshot contains every
+ * change to the database as a user property.
+ *
+ * The files in such a snapshot are what a crash at that point would
+ * have left behind, so WAL replayed from this location brings them up
+ * to date.
+ *
+ * \returns True if the property was set.
+ */
+bool record_snapshot_lsn(const std::shared_ptr<zfs::dataset> &snapshot,
+                         XLogRecPtr lsn);
+
+/**
+ * Reads the location stored by \see record_snapshot_lsn.
+ *
+ * \returns InvalidXLogRecPtr if the snapshot does not record one.
+ */
+XLogRecPtr read_snapshot_lsn(const std::shared_ptr<zfs::dataset> &snapshot);
+
+/**
+ * Reads the horizon stored in the user properties of a snapshot.
+ *
+ * \param snapshot Snapshot to read the horizon of.
+ * \param horizon  Receives the horizon.
+ *
+ * \returns False if the snapshot has no horizon, for example because
+ *          it was taken by an older version of pgcow or by hand.
+ */
+bool read_snapshot_horizon(const std::shared_ptr<zfs::dataset> &snapshot,
+                           snapshot_horizon &horizon);
+
+/**
+ * Checks that the transaction status of everything in a snapshot is
+ * still known, and arranges for the new database's pg_database row to
+ * carry the snapshot's horizon once CREATE DATABASE created it.
+ *
+ * Raises an error if the snapshot records neither that it is consistent,
+ * see \see record_snapshot_checkpoint, nor the WAL location it was
+ * flushed at, see \see record_snapshot_lsn, or if the commit log the
+ * snapshot depends on has already been truncated. Snapshots that are
+ * only flushed are cloned with a warning.
+ *
+ * \param database OID of the database being created.
+ * \param snapshot Snapshot the database is cloned from.
+ */
+void prepare_snapshot_clone(Oid database,
+                            const std::shared_ptr<zfs::dataset> &snapshot);
+
+/**
+ * Lowers the horizon of the database that was just cloned from an
+ * older snapshot, so that VACUUM does not truncate the commit log
+ * the database still depends on.
+ *
+ * Does nothing unless \see prepare_snapshot_clone was called by the
+ * current CREATE DATABASE.
+ */
+void finish_snapshot_clone();
+
+/**
+ * Forgets about a clone that \see prepare_snapshot_clone was called
+ * for, so that a failed CREATE DATABASE does not leak into the next.
+ */
+void reset_snapshot_clone();
+
+} // namespace postgres
+} // namespace pgcow
+
+extern "C" {
+
+/**
+ * Set-returning SQL function that lists the snapshots of the zfs
+ * datasets of all databases.
+ *
+ * Backs the `pgcow_database_snapshots` view.
+ */
+PGDLLEXPORT Datum pgcow_snapshots(PG_FUNCTION_ARGS);
+}
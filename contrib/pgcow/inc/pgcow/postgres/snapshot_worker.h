@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <pgcow/postgres/extension.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Prefix of the names of snapshots taken by the snapshot worker.
+ *
+ * Only snapshots with this prefix are subject to the retention policy,
+ * snapshots taken for clones (CREATE DATABASE) are left alone.
+ */
+static const std::string auto_snapshot_prefix = "auto-";
+
+/**
+ * A single entry from the `pgcow.snapshot_schedule` setting.
+ */
+struct snapshot_schedule_entry {
+    /**
+     * Name of the database to snapshot.
+     */
+    std::string database;
+
+    /**
+     * Number of seconds between two consecutive snapshots.
+     */
+    int interval;
+
+    /**
+     * Number of automatic snapshots to keep around.
+     */
+    int retention;
+
+    /**
+     * Whether to keep new connections out while the snapshot is taken,
+     * if nothing else uses the database at the time.
+     */
+    bool quiesce = false;
+};
+
+/**
+ * Parses the value of the `pgcow.snapshot_schedule` setting.
+ *
+ * The schedule is a comma separated list of `database:interval:retention`
+ * entries, for example "app:15min:96, reports:1h:24". An entry can end
+ * in `:quiesce` to ask for quiesced snapshots, see
+ * \see snapshot_schedule_entry::quiesce.
+ *
+ * \param value   Value of the setting to parse.
+ * \param entries Vector to append the parsed entries to.
+ * \param error   Receives a description of the problem if \paramref value
+ *                is not a valid schedule.
+ *
+ * \returns True if \paramref value is a valid schedule.
+ */
+bool parse_snapshot_schedule(const std::string &value,
+                             std::vector<snapshot_schedule_entry> &entries,
+                             std::string &error);
+
+/**
+ * Defines the settings of the snapshot worker and registers it
+ * with the postmaster.
+ *
+ * The worker is only registered when pgcow is loaded through
+ * `shared_preload_libraries`.
+ */
+void register_snapshot_worker();
+
+} // namespace postgres
+} // namespace pgcow
+
+extern "C" {
+
+/**
+ * Entrypoint of the snapshot background worker.
+ */
+PGDLLEXPORT void pgcow_snapshot_worker_main(Datum main_arg);
+}
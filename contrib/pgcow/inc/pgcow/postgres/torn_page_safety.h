@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+
+#include <pgcow/postgres/extension.h>
+#include <pgcow/zfs/dataset.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Defines the settings for skipping full-page images, reserves the
+ * shared memory that tracks which databases are stored on torn-page-safe
+ * datasets and installs the WAL hook that consults it.
+ *
+ * The datasets of the existing databases are verified when the
+ * shared memory is initialized.
+ */
+void register_torn_page_safety();
+
+/**
+ * Checks whether the dataset of a database rules out torn pages and
+ * if so, stops full-page images from being written for the database.
+ *
+ * \param database OID of the database stored in \paramref dataset.
+ * \param dataset  Dataset mounted as the database's directory.
+ */
+void verify_torn_page_safety(Oid database,
+                             const std::shared_ptr<zfs::dataset> &dataset);
+
+/**
+ * Resumes writing full-page images for a database, for example because
+ * its directory is about to be replaced.
+ *
+ * \param database OID of the database.
+ */
+void forget_torn_page_safety(Oid database);
+
+} // namespace postgres
+} // namespace pgcow
+
+extern "C" {
+
+/**
+ * SQL function that reports how many full-page images were skipped
+ * because the pages were stored on torn-page-safe datasets.
+ */
+PGDLLEXPORT Datum pgcow_full_page_image_stats(PG_FUNCTION_ARGS);
+}
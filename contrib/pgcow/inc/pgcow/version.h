@@ -1,3 +1,5 @@
+#pragma once
+
 namespace pgcow {
 static std::string version = "0.0.1~alpha1";
 }
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <memory>
 #include <vector>
 #include <string>
@@ -119,6 +121,155 @@ class dataset {
      */
     std::shared_ptr<dataset> clone(const std::string &name) const;
 
+    /**
+     * Creates a clone of this snapshot with the specified full name.
+     *
+     * \param clone_name The full name of the new, cloned dataset,
+     *                   including the names of its ancestors.
+     *
+     * \returns An instance of \see dataset, representing the newly
+     *          created clone. Nullptr if creation of the dataset
+     *          failed.
+     */
+    std::shared_ptr<dataset> clone_to(const std::string &clone_name) const;
+
+    /**
+     * Sets a property of this dataset.
+     *
+     * \param name  Name of the property, for example "mountpoint".
+     * \param value Value to set the property to.
+     *
+     * \returns True if the property was set.
+     */
+    bool set_property(const std::string &name,
+                      const std::string &value) const;
+
+    /**
+     * Gets the value of a user property of this dataset.
+     *
+     * User properties have a colon in their name, for example
+     * "pgcow:datfrozenxid". ZFS stores but does not interpret them.
+     *
+     * \param name Name of the user property.
+     *
+     * \returns An empty string if the property is not set.
+     */
+    std::string user_property(const std::string &name) const;
+
+    /**
+     * Mounts this file system at its mountpoint.
+     *
+     * \returns True if the file system was mounted.
+     */
+    bool mount() const;
+
+    /**
+     * Gets a list of all snapshots of this dataset.
+     */
+    std::vector<std::shared_ptr<dataset>> snapshots() const;
+
+    /**
+     * Gets a list of the direct child file systems of this dataset.
+     */
+    std::vector<std::shared_ptr<dataset>> children() const;
+
+    /**
+     * Gets the dataset this dataset belongs to.
+     *
+     * For a snapshot, this is the dataset the snapshot was taken of. For
+     * any other dataset, this is the dataset one level up in the hierarchy.
+     *
+     * \returns Nullptr if this is a root dataset or the parent cannot
+     *          be opened.
+     */
+    std::shared_ptr<dataset> parent() const;
+
+    /**
+     * Gets the name of the snapshot this dataset was cloned from.
+     *
+     * \returns An empty string if this dataset is not a clone.
+     */
+    std::string origin() const;
+
+    /**
+     * Gets the transaction group in which this dataset was created.
+     *
+     * Transaction groups only increase, this can be used to order
+     * snapshots by age.
+     */
+    uint64_t creation_txg() const;
+
+    /**
+     * Gets the time at which this dataset was created, as the number
+     * of seconds that elapsed since January 1st, 1970 (UTC).
+     */
+    uint64_t creation_time() const;
+
+    /**
+     * Gets whether this dataset is a file system, as opposed to a
+     * snapshot or volume.
+     */
+    bool is_filesystem() const;
+
+    /**
+     * Gets the size in bytes of the records files in this dataset
+     * are stored in.
+     *
+     * ZFS never writes part of a record in place, a write either
+     * replaces the whole record or not at all.
+     */
+    uint64_t record_size() const;
+
+    /**
+     * Promotes this clone so it no longer depends on its origin snapshot.
+     *
+     * The origin snapshot and all snapshots before it move from the
+     * origin dataset to this dataset, together with their other clones.
+     *
+     * \returns True if the clone was promoted.
+     */
+    bool promote() const;
+
+    /**
+     * Destroys this dataset or snapshot.
+     *
+     * File systems are unmounted first. The underlying handle stays
+     * open until this instance is freed, but it can no longer be used
+     * for anything.
+     *
+     * \returns True if the dataset was destroyed, false if ZFS refused
+     *          to destroy it (for example because a snapshot still
+     *          has dependent clones).
+     */
+    bool destroy() const;
+
+    /**
+     * Destroys the snapshot with the specified name of this dataset
+     * and of all of its descendants.
+     *
+     * \param name The name of the snapshots, without the dataset name.
+     *
+     * \returns True if the snapshots were destroyed.
+     */
+    bool destroy_snapshots(const std::string &name) const;
+
+    /**
+     * Writes a replication stream (`zfs send -R`) of this dataset up
+     * to the specified snapshot.
+     *
+     * The stream contains all descendant datasets and their snapshots.
+     * Clones whose origin is part of the stream are sent as increments
+     * on top of their origin, so receiving the stream recreates the
+     * clones without duplicating the data they share.
+     *
+     * \param snapshot_name The name of the snapshot to send, without
+     *                      the dataset name.
+     * \param fd            File descriptor to write the stream to.
+     *
+     * \returns True if the stream was written completely.
+     */
+    bool send(const std::string &snapshot_name, int fd) const;
+
   private:
     /**
      * Iterates over all datasets and appends them to \paramref datasets.
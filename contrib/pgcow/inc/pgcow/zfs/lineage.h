@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <pgcow/zfs/dataset.h>
+
+namespace pgcow {
+namespace zfs {
+
+/**
+ * Gets all clones of the specified snapshot.
+ *
+ * pgcow creates clones next to the dataset they were cloned from, so
+ * only the siblings of the snapshot's dataset are considered.
+ */
+std::vector<std::shared_ptr<dataset>>
+clones(const std::shared_ptr<dataset> &snapshot);
+
+/**
+ * Gets all clones of any of the snapshots of the specified dataset.
+ */
+std::vector<std::shared_ptr<dataset>>
+dependent_clones(const std::shared_ptr<dataset> &dataset);
+
+/**
+ * Destroys a dataset and its snapshots, even if other datasets
+ * were cloned from it.
+ *
+ * If the dataset has dependent clones, the clone of the newest snapshot
+ * is promoted first. ZFS then moves that snapshot, all older snapshots
+ * and the clones of those snapshots over to the promoted clone. This is
+ * a metadata-only operation, no data is copied. The snapshots that are
+ * left behind are newer than any clone's origin and can be destroyed.
+ *
+ * \returns True if the dataset was destroyed.
+ */
+bool destroy_promoting_clones(const std::shared_ptr<dataset> &dataset);
+
+} // namespace zfs
+} // namespace pgcow
@@ -0,0 +1,76 @@
+/* contrib/pgcow/pgcow--0.1.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION pgcow" to load this file. \quit
+
+-- Lists the zfs datasets of all databases and the snapshot each was cloned from
+CREATE FUNCTION pgcow_clone_origins(
+    OUT database oid,
+    OUT dataset text,
+    OUT origin text,
+    OUT origin_database oid
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgcow_clone_origins'
+LANGUAGE C STRICT VOLATILE;
+
+-- Which database every database was cloned from
+CREATE VIEW pgcow_clone_lineage AS
+    SELECT
+        o.database AS database_oid,
+        d.datname AS database,
+        o.origin_database AS template_oid,
+        t.datname AS template,
+        o.dataset,
+        o.origin
+    FROM pgcow_clone_origins() o
+    LEFT JOIN pg_catalog.pg_database d ON d.oid = o.database
+    LEFT JOIN pg_catalog.pg_database t ON t.oid = o.origin_database;
+
+-- Full-page images skipped because the pages were on torn-page-safe datasets
+CREATE FUNCTION pgcow_full_page_image_stats(
+    OUT skipped_images bigint,
+    OUT skipped_bytes bigint
+)
+RETURNS record
+AS 'MODULE_PATHNAME', 'pgcow_full_page_image_stats'
+LANGUAGE C STRICT VOLATILE;
+
+-- Takes an online backup as a zfs replication stream that preserves clones
+CREATE FUNCTION pgcow_backup(
+    directory text,
+    label text DEFAULT 'pgcow backup',
+    fast boolean DEFAULT false,
+    OUT start_lsn pg_lsn,
+    OUT stop_lsn pg_lsn,
+    OUT snapshot text
+)
+RETURNS record
+AS 'MODULE_PATHNAME', 'pgcow_backup'
+LANGUAGE C STRICT VOLATILE;
+
+REVOKE ALL ON FUNCTION pgcow_backup(text, text, boolean) FROM PUBLIC;
+
+-- Lists the snapshots of the zfs datasets of all databases
+CREATE FUNCTION pgcow_snapshots(
+    OUT database oid,
+    OUT snapshot text,
+    OUT created timestamptz,
+    OUT frozen_xid xid,
+    OUT lsn pg_lsn
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pgcow_snapshots'
+LANGUAGE C STRICT VOLATILE;
+
+-- Snapshots every database can be cloned from with pgcow.clone_snapshot
+CREATE VIEW pgcow_database_snapshots AS
+    SELECT
+        s.database AS database_oid,
+        d.datname AS database,
+        s.snapshot,
+        s.created,
+        s.frozen_xid,
+        s.lsn
+    FROM pgcow_snapshots() s
+    LEFT JOIN pg_catalog.pg_database d ON d.oid = s.database;
@@ -0,0 +1,311 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <cxxopts.hpp>
+#include <libzfs.h>
+#include <spdlog/spdlog.h>
+
+#include <pgcow/fs.h>
+#include <pgcow/postgres/data_directory.h>
+#include <pgcow/zfs/dataset.h>
+
+/**
+ * Gets the current time as the number of milliseconds that
+ * elapsed since January 1st, 1970 (UTC).
+ */
+static uint64_t current_time_ms() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Clones a snapshot of a dataset and all of its descendants.
+ *
+ * The clones mirror the hierarchy of the original datasets under
+ * \paramref clone_name. Descendants inherit their mountpoint from
+ * the top-most clone.
+ *
+ * \param zfs           ZFS Library handle.
+ * \param dataset       Dataset to clone.
+ * \param snapshot_name Name of the recursive snapshot to clone from,
+ *                      without the dataset name.
+ * \param clone_name    Full name of the clone of \paramref dataset.
+ * \param mountpoint    Where to mount the clone, empty to inherit
+ *                      the mountpoint.
+ *
+ * \returns True if all datasets were cloned and mounted.
+ */
+static bool clone_tree(libzfs_handle_t *zfs,
+                       std::shared_ptr<pgcow::zfs::dataset> dataset,
+                       const std::string &snapshot_name,
+                       const std::string &clone_name,
+                       const std::string &mountpoint) {
+    std::string full_snapshot_name = dataset->name() + "@" + snapshot_name;
+    auto snapshot = pgcow::zfs::dataset::by_name(zfs, full_snapshot_name);
+    if (!snapshot) {
+        spdlog::critical("cannot find zfs snapshot '{0}'", full_snapshot_name);
+        return false;
+    }
+
+    auto clone = snapshot->clone_to(clone_name);
+    if (!clone) {
+        spdlog::critical("failed to clone '{0}' into '{1}'",
+                         full_snapshot_name, clone_name);
+        return false;
+    }
+
+    if (!mountpoint.empty() && !clone->set_property("mountpoint", mountpoint)) {
+        spdlog::critical("failed to set mountpoint of '{0}' to '{1}'",
+                         clone_name, mountpoint);
+        return false;
+    }
+
+    if (!clone->mount()) {
+        spdlog::critical("failed to mount '{0}'", clone_name);
+        return false;
+    }
+
+    spdlog::debug("cloned '{0}' into '{1}', mounted at '{2}'",
+                  full_snapshot_name, clone_name, clone->mountpoint());
+
+    for (const auto &child : dataset->children()) {
+        std::string child_clone_name =
+            clone_name + "/" + pgcow::fs::path::leaf(child->name());
+        if (!clone_tree(zfs, child, snapshot_name, child_clone_name, "")) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Overrides settings in a postgresql.auto.conf file.
+ *
+ * Existing lines for the overridden settings are dropped, the new
+ * values are appended at the end.
+ *
+ * \returns True if the file was written.
+ */
+static bool
+override_settings(const std::string &path,
+                  const std::map<std::string, std::string> &settings) {
+    std::stringstream contents;
+
+    if (std::filesystem::exists(path)) {
+        std::ifstream input(path);
+        std::string line;
+        while (std::getline(input, line)) {
+            auto start = line.find_first_not_of(" \t");
+            std::string name;
+            if (start != std::string::npos) {
+                auto end = line.find_first_of(" \t=", start);
+                name = line.substr(start, end - start);
+            }
+
+            if (settings.count(name) == 0) {
+                contents << line << std::endl;
+            }
+        }
+    } else {
+        contents << "# Do not edit this file manually!" << std::endl
+                 << "# It will be overwritten by the ALTER SYSTEM command."
+                 << std::endl;
+    }
+
+    for (const auto &[name, value] : settings) {
+        contents << name << " = '" << value << "'" << std::endl;
+    }
+
+    std::ofstream output(path, std::ios::trunc);
+    output << contents.str();
+    output.close();
+    return !output.fail();
+}
+
+int main(int argc, char **argv) {
+    spdlog::set_level(spdlog::level::info);
+
+    cxxopts::Options options("pgcow-branch", "PGCow Branch\n");
+    options.positional_help("[zdataset] [branch]")
+        .show_positional_help()
+        .add_options()("zdataset",
+                       "Name of the ZFS dataset of the data directory to "
+                       "branch",
+                       cxxopts::value<std::string>())(
+            "branch", "Name of the ZFS dataset to create for the branch",
+            cxxopts::value<std::string>())(
+            "p,port", "Port the branch should listen on",
+            cxxopts::value<int>())(
+            "m,mountpoint",
+            "Where to mount the branch, inherited from the parent "
+            "dataset by default",
+            cxxopts::value<std::string>())(
+            "s,start", "Starts the branch once it is created")(
+            "b,bindir", "Directory containing pg_ctl",
+            cxxopts::value<std::string>())("h,help",
+                                           "Prints a list of options");
+
+    options.parse_positional({"zdataset", "branch"});
+
+    std::string dataset_name;
+    std::string branch_name;
+    std::string mountpoint;
+    std::string bindir;
+    int port = 0;
+    bool start = false;
+
+    try {
+        auto result = options.parse(argc, argv);
+        if (result.count("help") || result.arguments().size() == 0) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        if (!result.count("zdataset") || !result.count("branch") ||
+            !result.count("port")) {
+            std::cout << options.help() << std::endl;
+            return 1;
+        }
+
+        dataset_name = result["zdataset"].as<std::string>();
+        branch_name = result["branch"].as<std::string>();
+        port = result["port"].as<int>();
+        start = result.count("start") > 0;
+
+        if (result.count("mountpoint")) {
+            mountpoint = result["mountpoint"].as<std::string>();
+        }
+
+        if (result.count("bindir")) {
+            bindir = result["bindir"].as<std::string>();
+        }
+    } catch (const cxxopts::OptionException &err) {
+        std::cout << options.help() << std::endl;
+        return 1;
+    }
+
+    auto zfs = libzfs_init();
+    if (!zfs) {
+        spdlog::critical("could not initialize libzfs");
+        return 1;
+    }
+
+    auto dataset = pgcow::zfs::dataset::by_name(zfs, dataset_name);
+    if (!dataset) {
+        spdlog::critical("cannot find zfs dataset named '{0}'", dataset_name);
+        return 1;
+    }
+
+    auto data_directory =
+        pgcow::postgres::data_directory(dataset->mountpoint());
+    auto data_directory_paths = data_directory.paths();
+
+    if (!std::filesystem::exists(data_directory_paths.pgcow_version)) {
+        spdlog::critical("pgcow is not initialized in '{0}', run "
+                         "'pgcow-initdb {1}'",
+                         dataset->mountpoint(), dataset_name);
+        return 1;
+    }
+
+    // tablespaces live outside of the dataset and would be shared
+    if (data_directory.has_tablespaces()) {
+        spdlog::critical(
+            "'{0}' has custom tablespaces, these are not supported by pgcow",
+            dataset->mountpoint());
+        return 1;
+    }
+
+    // a recursive snapshot is atomic, all datasets of the data directory
+    // are captured at the same point, just like after a crash
+    std::string snapshot_name = "branch-" + std::to_string(current_time_ms());
+    if (!dataset->snapshot(snapshot_name)) {
+        spdlog::critical("failed to snapshot '{0}'", dataset_name);
+        return 1;
+    }
+
+    spdlog::info("snapshotted '{0}' as '{0}@{1}'", dataset_name,
+                 snapshot_name);
+
+    if (!clone_tree(zfs, dataset, snapshot_name, branch_name, mountpoint)) {
+        return 1;
+    }
+
+    auto branch = pgcow::zfs::dataset::by_name(zfs, branch_name);
+    if (!branch) {
+        spdlog::critical("cannot find zfs dataset named '{0}'", branch_name);
+        return 1;
+    }
+
+    auto branch_paths =
+        pgcow::postgres::data_directory(branch->mountpoint()).paths();
+
+    spdlog::info("cloned '{0}' into '{1}', mounted at '{2}'", dataset_name,
+                 branch_name, branch->mountpoint());
+
+    // the lock file names the original postmaster, which is still running
+    std::error_code error;
+    std::filesystem::remove(branch_paths.pid, error);
+    if (error) {
+        spdlog::critical("failed to remove '{0}', error {1}", branch_paths.pid,
+                         error.message());
+        return 1;
+    }
+
+    // the branch is a new primary, not a copy of the original's standby
+    if (std::filesystem::exists(branch_paths.recovery_config)) {
+        std::string recovery_done =
+            pgcow::fs::path::join(branch->mountpoint(), "recovery.done");
+        std::filesystem::rename(branch_paths.recovery_config, recovery_done,
+                                error);
+        if (error) {
+            spdlog::critical("failed to rename '{0}' to '{1}', error {2}",
+                             branch_paths.recovery_config, recovery_done,
+                             error.message());
+            return 1;
+        }
+    }
+
+    // don't archive into the original's archive or wait for its standbys
+    std::map<std::string, std::string> settings = {
+        {"port", std::to_string(port)},
+        {"archive_mode", "off"},
+        {"synchronous_standby_names", ""},
+    };
+
+    if (!override_settings(branch_paths.auto_config, settings)) {
+        spdlog::critical("failed to write '{0}'", branch_paths.auto_config);
+        return 1;
+    }
+
+    spdlog::info("branch '{0}' will listen on port {1}", branch_name, port);
+
+    std::string pg_ctl =
+        bindir.empty() ? "pg_ctl" : pgcow::fs::path::join(bindir, "pg_ctl");
+    std::string log_file =
+        pgcow::fs::path::join(branch->mountpoint(), "branch.log");
+    std::string start_command = "'" + pg_ctl + "' start -w -D '" +
+                                branch->mountpoint() + "' -l '" + log_file +
+                                "'";
+
+    if (!start) {
+        spdlog::info("start the branch with: {0}", start_command);
+        return 0;
+    }
+
+    // the branch goes through crash recovery from the snapshot
+    spdlog::info("starting branch: {0}", start_command);
+    if (std::system(start_command.c_str()) != 0) {
+        spdlog::critical("failed to start branch, see '{0}'", log_file);
+        return 1;
+    }
+
+    spdlog::info("branch '{0}' of '{1}' is running on port {2}", branch_name,
+                 dataset_name, port);
+    return 0;
+}
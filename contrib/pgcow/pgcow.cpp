@@ -1,9 +1,16 @@
 #include <chrono>
+#include <cstdlib>
 #include <filesystem>
 
 #include <pgcow/fs.h>
 #include <pgcow/zfs/dataset.h>
+#include <pgcow/zfs/lineage.h>
+#include <pgcow/postgres/clone_lineage.h>
+#include <pgcow/postgres/clone_prewarm.h>
 #include <pgcow/postgres/extension.h>
+#include <pgcow/postgres/snapshot_clone.h>
+#include <pgcow/postgres/snapshot_worker.h>
+#include <pgcow/postgres/torn_page_safety.h>
 
 extern "C" {
 
@@ -18,6 +25,11 @@ PG_MODULE_MAGIC;
  */
 static copydir_hook_type next_copydir_hook = NULL;
 
+/**
+ * Next hooked ProcessUtility to invoke.
+ */
+static ProcessUtility_hook_type next_process_utility_hook = NULL;
+
 /**
  * Gets the current time as the number of milliseconds that
  * elapsed since January 1st, 1970 (UTC).
@@ -45,12 +57,39 @@ static void intercept_copydir(char *fromdir, char *todir, bool recurse) {
         return;
     }
 
+    // database directories are named after the database's oid
+    std::string clone_name = pgcow::fs::path::leaf(todir);
+    Oid clone_database = (Oid)std::strtoul(clone_name.c_str(), nullptr, 10);
+
+    // whatever was stored under this oid before is being replaced
+    if (OidIsValid(clone_database)) {
+        pgcow::postgres::forget_torn_page_safety(clone_database);
+    }
+
     // paths passed to copydir() are relative to the current dir, make absolute
     std::string cwd = std::filesystem::current_path().u8string();
     std::string from_path = pgcow::fs::path::join(cwd, std::string(fromdir));
 
+    Oid template_database = (Oid)std::strtoul(
+        pgcow::fs::path::leaf(fromdir).c_str(), nullptr, 10);
+
+    // ALTER DATABASE .. SET TABLESPACE copies a database onto itself
+    std::string snapshot_name;
+    if (template_database != clone_database) {
+        snapshot_name = pgcow::postgres::clone_snapshot_name();
+    }
+
     // if `fromdir` is not a zfs dataset, do nothing and proceed normally
     auto dataset = pgcow::zfs::dataset::by_mountpoint(zfs, from_path);
+    if (!dataset && !snapshot_name.empty()) {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("cannot clone snapshot \"%s\" of \"%s\"",
+                        snapshot_name.c_str(), fromdir),
+                 errdetail("\"%s\" is not a zfs dataset.", fromdir)));
+        return;
+    }
+
     if (!dataset) {
         ereport(DEBUG4,
                 (errmsg_internal("\"%s\" is not a zfs dataset", fromdir)));
@@ -58,22 +97,48 @@ static void intercept_copydir(char *fromdir, char *todir, bool recurse) {
         return;
     }
 
-    // create a snapshot of the dataset
     ereport(DEBUG4, (errmsg_internal("found zfs dataset \"%s\" for \"%s\"",
                                      dataset->name().c_str(), fromdir)));
-    auto snapshot = dataset->snapshot(std::to_string(current_time_ms()));
-    if (!snapshot) {
-        ereport(ERROR,
-                (errcode_for_file_access(),
-                 errmsg("cannot create zfs snapshot of \"%s\"", fromdir)));
-        return;
-    }
 
-    ereport(DEBUG4, (errmsg_internal("created zfs snapshot \"%s\"",
-                                     snapshot->name().c_str())));
+    std::shared_ptr<pgcow::zfs::dataset> snapshot;
+    if (!snapshot_name.empty()) {
+        // clone an existing snapshot, the template is left alone
+        std::string full_snapshot_name = dataset->name() + "@" + snapshot_name;
+        snapshot = pgcow::zfs::dataset::by_name(zfs, full_snapshot_name);
+        if (!snapshot) {
+            ereport(ERROR,
+                    (errcode(ERRCODE_UNDEFINED_OBJECT),
+                     errmsg("zfs snapshot \"%s\" does not exist",
+                            full_snapshot_name.c_str()),
+                     errhint("The pgcow_database_snapshots view lists the "
+                             "snapshots of every database.")));
+            return;
+        }
+
+        pgcow::postgres::prepare_snapshot_clone(clone_database, snapshot);
+    } else {
+        // create a snapshot of the dataset
+        auto horizon = pgcow::postgres::database_horizon(template_database);
+        snapshot = dataset->snapshot(std::to_string(current_time_ms()));
+        if (!snapshot) {
+            ereport(ERROR,
+                    (errcode_for_file_access(),
+                     errmsg("cannot create zfs snapshot of \"%s\"", fromdir)));
+            return;
+        }
+
+        ereport(DEBUG4, (errmsg_internal("created zfs snapshot \"%s\"",
+                                         snapshot->name().c_str())));
+
+        // lets later clones of this snapshot know what it depends on;
+        // CREATE DATABASE checkpointed and made sure nobody uses the
+        // template, so the snapshot is consistent
+        pgcow::postgres::record_snapshot_horizon(snapshot, horizon);
+        pgcow::postgres::record_snapshot_checkpoint(snapshot,
+                                                    GetRedoRecPtr());
+    }
 
     // clone the snapshot into the target dir
-    std::string clone_name = pgcow::fs::path::leaf(todir);
     auto clone = snapshot->clone(clone_name);
     if (!clone) {
         ereport(ERROR, (errcode_for_file_access(),
@@ -85,6 +150,17 @@ static void intercept_copydir(char *fromdir, char *todir, bool recurse) {
     ereport(DEBUG4, (errmsg_internal("created zfs clone \"%s\"",
                                      clone->name().c_str())));
 
+    if (OidIsValid(clone_database)) {
+        pgcow::postgres::verify_torn_page_safety(clone_database, clone);
+    }
+
+    // the template's cache reflects its current state, not the snapshot
+    if (OidIsValid(template_database) && OidIsValid(clone_database) &&
+        template_database != clone_database && snapshot_name.empty()) {
+        pgcow::postgres::schedule_clone_prewarm(template_database,
+                                                clone_database);
+    }
+
     // if some other plugin hooked copydir(), call that one
     if (next_copydir_hook) {
         ereport(DEBUG4, (errmsg_internal("pgcow handing off to next hook")));
@@ -94,6 +170,114 @@ static void intercept_copydir(char *fromdir, char *todir, bool recurse) {
     }
 }
 
+/**
+ * Destroys the zfs dataset of a database that was just dropped.
+ *
+ * Clones of the database's snapshots are kept alive by promoting one of
+ * them, which takes over the snapshots and the other clones. The snapshot
+ * the dropped database itself was cloned from is destroyed as well if
+ * nothing else depends on it, so its space is reclaimed.
+ */
+static void release_database_dataset(Oid database_oid) {
+    pgcow::postgres::forget_torn_page_safety(database_oid);
+
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        ereport(WARNING,
+                (errcode_for_file_access(), errmsg("cannot init libzfs")));
+        return;
+    }
+
+    std::string database_path = pgcow::fs::path::join(
+        pgcow::fs::path::join(DataDir, "base"), std::to_string(database_oid));
+
+    auto dataset = pgcow::zfs::dataset::by_mountpoint(zfs, database_path);
+    if (!dataset) {
+        ereport(DEBUG4, (errmsg_internal("\"%s\" is not a zfs dataset",
+                                         database_path.c_str())));
+        libzfs_fini(zfs);
+        return;
+    }
+
+    std::string dataset_name = dataset->name();
+    std::string origin = dataset->origin();
+
+    if (!pgcow::zfs::destroy_promoting_clones(dataset)) {
+        ereport(WARNING, (errmsg("cannot destroy zfs dataset \"%s\" of "
+                                 "dropped database",
+                                 dataset_name.c_str())));
+        libzfs_fini(zfs);
+        return;
+    }
+
+    ereport(DEBUG4, (errmsg_internal("destroyed zfs dataset \"%s\"",
+                                     dataset_name.c_str())));
+
+    // the database directory stayed behind as the (now empty) mountpoint
+    std::error_code _;
+    std::filesystem::remove(database_path, _);
+
+    // automatic snapshots are left to the retention policy
+    std::string origin_snapshot_name = origin.substr(origin.find("@") + 1);
+    if (!origin.empty() &&
+        origin_snapshot_name.compare(
+            0, pgcow::postgres::auto_snapshot_prefix.size(),
+            pgcow::postgres::auto_snapshot_prefix) != 0) {
+        auto origin_snapshot = pgcow::zfs::dataset::by_name(zfs, origin);
+        if (origin_snapshot && pgcow::zfs::clones(origin_snapshot).empty() &&
+            origin_snapshot->destroy()) {
+            ereport(DEBUG4, (errmsg_internal("destroyed zfs snapshot \"%s\"",
+                                             origin.c_str())));
+        }
+    }
+
+    libzfs_fini(zfs);
+}
+
+/**
+ * Hooked ProcessUtility function.
+ *
+ * pgcow needs to know when a database is dropped so that it can
+ * destroy the database's zfs dataset, and when a database was cloned
+ * from an older snapshot so that it can correct its horizon.
+ */
+static void intercept_process_utility(PlannedStmt *pstmt,
+                                      const char *query_string,
+                                      ProcessUtilityContext context,
+                                      ParamListInfo params,
+                                      QueryEnvironment *query_env,
+                                      DestReceiver *dest,
+                                      char *completion_tag) {
+    Node *parsetree = pstmt->utilityStmt;
+    Oid dropped_database = InvalidOid;
+
+    // look up the database before it's gone
+    if (IsA(parsetree, DropdbStmt)) {
+        DropdbStmt *stmt = (DropdbStmt *)parsetree;
+        dropped_database = get_database_oid(stmt->dbname, true);
+    }
+
+    if (IsA(parsetree, CreatedbStmt)) {
+        pgcow::postgres::reset_snapshot_clone();
+    }
+
+    if (next_process_utility_hook) {
+        (*next_process_utility_hook)(pstmt, query_string, context, params,
+                                     query_env, dest, completion_tag);
+    } else {
+        standard_ProcessUtility(pstmt, query_string, context, params,
+                                query_env, dest, completion_tag);
+    }
+
+    if (IsA(parsetree, CreatedbStmt)) {
+        pgcow::postgres::finish_snapshot_clone();
+    }
+
+    if (OidIsValid(dropped_database)) {
+        release_database_dataset(dropped_database);
+    }
+}
+
 void _PG_init(void);
 
 /**
@@ -102,5 +286,13 @@ void _PG_init(void);
 void _PG_init(void) {
     next_copydir_hook = copydir_hook;
     copydir_hook = intercept_copydir;
+
+    next_process_utility_hook = ProcessUtility_hook;
+    ProcessUtility_hook = intercept_process_utility;
+
+    pgcow::postgres::register_snapshot_worker();
+    pgcow::postgres::register_clone_prewarm();
+    pgcow::postgres::register_torn_page_safety();
+    pgcow::postgres::register_snapshot_clone();
 }
 }
@@ -0,0 +1,360 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <pgcow/postgres/backup.h>
+#include <pgcow/postgres/extension.h>
+#include <pgcow/version.h>
+#include <pgcow/zfs/dataset.h>
+
+extern "C" {
+
+PG_FUNCTION_INFO_V1(pgcow_backup);
+
+/**
+ * Prefix of the names of the snapshots backups are sent from.
+ */
+static const std::string backup_snapshot_prefix = "backup-";
+
+/**
+ * Name of the file in the backup directory the replication stream
+ * is written to.
+ */
+static const std::string backup_stream_file = "base.zfs";
+
+/**
+ * Name of the file in the backup directory that describes the backup.
+ */
+static const std::string backup_manifest_file = "backup_manifest";
+
+/**
+ * Gets the current time as the number of milliseconds that
+ * elapsed since January 1st, 1970 (UTC).
+ */
+static uint64_t current_time_ms() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * ZFS state of a backup that is being taken.
+ *
+ * ereport(ERROR) longjmps past C++ destructors, so the objects that
+ * need them live on the heap and are released explicitly, both when
+ * the backup succeeds and from the error cleanup callback.
+ */
+struct backup_state {
+    /**
+     * libzfs handle, must outlive `dataset`.
+     */
+    libzfs_handle_t *zfs = nullptr;
+
+    /**
+     * Dataset of the data directory.
+     */
+    std::shared_ptr<pgcow::zfs::dataset> dataset;
+
+    /**
+     * Name of the snapshot the backup is sent from, without the
+     * dataset name.
+     */
+    std::string snapshot_name;
+
+    /**
+     * Whether the snapshot was taken and must be destroyed.
+     */
+    bool snapshot_taken = false;
+};
+
+/**
+ * Destroys the backup's snapshot if it was taken and releases the
+ * ZFS state.
+ */
+static void release_backup_state(backup_state *state) {
+    if (state->snapshot_taken &&
+        !state->dataset->destroy_snapshots(state->snapshot_name)) {
+        ereport(WARNING, (errmsg("cannot destroy zfs snapshot \"%s@%s\"",
+                                 state->dataset->name().c_str(),
+                                 state->snapshot_name.c_str())));
+    }
+
+    state->dataset.reset();
+    libzfs_fini(state->zfs);
+    delete state;
+}
+
+/**
+ * Releases the ZFS state if taking the backup fails.
+ */
+static void backup_state_cleanup(int code, Datum arg) {
+    release_backup_state((backup_state *)DatumGetPointer(arg));
+}
+
+/**
+ * Takes the server out of backup mode if taking the backup fails.
+ */
+static void backup_cleanup(int code, Datum arg) { do_pg_abort_backup(); }
+
+/**
+ * Writes a file to the backup directory and flushes it to disk.
+ */
+static void write_backup_file(const char *path, const char *data,
+                              size_t length) {
+    FILE *file = AllocateFile(path, PG_BINARY_W);
+    if (!file) {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not create file \"%s\": %m", path)));
+    }
+
+    if ((length > 0 && fwrite(data, length, 1, file) != 1) ||
+        fflush(file) != 0 || pg_fsync(fileno(file)) != 0 || ferror(file)) {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not write file \"%s\": %m", path)));
+    }
+
+    if (FreeFile(file)) {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not close file \"%s\": %m", path)));
+    }
+}
+
+/**
+ * Copies the WAL segments between the start and stop of the backup
+ * into the backup directory.
+ *
+ * The snapshot only contains the WAL written before it was taken,
+ * recovery needs the WAL up to the end of the backup to reach a
+ * consistent state.
+ *
+ * \returns The number of segments that were copied.
+ */
+static int copy_wal_segments(const char *backup_wal_path, XLogRecPtr start_lsn,
+                             XLogRecPtr stop_lsn, TimeLineID timeline) {
+    XLogSegNo start_segment;
+    XLogSegNo stop_segment;
+    char first_file[MAXFNAMELEN];
+    char last_file[MAXFNAMELEN];
+    char wal_path[MAXPGPATH];
+    char from[MAXPGPATH];
+    char to[MAXPGPATH];
+    int segments = 0;
+
+    // like pg_basebackup, compare without the timeline
+    XLByteToSeg(start_lsn, start_segment, wal_segment_size);
+    XLogFileName(first_file, timeline, start_segment, wal_segment_size);
+    XLByteToPrevSeg(stop_lsn, stop_segment, wal_segment_size);
+    XLogFileName(last_file, timeline, stop_segment, wal_segment_size);
+
+    if (MakePGDirectory(backup_wal_path) != 0) {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not create directory \"%s\": %m",
+                        backup_wal_path)));
+    }
+
+    snprintf(wal_path, sizeof(wal_path), "%s/%s", DataDir, XLOGDIR);
+
+    DIR *dir = AllocateDir(wal_path);
+    struct dirent *entry;
+    while ((entry = ReadDir(dir, wal_path)) != NULL) {
+        if (!IsXLogFileName(entry->d_name) ||
+            strcmp(entry->d_name + 8, first_file + 8) < 0 ||
+            strcmp(entry->d_name + 8, last_file + 8) > 0) {
+            continue;
+        }
+
+        snprintf(from, sizeof(from), "%s/%s", wal_path, entry->d_name);
+        snprintf(to, sizeof(to), "%s/%s", backup_wal_path, entry->d_name);
+        copy_file(from, to);
+        segments++;
+    }
+    FreeDir(dir);
+
+    if ((XLogSegNo)segments != stop_segment - start_segment + 1) {
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("could not find all WAL segments between %s and %s",
+                        first_file, last_file),
+                 errhint("Increase wal_keep_segments so that the segments "
+                         "are not removed while the backup is taken.")));
+    }
+
+    return segments;
+}
+
+/**
+ * Writes the replication stream of the backup's snapshot and the files
+ * describing it to the backup directory.
+ *
+ * \returns The number of WAL segments that were copied.
+ */
+static int write_backup(backup_state *state, const char *directory,
+                        const char *label_file, XLogRecPtr start_lsn,
+                        XLogRecPtr stop_lsn, TimeLineID stop_timeline) {
+    char path[MAXPGPATH];
+
+    snprintf(path, sizeof(path), "%s/%s", directory, BACKUP_LABEL_FILE);
+    write_backup_file(path, label_file, strlen(label_file));
+
+    snprintf(path, sizeof(path), "%s/%s", directory, XLOGDIR);
+    int segments = copy_wal_segments(path, start_lsn, stop_lsn, stop_timeline);
+
+    snprintf(path, sizeof(path), "%s/%s", directory,
+             backup_stream_file.c_str());
+    int fd = OpenTransientFile(path, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY);
+    if (fd < 0) {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not create file \"%s\": %m", path)));
+    }
+
+    if (!state->dataset->send(state->snapshot_name, fd)) {
+        char *dataset_name = pstrdup(state->dataset->name().c_str());
+        ereport(ERROR, (errcode_for_file_access(),
+                        errmsg("cannot send zfs snapshot \"%s@%s\"",
+                               dataset_name, state->snapshot_name.c_str())));
+    }
+
+    if (pg_fsync(fd) != 0) {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not fsync file \"%s\": %m", path)));
+    }
+
+    CloseTransientFile(fd);
+
+    return segments;
+}
+
+Datum pgcow_backup(PG_FUNCTION_ARGS) {
+    char *directory = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    char *label = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    bool fast = PG_GETARG_BOOL(2);
+    TupleDesc tupdesc;
+    Datum values[3];
+    bool nulls[3] = {false, false, false};
+
+    if (!superuser()) {
+        ereport(ERROR, (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                        errmsg("must be superuser to take a pgcow backup")));
+    }
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE) {
+        elog(ERROR, "return type must be a row type");
+    }
+
+    if (!is_absolute_path(directory)) {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("backup directory must be an absolute path")));
+    }
+
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        ereport(ERROR,
+                (errcode_for_file_access(), errmsg("cannot init libzfs")));
+    }
+
+    backup_state *state = new backup_state;
+    state->zfs = zfs;
+    state->dataset = pgcow::zfs::dataset::by_mountpoint(zfs, DataDir);
+    state->snapshot_name =
+        backup_snapshot_prefix + std::to_string(current_time_ms());
+
+    StringInfo label_file = makeStringInfo();
+    StringInfo tablespace_map_file = makeStringInfo();
+    char *dataset_name = NULL;
+    char *snapshot_name = pstrdup(state->snapshot_name.c_str());
+    TimeLineID start_timeline;
+    TimeLineID stop_timeline;
+    XLogRecPtr start_lsn;
+    XLogRecPtr stop_lsn;
+    int segments;
+
+    // from here on an error must release the ZFS state, including the
+    // snapshot once it is taken
+    PG_ENSURE_ERROR_CLEANUP(backup_state_cleanup, PointerGetDatum(state));
+    {
+        if (!state->dataset) {
+            ereport(ERROR,
+                    (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                     errmsg("data directory \"%s\" is not a zfs dataset",
+                            DataDir)));
+        }
+        dataset_name = pstrdup(state->dataset->name().c_str());
+
+        if (MakePGDirectory(directory) != 0) {
+            ereport(ERROR,
+                    (errcode_for_file_access(),
+                     errmsg("could not create directory \"%s\": %m",
+                            directory)));
+        }
+
+        start_lsn =
+            do_pg_start_backup(label, fast, &start_timeline, label_file, NULL,
+                               tablespace_map_file, false, false);
+
+        // all functionality between starting and stopping the backup must
+        // be inside the error cleanup block, see perform_base_backup()
+        PG_ENSURE_ERROR_CLEANUP(backup_cleanup, (Datum)0);
+        {
+            if (tablespace_map_file->len > 0) {
+                ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                                errmsg("custom tablespaces are not supported "
+                                       "by pgcow")));
+            }
+
+            // the snapshot is atomic across all datasets of the cluster
+            if (!state->dataset->snapshot(state->snapshot_name)) {
+                ereport(ERROR, (errcode_for_file_access(),
+                                errmsg("cannot create zfs snapshot of \"%s\"",
+                                       DataDir)));
+            }
+            state->snapshot_taken = true;
+
+            stop_lsn =
+                do_pg_stop_backup(label_file->data, false, &stop_timeline);
+        }
+        PG_END_ENSURE_ERROR_CLEANUP(backup_cleanup, (Datum)0);
+
+        segments = write_backup(state, directory, label_file->data, start_lsn,
+                                stop_lsn, stop_timeline);
+    }
+    PG_END_ENSURE_ERROR_CLEANUP(backup_state_cleanup, PointerGetDatum(state));
+
+    // the stream has everything, don't keep the snapshot's blocks around
+    release_backup_state(state);
+
+    StringInfoData manifest;
+    initStringInfo(&manifest);
+    appendStringInfo(&manifest, "PGCOW VERSION: %s\n",
+                     pgcow::version.c_str());
+    appendStringInfo(&manifest, "LABEL: %s\n", label);
+    appendStringInfo(&manifest, "DATASET: %s\n", dataset_name);
+    appendStringInfo(&manifest, "SNAPSHOT: %s\n", snapshot_name);
+    appendStringInfo(&manifest, "STREAM: %s\n", backup_stream_file.c_str());
+    appendStringInfo(&manifest, "START WAL LOCATION: %X/%X\n",
+                     (uint32)(start_lsn >> 32), (uint32)start_lsn);
+    appendStringInfo(&manifest, "STOP WAL LOCATION: %X/%X\n",
+                     (uint32)(stop_lsn >> 32), (uint32)stop_lsn);
+    appendStringInfo(&manifest, "START TIMELINE: %u\n", start_timeline);
+    appendStringInfo(&manifest, "STOP TIMELINE: %u\n", stop_timeline);
+    appendStringInfo(&manifest, "WAL SEGMENTS: %d\n", segments);
+
+    char path[MAXPGPATH];
+    snprintf(path, sizeof(path), "%s/%s", directory,
+             backup_manifest_file.c_str());
+    write_backup_file(path, manifest.data, manifest.len);
+
+    values[0] = LSNGetDatum(start_lsn);
+    values[1] = LSNGetDatum(stop_lsn);
+    values[2] = CStringGetTextDatum(psprintf("%s@%s", dataset_name,
+                                             snapshot_name));
+
+    PG_RETURN_DATUM(
+        HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+}
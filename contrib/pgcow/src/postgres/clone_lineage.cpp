@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <string>
+
+#include <pgcow/fs.h>
+#include <pgcow/postgres/clone_lineage.h>
+#include <pgcow/postgres/extension.h>
+#include <pgcow/zfs/dataset.h>
+
+extern "C" {
+
+PG_FUNCTION_INFO_V1(pgcow_clone_origins);
+
+/**
+ * Parses a dataset name's last segment as a database OID.
+ *
+ * \returns InvalidOid if the dataset is not named after an OID.
+ */
+static Oid dataset_database_oid(const std::string &dataset_name) {
+    std::string leaf = pgcow::fs::path::leaf(dataset_name);
+
+    char *end = nullptr;
+    unsigned long oid = std::strtoul(leaf.c_str(), &end, 10);
+    if (leaf.empty() || *end != '\0') {
+        return InvalidOid;
+    }
+
+    return (Oid)oid;
+}
+
+Datum pgcow_clone_origins(PG_FUNCTION_ARGS) {
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *)fcinfo->resultinfo;
+    TupleDesc tupdesc;
+    Tuplestorestate *tupstore;
+    MemoryContext per_query_ctx;
+    MemoryContext oldcontext;
+
+    if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo)) {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("set-valued function called in context that cannot "
+                        "accept a set")));
+    }
+
+    if (!(rsinfo->allowedModes & SFRM_Materialize)) {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("materialize mode required, but it is not allowed "
+                        "in this context")));
+    }
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE) {
+        elog(ERROR, "return type must be a row type");
+    }
+
+    per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+    oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+    tupstore = tuplestore_begin_heap(true, false, work_mem);
+    rsinfo->returnMode = SFRM_Materialize;
+    rsinfo->setResult = tupstore;
+    rsinfo->setDesc = tupdesc;
+
+    MemoryContextSwitchTo(oldcontext);
+
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        ereport(ERROR,
+                (errcode_for_file_access(), errmsg("cannot init libzfs")));
+    }
+
+    {
+        std::string databases_path = pgcow::fs::path::join(DataDir, "base");
+
+        // if the databases directory is not a dataset, nothing was cloned
+        auto databases_dataset =
+            pgcow::zfs::dataset::by_mountpoint(zfs, databases_path);
+        if (databases_dataset) {
+            std::string databases_dataset_name = databases_dataset->name();
+
+            for (const auto &dataset : databases_dataset->children()) {
+                std::string dataset_name = dataset->name();
+
+                Oid database = dataset_database_oid(dataset_name);
+                if (!OidIsValid(database)) {
+                    continue;
+                }
+
+                Datum values[4];
+                bool nulls[4];
+                memset(nulls, 0, sizeof(nulls));
+
+                values[0] = ObjectIdGetDatum(database);
+                values[1] = CStringGetTextDatum(dataset_name.c_str());
+
+                std::string origin = dataset->origin();
+                if (origin.empty()) {
+                    nulls[2] = true;
+                    nulls[3] = true;
+                } else {
+                    values[2] = CStringGetTextDatum(origin.c_str());
+
+                    // only clones of sibling datasets are databases
+                    std::string origin_dataset =
+                        origin.substr(0, origin.find("@"));
+                    Oid origin_database = InvalidOid;
+
+                    if (origin_dataset.compare(
+                            0, databases_dataset_name.size() + 1,
+                            databases_dataset_name + "/") == 0) {
+                        origin_database = dataset_database_oid(origin_dataset);
+                    }
+
+                    if (OidIsValid(origin_database)) {
+                        values[3] = ObjectIdGetDatum(origin_database);
+                    } else {
+                        nulls[3] = true;
+                    }
+                }
+
+                tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+            }
+        }
+    }
+
+    libzfs_fini(zfs);
+
+    tuplestore_donestoring(tupstore);
+
+    return (Datum)0;
+}
+}
@@ -0,0 +1,112 @@
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include <pgcow/fs.h>
+#include <pgcow/postgres/clone_prewarm.h>
+#include <pgcow/postgres/extension.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Name of the file pg_prewarm's autoprewarm worker dumps
+ * the contents of shared_buffers to, in the data directory.
+ */
+static const std::string autoprewarm_file = "autoprewarm.blocks";
+
+/**
+ * Value of the `pgcow.prewarm_clones` setting.
+ */
+static bool prewarm_clones = true;
+
+/**
+ * Template and clone database OIDs created in the current transaction.
+ */
+static std::vector<std::pair<Oid, Oid>> pending_prewarms;
+
+/**
+ * Starts pg_prewarm's clone worker for the specified databases.
+ */
+static void start_prewarm_worker(Oid template_database, Oid clone_database) {
+    BackgroundWorker worker;
+    memset(&worker, 0, sizeof(worker));
+    worker.bgw_flags =
+        BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+    worker.bgw_start_time = BgWorkerStart_ConsistentState;
+    worker.bgw_restart_time = BGW_NEVER_RESTART;
+    snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_prewarm");
+    snprintf(worker.bgw_function_name, BGW_MAXLEN, "autoprewarm_clone_main");
+    snprintf(worker.bgw_name, BGW_MAXLEN, "autoprewarm clone worker");
+    snprintf(worker.bgw_type, BGW_MAXLEN, "autoprewarm clone worker");
+    memcpy(worker.bgw_extra, &template_database, sizeof(Oid));
+    memcpy(worker.bgw_extra + sizeof(Oid), &clone_database, sizeof(Oid));
+
+    // not being able to prewarm is no reason to fail, and this
+    // runs after commit where we can't throw errors anyway
+    if (!RegisterDynamicBackgroundWorker(&worker, NULL)) {
+        ereport(LOG, (errmsg("pgcow: could not start prewarm worker for "
+                             "database %u",
+                             clone_database),
+                      errhint("You may need to increase "
+                              "max_worker_processes.")));
+    }
+}
+
+/**
+ * Starts the scheduled prewarm workers when the transaction that
+ * created the databases commits.
+ */
+static void prewarm_xact_callback(XactEvent event, void *arg) {
+    switch (event) {
+    case XACT_EVENT_COMMIT:
+        for (const auto &pending : pending_prewarms) {
+            start_prewarm_worker(pending.first, pending.second);
+        }
+        pending_prewarms.clear();
+        break;
+
+    case XACT_EVENT_ABORT:
+        pending_prewarms.clear();
+        break;
+
+    default:
+        break;
+    }
+}
+
+void register_clone_prewarm() {
+    DefineCustomBoolVariable(
+        "pgcow.prewarm_clones",
+        "Prewarms new databases with the blocks their template had cached.",
+        "Requires pg_prewarm's autoprewarm worker to be running.",
+        &prewarm_clones, true, PGC_SUSET, 0, nullptr, nullptr, nullptr);
+
+    RegisterXactCallback(prewarm_xact_callback, nullptr);
+}
+
+void schedule_clone_prewarm(Oid template_database, Oid clone_database) {
+    if (!prewarm_clones) {
+        return;
+    }
+
+    // without a dump there is nothing to prewarm from
+    if (!std::filesystem::exists(
+            pgcow::fs::path::join(DataDir, autoprewarm_file))) {
+        return;
+    }
+
+    // the copydir hook runs once per tablespace directory of the
+    // new database, but one worker prewarms all of them
+    for (const auto &pending : pending_prewarms) {
+        if (pending.second == clone_database) {
+            return;
+        }
+    }
+
+    pending_prewarms.push_back(
+        std::make_pair(template_database, clone_database));
+}
+
+} // namespace postgres
+} // namespace pgcow
@@ -21,6 +21,8 @@ data_directory_paths data_directory::paths() const {
         pgcow::fs::path::join(this->path_, "pg_tblspc"),
         pgcow::fs::path::join(this->path_, "postmaster.pid"),
         pgcow::fs::path::join(this->path_, "pgcow.version"),
+        pgcow::fs::path::join(this->path_, "postgresql.auto.conf"),
+        pgcow::fs::path::join(this->path_, "recovery.conf"),
     };
 
     return paths;
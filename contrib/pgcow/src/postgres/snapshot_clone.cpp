@@ -0,0 +1,390 @@
+#include <cstdlib>
+#include <string>
+
+#include <pgcow/fs.h>
+#include <pgcow/postgres/extension.h>
+#include <pgcow/postgres/snapshot_clone.h>
+#include <pgcow/zfs/dataset.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Name of the user property that stores `datfrozenxid` on snapshots.
+ */
+static const std::string frozen_xid_property = "pgcow:datfrozenxid";
+
+/**
+ * Name of the user property that stores `datminmxid` on snapshots.
+ */
+static const std::string min_multi_property = "pgcow:datminmxid";
+
+/**
+ * Name of the user property that stores the redo location of the
+ * checkpoint a snapshot was taken under.
+ */
+static const std::string checkpoint_property = "pgcow:checkpoint";
+
+/**
+ * Name of the user property that stores the WAL insert location as of
+ * which a snapshot contains every change.
+ */
+static const std::string lsn_property = "pgcow:lsn";
+
+/**
+ * Value of the `pgcow.clone_snapshot` setting.
+ */
+static char *clone_snapshot = nullptr;
+
+/**
+ * Next createdb_template_in_use_hook to invoke.
+ */
+static createdb_template_in_use_hook_type next_template_in_use_hook = nullptr;
+
+/**
+ * Database created by the current CREATE DATABASE from an older
+ * snapshot, and the horizon to give it.
+ */
+static struct {
+    bool pending;
+    Oid database;
+    snapshot_horizon horizon;
+} snapshot_clone = {false,
+                    InvalidOid,
+                    {InvalidTransactionId, InvalidMultiXactId}};
+
+/**
+ * Hooked createdb_template_in_use_hook function.
+ *
+ * Cloning an existing snapshot never looks at the template's current
+ * files, so sessions connected to the template cannot interfere.
+ */
+static bool intercept_template_in_use(Oid src_dboid) {
+    if (!clone_snapshot_name().empty()) {
+        return true;
+    }
+
+    if (next_template_in_use_hook) {
+        return (*next_template_in_use_hook)(src_dboid);
+    }
+
+    return false;
+}
+
+/**
+ * Parses the value of a numeric user property.
+ *
+ * \returns Zero if the value is empty or not a number.
+ */
+static uint32 parse_property(const std::string &value) {
+    char *end = nullptr;
+    unsigned long number = std::strtoul(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0') {
+        return 0;
+    }
+
+    return (uint32)number;
+}
+
+/**
+ * Parses the value of a user property that stores a WAL location.
+ *
+ * \returns InvalidXLogRecPtr if the value is empty or not a number.
+ */
+static XLogRecPtr parse_lsn_property(const std::string &value) {
+    char *end = nullptr;
+    unsigned long long lsn = std::strtoull(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0') {
+        return InvalidXLogRecPtr;
+    }
+
+    return (XLogRecPtr)lsn;
+}
+
+void register_snapshot_clone() {
+    DefineCustomStringVariable(
+        "pgcow.clone_snapshot",
+        "Name of the snapshot of the template CREATE DATABASE clones.",
+        "Empty to clone the template as it is right now.", &clone_snapshot,
+        "", PGC_USERSET, 0, nullptr, nullptr, nullptr);
+
+    next_template_in_use_hook = createdb_template_in_use_hook;
+    createdb_template_in_use_hook = intercept_template_in_use;
+}
+
+std::string clone_snapshot_name() {
+    if (!clone_snapshot) {
+        return "";
+    }
+
+    return std::string(clone_snapshot);
+}
+
+snapshot_horizon database_horizon(Oid database) {
+    snapshot_horizon horizon = {InvalidTransactionId, InvalidMultiXactId};
+
+    HeapTuple tuple =
+        SearchSysCache1(DATABASEOID, ObjectIdGetDatum(database));
+    if (HeapTupleIsValid(tuple)) {
+        Form_pg_database form = (Form_pg_database)GETSTRUCT(tuple);
+        horizon.frozen_xid = form->datfrozenxid;
+        horizon.min_multi = form->datminmxid;
+        ReleaseSysCache(tuple);
+    }
+
+    return horizon;
+}
+
+bool record_snapshot_horizon(const std::shared_ptr<zfs::dataset> &snapshot,
+                             const snapshot_horizon &horizon) {
+    if (!TransactionIdIsNormal(horizon.frozen_xid)) {
+        return false;
+    }
+
+    return snapshot->set_property(frozen_xid_property,
+                                  std::to_string(horizon.frozen_xid)) &&
+           snapshot->set_property(min_multi_property,
+                                  std::to_string(horizon.min_multi));
+}
+
+bool record_snapshot_checkpoint(const std::shared_ptr<zfs::dataset> &snapshot,
+                                XLogRecPtr redo) {
+    return snapshot->set_property(checkpoint_property,
+                                  std::to_string((uint64)redo));
+}
+
+XLogRecPtr
+read_snapshot_checkpoint(const std::shared_ptr<zfs::dataset> &snapshot) {
+    return parse_lsn_property(snapshot->user_property(checkpoint_property));
+}
+
+bool record_snapshot_lsn(const std::shared_ptr<zfs::dataset> &snapshot,
+                         XLogRecPtr lsn) {
+    return snapshot->set_property(lsn_property, std::to_string((uint64)lsn));
+}
+
+XLogRecPtr read_snapshot_lsn(const std::shared_ptr<zfs::dataset> &snapshot) {
+    return parse_lsn_property(snapshot->user_property(lsn_property));
+}
+
+bool read_snapshot_horizon(const std::shared_ptr<zfs::dataset> &snapshot,
+                           snapshot_horizon &horizon) {
+    horizon.frozen_xid =
+        parse_property(snapshot->user_property(frozen_xid_property));
+    horizon.min_multi =
+        parse_property(snapshot->user_property(min_multi_property));
+
+    return TransactionIdIsNormal(horizon.frozen_xid) &&
+           MultiXactIdIsValid(horizon.min_multi);
+}
+
+void prepare_snapshot_clone(Oid database,
+                            const std::shared_ptr<zfs::dataset> &snapshot) {
+    MultiXactId next_multi;
+    MultiXactOffset next_multi_offset;
+    MultiXactId oldest_multi;
+    Oid oldest_multi_database;
+
+    LWLockAcquire(XidGenLock, LW_SHARED);
+    TransactionId oldest_xid = ShmemVariableCache->oldestXid;
+    LWLockRelease(XidGenLock);
+
+    MultiXactGetCheckptMulti(false, &next_multi, &next_multi_offset,
+                             &oldest_multi, &oldest_multi_database);
+
+    // a snapshot taken by hand can miss changes that were only in
+    // shared_buffers, one taken after flushing them is at least what a
+    // crash would have left behind
+    if (read_snapshot_checkpoint(snapshot) == InvalidXLogRecPtr) {
+        XLogRecPtr lsn = read_snapshot_lsn(snapshot);
+        if (lsn == InvalidXLogRecPtr) {
+            ereport(ERROR,
+                    (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                     errmsg("zfs snapshot \"%s\" is not consistent",
+                            snapshot->name().c_str()),
+                     errdetail("Only snapshots that pgcow took after writing "
+                               "the database's buffers to disk can be "
+                               "cloned.")));
+        }
+
+        ereport(WARNING,
+                (errmsg("zfs snapshot \"%s\" was taken while the database "
+                        "was in use",
+                        snapshot->name().c_str()),
+                 errdetail("The snapshot contains every change up to WAL "
+                           "location %X/%X. Transactions that were in "
+                           "progress might be partially visible in the new "
+                           "database.",
+                           (uint32)(lsn >> 32), (uint32)lsn)));
+    }
+
+    snapshot_horizon horizon;
+    if (!read_snapshot_horizon(snapshot, horizon)) {
+        ereport(WARNING,
+                (errmsg("zfs snapshot \"%s\" does not record the oldest "
+                        "transaction it depends on",
+                        snapshot->name().c_str()),
+                 errdetail("Rows in the new database might be invisible if "
+                           "the snapshot predates the last truncation of "
+                           "the commit log.")));
+        horizon.frozen_xid = oldest_xid;
+        horizon.min_multi = oldest_multi;
+    }
+
+    if (TransactionIdPrecedes(horizon.frozen_xid, oldest_xid) ||
+        MultiXactIdPrecedes(horizon.min_multi, oldest_multi)) {
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("zfs snapshot \"%s\" is too old to be cloned",
+                        snapshot->name().c_str()),
+                 errdetail("The commit log the snapshot depends on has "
+                           "already been truncated.")));
+    }
+
+    snapshot_clone.pending = true;
+    snapshot_clone.database = database;
+    snapshot_clone.horizon = horizon;
+}
+
+void finish_snapshot_clone() {
+    if (!snapshot_clone.pending) {
+        return;
+    }
+
+    snapshot_clone.pending = false;
+
+    // make the row inserted by CREATE DATABASE visible
+    CommandCounterIncrement();
+
+    Relation relation = heap_open(DatabaseRelationId, RowExclusiveLock);
+
+    HeapTuple tuple = SearchSysCacheCopy1(
+        DATABASEOID, ObjectIdGetDatum(snapshot_clone.database));
+    if (!HeapTupleIsValid(tuple)) {
+        elog(ERROR, "cache lookup failed for database %u",
+             snapshot_clone.database);
+    }
+
+    // CREATE DATABASE copied the template's current horizon
+    Form_pg_database form = (Form_pg_database)GETSTRUCT(tuple);
+    if (TransactionIdPrecedes(snapshot_clone.horizon.frozen_xid,
+                              form->datfrozenxid)) {
+        form->datfrozenxid = snapshot_clone.horizon.frozen_xid;
+    }
+    if (MultiXactIdPrecedes(snapshot_clone.horizon.min_multi,
+                            form->datminmxid)) {
+        form->datminmxid = snapshot_clone.horizon.min_multi;
+    }
+
+    CatalogTupleUpdate(relation, &tuple->t_self, tuple);
+
+    heap_freetuple(tuple);
+    heap_close(relation, RowExclusiveLock);
+}
+
+void reset_snapshot_clone() { snapshot_clone.pending = false; }
+
+} // namespace postgres
+} // namespace pgcow
+
+extern "C" {
+
+PG_FUNCTION_INFO_V1(pgcow_snapshots);
+
+Datum pgcow_snapshots(PG_FUNCTION_ARGS) {
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *)fcinfo->resultinfo;
+    TupleDesc tupdesc;
+    Tuplestorestate *tupstore;
+    MemoryContext per_query_ctx;
+    MemoryContext oldcontext;
+
+    if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo)) {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("set-valued function called in context that cannot "
+                        "accept a set")));
+    }
+
+    if (!(rsinfo->allowedModes & SFRM_Materialize)) {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("materialize mode required, but it is not allowed "
+                        "in this context")));
+    }
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE) {
+        elog(ERROR, "return type must be a row type");
+    }
+
+    per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+    oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+    tupstore = tuplestore_begin_heap(true, false, work_mem);
+    rsinfo->returnMode = SFRM_Materialize;
+    rsinfo->setResult = tupstore;
+    rsinfo->setDesc = tupdesc;
+
+    MemoryContextSwitchTo(oldcontext);
+
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        ereport(ERROR,
+                (errcode_for_file_access(), errmsg("cannot init libzfs")));
+    }
+
+    {
+        std::string databases_path = pgcow::fs::path::join(DataDir, "base");
+
+        auto databases_dataset =
+            pgcow::zfs::dataset::by_mountpoint(zfs, databases_path);
+        if (databases_dataset) {
+            for (const auto &dataset : databases_dataset->children()) {
+                std::string leaf = pgcow::fs::path::leaf(dataset->name());
+
+                char *end = nullptr;
+                Oid database = (Oid)std::strtoul(leaf.c_str(), &end, 10);
+                if (leaf.empty() || *end != '\0' || !OidIsValid(database)) {
+                    continue;
+                }
+
+                for (const auto &snapshot : dataset->snapshots()) {
+                    Datum values[5];
+                    bool nulls[5];
+                    memset(nulls, 0, sizeof(nulls));
+
+                    std::string name = snapshot->name();
+                    values[0] = ObjectIdGetDatum(database);
+                    values[1] = CStringGetTextDatum(
+                        name.substr(name.find("@") + 1).c_str());
+                    values[2] = TimestampTzGetDatum(time_t_to_timestamptz(
+                        (pg_time_t)snapshot->creation_time()));
+
+                    pgcow::postgres::snapshot_horizon horizon;
+                    if (pgcow::postgres::read_snapshot_horizon(snapshot,
+                                                               horizon)) {
+                        values[3] = TransactionIdGetDatum(horizon.frozen_xid);
+                    } else {
+                        nulls[3] = true;
+                    }
+
+                    XLogRecPtr lsn =
+                        pgcow::postgres::read_snapshot_lsn(snapshot);
+                    if (lsn != InvalidXLogRecPtr) {
+                        values[4] = LSNGetDatum(lsn);
+                    } else {
+                        nulls[4] = true;
+                    }
+
+                    tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+                }
+            }
+        }
+    }
+
+    libzfs_fini(zfs);
+
+    tuplestore_donestoring(tupstore);
+
+    return (Datum)0;
+}
+}
@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pgcow/fs.h>
+#include <pgcow/postgres/extension.h>
+#include <pgcow/postgres/snapshot_clone.h>
+#include <pgcow/postgres/snapshot_worker.h>
+#include <pgcow/zfs/dataset.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Value of the `pgcow.snapshot_schedule` setting.
+ */
+static char *snapshot_schedule = nullptr;
+
+static volatile sig_atomic_t got_sighup = false;
+static volatile sig_atomic_t got_sigterm = false;
+
+/**
+ * Gets the current time as the number of milliseconds that
+ * elapsed since January 1st, 1970 (UTC).
+ */
+static uint64_t current_time_ms() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Strips leading and trailing whitespace from the specified string.
+ */
+static std::string trim(const std::string &value) {
+    auto begin = value.find_first_not_of(" \t\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+
+    auto end = value.find_last_not_of(" \t\n");
+    return value.substr(begin, end - begin + 1);
+}
+
+bool parse_snapshot_schedule(const std::string &value,
+                             std::vector<snapshot_schedule_entry> &entries,
+                             std::string &error) {
+    std::stringstream stream(value);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        item = trim(item);
+        if (item.empty()) {
+            continue;
+        }
+
+        snapshot_schedule_entry entry;
+
+        // database names can contain colons, so split from the right
+        auto flag_sep = item.rfind(':');
+        if (flag_sep != std::string::npos &&
+            trim(item.substr(flag_sep + 1)) == "quiesce") {
+            entry.quiesce = true;
+            item = trim(item.substr(0, flag_sep));
+        }
+
+        auto retention_sep = item.rfind(':');
+        auto interval_sep = std::string::npos;
+        if (retention_sep != std::string::npos && retention_sep > 0) {
+            interval_sep = item.rfind(':', retention_sep - 1);
+        }
+        if (interval_sep == std::string::npos) {
+            error = "entry \"" + item +
+                    "\" is not of the form database:interval:retention";
+            return false;
+        }
+
+        entry.database = trim(item.substr(0, interval_sep));
+
+        std::string interval = trim(
+            item.substr(interval_sep + 1, retention_sep - interval_sep - 1));
+        std::string retention = trim(item.substr(retention_sep + 1));
+
+        if (entry.database.empty()) {
+            error = "entry \"" + item + "\" does not specify a database";
+            return false;
+        }
+
+        const char *hint = nullptr;
+        if (!parse_int(interval.c_str(), &entry.interval, GUC_UNIT_S, &hint) ||
+            entry.interval <= 0) {
+            error = "invalid snapshot interval \"" + interval +
+                    "\" for database \"" + entry.database + "\"";
+            if (hint) {
+                error += ": " + std::string(hint);
+            }
+            return false;
+        }
+
+        if (!parse_int(retention.c_str(), &entry.retention, 0, nullptr) ||
+            entry.retention <= 0) {
+            error = "invalid snapshot retention \"" + retention +
+                    "\" for database \"" + entry.database + "\"";
+            return false;
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+/**
+ * Validates a new value for the `pgcow.snapshot_schedule` setting.
+ */
+static bool check_snapshot_schedule(char **newval, void **extra,
+                                    GucSource source) {
+    std::vector<snapshot_schedule_entry> entries;
+    std::string error;
+
+    if (!parse_snapshot_schedule(*newval, entries, error)) {
+        GUC_check_errdetail("%s", error.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Signal handler for SIGHUP, re-reads the configuration.
+ */
+static void handle_sighup(SIGNAL_ARGS) {
+    int save_errno = errno;
+
+    got_sighup = true;
+    SetLatch(MyLatch);
+
+    errno = save_errno;
+}
+
+/**
+ * Signal handler for SIGTERM, asks the worker to exit.
+ */
+static void handle_sigterm(SIGNAL_ARGS) {
+    int save_errno = errno;
+
+    got_sigterm = true;
+    SetLatch(MyLatch);
+
+    errno = save_errno;
+}
+
+/**
+ * Gets the automatic snapshots of the specified dataset, ordered from
+ * oldest to newest, together with the time they were taken at.
+ */
+static std::vector<std::pair<uint64_t, std::shared_ptr<pgcow::zfs::dataset>>>
+auto_snapshots(const std::shared_ptr<pgcow::zfs::dataset> &dataset) {
+    std::vector<std::pair<uint64_t, std::shared_ptr<pgcow::zfs::dataset>>>
+        snapshots;
+
+    for (const auto &snapshot : dataset->snapshots()) {
+        std::string name = snapshot->name();
+
+        auto at_symbol_index = name.find("@");
+        if (at_symbol_index == std::string::npos) {
+            continue;
+        }
+
+        name = name.substr(at_symbol_index + 1);
+        if (name.compare(0, auto_snapshot_prefix.size(),
+                         auto_snapshot_prefix) != 0) {
+            continue;
+        }
+
+        uint64_t taken_at = std::strtoull(
+            name.c_str() + auto_snapshot_prefix.size(), nullptr, 10);
+        snapshots.push_back(std::make_pair(taken_at, snapshot));
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    return snapshots;
+}
+
+/**
+ * Looks up the OID of the database with the specified name.
+ *
+ * \returns InvalidOid if no such database exists.
+ */
+static Oid database_oid(const std::string &database) {
+    Oid oid;
+
+    SetCurrentStatementStartTimestamp();
+    StartTransactionCommand();
+    oid = get_database_oid(database.c_str(), true);
+    CommitTransactionCommand();
+
+    return oid;
+}
+
+/**
+ * Opens the ZFS dataset that holds the database with the specified OID.
+ */
+static std::shared_ptr<pgcow::zfs::dataset>
+database_dataset(libzfs_handle_t *zfs, Oid oid) {
+    std::string databases_path = pgcow::fs::path::join(DataDir, "base");
+    std::string database_path =
+        pgcow::fs::path::join(databases_path, std::to_string(oid));
+
+    return pgcow::zfs::dataset::by_mountpoint(zfs, database_path);
+}
+
+/**
+ * Locks a database against new connections if no session or prepared
+ * transaction uses it, without waiting for anything.
+ *
+ * Must be called inside a transaction. The lock is held until the
+ * transaction ends.
+ *
+ * \returns True if the database is locked and nothing uses it.
+ */
+static bool quiesce_database(Oid oid) {
+    int other_backends;
+    int prepared_xacts;
+    LOCKTAG tag;
+
+    // CountOtherDBBackends() waits for up to 5 seconds while sessions
+    // are around, so it only gets to look for prepared transactions
+    if (CountDBBackends(oid) > 0 ||
+        CountOtherDBBackends(oid, &other_backends, &prepared_xacts)) {
+        return false;
+    }
+
+    // conflicts with new connections, like LockSharedObject() but
+    // without waiting for sessions that are connecting right now
+    SET_LOCKTAG_OBJECT(tag, InvalidOid, DatabaseRelationId, oid, 0);
+    if (LockAcquire(&tag, ShareLock, false, true) == LOCKACQUIRE_NOT_AVAIL) {
+        return false;
+    }
+
+    // a session might have connected before the lock was taken
+    if (CountDBBackends(oid) > 0) {
+        LockRelease(&tag, ShareLock, false);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Snapshots the database's dataset after writing its buffers to disk.
+ *
+ * Sessions keep using the database while the snapshot is taken. The
+ * snapshot records the WAL insert location from before the buffers
+ * were written, it contains every change up to there. Such a snapshot
+ * is what a crash would have left behind, transactions that were in
+ * progress can be partially written.
+ *
+ * If the schedule entry asks for it and nothing uses the database, new
+ * connections are kept out until the snapshot is taken, and the
+ * snapshot is recorded as consistent.
+ *
+ * \returns True if a snapshot was taken.
+ */
+static bool take_snapshot(const std::shared_ptr<pgcow::zfs::dataset> &dataset,
+                          const snapshot_schedule_entry &entry, Oid oid,
+                          uint64_t now) {
+    SetCurrentStatementStartTimestamp();
+    StartTransactionCommand();
+
+    bool quiesced = entry.quiesce && quiesce_database(oid);
+    if (entry.quiesce && !quiesced) {
+        ereport(LOG, (errmsg("pgcow: database \"%s\" is in use, taking a "
+                             "snapshot that is not quiesced",
+                             entry.database.c_str())));
+    }
+
+    XLogRecPtr redo = GetRedoRecPtr();
+    XLogRecPtr lsn = GetXLogInsertRecPtr();
+    snapshot_horizon horizon = database_horizon(oid);
+
+    FlushDatabaseBuffers(oid);
+
+    auto snapshot =
+        dataset->snapshot(auto_snapshot_prefix + std::to_string(now));
+    if (!snapshot) {
+        CommitTransactionCommand();
+        ereport(WARNING, (errmsg("pgcow: cannot create snapshot of database "
+                                 "\"%s\"",
+                                 entry.database.c_str())));
+        return false;
+    }
+
+    CommitTransactionCommand();
+
+    // needed to clone the snapshot into a new database later on, and
+    // to replay WAL on top of it
+    if (!record_snapshot_horizon(snapshot, horizon) ||
+        !record_snapshot_lsn(snapshot, lsn) ||
+        (quiesced && !record_snapshot_checkpoint(snapshot, redo))) {
+        ereport(LOG, (errmsg("pgcow: cannot record horizon and WAL location "
+                             "of snapshot \"%s\"",
+                             snapshot->name().c_str())));
+    }
+
+    ereport(DEBUG1, (errmsg_internal("pgcow: created snapshot \"%s\"",
+                                     snapshot->name().c_str())));
+    return true;
+}
+
+/**
+ * Destroys all but the newest \paramref retention automatic snapshots.
+ *
+ * Snapshots that still have dependent clones cannot be destroyed
+ * and are kept around until their clones are gone.
+ */
+static void
+prune_snapshots(const std::shared_ptr<pgcow::zfs::dataset> &dataset,
+                int retention) {
+    auto snapshots = auto_snapshots(dataset);
+    if (snapshots.size() <= (size_t)retention) {
+        return;
+    }
+
+    for (size_t i = 0; i < snapshots.size() - retention; ++i) {
+        auto &snapshot = snapshots[i].second;
+
+        if (!snapshot->destroy()) {
+            ereport(LOG, (errmsg("pgcow: cannot prune snapshot \"%s\"",
+                                 snapshot->name().c_str()),
+                          errdetail("The snapshot might have dependent "
+                                    "clones.")));
+            continue;
+        }
+
+        ereport(DEBUG1, (errmsg_internal("pgcow: pruned snapshot \"%s\"",
+                                         snapshot->name().c_str())));
+    }
+}
+
+void register_snapshot_worker() {
+    DefineCustomStringVariable(
+        "pgcow.snapshot_schedule",
+        "Schedule for automatic snapshots of databases.",
+        "Comma separated list of database:interval:retention entries, "
+        "for example \"app:15min:96\".",
+        &snapshot_schedule, "", PGC_SIGHUP, 0, check_snapshot_schedule,
+        nullptr, nullptr);
+
+    if (!process_shared_preload_libraries_in_progress) {
+        return;
+    }
+
+    BackgroundWorker worker;
+    memset(&worker, 0, sizeof(worker));
+    worker.bgw_flags =
+        BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+    worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    worker.bgw_restart_time = 60;
+    snprintf(worker.bgw_library_name, BGW_MAXLEN, "pgcow");
+    snprintf(worker.bgw_function_name, BGW_MAXLEN,
+             "pgcow_snapshot_worker_main");
+    snprintf(worker.bgw_name, BGW_MAXLEN, "pgcow snapshot worker");
+    snprintf(worker.bgw_type, BGW_MAXLEN, "pgcow snapshot worker");
+
+    RegisterBackgroundWorker(&worker);
+}
+
+} // namespace postgres
+} // namespace pgcow
+
+extern "C" {
+
+void pgcow_snapshot_worker_main(Datum main_arg) {
+    using pgcow::postgres::snapshot_schedule_entry;
+
+    pqsignal(SIGHUP, pgcow::postgres::handle_sighup);
+    pqsignal(SIGTERM, pgcow::postgres::handle_sigterm);
+    BackgroundWorkerUnblockSignals();
+
+    // only shared catalogs (pg_database) are needed
+    BackgroundWorkerInitializeConnection(NULL, NULL, 0);
+
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        ereport(ERROR,
+                (errcode_for_file_access(), errmsg("cannot init libzfs")));
+        return;
+    }
+
+    std::vector<snapshot_schedule_entry> schedule;
+    std::string error;
+    pgcow::postgres::parse_snapshot_schedule(
+        pgcow::postgres::snapshot_schedule, schedule, error);
+
+    // when the last snapshot of each database was taken, initialized
+    // from existing snapshots so that a restart does not cause a burst
+    std::map<std::string, uint64_t> last_snapshot_ms;
+
+    while (!pgcow::postgres::got_sigterm) {
+        if (pgcow::postgres::got_sighup) {
+            pgcow::postgres::got_sighup = false;
+            ProcessConfigFile(PGC_SIGHUP);
+
+            schedule.clear();
+            pgcow::postgres::parse_snapshot_schedule(
+                pgcow::postgres::snapshot_schedule, schedule, error);
+        }
+
+        uint64_t now = pgcow::postgres::current_time_ms();
+
+        // wake up at least once a minute to pick up databases
+        // from the schedule that did not exist yet
+        long timeout_ms = 60 * 1000;
+
+        for (const auto &entry : schedule) {
+            Oid oid = pgcow::postgres::database_oid(entry.database);
+            if (!OidIsValid(oid)) {
+                ereport(DEBUG1,
+                        (errmsg_internal("pgcow: database \"%s\" in snapshot "
+                                         "schedule does not exist",
+                                         entry.database.c_str())));
+                continue;
+            }
+
+            auto dataset = pgcow::postgres::database_dataset(zfs, oid);
+            if (!dataset) {
+                ereport(DEBUG1,
+                        (errmsg_internal("pgcow: database \"%s\" is not a "
+                                         "zfs dataset, not taking snapshots",
+                                         entry.database.c_str())));
+                continue;
+            }
+
+            if (last_snapshot_ms.find(entry.database) ==
+                last_snapshot_ms.end()) {
+                auto snapshots = pgcow::postgres::auto_snapshots(dataset);
+                last_snapshot_ms[entry.database] =
+                    snapshots.empty() ? 0 : snapshots.back().first;
+            }
+
+            uint64_t interval_ms = (uint64_t)entry.interval * 1000;
+            uint64_t due_ms = last_snapshot_ms[entry.database] + interval_ms;
+
+            if (due_ms <= now) {
+                if (pgcow::postgres::take_snapshot(dataset, entry, oid, now)) {
+                    last_snapshot_ms[entry.database] = now;
+                    pgcow::postgres::prune_snapshots(dataset, entry.retention);
+                }
+
+                due_ms = now + interval_ms;
+            }
+
+            timeout_ms = std::min(timeout_ms, (long)(due_ms - now));
+        }
+
+        int rc =
+            WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+                      timeout_ms, PG_WAIT_EXTENSION);
+        ResetLatch(MyLatch);
+
+        if (rc & WL_POSTMASTER_DEATH) {
+            proc_exit(1);
+        }
+
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    libzfs_fini(zfs);
+    proc_exit(0);
+}
+}
@@ -0,0 +1,315 @@
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <pgcow/fs.h>
+#include <pgcow/postgres/extension.h>
+#include <pgcow/postgres/torn_page_safety.h>
+
+namespace pgcow {
+namespace postgres {
+
+/**
+ * Maximum number of databases that can be tracked as torn-page-safe.
+ *
+ * Databases beyond this limit keep writing full-page images.
+ */
+static const int max_torn_page_safe_databases = 4096;
+
+/**
+ * Shared state, lives in shared memory.
+ *
+ * The WAL hook runs inside a critical section, so it reads the list of
+ * databases without taking a lock. Slots are only ever filled or
+ * cleared as a whole and `database_count` only grows, so a reader sees
+ * either the old or the new value of a slot.
+ */
+struct torn_page_safety_state {
+    /**
+     * Serializes changes to the list of databases.
+     */
+    slock_t mutex;
+
+    /**
+     * Number of slots in `databases` that were ever used.
+     */
+    pg_atomic_uint32 database_count;
+
+    /**
+     * Full-page images that were skipped.
+     */
+    pg_atomic_uint64 skipped_images;
+
+    /**
+     * OIDs of the databases on torn-page-safe datasets, InvalidOid
+     * for free slots.
+     */
+    pg_atomic_uint32 databases[max_torn_page_safe_databases];
+};
+
+/**
+ * Value of the `pgcow.skip_full_page_images` setting.
+ */
+static bool skip_full_page_images = true;
+
+/**
+ * Pointer to the shared state.
+ */
+static torn_page_safety_state *state = nullptr;
+
+/**
+ * Next shmem_startup_hook to invoke.
+ */
+static shmem_startup_hook_type next_shmem_startup_hook = nullptr;
+
+/**
+ * Next torn_page_safe_hook to invoke.
+ */
+static torn_page_safe_hook_type next_torn_page_safe_hook = nullptr;
+
+/**
+ * Next torn_page_images_skipped_hook to invoke.
+ */
+static torn_page_images_skipped_hook_type next_torn_page_images_skipped_hook =
+    nullptr;
+
+/**
+ * Gets whether a dataset rules out torn pages.
+ *
+ * ZFS file systems are copy-on-write: a record is never partially
+ * overwritten in place. With records that are a multiple of the
+ * page size, a page never straddles two records, so a crash either
+ * leaves the old or the new version of a page on disk.
+ */
+static bool is_torn_page_safe(const zfs::dataset &dataset) {
+    uint64_t record_size = dataset.record_size();
+    return dataset.is_filesystem() && record_size >= BLCKSZ &&
+           record_size % BLCKSZ == 0;
+}
+
+/**
+ * Hooked torn_page_safe_hook function.
+ *
+ * Only relations in the default tablespace live in the database's
+ * dataset, other tablespaces are not managed by pgcow.
+ */
+static bool intercept_torn_page_safe(const RelFileNode *rnode,
+                                     ForkNumber forknum) {
+    if (skip_full_page_images && state &&
+        rnode->spcNode == DEFAULTTABLESPACE_OID) {
+        uint32 count = pg_atomic_read_u32(&state->database_count);
+        for (uint32 i = 0; i < count; i++) {
+            if (pg_atomic_read_u32(&state->databases[i]) == rnode->dbNode) {
+                return true;
+            }
+        }
+    }
+
+    if (next_torn_page_safe_hook) {
+        return (*next_torn_page_safe_hook)(rnode, forknum);
+    }
+
+    return false;
+}
+
+/**
+ * Hooked torn_page_images_skipped_hook function.
+ *
+ * A record can be assembled several times before it is inserted, so the
+ * images are counted here rather than when the hook above decides.
+ */
+static void intercept_torn_page_images_skipped(int nimages) {
+    if (state) {
+        pg_atomic_fetch_add_u64(&state->skipped_images, (uint64)nimages);
+    }
+
+    if (next_torn_page_images_skipped_hook) {
+        (*next_torn_page_images_skipped_hook)(nimages);
+    }
+}
+
+/**
+ * Verifies the datasets of all databases in the data directory.
+ */
+static void verify_existing_databases() {
+    libzfs_handle_t *zfs = libzfs_init();
+    if (!zfs) {
+        ereport(LOG, (errmsg("pgcow: cannot init libzfs, full-page images "
+                             "will be written for all databases")));
+        return;
+    }
+
+    std::error_code error;
+    std::string base_path = pgcow::fs::path::join(DataDir, "base");
+    for (const auto &entry :
+         std::filesystem::directory_iterator(base_path, error)) {
+        std::string name = entry.path().filename().u8string();
+
+        char *end = nullptr;
+        Oid database = (Oid)std::strtoul(name.c_str(), &end, 10);
+        if (name.empty() || *end != '\0' || !OidIsValid(database)) {
+            continue;
+        }
+
+        auto dataset =
+            zfs::dataset::by_mountpoint(zfs, entry.path().u8string());
+        if (dataset) {
+            verify_torn_page_safety(database, dataset);
+        }
+    }
+
+    libzfs_fini(zfs);
+}
+
+/**
+ * Allocates or attaches to the shared state.
+ */
+static void torn_page_safety_shmem_startup() {
+    bool found;
+
+    if (next_shmem_startup_hook) {
+        (*next_shmem_startup_hook)();
+    }
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+    state = (torn_page_safety_state *)ShmemInitStruct(
+        "pgcow torn page safety", sizeof(torn_page_safety_state), &found);
+
+    if (!found) {
+        SpinLockInit(&state->mutex);
+        pg_atomic_init_u32(&state->database_count, 0);
+        pg_atomic_init_u64(&state->skipped_images, 0);
+        for (int i = 0; i < max_torn_page_safe_databases; i++) {
+            pg_atomic_init_u32(&state->databases[i], InvalidOid);
+        }
+    }
+
+    LWLockRelease(AddinShmemInitLock);
+
+    // the postmaster verifies once, backends inherit the result
+    if (!found) {
+        verify_existing_databases();
+    }
+}
+
+void register_torn_page_safety() {
+    DefineCustomBoolVariable(
+        "pgcow.skip_full_page_images",
+        "Skips full-page images of pages on torn-page-safe datasets.",
+        "Full-page images are still written during online backups.",
+        &skip_full_page_images, true, PGC_SIGHUP, 0, nullptr, nullptr,
+        nullptr);
+
+    RequestAddinShmemSpace(sizeof(torn_page_safety_state));
+
+    next_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = torn_page_safety_shmem_startup;
+
+    next_torn_page_safe_hook = torn_page_safe_hook;
+    torn_page_safe_hook = intercept_torn_page_safe;
+
+    next_torn_page_images_skipped_hook = torn_page_images_skipped_hook;
+    torn_page_images_skipped_hook = intercept_torn_page_images_skipped;
+}
+
+void verify_torn_page_safety(Oid database,
+                             const std::shared_ptr<zfs::dataset> &dataset) {
+    if (!state || !is_torn_page_safe(*dataset)) {
+        ereport(DEBUG1,
+                (errmsg_internal("zfs dataset \"%s\" of database %u is not "
+                                 "torn-page-safe",
+                                 dataset->name().c_str(), database)));
+        return;
+    }
+
+    bool tracked = false;
+
+    SpinLockAcquire(&state->mutex);
+
+    uint32 count = pg_atomic_read_u32(&state->database_count);
+    int free_slot = -1;
+    for (uint32 i = 0; i < count && !tracked; i++) {
+        Oid slot = pg_atomic_read_u32(&state->databases[i]);
+        if (slot == database) {
+            tracked = true;
+        } else if (slot == InvalidOid && free_slot < 0) {
+            free_slot = (int)i;
+        }
+    }
+
+    if (!tracked && free_slot >= 0) {
+        pg_atomic_write_u32(&state->databases[free_slot], database);
+        tracked = true;
+    } else if (!tracked && count < max_torn_page_safe_databases) {
+        // fill the slot before readers can see it
+        pg_atomic_write_u32(&state->databases[count], database);
+        pg_atomic_fetch_add_u32(&state->database_count, 1);
+        tracked = true;
+    }
+
+    SpinLockRelease(&state->mutex);
+
+    if (!tracked) {
+        ereport(LOG, (errmsg("pgcow: too many torn-page-safe databases, "
+                             "full-page images will be written for "
+                             "database %u",
+                             database)));
+        return;
+    }
+
+    ereport(DEBUG1, (errmsg_internal("zfs dataset \"%s\" of database %u is "
+                                     "torn-page-safe",
+                                     dataset->name().c_str(), database)));
+}
+
+void forget_torn_page_safety(Oid database) {
+    if (!state) {
+        return;
+    }
+
+    SpinLockAcquire(&state->mutex);
+
+    uint32 count = pg_atomic_read_u32(&state->database_count);
+    for (uint32 i = 0; i < count; i++) {
+        if (pg_atomic_read_u32(&state->databases[i]) == database) {
+            pg_atomic_write_u32(&state->databases[i], InvalidOid);
+        }
+    }
+
+    SpinLockRelease(&state->mutex);
+}
+
+} // namespace postgres
+} // namespace pgcow
+
+extern "C" {
+
+PG_FUNCTION_INFO_V1(pgcow_full_page_image_stats);
+
+Datum pgcow_full_page_image_stats(PG_FUNCTION_ARGS) {
+    TupleDesc tupdesc;
+    Datum values[2];
+    bool nulls[2] = {false, false};
+
+    if (!pgcow::postgres::state) {
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("pgcow must be loaded via shared_preload_libraries")));
+    }
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE) {
+        elog(ERROR, "return type must be a row type");
+    }
+
+    // the hole between pd_lower and pd_upper is never written, so the
+    // number of bytes is an upper bound
+    uint64 skipped_images =
+        pg_atomic_read_u64(&pgcow::postgres::state->skipped_images);
+    values[0] = Int64GetDatum((int64)skipped_images);
+    values[1] = Int64GetDatum((int64)(skipped_images * BLCKSZ));
+
+    PG_RETURN_DATUM(
+        HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+}
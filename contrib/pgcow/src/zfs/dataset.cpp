@@ -68,8 +68,9 @@ std::shared_ptr<dataset> dataset::by_mountpoint(libzfs_handle_t *zfs,
 
     std::vector<std::shared_ptr<dataset>> datasets = all(zfs);
 
+    // snapshots are not mounted and have no mountpoint
     for (auto dataset : datasets) {
-        if (dataset->mountpoint() == mountpoint) {
+        if (dataset->is_filesystem() && dataset->mountpoint() == mountpoint) {
             return dataset;
         }
     }
@@ -231,10 +232,11 @@ dataset::create(libzfs_handle_t *zfs, std::shared_ptr<dataset> parent_dataset,
         return nullptr;
     }
 
-    auto dataset = dataset::by_name(zfs, name);
+    auto dataset = dataset::by_name(zfs, dataset_name);
     if (!dataset) {
         spdlog::error(
-            "created zfs dataset '{0}', but cannot open it, error {1}", name,
+            "created zfs dataset '{0}', but cannot open it, error {1}",
+            dataset_name,
             error_description(zfs));
         return nullptr;
     }
@@ -257,7 +259,7 @@ std::string dataset::mountpoint() const {
                            ZFS_MAXPROPLEN, nullptr, nullptr, 0, B_FALSE);
 
     if (err != 0) {
-        spdlog::error("failed to get zfs dataset '{0}' mountpoint, error {2}",
+        spdlog::error("failed to get zfs dataset '{0}' mountpoint, error {1}",
                       this->name(),
                       error_description(zfs_get_handle(this->handle_)));
         return "";
@@ -314,6 +316,11 @@ std::shared_ptr<dataset> dataset::clone(const std::string &name) const {
 
     clone_name += name;
 
+    return this->clone_to(clone_name);
+}
+
+std::shared_ptr<dataset>
+dataset::clone_to(const std::string &clone_name) const {
     spdlog::debug("cloning zfs dataset '{0}' to '{1}'", this->name(),
                   clone_name);
 
@@ -328,6 +335,212 @@ std::shared_ptr<dataset> dataset::clone(const std::string &name) const {
     return by_name(zfs_get_handle(this->handle_), clone_name);
 }
 
+std::string dataset::user_property(const std::string &name) const {
+    nvlist_t *properties = zfs_get_user_props(this->handle_);
+    nvlist_t *property = nullptr;
+    char *value = nullptr;
+
+    if (!properties ||
+        nvlist_lookup_nvlist(properties, name.c_str(), &property) != 0 ||
+        nvlist_lookup_string(property, ZPROP_VALUE, &value) != 0) {
+        return "";
+    }
+
+    return std::string(value);
+}
+
+bool dataset::set_property(const std::string &name,
+                           const std::string &value) const {
+    spdlog::debug("setting property '{0}' of zfs dataset '{1}' to '{2}'",
+                  name, this->name(), value);
+
+    int err = zfs_prop_set(this->handle_, name.c_str(), value.c_str());
+    if (err != 0) {
+        spdlog::error("failed to set property '{0}' of zfs dataset '{1}', "
+                      "error {2}",
+                      name, this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    return true;
+}
+
+bool dataset::mount() const {
+    spdlog::debug("mounting zfs dataset '{0}'", this->name());
+
+    int err = zfs_mount(this->handle_, nullptr, 0);
+    if (err != 0) {
+        spdlog::error("failed to mount zfs dataset '{0}', error {1}",
+                      this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<std::shared_ptr<dataset>> dataset::snapshots() const {
+    std::vector<std::shared_ptr<dataset>> snapshots;
+
+    int err = zfs_iter_snapshots(this->handle_, B_FALSE, __iterate_datasets,
+                                 reinterpret_cast<void *>(&snapshots));
+    if (err != 0) {
+        spdlog::error("failed to iterate snapshots of zfs dataset '{0}', "
+                      "error {1}",
+                      this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+    }
+
+    return snapshots;
+}
+
+std::vector<std::shared_ptr<dataset>> dataset::children() const {
+    std::vector<std::shared_ptr<dataset>> children;
+
+    int err = zfs_iter_filesystems(this->handle_, __iterate_datasets,
+                                   reinterpret_cast<void *>(&children));
+    if (err != 0) {
+        spdlog::error("failed to iterate children of zfs dataset '{0}', "
+                      "error {1}",
+                      this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+    }
+
+    return children;
+}
+
+std::shared_ptr<dataset> dataset::parent() const {
+    std::string parent_name = this->name();
+
+    auto at_symbol_index = parent_name.find("@");
+    if (at_symbol_index != std::string::npos) {
+        parent_name = parent_name.substr(0, at_symbol_index);
+    } else {
+        auto last_slash_index = parent_name.rfind("/");
+        if (last_slash_index == std::string::npos) {
+            return nullptr;
+        }
+
+        parent_name = parent_name.substr(0, last_slash_index);
+    }
+
+    return by_name(zfs_get_handle(this->handle_), parent_name);
+}
+
+std::string dataset::origin() const {
+    std::string origin(ZFS_MAXPROPLEN, ' ');
+    int err = zfs_prop_get(this->handle_, ZFS_PROP_ORIGIN, &origin[0],
+                           ZFS_MAXPROPLEN, nullptr, nullptr, 0, B_FALSE);
+
+    // zfs reports an error when the property does not apply,
+    // which is the case for datasets that are not clones
+    if (err != 0) {
+        return "";
+    }
+
+    origin.resize(::strlen(origin.c_str()));
+    if (origin == "-") {
+        return "";
+    }
+
+    return origin;
+}
+
+uint64_t dataset::creation_txg() const {
+    return zfs_prop_get_int(this->handle_, ZFS_PROP_CREATETXG);
+}
+
+uint64_t dataset::creation_time() const {
+    return zfs_prop_get_int(this->handle_, ZFS_PROP_CREATION);
+}
+
+bool dataset::is_filesystem() const {
+    return zfs_get_type(this->handle_) == ZFS_TYPE_FILESYSTEM;
+}
+
+uint64_t dataset::record_size() const {
+    return zfs_prop_get_int(this->handle_, ZFS_PROP_RECORDSIZE);
+}
+
+bool dataset::promote() const {
+    spdlog::debug("promoting zfs clone '{0}'", this->name());
+
+    int err = zfs_promote(this->handle_);
+    if (err != 0) {
+        spdlog::error("failed to promote zfs clone '{0}', error {1}",
+                      this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    return true;
+}
+
+bool dataset::destroy() const {
+    spdlog::debug("destroying zfs dataset '{0}'", this->name());
+
+    if (zfs_get_type(this->handle_) == ZFS_TYPE_FILESYSTEM &&
+        zfs_unmount(this->handle_, nullptr, 0) != 0) {
+        spdlog::error("failed to unmount zfs dataset '{0}', error {1}",
+                      this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    int err = zfs_destroy(this->handle_, B_FALSE);
+    if (err != 0) {
+        spdlog::error("failed to destroy zfs dataset '{0}', error {1}",
+                      this->name(),
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    return true;
+}
+
+bool dataset::destroy_snapshots(const std::string &name) const {
+    spdlog::debug("destroying zfs snapshots '{0}@{1}' recursively",
+                  this->name(), name);
+
+    // libzfs takes a non-const name
+    std::vector<char> snapshot_name(name.begin(), name.end());
+    snapshot_name.push_back('\0');
+
+    int err = zfs_destroy_snaps(this->handle_, snapshot_name.data(), B_FALSE);
+    if (err != 0) {
+        spdlog::error("failed to destroy zfs snapshots '{0}@{1}', error {2}",
+                      this->name(), name,
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    return true;
+}
+
+bool dataset::send(const std::string &snapshot_name, int fd) const {
+    spdlog::debug("sending zfs dataset '{0}@{1}'", this->name(),
+                  snapshot_name);
+
+    sendflags_t flags = {};
+    flags.replicate = B_TRUE;
+    flags.props = B_TRUE;
+    flags.largeblock = B_TRUE;
+    flags.embed_data = B_TRUE;
+    flags.compress = B_TRUE;
+
+    int err = zfs_send(this->handle_, nullptr, snapshot_name.c_str(), &flags,
+                       fd, nullptr, nullptr, nullptr);
+    if (err != 0) {
+        spdlog::error("failed to send zfs dataset '{0}@{1}', error {2}",
+                      this->name(), snapshot_name,
+                      error_description(zfs_get_handle(this->handle_)));
+        return false;
+    }
+
+    return true;
+}
+
 void dataset::iterate(libzfs_handle_t *zfs,
                       std::vector<std::shared_ptr<dataset>> &datasets) {
     int err = zfs_iter_root(zfs, __iterate_datasets,
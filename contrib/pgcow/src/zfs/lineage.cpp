@@ -0,0 +1,111 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <pgcow/zfs/dataset.h>
+#include <pgcow/zfs/lineage.h>
+
+namespace pgcow {
+namespace zfs {
+
+std::vector<std::shared_ptr<dataset>>
+clones(const std::shared_ptr<dataset> &snapshot) {
+    std::vector<std::shared_ptr<dataset>> clones;
+
+    auto origin_dataset = snapshot->parent();
+    if (!origin_dataset) {
+        return clones;
+    }
+
+    auto siblings_parent = origin_dataset->parent();
+    if (!siblings_parent) {
+        return clones;
+    }
+
+    std::string snapshot_name = snapshot->name();
+    for (const auto &sibling : siblings_parent->children()) {
+        if (sibling->origin() == snapshot_name) {
+            clones.push_back(sibling);
+        }
+    }
+
+    return clones;
+}
+
+std::vector<std::shared_ptr<dataset>>
+dependent_clones(const std::shared_ptr<dataset> &dataset) {
+    std::vector<std::shared_ptr<zfs::dataset>> clones;
+
+    auto siblings_parent = dataset->parent();
+    if (!siblings_parent) {
+        return clones;
+    }
+
+    std::string snapshot_prefix = dataset->name() + "@";
+    for (const auto &sibling : siblings_parent->children()) {
+        if (sibling->origin().compare(0, snapshot_prefix.size(),
+                                      snapshot_prefix) == 0) {
+            clones.push_back(sibling);
+        }
+    }
+
+    return clones;
+}
+
+bool destroy_promoting_clones(const std::shared_ptr<dataset> &dataset) {
+    auto clones = dependent_clones(dataset);
+
+    if (!clones.empty()) {
+        // the clone of the newest snapshot takes over all snapshots
+        // up to and including its origin, and with that all other clones
+        std::map<std::string, uint64_t> snapshot_txgs;
+        for (const auto &snapshot : dataset->snapshots()) {
+            snapshot_txgs[snapshot->name()] = snapshot->creation_txg();
+        }
+
+        std::shared_ptr<zfs::dataset> heir;
+        uint64_t heir_origin_txg = 0;
+
+        for (const auto &clone : clones) {
+            auto origin = snapshot_txgs.find(clone->origin());
+            if (origin == snapshot_txgs.end()) {
+                continue;
+            }
+
+            uint64_t origin_txg = origin->second;
+            if (!heir || origin_txg > heir_origin_txg) {
+                heir = clone;
+                heir_origin_txg = origin_txg;
+            }
+        }
+
+        if (!heir) {
+            spdlog::error("cannot find origin snapshots of clones of zfs "
+                          "dataset '{0}'",
+                          dataset->name());
+            return false;
+        }
+
+        spdlog::debug("promoting zfs clone '{0}' to release zfs dataset '{1}'",
+                      heir->name(), dataset->name());
+
+        if (!heir->promote()) {
+            return false;
+        }
+    }
+
+    // whatever is left is newer than the origin of any clone
+    for (const auto &snapshot : dataset->snapshots()) {
+        if (!snapshot->destroy()) {
+            return false;
+        }
+    }
+
+    return dataset->destroy();
+}
+
+} // namespace zfs
+} // namespace pgcow
@@ -514,7 +514,7 @@ SELECT t1.c1 FROM ft1 t1 WHERE EXISTS (SELECT 1 FROM ft2 t2 WHERE t1.c1 = t2.c1)
 EXPLAIN (VERBOSE, COSTS OFF)
 SELECT t1.c1 FROM ft1 t1 WHERE NOT EXISTS (SELECT 1 FROM ft2 t2 WHERE t1.c1 = t2.c2) ORDER BY t1.c1 OFFSET 100 LIMIT 10;
 SELECT t1.c1 FROM ft1 t1 WHERE NOT EXISTS (SELECT 1 FROM ft2 t2 WHERE t1.c1 = t2.c2) ORDER BY t1.c1 OFFSET 100 LIMIT 10;
--- CROSS JOIN, not pushed down
+-- CROSS JOIN can be pushed down
 EXPLAIN (VERBOSE, COSTS OFF)
 SELECT t1.c1, t2.c1 FROM ft1 t1 CROSS JOIN ft2 t2 ORDER BY t1.c1, t2.c1 OFFSET 100 LIMIT 10;
 SELECT t1.c1, t2.c1 FROM ft1 t1 CROSS JOIN ft2 t2 ORDER BY t1.c1, t2.c1 OFFSET 100 LIMIT 10;
@@ -2031,9 +2031,39 @@ copy remp1 from stdin;
 
 select tableoid::regclass, * FROM remp1;
 
+-- Rows for local partitions are buffered, but those for foreign partitions
+-- are inserted one at a time.  The buffered rows must be written out first,
+-- so that the AFTER ROW triggers fire in input order.
+create table ctrtest_local (b text, a int check (a in (3)));
+alter table ctrtest attach partition ctrtest_local for values in (3);
+create table ctrtest_log (n serial, tab text, a int, b text);
+create function ctrtest_log_row() returns trigger as $$
+begin
+  insert into ctrtest_log (tab, a, b) values (TG_TABLE_NAME, new.a, new.b);
+  return null;
+end;
+$$ language plpgsql;
+create trigger ctrtest_log after insert on ctrtest
+  for each row execute procedure ctrtest_log_row();
+
+copy ctrtest from stdin;
+3	one
+3	two
+2	three
+3	four
+1	five
+3	six
+3	seven
+\.
+
+select tableoid::regclass, * FROM ctrtest order by a, b;
+select * from ctrtest_log order by n;
+
 drop table ctrtest;
 drop table loct1;
 drop table loct2;
+drop table ctrtest_log;
+drop function ctrtest_log_row();
 
 -- ===================================================================
 -- test COPY FROM
@@ -20,19 +20,25 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/heapam.h"
 #include "access/xloginsert.h"
 #include "access/xlog.h"
+#include "commands/dbcommands.h"
 #include "commands/vacuum.h"
 #include "catalog/pg_am.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/acl.h"
+#include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/indexfsm.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
 
 /* GUC parameter */
 int			gin_pending_list_limit = 0;
@@ -40,6 +46,13 @@ int			gin_pending_list_limit = 0;
 #define GIN_PAGE_FREESIZE \
 	( BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(GinPageOpaqueData)) )
 
+/*
+ * Pending list cleanup is normally left to autovacuum.  If the list grows to
+ * this many times gin_pending_list_limit anyway, because autovacuum hasn't
+ * got to it yet, inserting backends go back to cleaning it themselves.
+ */
+#define GIN_PENDING_LIST_FOREGROUND_FACTOR	4
+
 typedef struct KeyArray
 {
 	Datum	   *keys;			/* expansible array */
@@ -48,6 +61,8 @@ typedef struct KeyArray
 	int32		maxvalues;		/* allocated size of arrays */
 } KeyArray;
 
+static bool requestPendingListCleanup(Relation index);
+
 
 /*
  * Build a pending-list page from the given array of tuples, and write it out.
@@ -226,7 +241,9 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
-	int			cleanupSize;
+	bool		needForegroundCleanup = false;
+	int64		pendingSize;
+	int64		cleanupSize;
 	bool		needWal;
 
 	if (collector->ntuples == 0)
@@ -436,18 +453,24 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 		UnlockReleaseBuffer(buffer);
 
 	/*
-	 * Force pending list cleanup when it becomes too long. And,
-	 * ginInsertCleanup could take significant amount of time, so we prefer to
-	 * call it when it can do all the work in a single collection cycle. In
-	 * non-vacuum mode, it shouldn't require maintenance_work_mem, so fire it
-	 * while pending list is still small enough to fit into
-	 * gin_pending_list_limit.
+	 * Force pending list cleanup when it becomes too long.  ginInsertCleanup
+	 * could take significant amount of time, so we'd rather not make the
+	 * inserting backend wait for it: ask autovacuum to do it in the
+	 * background instead.  Only if that's not possible, or if the list has
+	 * kept growing well past the limit while waiting for autovacuum, do we
+	 * clean it up here, with just work_mem to collect entries in.  Even
+	 * then ginInsertCleanup merges no more than the limit's worth of pages,
+	 * so the inserting backend never does more work than it did before
+	 * cleanup was handed to autovacuum.
 	 *
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
-	cleanupSize = GinGetPendingListCleanupSize(index);
-	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
+	cleanupSize = (int64) GinGetPendingListCleanupSize(index) * 1024L;
+	pendingSize = (int64) metadata->nPendingPages * GIN_PAGE_FREESIZE;
+	if (pendingSize > cleanupSize)
 		needCleanup = true;
+	if (pendingSize > GIN_PENDING_LIST_FOREGROUND_FACTOR * cleanupSize)
+		needForegroundCleanup = true;
 
 	UnlockReleaseBuffer(metabuffer);
 
@@ -457,10 +480,45 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 * Since it could contend with concurrent cleanup process we cleanup
 	 * pending list not forcibly.
 	 */
-	if (needCleanup)
+	if (needCleanup &&
+		(needForegroundCleanup || !requestPendingListCleanup(index)))
 		ginInsertCleanup(ginstate, false, true, false, NULL);
 }
 
+/*
+ * Ask autovacuum to clean up the pending list of the index in the
+ * background.  Returns false if it can't, in which case the caller had better
+ * do it itself.
+ */
+static bool
+requestPendingListCleanup(Relation index)
+{
+	Relation	heapRel;
+	bool		enabled;
+
+	/*
+	 * An autovacuum worker can't see temporary relations, nor ones created
+	 * by our still-running transaction.
+	 */
+	if (!AutoVacuumingActive() || RELATION_IS_LOCAL(index))
+		return false;
+
+	/*
+	 * Respect autovacuum_enabled = off on the table, too.  The inserting
+	 * transaction holds a lock on it, so it can't go away under us.
+	 */
+	heapRel = RelationIdGetRelation(index->rd_index->indrelid);
+	enabled = heapRel->rd_options == NULL ||
+		((StdRdOptions *) heapRel->rd_options)->autovacuum.enabled;
+	RelationClose(heapRel);
+	if (!enabled)
+		return false;
+
+	return AutoVacuumRequestWork(AVW_GINCleanPendingList,
+								 RelationGetRelid(index),
+								 InvalidBlockNumber);
+}
+
 /*
  * Create temporary index tuples for a single indexable item (one index column
  * for the heap tuple specified by ht_ctid), and append them to the array
@@ -751,7 +809,12 @@ processPendingPage(BuildAccumulator *accum, KeyArray *ka,
  * to FSM otherwise caller is responsible to put deleted pages into
  * FSM.
  *
+ * If forceCleanup is false, we're called by an inserting backend, and merge
+ * only up to gin_pending_list_limit's worth of pages.
+ *
  * If stats isn't null, we count deleted pending pages into the counts.
+ * Whoever does the work, the cleanup is also reported to the statistics
+ * collector, with the number of pages merged and the time it took.
  */
 void
 ginInsertCleanup(GinState *ginstate, bool full_clean,
@@ -773,6 +836,10 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 	bool		cleanupFinish = false;
 	bool		fsm_vac = false;
 	Size		workMemory;
+	int64		maxPages;
+	int64		npages = 0;
+	instr_time	starttime;
+	instr_time	duration;
 
 	/*
 	 * We would like to prevent concurrent cleanup process. For that we will
@@ -791,6 +858,7 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 		workMemory =
 			(IsAutoVacuumWorkerProcess() && autovacuum_work_mem != -1) ?
 			autovacuum_work_mem : maintenance_work_mem;
+		maxPages = PG_INT64_MAX;
 	}
 	else
 	{
@@ -802,6 +870,15 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 		if (!ConditionalLockPage(index, GIN_METAPAGE_BLKNO, ExclusiveLock))
 			return;
 		workMemory = work_mem;
+
+		/*
+		 * The list may have grown well past gin_pending_list_limit while
+		 * waiting for autovacuum to clean it up.  Don't make the inserting
+		 * backend merge more than the limit's worth of pages; the rest is
+		 * left for whoever comes next.
+		 */
+		maxPages = Max((int64) GinGetPendingListCleanupSize(index) * 1024L /
+					   GIN_PAGE_FREESIZE, 1);
 	}
 
 	metabuffer = ReadBuffer(index, GIN_METAPAGE_BLKNO);
@@ -817,6 +894,8 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 		return;
 	}
 
+	INSTR_TIME_SET_CURRENT(starttime);
+
 	/*
 	 * Remember a tail page to prevent infinite cleanup if other backends add
 	 * new tuples faster than we can cleanup.
@@ -868,17 +947,19 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 		 * read page's datums into accum
 		 */
 		processPendingPage(&accum, &datums, page, FirstOffsetNumber);
+		npages++;
 
 		vacuum_delay_point();
 
 		/*
 		 * Is it time to flush memory to disk?	Flush if we are at the end of
 		 * the pending list, or if we have a full row and memory is getting
-		 * full.
+		 * full or we have read as many pages as we're allowed to.
 		 */
 		if (GinPageGetOpaque(page)->rightlink == InvalidBlockNumber ||
 			(GinPageHasFullRow(page) &&
-			 (accum.allocatedMemory >= workMemory * 1024L)))
+			 (accum.allocatedMemory >= workMemory * 1024L ||
+			  npages >= maxPages)))
 		{
 			ItemPointerData *list;
 			uint32		nlist;
@@ -958,9 +1039,11 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 
 			/*
 			 * if we removed the whole pending list or we cleanup tail (which
-			 * we remembered on start our cleanup process) then just exit
+			 * we remembered on start our cleanup process) or we have used up
+			 * our page budget then just exit
 			 */
-			if (blkno == InvalidBlockNumber || cleanupFinish)
+			if (blkno == InvalidBlockNumber || cleanupFinish ||
+				npages >= maxPages)
 				break;
 
 			/*
@@ -999,6 +1082,72 @@ ginInsertCleanup(GinState *ginstate, bool full_clean,
 	/* Clean up temporary space */
 	MemoryContextSwitchTo(oldCtx);
 	MemoryContextDelete(opCtx);
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, starttime);
+	pgstat_count_gin_pending_cleanup(index, npages,
+									 INSTR_TIME_GET_MICROSEC(duration));
+}
+
+/*
+ * Clean up the pending list of an index, as an autovacuum work item
+ * requested by ginHeapTupleFastInsert().
+ *
+ * Unlike gin_clean_pending_list(), this stops at the tail the list had when
+ * we started, as a vacuum would, so that we don't keep chasing concurrent
+ * insertions.  The duration is logged if it exceeds
+ * log_autovacuum_min_duration.
+ */
+void
+ginCleanPendingList(Oid indexoid)
+{
+	Relation	indexRel;
+	IndexBulkDeleteResult stats;
+	GinState	ginstate;
+	TimestampTz starttime = 0;
+
+	/* The index might have been dropped since the request was made */
+	indexRel = try_relation_open(indexoid, AccessShareLock);
+	if (indexRel == NULL)
+		return;
+
+	if (indexRel->rd_rel->relkind != RELKIND_INDEX ||
+		indexRel->rd_rel->relam != GIN_AM_OID)
+	{
+		relation_close(indexRel, AccessShareLock);
+		return;
+	}
+
+	if (Log_autovacuum_min_duration >= 0)
+		starttime = GetCurrentTimestamp();
+
+	memset(&stats, 0, sizeof(stats));
+	initGinState(&ginstate, indexRel);
+	ginInsertCleanup(&ginstate, false, true, true, &stats);
+
+	if (Log_autovacuum_min_duration >= 0)
+	{
+		TimestampTz endtime = GetCurrentTimestamp();
+
+		if (Log_autovacuum_min_duration == 0 ||
+			TimestampDifferenceExceeds(starttime, endtime,
+									   Log_autovacuum_min_duration))
+		{
+			long		secs;
+			int			usecs;
+
+			TimestampDifference(starttime, endtime, &secs, &usecs);
+			ereport(LOG,
+					(errmsg("automatic GIN pending list cleanup of index \"%s.%s.%s\": pages merged: %u, elapsed: %ld.%03d s",
+							get_database_name(MyDatabaseId),
+							get_namespace_name(RelationGetNamespace(indexRel)),
+							RelationGetRelationName(indexRel),
+							stats.pages_deleted,
+							secs, usecs / 1000)));
+		}
+	}
+
+	relation_close(indexRel, AccessShareLock);
 }
 
 /*
@@ -16,17 +16,109 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/smgr.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/tuplesort.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.  Note that there is a separate tuplesort TOC
+ * entry, private to tuplesort.c but allocated by this module on its behalf.
+ *
+ * A parallel build works much like a serial one, except that each
+ * participant scans part of the heap, and instead of inserting what it has
+ * accumulated into the index, feeds it to a shared sort as entry tuples,
+ * each holding a key and a run of that key's heap TIDs.  The leader then
+ * reads the sorted tuples, merges the TID runs of each key (runs from
+ * different participants interleave, as the heap is handed out a block at a
+ * time), and inserts each key once with all of its TIDs, in TID order.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scantuplesortstates;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * mutable state that workers maintain during scan (and before leader can
+	 * proceed to tuplesort_performsort()).
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all fields before heapdesc.
+	 *
+	 * nparticipantsdone is number of worker processes finished.  reltuples
+	 * is the total number of input heap tuples, and indtuples the total
+	 * number of entries extracted from them.  brokenhotchain indicates if
+	 * any worker detected a broken HOT chain during build.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * This variable-sized field must come last.
+	 *
+	 * See _gin_parallel_estimate_shared().
+	 */
+	ParallelHeapScanDescData heapdesc;
+} GinShared;
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one for the leader, which always
+	 * participates as a worker.
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).  snapshot is the snapshot used by the scan iff an MVCC
+	 * snapshot is required.
+	 */
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+} GinLeader;
+
 typedef struct
 {
 	GinState	ginstate;
@@ -35,8 +127,31 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+	Size		accumMem;		/* dump the accumulator beyond this size */
+
+	/*
+	 * In a participant of a parallel build, accumulated entries go to this
+	 * sort rather than into the index.
+	 */
+	Tuplesortstate *sortstate;
+
+	/* Only present in the leader of a parallel build */
+	GinLeader  *ginleader;
 } GinBuildState;
 
+static void ginBuildSpool(GinBuildState *buildstate);
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+					Relation index, bool isconcurrent, int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static Size _gin_parallel_estimate_shared(Snapshot snapshot);
+static double _gin_parallel_heapscan(GinBuildState *buildstate,
+					   bool *brokenhotchain);
+static void _gin_parallel_merge(GinBuildState *buildstate, Relation heap,
+					Relation index);
+static void _gin_parallel_scan_and_sort(GinShared *ginshared,
+							Sharedsort *sharedsort, Relation heap,
+							Relation index, int sortmem);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -285,8 +400,14 @@ ginBuildCallback(Relation index, HeapTuple htup, Datum *values,
 							   values[i], isnull[i],
 							   &htup->t_self);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= (Size) maintenance_work_mem * 1024L)
+	/*
+	 * If we've maxed out our available memory, dump everything to the index,
+	 * or to the sort in a parallel build.
+	 */
+	if (buildstate->sortstate &&
+		buildstate->accum.allocatedMemory >= buildstate->accumMem)
+		ginBuildSpool(buildstate);
+	else if (buildstate->accum.allocatedMemory >= buildstate->accumMem)
 	{
 		ItemPointerData *list;
 		Datum		key;
@@ -333,6 +454,9 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	initGinState(&buildstate.ginstate, index);
 	buildstate.indtuples = 0;
 	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.accumMem = (Size) maintenance_work_mem * 1024L;
+	buildstate.sortstate = NULL;
+	buildstate.ginleader = NULL;
 
 	/* initialize the meta page */
 	MetaBuffer = GinNewBuffer(index);
@@ -371,6 +495,25 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	/* count the root as first entry page */
 	buildstate.buildStats.nEntryPages++;
 
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index, indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
+
+	/*
+	 * If at least one worker process was launched, the scan is under way;
+	 * wait for it, then merge what all participants sorted into the index.
+	 */
+	if (buildstate.ginleader)
+	{
+		reltuples = _gin_parallel_heapscan(&buildstate,
+										   &indexInfo->ii_BrokenHotChain);
+		_gin_parallel_merge(&buildstate, heap, index);
+		_gin_end_parallel(buildstate.ginleader);
+
+		goto done;
+	}
+
 	/*
 	 * create a temporary memory context that is used to hold data not yet
 	 * dumped out to the index
@@ -413,6 +556,8 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
 
+done:
+
 	/*
 	 * Update metapage stats
 	 */
@@ -538,3 +683,581 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Feed everything in a parallel build participant's accumulator to its sort,
+ * and reset the accumulator.
+ *
+ * Each key becomes one or more entry tuples: the key, as GinFormTuple forms
+ * it, followed by an uncompressed array of heap TIDs in place of the posting
+ * list.  These tuples are never stored in the index, so they are only
+ * limited by the maximum size of an index tuple; a key with more TIDs than
+ * fit in one is split into several, each holding a sorted run of them.
+ */
+static void
+ginBuildSpool(GinBuildState *buildstate)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		IndexTuple	keytup;
+		Size		offset;
+		uint32		maxitems;
+		uint32		i;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		/* The key on its own must fit, just as in a serial build */
+		keytup = GinFormTuple(ginstate, attnum, key, category,
+							  NULL, 0, 0, true);
+		offset = GinGetPostingOffset(keytup);
+		maxitems = (MAXALIGN_DOWN(INDEX_SIZE_MASK) - offset) /
+			sizeof(ItemPointerData);
+
+		for (i = 0; i < nlist; i += maxitems)
+		{
+			uint32		nitems = Min(maxitems, nlist - i);
+			Size		size;
+			IndexTuple	itup;
+
+			size = MAXALIGN(offset + nitems * sizeof(ItemPointerData));
+			itup = (IndexTuple) palloc0(size);
+			memcpy(itup, keytup, offset);
+			itup->t_info &= ~INDEX_SIZE_MASK;
+			itup->t_info |= size;
+			GinSetNPosting(itup, nitems);
+			memcpy(GinGetPosting(itup), &list[i],
+				   nitems * sizeof(ItemPointerData));
+
+			tuplesort_putgintuple(buildstate->sortstate, itup);
+			pfree(itup);
+		}
+
+		pfree(keytup);
+	}
+
+	MemoryContextReset(buildstate->tmpCtx);
+	ginInitBA(&buildstate->accum);
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		estsort;
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	char	   *sharedquery;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request, true);
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and
+	 * PARALLEL_KEY_TUPLESORT tuplesort workspace
+	 */
+	estginshared = _gin_parallel_estimate_shared(snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	querylen = strlen(debug_query_string);
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->scantuplesortstates = scantuplesortstates;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	heap_parallelscan_initialize(&ginshared->heapdesc, heap, snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Store query string for workers */
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+	memcpy(sharedquery, debug_query_string, querylen + 1);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	ginleader->ginshared = ginshared;
+	ginleader->sharedsort = sharedsort;
+	ginleader->snapshot = snapshot;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->ginleader = ginleader;
+
+	/*
+	 * Join heap scan ourselves.  Might as well use reliable figure when
+	 * doling out maintenance_work_mem (when requested number of workers were
+	 * not launched, this will be somewhat higher than it is for other
+	 * workers).
+	 */
+	_gin_parallel_scan_and_sort(ginshared, sharedsort, heap, index,
+								maintenance_work_mem /
+								ginleader->nparticipanttuplesorts);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Snapshot snapshot)
+{
+	if (!IsMVCCSnapshot(snapshot))
+	{
+		Assert(snapshot == SnapshotAny);
+		return sizeof(GinShared);
+	}
+
+	return add_size(offsetof(GinShared, heapdesc) +
+					offsetof(ParallelHeapScanDescData, phs_snapshot_data),
+					EstimateSnapshotSpace(snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, parallel heap scan started by _gin_begin_parallel() will
+ * already be underway within worker processes (the leader has taken part
+ * in it, so we should end up here just as workers are finishing).
+ *
+ * Fills in fields needed for ambuild statistics, and lets caller set
+ * field indicating that some worker encountered a broken HOT chain.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_heapscan(GinBuildState *buildstate, bool *brokenhotchain)
+{
+	GinShared  *ginshared = buildstate->ginleader->ginshared;
+	int			nparticipanttuplesorts;
+	double		reltuples;
+
+	nparticipanttuplesorts = buildstate->ginleader->nparticipanttuplesorts;
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == nparticipanttuplesorts)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			*brokenhotchain = ginshared->brokenhotchain;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Returns the number of TIDs in sorted array items[] that sort before bound.
+ */
+static uint32
+ginItemsBefore(ItemPointerData *items, uint32 nitems, ItemPointer bound)
+{
+	uint32		lo = 0;
+	uint32		hi = nitems;
+
+	while (lo < hi)
+	{
+		uint32		mid = lo + (hi - lo) / 2;
+
+		if (ginCompareItemPointers(&items[mid], bound) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Within leader, merge the participants' sorted entry tuples into the index.
+ *
+ * The tuples of each key come in the order of their first TID.  Every TID
+ * in the runs still to come for the key therefore follows the first TID of
+ * the current run, so merging a run into the key's TID list only ever
+ * touches the list's tail, and everything before the run's first TID is
+ * final.  When the list grows large we insert that final part and keep
+ * going, so a key's TIDs always reach the index in order and memory stays
+ * bounded however many of them there are.
+ */
+static void
+_gin_parallel_merge(GinBuildState *buildstate, Relation heap, Relation index)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	GinLeader  *ginleader = buildstate->ginleader;
+	SortCoordinate coordinate;
+	Tuplesortstate *sortstate;
+	MemoryContext insertCtx;
+	MemoryContext oldCtx;
+	IndexTuple	itup;
+	IndexTuple	curtup = NULL;
+	OffsetNumber curattnum = InvalidOffsetNumber;
+	Datum		curkey = (Datum) 0;
+	GinNullCategory curcategory = GIN_CAT_NORM_KEY;
+	ItemPointerData *items;
+	uint32		nitems = 0;
+	uint32		maxitems;
+	uint32		maxflush;
+
+	/* Begin the leader's sort, which merges the participants' runs */
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = false;
+	coordinate->nParticipants = ginleader->nparticipanttuplesorts;
+	coordinate->sharedsort = ginleader->sharedsort;
+	sortstate = tuplesort_begin_index_gin(heap, index, ginstate,
+										  maintenance_work_mem, coordinate,
+										  false);
+	tuplesort_performsort(sortstate);
+
+	/* ginEntryInsert can leak, so call it in a context reset after each */
+	insertCtx = AllocSetContextCreate(CurrentMemoryContext,
+									  "Gin build merge context",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	/* Insert final TIDs once the list takes half of maintenance_work_mem */
+	maxflush = Max(((Size) maintenance_work_mem * 1024L / 2) /
+				   sizeof(ItemPointerData), MaxHeapTuplesPerPage);
+	maxitems = 1024;
+	items = (ItemPointerData *) palloc(maxitems * sizeof(ItemPointerData));
+
+	for (;;)
+	{
+		OffsetNumber attnum = InvalidOffsetNumber;
+		Datum		key = (Datum) 0;
+		GinNullCategory category = GIN_CAT_NORM_KEY;
+		ItemPointerData *run = NULL;
+		uint32		nrun = 0;
+		uint32		nbefore;
+
+		CHECK_FOR_INTERRUPTS();
+
+		itup = tuplesort_getindextuple(sortstate, true);
+		if (itup != NULL)
+		{
+			attnum = gintuple_get_attrnum(ginstate, itup);
+			key = gintuple_get_key(ginstate, itup, &category);
+			run = (ItemPointerData *) GinGetPosting(itup);
+			nrun = GinGetNPosting(itup);
+		}
+
+		/* At the end, or at the next key, write out the current key */
+		if (curtup != NULL &&
+			(itup == NULL ||
+			 ginCompareAttEntries(ginstate, attnum, key, category,
+								  curattnum, curkey, curcategory) != 0))
+		{
+			oldCtx = MemoryContextSwitchTo(insertCtx);
+			ginEntryInsert(ginstate, curattnum, curkey, curcategory,
+						   items, nitems, &buildstate->buildStats);
+			MemoryContextSwitchTo(oldCtx);
+			MemoryContextReset(insertCtx);
+
+			pfree(curtup);
+			curtup = NULL;
+			nitems = 0;
+		}
+
+		if (itup == NULL)
+			break;
+
+		if (curtup == NULL)
+		{
+			/* Keep the key, which points into the tuple, until we're done */
+			curtup = CopyIndexTuple(itup);
+			curattnum = attnum;
+			curkey = gintuple_get_key(ginstate, curtup, &curcategory);
+		}
+
+		nbefore = ginItemsBefore(items, nitems, &run[0]);
+
+		if (nitems >= maxflush && nbefore > 0)
+		{
+			oldCtx = MemoryContextSwitchTo(insertCtx);
+			ginEntryInsert(ginstate, curattnum, curkey, curcategory,
+						   items, nbefore, &buildstate->buildStats);
+			MemoryContextSwitchTo(oldCtx);
+			MemoryContextReset(insertCtx);
+
+			nitems -= nbefore;
+			memmove(items, items + nbefore, nitems * sizeof(ItemPointerData));
+			nbefore = 0;
+		}
+
+		if (nitems + nrun > maxitems)
+		{
+			while (nitems + nrun > maxitems)
+				maxitems *= 2;
+			items = (ItemPointerData *)
+				repalloc_huge(items, (Size) maxitems * sizeof(ItemPointerData));
+		}
+
+		if (nbefore == nitems)
+		{
+			/* The usual case: the run follows everything we have */
+			memcpy(items + nitems, run, nrun * sizeof(ItemPointerData));
+			nitems += nrun;
+		}
+		else
+		{
+			ItemPointerData *merged;
+			int			nmerged;
+
+			merged = ginMergeItemPointers(items + nbefore, nitems - nbefore,
+										  run, nrun, &nmerged);
+			memcpy(items + nbefore, merged, nmerged * sizeof(ItemPointerData));
+			nitems = nbefore + nmerged;
+			pfree(merged);
+		}
+	}
+
+	pfree(items);
+	MemoryContextDelete(insertCtx);
+	tuplesort_end(sortstate);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, false);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = heap_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Look up shared state private to tuplesort.c */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	_gin_parallel_scan_and_sort(ginshared, sharedsort, heapRel, indexRel,
+								maintenance_work_mem /
+								ginshared->scantuplesortstates);
+
+	index_close(indexRel, indexLockmode);
+	heap_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build: scan its share of
+ * the heap, accumulating entries as a serial build would, and sort them.
+ *
+ * sortmem is the amount of working memory to use within each participant,
+ * expressed in KBs.  Half of it goes to the accumulator, and half to the
+ * sort.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_gin_parallel_scan_and_sort(GinShared *ginshared, Sharedsort *sharedsort,
+							Relation heap, Relation index, int sortmem)
+{
+	SortCoordinate coordinate;
+	GinBuildState buildstate;
+	HeapScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+	MemoryContext oldCtx;
+
+	/* Initialize local tuplesort coordination state */
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Fill in buildstate for ginBuildCallback() */
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.accumMem = (Size) Max(sortmem / 2, 64) * 1024L;
+	buildstate.ginleader = NULL;
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+
+	/* Begin "partial" tuplesort */
+	buildstate.sortstate = tuplesort_begin_index_gin(heap, index,
+													 &buildstate.ginstate,
+													 Max(sortmem / 2, 64),
+													 coordinate, false);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = heap_beginscan_parallel(heap, &ginshared->heapdesc);
+	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+								   ginBuildCallback, (void *) &buildstate,
+								   scan);
+
+	/* Spool remaining entries, and execute this participant's sort */
+	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+	ginBuildSpool(&buildstate);
+	MemoryContextSwitchTo(oldCtx);
+	tuplesort_performsort(buildstate.sortstate);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+
+	/* We can end tuplesorts immediately */
+	tuplesort_end(buildstate.sortstate);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+}
@@ -2363,6 +2363,9 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->extended_by = 0;
 	return bistate;
 }
 
@@ -2380,6 +2383,9 @@ FreeBulkInsertState(BulkInsertState bistate)
 
 /*
  * ReleaseBulkInsertStatePin - release a buffer currently held in bistate
+ *
+ * This is used when switching to another relation, so also forget the blocks
+ * set aside in the old one.
  */
 void
 ReleaseBulkInsertStatePin(BulkInsertState bistate)
@@ -2387,6 +2393,9 @@ ReleaseBulkInsertStatePin(BulkInsertState bistate)
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
 	bistate->current_buf = InvalidBuffer;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->extended_by = 0;
 }
 
 
@@ -2633,8 +2642,10 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * relation extension or GIN page locks will not conflict between members
 	 * of a lock group, but we don't prohibit that case here because there are
 	 * useful special cases that we can safely allow, such as CREATE TABLE AS.
+	 * Likewise, a worker entry point that has verified its target is safe
+	 * for concurrent inserts (parallel COPY FROM) may lift the restriction.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !ParallelWorkerMayInsert)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
@@ -169,53 +169,91 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 }
 
 /*
- * Extend a relation by multiple blocks to avoid future contention on the
- * relation extension lock.  Our goal is to pre-extend the relation by an
- * amount which ramps up as the degree of contention ramps up, but limiting
- * the result to some sane overall value.
+ * Upper limit on the number of blocks set aside for a bulk insert at a time,
+ * including the block returned to the caller.  64 blocks is 512kB with the
+ * default block size.
+ */
+#define MAX_BULK_EXTEND_BLOCKS	64
+
+/*
+ * Extend a relation by multiple blocks at once, after the block the caller
+ * has just added for itself.  Caller must hold the relation extension lock,
+ * unless the relation is local.
+ *
+ * If we had to wait for the extension lock ('contended'), we add blocks for
+ * the other waiters and enter them in the FSM, so that they can use them
+ * rather than queueing up for the lock again.  The amount ramps up as the
+ * degree of contention ramps up, but is limited to some sane overall value.
+ *
+ * A bulk insert also gets blocks set aside for itself, in bistate.  Their
+ * number doubles with every extension, up to MAX_BULK_EXTEND_BLOCKS, so that
+ * a long COPY only needs to take the extension lock once per that many
+ * blocks, while a short one doesn't leave many unused blocks behind.  They
+ * are entered in the FSM too, so that any the bulk insert doesn't get to
+ * use, for instance because COPY switched to another partition, are found by
+ * later insertions.  Coming last in the relation, blocks that stay empty can
+ * also be truncated away by VACUUM.
+ *
+ * All the blocks are added with a single smgrzeroextend() call, rather than
+ * writing them out one by one, and initialized in shared buffers.
  */
 static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+RelationAddExtraBlocks(Relation relation, BulkInsertState bistate,
+					   bool contended)
 {
-	BlockNumber blockNum,
-				firstBlock = InvalidBlockNumber;
+	BlockNumber firstBlock;
+	BlockNumber blockNum;
+	int			fsmBlocks = 0;
+	int			bulkBlocks = 0;
 	int			extraBlocks;
-	int			lockWaiters;
 
-	/* Use the length of the lock wait queue to judge how much to extend. */
-	lockWaiters = RelationExtensionLockWaiterCount(relation);
-	if (lockWaiters <= 0)
+	if (contended)
+	{
+		/* Use the length of the lock wait queue to judge how much to extend. */
+		int			lockWaiters = RelationExtensionLockWaiterCount(relation);
+
+		/*
+		 * It might seem like multiplying the number of lock waiters by as
+		 * much as 20 is too aggressive, but benchmarking revealed that
+		 * smaller numbers were insufficient.  512 is just an arbitrary cap to
+		 * prevent pathological results.
+		 */
+		if (lockWaiters > 0)
+			fsmBlocks = Min(512, lockWaiters * 20);
+	}
+
+	if (bistate)
+		bulkBlocks = Min(MAX_BULK_EXTEND_BLOCKS - 1, bistate->extended_by);
+
+	extraBlocks = fsmBlocks + bulkBlocks;
+	if (extraBlocks == 0)
 		return;
 
 	/*
-	 * It might seem like multiplying the number of lock waiters by as much as
-	 * 20 is too aggressive, but benchmarking revealed that smaller numbers
-	 * were insufficient.  512 is just an arbitrary cap to prevent
-	 * pathological results.
+	 * Extend the file in one go.  This should generally match the main-line
+	 * extension code in RelationGetBufferForTuple, except that we hold the
+	 * relation extension lock throughout.
 	 */
-	extraBlocks = Min(512, lockWaiters * 20);
+	firstBlock = RelationGetNumberOfBlocks(relation);
+	RelationOpenSmgr(relation);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, extraBlocks,
+				   false);
 
-	do
+	for (blockNum = firstBlock; blockNum < firstBlock + extraBlocks; blockNum++)
 	{
 		Buffer		buffer;
 		Page		page;
 		Size		freespace;
 
 		/*
-		 * Extend by one page.  This should generally match the main-line
-		 * extension code in RelationGetBufferForTuple, except that we hold
-		 * the relation extension lock throughout.
+		 * The block is all zeroes on disk, so there's no point in reading
+		 * it; RBM_ZERO_AND_LOCK gets us a zeroed, locked buffer for it.
 		 */
-		buffer = ReadBufferBI(relation, P_NEW, bistate);
-
-		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		buffer = ReadBufferExtended(relation, MAIN_FORKNUM, blockNum,
+									RBM_ZERO_AND_LOCK,
+									bistate ? bistate->strategy : NULL);
 		page = BufferGetPage(buffer);
 
-		if (!PageIsNew(page))
-			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-				 BufferGetBlockNumber(buffer),
-				 RelationGetRelationName(relation));
-
 		PageInit(page, BufferGetPageSize(buffer), 0);
 
 		/*
@@ -226,15 +264,10 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 		MarkBufferDirty(buffer);
 
 		/* we'll need this info below */
-		blockNum = BufferGetBlockNumber(buffer);
 		freespace = PageGetHeapFreeSpace(page);
 
 		UnlockReleaseBuffer(buffer);
 
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
-
 		/*
 		 * Immediately update the bottom level of the FSM.  This has a good
 		 * chance of making this page visible to other concurrently inserting
@@ -242,7 +275,12 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 		 */
 		RecordPageWithFreeSpace(relation, blockNum, freespace);
 	}
-	while (--extraBlocks > 0);
+
+	if (bulkBlocks > 0)
+	{
+		bistate->next_free = firstBlock;
+		bistate->last_free = firstBlock + bulkBlocks - 1;
+	}
 
 	/*
 	 * Updating the upper levels of the free space map is too expensive to do
@@ -250,7 +288,7 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * subsequent insertion activity sees all of those nifty free pages we
 	 * just inserted.
 	 */
-	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum + 1);
+	FreeSpaceMapVacuumRange(relation, firstBlock, firstBlock + extraBlocks);
 }
 
 /*
@@ -323,6 +361,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	BlockNumber targetBlock,
 				otherBlock;
 	bool		needLock;
+	bool		contended;
 
 	len = MAXALIGN(len);		/* be conservative */
 
@@ -502,6 +541,26 @@ loop:
 			ReleaseBuffer(buffer);
 		}
 
+		/*
+		 * A bulk insert moves on to the next of the blocks it set aside the
+		 * last time it extended the relation, rather than asking the FSM, so
+		 * that it fills them in order.  They were initialized then, but other
+		 * insertions may have found them in the FSM since, so go around the
+		 * loop to check that the tuple still fits.
+		 */
+		if (bistate && bistate->next_free != InvalidBlockNumber)
+		{
+			if (use_fsm)
+				RecordPageWithFreeSpace(relation, targetBlock, pageFreeSpace);
+
+			targetBlock = bistate->next_free;
+			if (bistate->next_free == bistate->last_free)
+				bistate->next_free = bistate->last_free = InvalidBlockNumber;
+			else
+				bistate->next_free++;
+			continue;
+		}
+
 		/* Without FSM, always fall out of the loop and extend */
 		if (!use_fsm)
 			break;
@@ -530,8 +589,11 @@ loop:
 	 * If we need the lock but are not able to acquire it immediately, we'll
 	 * consider extending the relation by multiple blocks at a time to manage
 	 * contention on the relation extension lock.  However, this only makes
-	 * sense if we're using the FSM; otherwise, there's no point.
+	 * sense if we're using the FSM; otherwise, there's no point.  Bulk
+	 * inserts extend by multiple blocks regardless, see
+	 * RelationAddExtraBlocks.
 	 */
+	contended = false;
 	if (needLock)
 	{
 		if (!use_fsm)
@@ -558,21 +620,25 @@ loop:
 			}
 
 			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
+			contended = true;
 		}
 	}
 
 	/*
-	 * In addition to whatever extension we performed above, we always add at
-	 * least one block to satisfy our own request.
-	 *
-	 * XXX This does an lseek - rather expensive - but at the moment it is the
-	 * only way to accurately determine how many blocks are in a relation.  Is
-	 * it worth keeping an accurate file length in shared memory someplace,
-	 * rather than relying on the kernel to do it for us?
+	 * We always add at least one block to satisfy our own request, and then
+	 * maybe some more after it; see RelationAddExtraBlocks.
 	 */
 	buffer = ReadBufferBI(relation, P_NEW, bistate);
 
+	RelationAddExtraBlocks(relation, bistate, contended);
+
+	if (bistate)
+	{
+		bistate->extended_by += 1;
+		if (bistate->next_free != InvalidBlockNumber)
+			bistate->extended_by += bistate->last_free - bistate->next_free + 1;
+	}
+
 	/*
 	 * We can be certain that locking the otherBuffer first is OK, since it
 	 * must have a lower page number.
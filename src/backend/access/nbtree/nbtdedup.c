@@ -0,0 +1,360 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtdedup.c
+ *	  Deduplicate items in Postgres btrees.
+ *
+ * Non-unique indexes on low-cardinality columns store many leaf tuples that
+ * differ only in their heap TIDs.  Deduplication merges such runs into a
+ * single "posting list" tuple holding the key once, followed by a sorted
+ * array of heap TIDs.  It is done while building an index, and lazily when
+ * an insertion finds that a leaf page is full, in the hope of avoiding a
+ * page split.  See the comments for INDEX_ALT_TID_MASK in nbtree.h for the
+ * tuple format.
+ *
+ * We only merge tuples whose key attributes are bitwise identical.  That is
+ * stricter than equality according to the operator class (numeric 1.0 and
+ * 1.00 are equal, but are never merged), but it is safe for every data type
+ * and means that a posting list tuple always returns exactly the values
+ * that were inserted, including any INCLUDE columns.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/nbtree/nbtdedup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/nbtree.h"
+#include "access/nbtxlog.h"
+#include "access/xloginsert.h"
+#include "catalog/catalog.h"
+#include "miscadmin.h"
+#include "utils/rel.h"
+
+static Size _bt_keysize(IndexTuple itup);
+static int	_bt_itemptr_cmp(const void *a, const void *b);
+
+
+/*
+ * Is deduplication enabled for this index?
+ *
+ * Unique indexes are never deduplicated: the few duplicates they have are
+ * there only until VACUUM removes them, and _bt_check_unique() expects to
+ * find one heap TID per leaf tuple.
+ *
+ * Neither are system catalog indexes.  Catalog scans return equal keys in
+ * index order, and some of them show it to the user, like the list of
+ * dependent objects that DROP prints.  With posting lists merged lazily,
+ * that order would depend on when each leaf page last filled up.
+ */
+bool
+_bt_dedup_enabled(Relation rel)
+{
+	StdRdOptions *relopts = (StdRdOptions *) rel->rd_options;
+
+	if (rel->rd_index->indisunique || IsCatalogRelation(rel))
+		return false;
+
+	return relopts == NULL || relopts->deduplicate_items;
+}
+
+/*
+ * Size of the part of a leaf tuple that precedes its heap TIDs: the whole
+ * tuple for an ordinary tuple, or the part before the posting list.
+ */
+static Size
+_bt_keysize(IndexTuple itup)
+{
+	if (BTreeTupleIsPosting(itup))
+		return BTreeTupleGetPostingOffset(itup);
+
+	return IndexTupleSize(itup);
+}
+
+/*
+ * Do two leaf tuples have bitwise identical keys, so that they may be
+ * merged into one posting list tuple?
+ *
+ * Either tuple may be a posting list tuple.
+ */
+bool
+_bt_dedup_keys_equal(IndexTuple a, IndexTuple b)
+{
+	Size		keysize = _bt_keysize(a);
+
+	if (keysize != _bt_keysize(b))
+		return false;
+	if ((a->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)) !=
+		(b->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)))
+		return false;
+
+	/* the null bitmap, if any, and the data follow the fixed header */
+	return memcmp((char *) a + sizeof(IndexTupleData),
+				  (char *) b + sizeof(IndexTupleData),
+				  keysize - sizeof(IndexTupleData)) == 0;
+}
+
+/*
+ * Form a tuple with the key of 'base' and the given heap TIDs, which must be
+ * in ascending order.  'base' may itself be a posting list tuple; its own
+ * heap TIDs are ignored.
+ *
+ * If nhtids is 1, the result is an ordinary leaf tuple.  That is also how
+ * callers get at the key of a posting list tuple without its posting list.
+ * The result is palloc'd.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysize = _bt_keysize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(nhtids > 0);
+	Assert(keysize == MAXALIGN(keysize));
+
+	if (nhtids > 1)
+		newsize = MAXALIGN(keysize + nhtids * sizeof(ItemPointerData));
+	else
+		newsize = keysize;
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysize);
+	itup->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	itup->t_info |= newsize;
+
+	if (nhtids > 1)
+	{
+		BTreeTupleSetPosting(itup, nhtids, keysize);
+		memcpy(BTreeTupleGetPosting(itup), htids,
+			   nhtids * sizeof(ItemPointerData));
+	}
+	else
+		ItemPointerCopy(htids, &itup->t_tid);
+
+	return itup;
+}
+
+/*
+ * Try to make room on a full leaf page by merging runs of duplicates into
+ * posting list tuples.
+ *
+ * The caller must hold an exclusive lock on the buffer.  A super-exclusive
+ * lock isn't needed: items move to different offsets, but no heap TID is
+ * removed, so a concurrent scan holding a pin can at worst fail to set
+ * LP_DEAD hints for the items it returned.  LP_DEAD items are never merged,
+ * so that their hint survives for _bt_vacuum_one_page().
+ *
+ * Returns true if the page was modified.
+ */
+bool
+_bt_dedup_one_page(Relation rel, Buffer buf)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	Size		maxpostingsize = BTMaxPostingSize(page);
+	OffsetNumber offnum,
+				maxoff;
+	BTDedupInterval *intervals;
+	int			nintervals = 0;
+	Page		newpage;
+
+	Assert(P_ISLEAF(opaque));
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	intervals = (BTDedupInterval *)
+		palloc(sizeof(BTDedupInterval) * (maxoff / 2 + 1));
+
+	/*
+	 * Find maximal runs of adjacent live items with identical keys.  A run
+	 * ends early if adding the next item would make the posting list tuple
+	 * too big; the next item then starts a new run.
+	 */
+	offnum = P_FIRSTDATAKEY(opaque);
+	while (offnum <= maxoff)
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	base;
+		Size		keysize;
+		int			nhtids;
+		OffsetNumber next;
+
+		if (ItemIdIsDead(itemid))
+		{
+			offnum = OffsetNumberNext(offnum);
+			continue;
+		}
+
+		base = (IndexTuple) PageGetItem(page, itemid);
+		keysize = _bt_keysize(base);
+		nhtids = BTreeTupleGetNHeapTIDs(base);
+
+		for (next = OffsetNumberNext(offnum);
+			 next <= maxoff;
+			 next = OffsetNumberNext(next))
+		{
+			ItemId		nextid = PageGetItemId(page, next);
+			IndexTuple	itup;
+			int			n;
+
+			if (ItemIdIsDead(nextid))
+				break;
+			itup = (IndexTuple) PageGetItem(page, nextid);
+			if (!_bt_dedup_keys_equal(base, itup))
+				break;
+
+			n = BTreeTupleGetNHeapTIDs(itup);
+			if (MAXALIGN(keysize + (nhtids + n) * sizeof(ItemPointerData)) >
+				maxpostingsize)
+				break;
+			nhtids += n;
+		}
+
+		if (next - offnum > 1)
+		{
+			intervals[nintervals].baseoff = offnum;
+			intervals[nintervals].nitems = next - offnum;
+			nintervals++;
+		}
+		offnum = next;
+	}
+
+	if (nintervals == 0)
+	{
+		pfree(intervals);
+		return false;
+	}
+
+	/* Build the new page before entering the critical section */
+	newpage = _bt_dedup_form_page(page, intervals, nintervals);
+
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+	MarkBufferDirty(buf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		xl_btree_dedup xlrec_dedup;
+
+		xlrec_dedup.nintervals = nintervals;
+
+		XLogBeginInsert();
+		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+		XLogRegisterData((char *) &xlrec_dedup, SizeOfBtreeDedup);
+
+		/*
+		 * The intervals array is not in the buffer, but pretend that it is.
+		 * When XLogInsert stores the whole buffer, the array need not be
+		 * stored too.
+		 */
+		XLogRegisterBufData(0, (char *) intervals,
+							nintervals * sizeof(BTDedupInterval));
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_DEDUP);
+
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	pfree(intervals);
+
+	return true;
+}
+
+/*
+ * Return a temporary copy of a leaf page with each of the given runs of
+ * items merged into a single posting list tuple.
+ *
+ * This is shared with WAL replay, so it must be deterministic given the
+ * page and the intervals.  The caller installs the result with
+ * PageRestoreTempPage().
+ */
+Page
+_bt_dedup_form_page(Page page, BTDedupInterval *intervals, int nintervals)
+{
+	Page		newpage = PageGetTempPageCopySpecial(page);
+	OffsetNumber offnum,
+				newoff,
+				maxoff;
+	ItemPointer htids;
+	int			i = 0;
+
+	htids = (ItemPointer) palloc(sizeof(ItemPointerData) * MaxTIDsPerBTreePage);
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	offnum = FirstOffsetNumber;
+	newoff = FirstOffsetNumber;
+	while (offnum <= maxoff)
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+		if (i < nintervals && intervals[i].baseoff == offnum)
+		{
+			IndexTuple	posting;
+			int			nhtids = 0;
+			int			j;
+
+			for (j = 0; j < intervals[i].nitems; j++)
+			{
+				IndexTuple	dup;
+
+				dup = (IndexTuple) PageGetItem(page,
+											   PageGetItemId(page, offnum + j));
+				Assert(_bt_dedup_keys_equal(itup, dup));
+				if (BTreeTupleIsPosting(dup))
+				{
+					memcpy(htids + nhtids, BTreeTupleGetPosting(dup),
+						   BTreeTupleGetNPosting(dup) * sizeof(ItemPointerData));
+					nhtids += BTreeTupleGetNPosting(dup);
+				}
+				else
+					htids[nhtids++] = dup->t_tid;
+			}
+			qsort(htids, nhtids, sizeof(ItemPointerData), _bt_itemptr_cmp);
+
+			posting = _bt_form_posting(itup, htids, nhtids);
+			if (PageAddItem(newpage, (Item) posting,
+							MAXALIGN(IndexTupleSize(posting)), newoff,
+							false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add posting list tuple to index page");
+			pfree(posting);
+
+			offnum += intervals[i].nitems;
+			i++;
+		}
+		else
+		{
+			if (PageAddItem(newpage, (Item) itup, ItemIdGetLength(itemid),
+							newoff, false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add item to index page");
+			if (ItemIdIsDead(itemid))
+				ItemIdMarkDead(PageGetItemId(newpage, newoff));
+
+			offnum = OffsetNumberNext(offnum);
+		}
+		newoff = OffsetNumberNext(newoff);
+	}
+	Assert(i == nintervals);
+
+	pfree(htids);
+
+	return newpage;
+}
+
+/*
+ * qsort comparator for heap TIDs
+ */
+static int
+_bt_itemptr_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
@@ -623,7 +623,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
  *		any existing equal keys because of the way _bt_binsrch() works.
  *
  *		If there's not enough room in the space, we try to make room by
- *		removing any LP_DEAD tuples.
+ *		removing any LP_DEAD tuples, and then by deduplicating the page.
  *
  *		On entry, *bufptr and *offsetptr point to the first legal position
  *		where the new tuple could be inserted.  The caller should hold an
@@ -726,6 +726,20 @@ _bt_findinsertloc(Relation rel,
 				break;			/* OK, now we have enough space */
 		}
 
+		/*
+		 * still not enough, so see if merging duplicates into posting list
+		 * tuples helps.  This moves tuples around too, so it also makes the
+		 * caller's hint invalid.
+		 */
+		if (P_ISLEAF(lpageop) && _bt_dedup_enabled(rel) &&
+			_bt_dedup_one_page(rel, buf))
+		{
+			vacuumed = true;
+
+			if (PageGetFreeSpace(page) >= itemsz)
+				break;			/* OK, now we have enough space */
+		}
+
 		/*
 		 * nope, so check conditions (b) and (c) enumerated above
 		 */
@@ -1132,7 +1146,8 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber newitemoff,
 	OffsetNumber maxoff;
 	OffsetNumber i;
 	bool		newitemonleft,
-				isleaf;
+				isleaf,
+				loglhikey;
 	IndexTuple	lefthikey;
 	int			indnatts = IndexRelationGetNumberOfAttributes(rel);
 	int			indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
@@ -1233,6 +1248,13 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber newitemoff,
 		itemsz = IndexTupleSize(lefthikey);
 		itemsz = MAXALIGN(itemsz);
 	}
+	else if (isleaf && BTreeTupleIsPosting(item))
+	{
+		/* a high key is never a posting list tuple; keep just the key */
+		lefthikey = _bt_form_posting(item, BTreeTupleGetHeapTID(item), 1);
+		itemsz = IndexTupleSize(lefthikey);
+		itemsz = MAXALIGN(itemsz);
+	}
 	else
 		lefthikey = item;
 
@@ -1249,6 +1271,7 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber newitemoff,
 			 origpagenumber, RelationGetRelationName(rel));
 	leftoff = OffsetNumberNext(leftoff);
 	/* be tidy */
+	loglhikey = (lefthikey != item);
 	if (lefthikey != item)
 		pfree(lefthikey);
 
@@ -1497,7 +1520,6 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber newitemoff,
 		xl_btree_split xlrec;
 		uint8		xlinfo;
 		XLogRecPtr	recptr;
-		bool		loglhikey = false;
 
 		xlrec.level = ropaque->btpo.level;
 		xlrec.firstright = firstright;
@@ -1527,15 +1549,16 @@ _bt_split(Relation rel, Buffer buf, Buffer cbuf, OffsetNumber newitemoff,
 			XLogRegisterBufData(0, (char *) newitem, MAXALIGN(newitemsz));
 
 		/* Log left page */
-		if (!isleaf || indnatts != indnkeyatts)
+		if (!isleaf || loglhikey)
 		{
 			/*
-			 * We must also log the left page's high key.  There are two
+			 * We must also log the left page's high key.  There are three
 			 * reasons for that: right page's leftmost key is suppressed on
-			 * non-leaf levels and in covering indexes included columns are
-			 * truncated from high keys.  Show it as belonging to the left
-			 * page buffer, so that it is not stored if XLogInsert decides it
-			 * needs a full-page image of the left page.
+			 * non-leaf levels, in covering indexes included columns are
+			 * truncated from high keys, and a posting list is stripped from
+			 * the high key.  Show it as belonging to the left page buffer, so
+			 * that it is not stored if XLogInsert decides it needs a
+			 * full-page image of the left page.
 			 */
 			itemid = PageGetItemId(origpage, P_HIKEY);
 			item = (IndexTuple) PageGetItem(origpage, itemid);
@@ -908,6 +908,11 @@ _bt_page_recyclable(Page page)
  * This routine assumes that the caller has pinned and locked the buffer.
  * Also, the given itemnos *must* appear in increasing order in the array.
  *
+ * Posting list tuples that have lost only some of their heap TIDs are
+ * replaced instead: updated[i] overwrites the item at updatenos[i].  The
+ * updates are applied before the deletions, so both sets of offsets refer
+ * to the page as it is on entry.
+ *
  * We record VACUUMs and b-tree deletes differently in WAL. InHotStandby
  * we need to be able to pin all of the blocks in the btree in physical
  * order when replaying the effects of a VACUUM, just as we do for the
@@ -921,15 +926,33 @@ _bt_page_recyclable(Page page)
 void
 _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
+					OffsetNumber *updatenos, IndexTuple *updated, int nupdated,
 					BlockNumber lastBlockVacuumed)
 {
 	Page		page = BufferGetPage(buf);
 	BTPageOpaque opaque;
+	int			i;
+
+	/*
+	 * Each updated tuple is registered as a separate chunk of WAL data, so
+	 * make room for them before entering the critical section.
+	 */
+	if (RelationNeedsWAL(rel))
+		XLogEnsureRecordSpace(0, 3 + nupdated);
 
 	/* No ereport(ERROR) until changes are logged */
 	START_CRIT_SECTION();
 
 	/* Fix the page */
+	for (i = 0; i < nupdated; i++)
+	{
+		Size		itemsz = MAXALIGN(IndexTupleSize(updated[i]));
+
+		if (!PageIndexTupleOverwrite(page, updatenos[i], (Item) updated[i],
+									 itemsz))
+			elog(PANIC, "failed to update posting list tuple in index \"%s\"",
+				 RelationGetRelationName(rel));
+	}
 	if (nitems > 0)
 		PageIndexMultiDelete(page, itemnos, nitems);
 
@@ -958,18 +981,28 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		xl_btree_vacuum xlrec_vacuum;
 
 		xlrec_vacuum.lastBlockVacuumed = lastBlockVacuumed;
+		xlrec_vacuum.ndeleted = nitems;
+		xlrec_vacuum.nupdated = nupdated;
 
 		XLogBeginInsert();
 		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
 		XLogRegisterData((char *) &xlrec_vacuum, SizeOfBtreeVacuum);
 
 		/*
-		 * The target-offsets array is not in the buffer, but pretend that it
-		 * is.  When XLogInsert stores the whole buffer, the offsets array
-		 * need not be stored too.
+		 * The target-offsets array and the updated tuples are not in the
+		 * buffer, but pretend that they are.  When XLogInsert stores the
+		 * whole buffer, they need not be stored too.
 		 */
 		if (nitems > 0)
 			XLogRegisterBufData(0, (char *) itemnos, nitems * sizeof(OffsetNumber));
+		if (nupdated > 0)
+		{
+			XLogRegisterBufData(0, (char *) updatenos,
+								nupdated * sizeof(OffsetNumber));
+			for (i = 0; i < nupdated; i++)
+				XLogRegisterBufData(0, (char *) updated[i],
+									MAXALIGN(IndexTupleSize(updated[i])));
+		}
 
 		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_VACUUM);
 
@@ -96,6 +96,9 @@ static void btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 			 BTCycleId cycleid, TransactionId *oldestBtpoXact);
 static void btvacuumpage(BTVacState *vstate, BlockNumber blkno,
 			 BlockNumber orig_blkno);
+static IndexTuple btvacuumposting(IndexTuple itup,
+				IndexBulkDeleteCallback callback, void *callback_state,
+				int *nremaining);
 
 
 /*
@@ -261,8 +264,8 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 				 */
 				if (so->killedItems == NULL)
 					so->killedItems = (int *)
-						palloc(MaxIndexTuplesPerPage * sizeof(int));
-				if (so->numKilled < MaxIndexTuplesPerPage)
+						palloc(MaxTIDsPerBTreePage * sizeof(int));
+				if (so->numKilled < MaxTIDsPerBTreePage)
 					so->killedItems[so->numKilled++] = so->currPos.itemIndex;
 			}
 
@@ -1060,7 +1063,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 								 RBM_NORMAL, info->strategy);
 		LockBufferForCleanup(buf);
 		_bt_checkpage(rel, buf);
-		_bt_delitems_vacuum(rel, buf, NULL, 0, vstate.lastBlockVacuumed);
+		_bt_delitems_vacuum(rel, buf, NULL, 0, NULL, NULL, 0,
+							vstate.lastBlockVacuumed);
 		_bt_relbuf(rel, buf);
 	}
 
@@ -1181,6 +1185,11 @@ restart:
 	{
 		OffsetNumber deletable[MaxOffsetNumber];
 		int			ndeletable;
+		OffsetNumber updatable[MaxIndexTuplesPerPage];
+		IndexTuple	updated[MaxIndexTuplesPerPage];
+		int			nupdatable;
+		int			nhtidsdead,
+					nhtidslive;
 		OffsetNumber offnum,
 					minoff,
 					maxoff;
@@ -1217,24 +1226,28 @@ restart:
 
 		/*
 		 * Scan over all items to see which ones need deleted according to the
-		 * callback function.
+		 * callback function.  A posting list tuple is deleted if all of its
+		 * heap TIDs are dead, and replaced by a smaller one if only some are.
+		 * Live heap TIDs are counted as we go, since a page's item count says
+		 * little about how many tuples it indexes.
 		 */
 		ndeletable = 0;
+		nupdatable = 0;
+		nhtidsdead = 0;
+		nhtidslive = 0;
 		minoff = P_FIRSTDATAKEY(opaque);
 		maxoff = PageGetMaxOffsetNumber(page);
-		if (callback)
+		for (offnum = minoff;
+			 offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
 		{
-			for (offnum = minoff;
-				 offnum <= maxoff;
-				 offnum = OffsetNumberNext(offnum))
-			{
-				IndexTuple	itup;
-				ItemPointer htup;
+			IndexTuple	itup;
 
-				itup = (IndexTuple) PageGetItem(page,
-												PageGetItemId(page, offnum));
-				htup = &(itup->t_tid);
+			itup = (IndexTuple) PageGetItem(page,
+											PageGetItemId(page, offnum));
 
+			if (callback)
+			{
 				/*
 				 * During Hot Standby we currently assume that
 				 * XLOG_BTREE_VACUUM records do not produce conflicts. That is
@@ -1256,17 +1269,43 @@ restart:
 				 * applies to *any* type of index that marks index tuples as
 				 * killed.
 				 */
-				if (callback(htup, callback_state))
+				if (BTreeTupleIsPosting(itup))
+				{
+					IndexTuple	newitup;
+					int			nremaining;
+
+					newitup = btvacuumposting(itup, callback, callback_state,
+											  &nremaining);
+					nhtidsdead += BTreeTupleGetNPosting(itup) - nremaining;
+					nhtidslive += nremaining;
+					if (nremaining == 0)
+						deletable[ndeletable++] = offnum;
+					else if (newitup != NULL)
+					{
+						updatable[nupdatable] = offnum;
+						updated[nupdatable++] = newitup;
+					}
+					continue;
+				}
+				if (callback(&itup->t_tid, callback_state))
+				{
 					deletable[ndeletable++] = offnum;
+					nhtidsdead++;
+					continue;
+				}
 			}
+
+			nhtidslive += BTreeTupleGetNHeapTIDs(itup);
 		}
 
 		/*
-		 * Apply any needed deletes.  We issue just one _bt_delitems_vacuum()
-		 * call per page, so as to minimize WAL traffic.
+		 * Apply any needed deletes and updates.  We issue just one
+		 * _bt_delitems_vacuum() call per page, so as to minimize WAL traffic.
 		 */
-		if (ndeletable > 0)
+		if (ndeletable > 0 || nupdatable > 0)
 		{
+			int			i;
+
 			/*
 			 * Notice that the issued XLOG_BTREE_VACUUM WAL record includes
 			 * all information to the replay code to allow it to get a cleanup
@@ -1282,7 +1321,10 @@ restart:
 			 * that.
 			 */
 			_bt_delitems_vacuum(rel, buf, deletable, ndeletable,
+								updatable, updated, nupdatable,
 								vstate->lastBlockVacuumed);
+			for (i = 0; i < nupdatable; i++)
+				pfree(updated[i]);
 
 			/*
 			 * Remember highest leaf page number we've issued a
@@ -1291,7 +1333,7 @@ restart:
 			if (blkno > vstate->lastBlockVacuumed)
 				vstate->lastBlockVacuumed = blkno;
 
-			stats->tuples_removed += ndeletable;
+			stats->tuples_removed += nhtidsdead;
 			/* must recompute maxoff */
 			maxoff = PageGetMaxOffsetNumber(page);
 		}
@@ -1323,7 +1365,7 @@ restart:
 		if (minoff > maxoff)
 			delete_now = (blkno == orig_blkno);
 		else
-			stats->num_index_tuples += maxoff - minoff + 1;
+			stats->num_index_tuples += nhtidslive;
 	}
 
 	if (delete_now)
@@ -1366,6 +1408,42 @@ restart:
 	}
 }
 
+/*
+ * btvacuumposting --- check the heap TIDs of a posting list tuple
+ *
+ * Sets *nremaining to the number of heap TIDs that the callback says are
+ * still live.  If some but not all of them are dead, returns a palloc'd
+ * replacement tuple holding just the live ones (an ordinary tuple, if only
+ * one remains); otherwise returns NULL.
+ */
+static IndexTuple
+btvacuumposting(IndexTuple itup, IndexBulkDeleteCallback callback,
+				void *callback_state, int *nremaining)
+{
+	int			nposting = BTreeTupleGetNPosting(itup);
+	ItemPointer live;
+	int			nlive = 0;
+	int			i;
+	IndexTuple	newitup = NULL;
+
+	live = (ItemPointer) palloc(nposting * sizeof(ItemPointerData));
+	for (i = 0; i < nposting; i++)
+	{
+		ItemPointer htid = BTreeTupleGetPostingN(itup, i);
+
+		if (!callback(htid, callback_state))
+			live[nlive++] = *htid;
+	}
+
+	if (nlive > 0 && nlive < nposting)
+		newitup = _bt_form_posting(itup, live, nlive);
+
+	pfree(live);
+	*nremaining = nlive;
+
+	return newitup;
+}
+
 /*
  *	btcanreturn() -- Check whether btree indexes support index-only scans.
  *
@@ -1258,7 +1258,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			{
 				/* tuple passes all scan key conditions, so remember it */
 				_bt_saveitem(so, itemIndex, offnum, itup);
-				itemIndex++;
+				itemIndex += BTreeTupleGetNHeapTIDs(itup);
 			}
 			if (!continuescan)
 			{
@@ -1270,7 +1270,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			offnum = OffsetNumberNext(offnum);
 		}
 
-		Assert(itemIndex <= MaxIndexTuplesPerPage);
+		Assert(itemIndex <= MaxTIDsPerBTreePage);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
@@ -1278,7 +1278,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxIndexTuplesPerPage;
+		itemIndex = MaxTIDsPerBTreePage;
 
 		offnum = Min(offnum, maxoff);
 
@@ -1288,7 +1288,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (itup != NULL)
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				itemIndex--;
+				itemIndex -= BTreeTupleGetNHeapTIDs(itup);
 				_bt_saveitem(so, itemIndex, offnum, itup);
 			}
 			if (!continuescan)
@@ -1303,30 +1303,44 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
-		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
+		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
 }
 
-/* Save an index item into so->currPos.items[itemIndex] */
+/*
+ * Save an index item into so->currPos.items[itemIndex].  A posting list
+ * tuple fills one entry per heap TID, starting at itemIndex, and all of
+ * them share a single copy of the tuple in the workspace.
+ */
 static void
 _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup)
 {
-	BTScanPosItem *currItem = &so->currPos.items[itemIndex];
+	int			nhtids = BTreeTupleGetNHeapTIDs(itup);
+	ItemPointer htids = BTreeTupleGetHeapTID(itup);
+	LocationIndex tupleOffset = 0;
+	int			i;
 
-	currItem->heapTid = itup->t_tid;
-	currItem->indexOffset = offnum;
 	if (so->currTuples)
 	{
 		Size		itupsz = IndexTupleSize(itup);
 
-		currItem->tupleOffset = so->currPos.nextTupleOffset;
+		tupleOffset = so->currPos.nextTupleOffset;
 		memcpy(so->currTuples + so->currPos.nextTupleOffset, itup, itupsz);
 		so->currPos.nextTupleOffset += MAXALIGN(itupsz);
 	}
+
+	for (i = 0; i < nhtids; i++)
+	{
+		BTScanPosItem *currItem = &so->currPos.items[itemIndex + i];
+
+		currItem->heapTid = htids[i];
+		currItem->indexOffset = offnum;
+		currItem->tupleOffset = tupleOffset;
+	}
 }
 
 /*
@@ -275,6 +275,8 @@ static void _bt_sortaddtup(Page page, Size itemsize,
 			   IndexTuple itup, OffsetNumber itup_off);
 static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
+static void _bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
@@ -880,7 +882,8 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemIdSetUnused(ii);	/* redundant */
 		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
 
-		if (indnkeyatts != indnatts && P_ISLEAF(opageop))
+		if (P_ISLEAF(opageop) &&
+			(indnkeyatts != indnatts || BTreeTupleIsPosting(oitup)))
 		{
 			IndexTuple	truncated;
 			Size		truncsz;
@@ -891,7 +894,8 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 			 * index).  This is only done at the leaf level because downlinks
 			 * in internal pages are either negative infinity items, or get
 			 * their contents from copying from one level down.  See also:
-			 * _bt_split().
+			 * _bt_split().  Likewise, a posting list tuple that becomes the
+			 * high key loses its posting list.
 			 *
 			 * Since the truncated tuple is probably smaller than the
 			 * original, it cannot just be copied in place (besides, we want
@@ -905,7 +909,11 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 			 * the latter portion of the space occupied by the original tuple.
 			 * This is fairly cheap.
 			 */
-			truncated = _bt_nonkey_truncate(wstate->index, oitup);
+			if (indnkeyatts != indnatts)
+				truncated = _bt_nonkey_truncate(wstate->index, oitup);
+			else
+				truncated = _bt_form_posting(oitup,
+											 BTreeTupleGetHeapTID(oitup), 1);
 			truncsz = IndexTupleSize(truncated);
 			PageIndexTupleDelete(opage, P_HIKEY);
 			_bt_sortaddtup(opage, truncsz, truncated, P_HIKEY);
@@ -991,6 +999,27 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	state->btps_lastoff = last_off;
 }
 
+/*
+ * Add a run of leaf tuples with identical keys, given as the first of them
+ * and the heap TIDs of all of them, as a single posting list tuple.
+ */
+static void
+_bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids)
+{
+	IndexTuple	posting;
+
+	if (nhtids == 1)
+	{
+		_bt_buildadd(wstate, state, base);
+		return;
+	}
+
+	posting = _bt_form_posting(base, htids, nhtids);
+	_bt_buildadd(wstate, state, posting);
+	pfree(posting);
+}
+
 /*
  * Finish writing out the completed btree.
  */
@@ -1172,6 +1201,54 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		}
 		pfree(sortKeys);
 	}
+	else if (_bt_dedup_enabled(wstate->index))
+	{
+		IndexTuple	base = NULL;
+		ItemPointer htids;
+		int			nhtids = 0;
+		Size		maxpostingsize = 0;
+
+		/*
+		 * Merge runs of duplicates into posting list tuples as we go.  The
+		 * sort breaks ties by heap TID, so each posting list comes out in
+		 * the required order.
+		 */
+		htids = (ItemPointer) palloc(sizeof(ItemPointerData) *
+									 MaxTIDsPerBTreePage);
+		while ((itup = tuplesort_getindextuple(btspool->sortstate,
+											   true)) != NULL)
+		{
+			/* When we see first tuple, create first index page */
+			if (state == NULL)
+			{
+				state = _bt_pagestate(wstate, 0);
+				maxpostingsize = BTMaxPostingSize(state->btps_page);
+			}
+
+			if (base != NULL && _bt_dedup_keys_equal(base, itup) &&
+				MAXALIGN(IndexTupleSize(base) +
+						 (nhtids + 1) * sizeof(ItemPointerData)) <= maxpostingsize)
+			{
+				htids[nhtids++] = itup->t_tid;
+				continue;
+			}
+
+			if (base != NULL)
+			{
+				_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+				pfree(base);
+			}
+			base = CopyIndexTuple(itup);
+			htids[0] = itup->t_tid;
+			nhtids = 1;
+		}
+		if (base != NULL)
+		{
+			_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+			pfree(base);
+		}
+		pfree(htids);
+	}
 	else
 	{
 		/* merge is unnecessary */
@@ -49,6 +49,10 @@ static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
 					 IndexTuple tuple, TupleDesc tupdesc,
 					 ScanDirection dir, bool *continuescan);
+static bool _bt_posting_contains(IndexTuple posting, ItemPointer htid);
+static bool *_bt_killed_items_map(BTScanOpaque so, int numKilled);
+static bool _bt_posting_all_killed(BTScanOpaque so, bool *killed,
+					   int itemIndex, IndexTuple posting);
 
 
 /*
@@ -1739,6 +1743,9 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  * has been modified since we read it (as determined by the LSN), we dare not
  * flag any entries because it is possible that the old entry was vacuumed
  * away and the TID was re-used by a completely different heap tuple.
+ *
+ * A posting list tuple can only be marked LP_DEAD once every one of its heap
+ * TIDs has been killed, since the flag applies to the whole tuple.
  */
 void
 _bt_killitems(IndexScanDesc scan)
@@ -1751,6 +1758,8 @@ _bt_killitems(IndexScanDesc scan)
 	int			i;
 	int			numKilled = so->numKilled;
 	bool		killedsomething = false;
+	bool	   *killed = NULL;
+	OffsetNumber postingoff = InvalidOffsetNumber;
 
 	Assert(BTScanPosIsValid(so->currPos));
 
@@ -1808,12 +1817,37 @@ _bt_killitems(IndexScanDesc scan)
 			   itemIndex <= so->currPos.lastItem);
 		if (offnum < minoff)
 			continue;			/* pure paranoia */
+
+		/*
+		 * The other heap TIDs of a posting list tuple come right after this
+		 * one in killedItems, if they were killed at all, and we've already
+		 * dealt with the whole tuple.
+		 */
+		if (offnum == postingoff)
+			continue;
+
 		while (offnum <= maxoff)
 		{
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (BTreeTupleIsPosting(ituple))
+			{
+				if (_bt_posting_contains(ituple, &kitem->heapTid))
+				{
+					/* found the tuple; are all of its heap TIDs dead? */
+					if (killed == NULL)
+						killed = _bt_killed_items_map(so, numKilled);
+					if (_bt_posting_all_killed(so, killed, itemIndex, ituple))
+					{
+						ItemIdMarkDead(iid);
+						killedsomething = true;
+					}
+					postingoff = kitem->indexOffset;
+					break;		/* out of inner search loop */
+				}
+			}
+			else if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
 			{
 				/* found the item */
 				ItemIdMarkDead(iid);
@@ -1824,6 +1858,9 @@ _bt_killitems(IndexScanDesc scan)
 		}
 	}
 
+	if (killed != NULL)
+		pfree(killed);
+
 	/*
 	 * Since this can be redone later if needed, mark as dirty hint.
 	 *
@@ -1839,6 +1876,90 @@ _bt_killitems(IndexScanDesc scan)
 	LockBuffer(so->currPos.buf, BUFFER_LOCK_UNLOCK);
 }
 
+/*
+ * Does a posting list tuple contain the given heap TID?
+ */
+static bool
+_bt_posting_contains(IndexTuple posting, ItemPointer htid)
+{
+	int			low = 0;
+	int			high = BTreeTupleGetNPosting(posting) - 1;
+
+	/* the posting list is sorted, so we can binary search it */
+	while (low <= high)
+	{
+		int			mid = low + (high - low) / 2;
+		int32		cmp;
+
+		cmp = ItemPointerCompare(htid, BTreeTupleGetPostingN(posting, mid));
+		if (cmp == 0)
+			return true;
+		if (cmp > 0)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return false;
+}
+
+/*
+ * Build a map of which entries of so->currPos.items[] were killed, indexed
+ * by itemIndex - firstItem.
+ */
+static bool *
+_bt_killed_items_map(BTScanOpaque so, int numKilled)
+{
+	bool	   *killed;
+	int			i;
+
+	killed = (bool *) palloc0((so->currPos.lastItem - so->currPos.firstItem + 1) *
+							  sizeof(bool));
+	for (i = 0; i < numKilled; i++)
+		killed[so->killedItems[i] - so->currPos.firstItem] = true;
+
+	return killed;
+}
+
+/*
+ * Were all of the heap TIDs of a posting list tuple killed?
+ *
+ * The scan saved the tuple's heap TIDs as consecutive entries of items[]
+ * sharing itemIndex's indexOffset, in the same order as in the posting list.
+ * We insist that the tuple still holds exactly those heap TIDs; if it has
+ * changed since (for example because deduplication merged more duplicates
+ * into it), it's left alone.
+ */
+static bool
+_bt_posting_all_killed(BTScanOpaque so, bool *killed, int itemIndex,
+					   IndexTuple posting)
+{
+	BTScanPosItem *items = so->currPos.items;
+	OffsetNumber indexOffset = items[itemIndex].indexOffset;
+	int			first = itemIndex;
+	int			last = itemIndex;
+	int			j;
+
+	while (first > so->currPos.firstItem &&
+		   items[first - 1].indexOffset == indexOffset)
+		first--;
+	while (last < so->currPos.lastItem &&
+		   items[last + 1].indexOffset == indexOffset)
+		last++;
+
+	if (last - first + 1 != BTreeTupleGetNPosting(posting))
+		return false;
+
+	for (j = first; j <= last; j++)
+	{
+		if (!killed[j - so->currPos.firstItem] ||
+			!ItemPointerEquals(&items[j].heapTid,
+							   BTreeTupleGetPostingN(posting, j - first)))
+			return false;
+	}
+
+	return true;
+}
 
 /*
  * The following routines manage a shared-memory area in which we track
@@ -2157,6 +2278,11 @@ _bt_check_natts(Relation rel, Page page, OffsetNumber offnum)
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 
+	/* Posting list tuples are never pivot tuples */
+	if (BTreeTupleIsPosting(itup) &&
+		(!P_ISLEAF(opaque) || offnum < P_FIRSTDATAKEY(opaque)))
+		return false;
+
 	if (P_ISLEAF(opaque))
 	{
 		if (offnum >= P_FIRSTDATAKEY(opaque))
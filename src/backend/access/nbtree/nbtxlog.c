@@ -401,11 +401,11 @@ static void
 btree_xlog_vacuum(XLogReaderState *record)
 {
 	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_btree_vacuum *xlrec = (xl_btree_vacuum *) XLogRecGetData(record);
 	Buffer		buffer;
 	Page		page;
 	BTPageOpaque opaque;
 #ifdef UNUSED
-	xl_btree_vacuum *xlrec = (xl_btree_vacuum *) XLogRecGetData(record);
 
 	/*
 	 * This section of code is thought to be no longer needed, after analysis
@@ -494,18 +494,31 @@ btree_xlog_vacuum(XLogReaderState *record)
 
 		page = (Page) BufferGetPage(buffer);
 
-		if (len > 0)
+		if (xlrec->nupdated > 0)
 		{
-			OffsetNumber *unused;
-			OffsetNumber *unend;
+			OffsetNumber *updatenos;
+			char	   *tuples;
+			int			i;
+
+			updatenos = (OffsetNumber *)
+				(ptr + xlrec->ndeleted * sizeof(OffsetNumber));
+			tuples = (char *) (updatenos + xlrec->nupdated);
 
-			unused = (OffsetNumber *) ptr;
-			unend = (OffsetNumber *) ((char *) ptr + len);
+			for (i = 0; i < xlrec->nupdated; i++)
+			{
+				IndexTuple	itup = (IndexTuple) tuples;
+				Size		itemsz = MAXALIGN(IndexTupleSize(itup));
 
-			if ((unend - unused) > 0)
-				PageIndexMultiDelete(page, unused, unend - unused);
+				if (!PageIndexTupleOverwrite(page, updatenos[i], (Item) itup,
+											 itemsz))
+					elog(PANIC, "btree_xlog_vacuum: failed to update posting list tuple");
+				tuples += itemsz;
+			}
 		}
 
+		if (xlrec->ndeleted > 0)
+			PageIndexMultiDelete(page, (OffsetNumber *) ptr, xlrec->ndeleted);
+
 		/*
 		 * Mark the page as not containing any LP_DEAD items --- see comments
 		 * in _bt_delitems_vacuum().
@@ -520,6 +533,33 @@ btree_xlog_vacuum(XLogReaderState *record)
 		UnlockReleaseBuffer(buffer);
 }
 
+static void
+btree_xlog_dedup(XLogReaderState *record)
+{
+	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_btree_dedup *xlrec = (xl_btree_dedup *) XLogRecGetData(record);
+	Buffer		buffer;
+
+	if (XLogReadBufferForRedo(record, 0, &buffer) == BLK_NEEDS_REDO)
+	{
+		Page		page = (Page) BufferGetPage(buffer);
+		BTDedupInterval *intervals;
+		Page		newpage;
+		Size		len;
+
+		intervals = (BTDedupInterval *) XLogRecGetBlockData(record, 0, &len);
+		Assert(len == xlrec->nintervals * sizeof(BTDedupInterval));
+
+		newpage = _bt_dedup_form_page(page, intervals, xlrec->nintervals);
+		PageRestoreTempPage(newpage, page);
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+}
+
 /*
  * Get the latestRemovedXid from the heap pages pointed at by the index
  * tuples being deleted. This puts the work for calculating latestRemovedXid
@@ -548,8 +588,11 @@ btree_xlog_delete_get_latestRemovedXid(XLogReaderState *record)
 	HeapTupleHeader htuphdr;
 	BlockNumber hblkno;
 	OffsetNumber hoffnum;
+	ItemPointer htids;
+	int			nhtids;
 	TransactionId latestRemovedXid = InvalidTransactionId;
-	int			i;
+	int			i,
+				j;
 
 	/*
 	 * If there's nothing running on the standby we don't need to derive a
@@ -603,62 +646,72 @@ btree_xlog_delete_get_latestRemovedXid(XLogReaderState *record)
 		itup = (IndexTuple) PageGetItem(ipage, iitemid);
 
 		/*
-		 * Locate the heap page that the index tuple points at
+		 * A posting list tuple points at several heap tuples; visit each.
 		 */
-		hblkno = ItemPointerGetBlockNumber(&(itup->t_tid));
-		hbuffer = XLogReadBufferExtended(xlrec->hnode, MAIN_FORKNUM, hblkno, RBM_NORMAL);
-		if (!BufferIsValid(hbuffer))
+		htids = BTreeTupleGetHeapTID(itup);
+		nhtids = BTreeTupleGetNHeapTIDs(itup);
+		for (j = 0; j < nhtids; j++)
 		{
-			UnlockReleaseBuffer(ibuffer);
-			return InvalidTransactionId;
-		}
-		LockBuffer(hbuffer, BT_READ);
-		hpage = (Page) BufferGetPage(hbuffer);
-
-		/*
-		 * Look up the heap tuple header that the index tuple points at by
-		 * using the heap node supplied with the xlrec. We can't use
-		 * heap_fetch, since it uses ReadBuffer rather than XLogReadBuffer.
-		 * Note that we are not looking at tuple data here, just headers.
-		 */
-		hoffnum = ItemPointerGetOffsetNumber(&(itup->t_tid));
-		hitemid = PageGetItemId(hpage, hoffnum);
+			/*
+			 * Locate the heap page that the index tuple points at
+			 */
+			hblkno = ItemPointerGetBlockNumber(&htids[j]);
+			hbuffer = XLogReadBufferExtended(xlrec->hnode, MAIN_FORKNUM,
+											 hblkno, RBM_NORMAL);
+			if (!BufferIsValid(hbuffer))
+			{
+				UnlockReleaseBuffer(ibuffer);
+				return InvalidTransactionId;
+			}
+			LockBuffer(hbuffer, BT_READ);
+			hpage = (Page) BufferGetPage(hbuffer);
 
-		/*
-		 * Follow any redirections until we find something useful.
-		 */
-		while (ItemIdIsRedirected(hitemid))
-		{
-			hoffnum = ItemIdGetRedirect(hitemid);
+			/*
+			 * Look up the heap tuple header that the index tuple points at
+			 * by using the heap node supplied with the xlrec. We can't use
+			 * heap_fetch, since it uses ReadBuffer rather than
+			 * XLogReadBuffer. Note that we are not looking at tuple data
+			 * here, just headers.
+			 */
+			hoffnum = ItemPointerGetOffsetNumber(&htids[j]);
 			hitemid = PageGetItemId(hpage, hoffnum);
-			CHECK_FOR_INTERRUPTS();
-		}
 
-		/*
-		 * If the heap item has storage, then read the header and use that to
-		 * set latestRemovedXid.
-		 *
-		 * Some LP_DEAD items may not be accessible, so we ignore them.
-		 */
-		if (ItemIdHasStorage(hitemid))
-		{
-			htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
+			/*
+			 * Follow any redirections until we find something useful.
+			 */
+			while (ItemIdIsRedirected(hitemid))
+			{
+				hoffnum = ItemIdGetRedirect(hitemid);
+				hitemid = PageGetItemId(hpage, hoffnum);
+				CHECK_FOR_INTERRUPTS();
+			}
 
-			HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr, &latestRemovedXid);
-		}
-		else if (ItemIdIsDead(hitemid))
-		{
 			/*
-			 * Conjecture: if hitemid is dead then it had xids before the xids
-			 * marked on LP_NORMAL items. So we just ignore this item and move
-			 * onto the next, for the purposes of calculating
-			 * latestRemovedxids.
+			 * If the heap item has storage, then read the header and use that
+			 * to set latestRemovedXid.
+			 *
+			 * Some LP_DEAD items may not be accessible, so we ignore them.
 			 */
-		}
-		else
-			Assert(!ItemIdIsUsed(hitemid));
+			if (ItemIdHasStorage(hitemid))
+			{
+				htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
 
-		UnlockReleaseBuffer(hbuffer);
+				HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr, &latestRemovedXid);
+			}
+			else if (ItemIdIsDead(hitemid))
+			{
+				/*
+				 * Conjecture: if hitemid is dead then it had xids before the
+				 * xids marked on LP_NORMAL items. So we just ignore this item
+				 * and move onto the next, for the purposes of calculating
+				 * latestRemovedxids.
+				 */
+			}
+			else
+				Assert(!ItemIdIsUsed(hitemid));
+
+			UnlockReleaseBuffer(hbuffer);
+		}
 	}
 
 	UnlockReleaseBuffer(ibuffer);
@@ -1019,6 +1072,9 @@ btree_redo(XLogReaderState *record)
 		case XLOG_BTREE_VACUUM:
 			btree_xlog_vacuum(record);
 			break;
+		case XLOG_BTREE_DEDUP:
+			btree_xlog_dedup(record);
+			break;
 		case XLOG_BTREE_DELETE:
 			btree_xlog_delete(record);
 			break;
@@ -14,6 +14,7 @@
 
 #include "postgres.h"
 
+#include "access/gin.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/session.h"
@@ -22,6 +23,7 @@
 #include "catalog/index.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
+#include "commands/copy.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -110,6 +112,13 @@ volatile bool ParallelMessagePending = false;
 /* Are we initializing a parallel worker? */
 bool		InitializingParallelWorker = false;
 
+/*
+ * May this parallel worker insert tuples?  Workers are normally strictly
+ * read-only; an entry point that has established that concurrent inserts
+ * are safe for its target (see ParallelCopyMain) sets this.
+ */
+bool		ParallelWorkerMayInsert = false;
+
 /* Pointer to our fixed parallel state. */
 static FixedParallelState *MyFixedParallelState;
 
@@ -135,6 +144,12 @@ static const struct
 	},
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
+	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
 	}
 };
 
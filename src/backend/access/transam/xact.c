@@ -683,11 +683,12 @@ GetCurrentCommandId(bool used)
 	{
 		/*
 		 * Forbid setting currentCommandIdUsed in a parallel worker, because
-		 * we have no provision for communicating this back to the master.  We
-		 * could relax this restriction when currentCommandIdUsed was already
-		 * true at the start of the parallel operation.
+		 * we have no provision for communicating this back to the master.
+		 * It's fine if the master had already marked the command ID used
+		 * before starting the parallel operation, though; we inherit that
+		 * flag, and parallel COPY FROM relies on it.
 		 */
-		Assert(!IsParallelWorker());
+		Assert(!IsParallelWorker() || currentCommandIdUsed);
 		currentCommandIdUsed = true;
 	}
 	return currentCommandId;
@@ -4990,8 +4991,9 @@ Size
 EstimateTransactionStateSpace(void)
 {
 	TransactionState s;
-	Size		nxids = 6;		/* iso level, deferrable, top & current XID,
-								 * command counter, XID count */
+	Size		nxids = 7;		/* iso level, deferrable, top & current XID,
+								 * command counter, command ID used, XID
+								 * count */
 
 	for (s = CurrentTransactionState; s != NULL; s = s->parent)
 	{
@@ -5014,7 +5016,8 @@ EstimateTransactionStateSpace(void)
  * contain XactDeferrable and XactIsoLevel; the next twelve bytes contain the
  * XID of the top-level transaction, the XID of the current transaction
  * (or, in each case, InvalidTransactionId if none), and the current command
- * counter.  After that, the next 4 bytes contain a count of how many
+ * counter.  The next 4 bytes say whether that command ID has already been
+ * used.  After that, the next 4 bytes contain a count of how many
  * additional XIDs follow; this is followed by all of those XIDs one after
  * another.  We emit the XIDs in sorted order for the convenience of the
  * receiving process.
@@ -5034,6 +5037,7 @@ SerializeTransactionState(Size maxsize, char *start_address)
 	result[c++] = XactTopTransactionId;
 	result[c++] = CurrentTransactionState->transactionId;
 	result[c++] = (TransactionId) currentCommandId;
+	result[c++] = (TransactionId) currentCommandIdUsed;
 	Assert(maxsize >= c * sizeof(TransactionId));
 
 	/*
@@ -5100,8 +5104,9 @@ StartParallelWorkerTransaction(char *tstatespace)
 	XactTopTransactionId = tstate[2];
 	CurrentTransactionState->transactionId = tstate[3];
 	currentCommandId = tstate[4];
-	nParallelCurrentXids = (int) tstate[5];
-	ParallelCurrentXids = &tstate[6];
+	currentCommandIdUsed = (bool) tstate[5];
+	nParallelCurrentXids = (int) tstate[6];
+	ParallelCurrentXids = &tstate[7];
 
 	CurrentTransactionState->blockState = TBLOCK_PARALLEL_INPROGRESS;
 }
@@ -358,6 +358,13 @@ static XLogRecPtr RedoRecPtr;
  */
 static bool doPageWrites;
 
+/*
+ * doForcePageWrites is this backend's local copy of forcePageWrites.  Pages
+ * on storage that cannot tear them only need full-page images while it is
+ * set, see torn_page_safe_hook.
+ */
+static bool doForcePageWrites;
+
 /* Has the recovery code requested a walreceiver wakeup? */
 static bool doRequestWalReceiverReply;
 
@@ -977,6 +984,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	XLogRecPtr	StartPos;
 	XLogRecPtr	EndPos;
 	bool		prevDoPageWrites = doPageWrites;
+	bool		prevDoForcePageWrites = doForcePageWrites;
 
 	/* we assume that all of the record header is in the first chunk */
 	Assert(rdata->len >= SizeOfXLogRecord);
@@ -1031,7 +1039,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 *
 	 * Also check to see if fullPageWrites or forcePageWrites was just turned
 	 * on; if we weren't already doing full-page writes then go back and
-	 * recompute.
+	 * recompute.  The same goes for forcePageWrites alone, because the caller
+	 * may have skipped images of pages on torn-page-safe storage.
 	 *
 	 * If we aren't doing full-page writes then RedoRecPtr doesn't actually
 	 * affect the contents of the XLOG record, so we'll update our local copy
@@ -1045,9 +1054,11 @@ XLogInsertRecord(XLogRecData *rdata,
 		RedoRecPtr = Insert->RedoRecPtr;
 	}
 	doPageWrites = (Insert->fullPageWrites || Insert->forcePageWrites);
+	doForcePageWrites = Insert->forcePageWrites;
 
 	if (doPageWrites &&
 		(!prevDoPageWrites ||
+		 (doForcePageWrites && !prevDoForcePageWrites) ||
 		 (fpw_lsn != InvalidXLogRecPtr && fpw_lsn <= RedoRecPtr)))
 	{
 		/*
@@ -6833,6 +6844,7 @@ StartupXLOG(void)
 
 	RedoRecPtr = XLogCtl->RedoRecPtr = XLogCtl->Insert.RedoRecPtr = checkPoint.redo;
 	doPageWrites = lastFullPageWrites;
+	doForcePageWrites = false;
 
 	if (RecPtr < checkPoint.redo)
 		ereport(PANIC,
@@ -8281,8 +8293,9 @@ InitXLOGAccess(void)
 
 	/* Use GetRedoRecPtr to copy the RedoRecPtr safely */
 	(void) GetRedoRecPtr();
-	/* Also update our copy of doPageWrites. */
+	/* Also update our copies of doPageWrites and doForcePageWrites. */
 	doPageWrites = (Insert->fullPageWrites || Insert->forcePageWrites);
+	doForcePageWrites = Insert->forcePageWrites;
 
 	/* Also initialize the working areas for constructing WAL records */
 	InitXLogInsert();
@@ -8328,6 +8341,17 @@ GetFullPageWriteInfo(XLogRecPtr *RedoRecPtr_p, bool *doPageWrites_p)
 	*doPageWrites_p = doPageWrites;
 }
 
+/*
+ * Return whether full-page images are being forced, i.e. whether an online
+ * backup is in progress.  Like GetFullPageWriteInfo, this returns a cached
+ * copy that XLogInsertRecord re-checks while holding the WAL insert lock.
+ */
+bool
+GetForcePageWrites(void)
+{
+	return doForcePageWrites;
+}
+
 /*
  * GetInsertRecPtr -- Returns the current insert position.
  *
@@ -32,6 +32,10 @@
 #include "utils/memutils.h"
 #include "pg_trace.h"
 
+/* Hooks for plugins to skip full-page images on torn-page-safe storage */
+torn_page_safe_hook_type torn_page_safe_hook = NULL;
+torn_page_images_skipped_hook_type torn_page_images_skipped_hook = NULL;
+
 /* Buffer size required to store a compressed version of backup block image */
 #define PGLZ_MAX_BLCKSZ PGLZ_MAX_OUTPUT(BLCKSZ)
 
@@ -108,7 +112,8 @@ static MemoryContext xloginsert_cxt;
 
 static XLogRecData *XLogRecordAssemble(RmgrId rmid, uint8 info,
 				   XLogRecPtr RedoRecPtr, bool doPageWrites,
-				   XLogRecPtr *fpw_lsn);
+				   bool doForcePageWrites,
+				   XLogRecPtr *fpw_lsn, int *num_skipped_fpi);
 static bool XLogCompressBackupBlock(char *page, uint16 hole_offset,
 						uint16 hole_length, char *dest, uint16 *dlen);
 
@@ -446,8 +451,10 @@ XLogInsert(RmgrId rmid, uint8 info)
 	{
 		XLogRecPtr	RedoRecPtr;
 		bool		doPageWrites;
+		bool		doForcePageWrites;
 		XLogRecPtr	fpw_lsn;
 		XLogRecData *rdt;
+		int			num_skipped_fpi;
 
 		/*
 		 * Get values needed to decide whether to do full-page writes. Since
@@ -455,11 +462,20 @@ XLogInsert(RmgrId rmid, uint8 info)
 		 * but XLogInsertRecord will recheck them once it has a lock.
 		 */
 		GetFullPageWriteInfo(&RedoRecPtr, &doPageWrites);
+		doForcePageWrites = GetForcePageWrites();
 
 		rdt = XLogRecordAssemble(rmid, info, RedoRecPtr, doPageWrites,
-								 &fpw_lsn);
+								 doForcePageWrites, &fpw_lsn, &num_skipped_fpi);
 
 		EndPos = XLogInsertRecord(rdt, fpw_lsn, curinsert_flags);
+
+		/*
+		 * Only report skipped images once the record is in, since a
+		 * reassembled record may make a different decision.
+		 */
+		if (EndPos != InvalidXLogRecPtr && num_skipped_fpi > 0 &&
+			torn_page_images_skipped_hook)
+			(*torn_page_images_skipped_hook) (num_skipped_fpi);
 	} while (EndPos == InvalidXLogRecPtr);
 
 	XLogResetInsertion();
@@ -478,11 +494,16 @@ XLogInsert(RmgrId rmid, uint8 info)
  * of all of them, *fpw_lsn is set to the lowest LSN among such pages. This
  * signals that the assembled record is only good for insertion on the
  * assumption that the RedoRecPtr and doPageWrites values were up-to-date.
+ *
+ * Full-page images of pages that torn_page_safe_hook reports as stored on
+ * storage that cannot tear them are only taken if doForcePageWrites is set.
+ * The number of images skipped that way is returned in *num_skipped_fpi.
  */
 static XLogRecData *
 XLogRecordAssemble(RmgrId rmid, uint8 info,
 				   XLogRecPtr RedoRecPtr, bool doPageWrites,
-				   XLogRecPtr *fpw_lsn)
+				   bool doForcePageWrites, XLogRecPtr *fpw_lsn,
+				   int *num_skipped_fpi)
 {
 	XLogRecData *rdt;
 	uint32		total_len = 0;
@@ -521,6 +542,7 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 	 * the headers for the block references in the scratch buffer.
 	 */
 	*fpw_lsn = InvalidXLogRecPtr;
+	*num_skipped_fpi = 0;
 	for (block_id = 0; block_id < max_registered_block_id; block_id++)
 	{
 		registered_buffer *regbuf = &registered_buffers[block_id];
@@ -558,6 +580,18 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 				if (*fpw_lsn == InvalidXLogRecPtr || page_lsn < *fpw_lsn)
 					*fpw_lsn = page_lsn;
 			}
+			else if (!doForcePageWrites && torn_page_safe_hook &&
+					 (*torn_page_safe_hook) (&regbuf->rnode, regbuf->forkno))
+			{
+				/*
+				 * The image only protects against torn pages, which the
+				 * storage rules out.  Don't update *fpw_lsn: a later
+				 * checkpoint doesn't change the decision, but an online
+				 * backup starting does, and XLogInsertRecord checks for that.
+				 */
+				needs_backup = false;
+				(*num_skipped_fpi)++;
+			}
 		}
 
 		/* Determine if the buffer data needs to included */
@@ -623,7 +623,10 @@ CREATE VIEW pg_stat_all_indexes AS
             I.relname AS indexrelname,
             pg_stat_get_numscans(I.oid) AS idx_scan,
             pg_stat_get_tuples_returned(I.oid) AS idx_tup_read,
-            pg_stat_get_tuples_fetched(I.oid) AS idx_tup_fetch
+            pg_stat_get_tuples_fetched(I.oid) AS idx_tup_fetch,
+            pg_stat_get_gin_pending_cleanups(I.oid) AS gin_pending_cleanups,
+            pg_stat_get_gin_pending_pages(I.oid) AS gin_pending_pages,
+            pg_stat_get_gin_pending_cleanup_time(I.oid) AS gin_pending_cleanup_time
     FROM pg_class C JOIN
             pg_index X ON C.oid = X.indrelid JOIN
             pg_class I ON I.oid = X.indexrelid
@@ -19,12 +19,16 @@
 #include <sys/stat.h>
 
 #include "access/heapam.h"
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/dependency.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_inherits.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
@@ -40,17 +44,24 @@
 #include "optimizer/planner.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_relation.h"
+#include "pgstat.h"
+#include "port/atomics.h"
 #include "port/pg_bswap.h"
+#include "port/pg_bytescan.h"
+#include "postmaster/bgworker_internals.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/fd.h"
+#include "storage/shm_mq.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/partcache.h"
 #include "utils/portal.h"
 #include "utils/rel.h"
 #include "utils/rls.h"
 #include "utils/snapmgr.h"
+#include "utils/typcache.h"
 
 
 #define ISOCTAL(c) (((c) >= '0') && ((c) <= '7'))
@@ -120,6 +131,7 @@ typedef struct CopyStateData
 	bool		binary;			/* binary format? */
 	bool		oids;			/* include OIDs? */
 	bool		freeze;			/* freeze rows on loading? */
+	int			nworkers;		/* parallel workers requested for COPY FROM */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	bool		header_line;	/* CSV header line? */
 	char	   *null_print;		/* NULL marker string (server encoding!) */
@@ -185,6 +197,16 @@ typedef struct CopyStateData
 	 */
 	StringInfoData attribute_buf;
 
+	/*
+	 * The bytes the text and CSV scanning loops must look at; any run of
+	 * other bytes is skipped or copied with pg_bytescan().  line_specials is
+	 * for CopyReadLineText, field_specials for the CopyReadAttributes
+	 * functions, and quoted_specials for inside a quoted CSV field.
+	 */
+	pg_byteset	line_specials;
+	pg_byteset	field_specials;
+	pg_byteset	quoted_specials;
+
 	/* field raw data pointers found by COPY FROM */
 
 	int			max_fields;
@@ -201,6 +223,16 @@ typedef struct CopyStateData
 	bool		line_buf_converted; /* converted to server encoding? */
 	bool		line_buf_valid; /* contains the row being processed? */
 
+	/*
+	 * In a parallel COPY FROM worker, lines come from the leader instead of
+	 * raw_buf, in chunks received over pcopy_mqh; see ParallelCopyReadLine.
+	 */
+	shm_mq_handle *pcopy_mqh;	/* queue from leader, or NULL */
+	char	   *pcopy_chunk;	/* chunk being consumed */
+	Size		pcopy_len;		/* length of chunk */
+	Size		pcopy_pos;		/* offset of next line in chunk */
+	uint64		pcopy_lineno;	/* line number of next line in chunk */
+
 	/*
 	 * Finally, raw_buf holds raw data read from the data source (file or
 	 * client connection).  CopyReadLine parses this data sufficiently to
@@ -214,6 +246,75 @@ typedef struct CopyStateData
 	int			raw_buf_len;	/* total # of bytes stored */
 } CopyStateData;
 
+/*
+ * Parallel COPY FROM.
+ *
+ * The leader reads the input and splits it into lines exactly as a serial
+ * COPY would (CopyReadLine handles quoting, the end-of-data marker and
+ * encoding conversion), and hands batches of complete lines to the workers
+ * over one shm_mq per worker, in round-robin order.  Each worker parses,
+ * converts and inserts its lines by running the ordinary CopyFrom() loop on
+ * a CopyState whose CopyReadLine() pulls from its queue.  Every chunk
+ * starts with the line number of its first line, so that errors raised in
+ * a worker still name the right input line.
+ */
+#define PARALLEL_COPY_KEY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_COPY_KEY_ATTLIST		UINT64CONST(0xC000000000000002)
+#define PARALLEL_COPY_KEY_OPTIONS		UINT64CONST(0xC000000000000003)
+#define PARALLEL_COPY_KEY_QUEUES		UINT64CONST(0xC000000000000004)
+#define PARALLEL_COPY_KEY_QUERY_TEXT	UINT64CONST(0xC000000000000005)
+
+/* Target size of one chunk of lines, and of each worker's queue */
+#define PARALLEL_COPY_CHUNK_SIZE		65536
+#define PARALLEL_COPY_QUEUE_SIZE		(4 * PARALLEL_COPY_CHUNK_SIZE)
+
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target relation */
+	pg_atomic_uint64 processed; /* tuples inserted by all workers */
+} ParallelCopyShared;
+
+/*
+ * COPY FROM gathers tuples and inserts them with heap_multi_insert(), one
+ * buffer per target relation.  When routing to partitions we keep buffers
+ * for up to MAX_PARTITION_BUFFERS partitions at once, and write out all of
+ * them when the tuples in them reach MAX_BUFFERED_TUPLES or
+ * MAX_BUFFERED_BYTES in total, so that memory use stays bounded however the
+ * input is spread over the partitions.
+ */
+#define MAX_BUFFERED_TUPLES		1000
+#define MAX_BUFFERED_BYTES		65535
+#define MAX_PARTITION_BUFFERS	32
+
+typedef struct CopyMultiInsertBuffer
+{
+	ResultRelInfo *resultRelInfo;	/* relation the tuples go into */
+	TupleTableSlot *slot;		/* slot of that relation's rowtype */
+	int			index;			/* leaf partition index, or 0 */
+	int			nused;			/* number of tuples buffered */
+	HeapTuple	tuples[MAX_BUFFERED_TUPLES];
+	uint64		linenos[MAX_BUFFERED_TUPLES];	/* input line of each tuple */
+} CopyMultiInsertBuffer;
+
+typedef struct CopyMultiInsertInfo
+{
+	CopyState	cstate;
+	EState	   *estate;
+	CommandId	mycid;
+	int			hi_options;
+	BulkInsertState bistate;
+	bool		routing;		/* are buffers for different partitions? */
+	CopyMultiInsertBuffer **partbuffers;	/* buffer in use for each leaf
+											 * partition (or the one target
+											 * relation), or NULL */
+	CopyMultiInsertBuffer *buffers[MAX_PARTITION_BUFFERS];	/* the ones in
+															 * use first */
+	int			nbuffers;		/* number of buffers in use */
+	int			nallocated;		/* number of buffers allocated */
+	int			ntuples;		/* tuples buffered, over all buffers */
+	Size		nbytes;			/* total size of those tuples */
+} CopyMultiInsertInfo;
+
 /* DestReceiver for COPY (query) TO */
 typedef struct
 {
@@ -310,7 +411,21 @@ static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					ResultRelInfo *resultRelInfo, TupleTableSlot *myslot,
 					BulkInsertState bistate,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
-					uint64 firstBufferedLineNo);
+					uint64 *bufferedLineNos);
+static CopyMultiInsertBuffer *CopyMultiInsertGetBuffer(CopyMultiInsertInfo *miinfo,
+						 ResultRelInfo *resultRelInfo, int index);
+static void CopyMultiInsertStore(CopyMultiInsertInfo *miinfo,
+					 CopyMultiInsertBuffer *buffer, HeapTuple tuple,
+					 uint64 lineno);
+static void CopyMultiInsertFlush(CopyMultiInsertInfo *miinfo);
+static bool CopyFromParallelSafe(CopyState cstate);
+static bool CopyRelationParallelSafe(Relation rel);
+static uint64 ParallelCopyFrom(CopyState cstate, List *attnamelist,
+				 List *options);
+static void ParallelCopySendChunk(shm_mq_handle **mqh, int nqueues,
+					  int *nextqueue, StringInfo chunk);
+static bool ParallelCopyReadLine(CopyState cstate);
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
 static int	CopyReadAttributesText(CopyState cstate);
@@ -993,7 +1108,19 @@ DoCopy(ParseState *pstate, const CopyStmt *stmt,
 
 		cstate = BeginCopyFrom(pstate, rel, stmt->filename, stmt->is_program,
 							   NULL, stmt->attlist, stmt->options);
-		*processed = CopyFrom(cstate);	/* copy from file to database */
+		if (cstate->nworkers > 0 && !CopyFromParallelSafe(cstate))
+		{
+			ereport(DEBUG1,
+					(errmsg("COPY into \"%s\" cannot use parallel workers, loading serially",
+							RelationGetRelationName(rel))));
+			cstate->nworkers = 0;
+		}
+
+		if (cstate->nworkers > 0)
+			*processed = ParallelCopyFrom(cstate, stmt->attlist,
+										  stmt->options);
+		else
+			*processed = CopyFrom(cstate);	/* copy from file to database */
 		EndCopyFrom(cstate);
 	}
 	else
@@ -1038,6 +1165,7 @@ ProcessCopyOptions(ParseState *pstate,
 				   List *options)
 {
 	bool		format_specified = false;
+	bool		parallel_specified = false;
 	ListCell   *option;
 
 	/* Support external use for option sanity checking */
@@ -1093,6 +1221,23 @@ ProcessCopyOptions(ParseState *pstate,
 						 parser_errposition(pstate, defel->location)));
 			cstate->freeze = defGetBoolean(defel);
 		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (parallel_specified)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			parallel_specified = true;
+			cstate->nworkers = defGetInt32(defel);
+			if (cstate->nworkers < 0 ||
+				cstate->nworkers > MAX_PARALLEL_WORKER_LIMIT)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("argument to option \"%s\" must be between %d and %d",
+								defel->defname, 0, MAX_PARALLEL_WORKER_LIMIT),
+						 parser_errposition(pstate, defel->location)));
+		}
 		else if (strcmp(defel->defname, "delimiter") == 0)
 		{
 			if (cstate->delim)
@@ -1362,6 +1507,12 @@ ProcessCopyOptions(ParseState *pstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("COPY force null only available using COPY FROM")));
 
+	/* Check parallel */
+	if (cstate->nworkers > 0 && !is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY parallel only available using COPY FROM")));
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(cstate->null_print, cstate->delim[0]) != NULL)
 		ereport(ERROR,
@@ -2336,14 +2487,9 @@ CopyFrom(CopyState cstate)
 	BulkInsertState bistate;
 	uint64		processed = 0;
 	bool		useHeapMultiInsert;
-	int			nBufferedTuples = 0;
+	CopyMultiInsertInfo miinfo;
 	int			prev_leaf_part_index = -1;
 
-#define MAX_BUFFERED_TUPLES 1000
-	HeapTuple  *bufferedTuples = NULL;	/* initialize to silence warning */
-	Size		bufferedTuplesSize = 0;
-	uint64		firstBufferedLineNo = 0;
-
 	Assert(cstate->rel);
 
 	/*
@@ -2577,13 +2723,21 @@ CopyFrom(CopyState cstate)
 	 * expressions. Such triggers or expressions might query the table we're
 	 * inserting to, and act differently if the tuples that have already been
 	 * processed and prepared for insertion are not there.  We also can't do
-	 * it if the table is foreign or partitioned.
+	 * it if the table is foreign.
+	 *
+	 * When routing to partitions, the same goes for each partition: tuples
+	 * for a foreign partition or one with BEFORE ROW triggers are inserted
+	 * one at a time, below.  We don't buffer at all if there are transition
+	 * tables to capture into, since the capture state is set up per tuple as
+	 * it is routed, and must not have changed by the time the buffered
+	 * tuples' AFTER ROW triggers are queued.
 	 */
 	if ((resultRelInfo->ri_TrigDesc != NULL &&
 		 (resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
 		  resultRelInfo->ri_TrigDesc->trig_insert_instead_row)) ||
 		resultRelInfo->ri_FdwRoutine != NULL ||
-		cstate->partition_tuple_routing != NULL ||
+		(cstate->partition_tuple_routing != NULL &&
+		 cstate->transition_capture != NULL) ||
 		cstate->volatile_defexprs)
 	{
 		useHeapMultiInsert = false;
@@ -2591,7 +2745,23 @@ CopyFrom(CopyState cstate)
 	else
 	{
 		useHeapMultiInsert = true;
-		bufferedTuples = palloc(MAX_BUFFERED_TUPLES * sizeof(HeapTuple));
+	}
+
+	memset(&miinfo, 0, sizeof(miinfo));
+	miinfo.cstate = cstate;
+	miinfo.estate = estate;
+	miinfo.mycid = mycid;
+	miinfo.hi_options = hi_options;
+	if (useHeapMultiInsert)
+	{
+		int			ntargets = 1;
+
+		if (cstate->partition_tuple_routing)
+		{
+			miinfo.routing = true;
+			ntargets = cstate->partition_tuple_routing->num_partitions;
+		}
+		miinfo.partbuffers = palloc0(ntargets * sizeof(CopyMultiInsertBuffer *));
 	}
 
 	/*
@@ -2606,6 +2776,7 @@ CopyFrom(CopyState cstate)
 	nulls = (bool *) palloc(tupDesc->natts * sizeof(bool));
 
 	bistate = GetBulkInsertState();
+	miinfo.bistate = bistate;
 	econtext = GetPerTupleExprContext(estate);
 
 	/* Set up callback to identify error line number */
@@ -2619,10 +2790,12 @@ CopyFrom(CopyState cstate)
 		TupleTableSlot *slot;
 		bool		skip_tuple;
 		Oid			loaded_oid = InvalidOid;
+		int			leaf_part_index = 0;	/* 0 if not routing */
+		bool		use_multi_insert = useHeapMultiInsert;
 
 		CHECK_FOR_INTERRUPTS();
 
-		if (nBufferedTuples == 0)
+		if (miinfo.ntuples == 0)
 		{
 			/*
 			 * Reset the per-tuple exprcontext. We can only do this if the
@@ -2660,7 +2833,6 @@ CopyFrom(CopyState cstate)
 		/* Determine the partition to heap_insert the tuple into */
 		if (cstate->partition_tuple_routing)
 		{
-			int			leaf_part_index;
 			PartitionTupleRouting *proute = cstate->partition_tuple_routing;
 
 			/*
@@ -2749,8 +2921,22 @@ CopyFrom(CopyState cstate)
 											  &slot);
 
 			tuple->t_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
+
+			/* Foreign partitions and BEFORE ROW triggers need single inserts */
+			if (resultRelInfo->ri_FdwRoutine != NULL ||
+				(resultRelInfo->ri_TrigDesc &&
+				 resultRelInfo->ri_TrigDesc->trig_insert_before_row))
+				use_multi_insert = false;
 		}
 
+		/*
+		 * Before inserting a tuple by itself, write out the ones buffered for
+		 * other partitions, so that triggers and the like see the tuples that
+		 * came before it.
+		 */
+		if (!use_multi_insert && miinfo.ntuples > 0)
+			CopyMultiInsertFlush(&miinfo);
+
 		skip_tuple = false;
 
 		/* BEFORE ROW INSERT Triggers */
@@ -2795,30 +2981,27 @@ CopyFrom(CopyState cstate)
 					  resultRelInfo->ri_TrigDesc->trig_insert_before_row)))
 					ExecPartitionCheck(resultRelInfo, slot, estate, true);
 
-				if (useHeapMultiInsert)
+				if (use_multi_insert)
 				{
-					/* Add this tuple to the tuple buffer */
-					if (nBufferedTuples == 0)
-						firstBufferedLineNo = cstate->cur_lineno;
-					bufferedTuples[nBufferedTuples++] = tuple;
-					bufferedTuplesSize += tuple->t_len;
+					CopyMultiInsertBuffer *buffer;
 
 					/*
-					 * If the buffer filled up, flush it.  Also flush if the
-					 * total size of all the tuples in the buffer becomes
-					 * large, to avoid using large amounts of memory for the
-					 * buffer when the tuples are exceptionally wide.
+					 * A tuple converted to the partition's rowtype belongs to
+					 * the conversion slot, which frees it on the next
+					 * conversion, so buffer a copy of it instead.
 					 */
-					if (nBufferedTuples == MAX_BUFFERED_TUPLES ||
-						bufferedTuplesSize > 65535)
+					if (slot != myslot)
 					{
-						CopyFromInsertBatch(cstate, estate, mycid, hi_options,
-											resultRelInfo, myslot, bistate,
-											nBufferedTuples, bufferedTuples,
-											firstBufferedLineNo);
-						nBufferedTuples = 0;
-						bufferedTuplesSize = 0;
+						MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+						tuple = heap_copytuple(tuple);
+						MemoryContextSwitchTo(oldcontext);
 					}
+
+					/* Add this tuple to its relation's buffer */
+					buffer = CopyMultiInsertGetBuffer(&miinfo, resultRelInfo,
+													  leaf_part_index);
+					CopyMultiInsertStore(&miinfo, buffer, tuple,
+										 cstate->cur_lineno);
 				}
 				else
 				{
@@ -2884,11 +3067,8 @@ next_tuple:
 	}
 
 	/* Flush any remaining buffered tuples */
-	if (nBufferedTuples > 0)
-		CopyFromInsertBatch(cstate, estate, mycid, hi_options,
-							resultRelInfo, myslot, bistate,
-							nBufferedTuples, bufferedTuples,
-							firstBufferedLineNo);
+	if (miinfo.ntuples > 0)
+		CopyMultiInsertFlush(&miinfo);
 
 	/* Done, clean up */
 	error_context_stack = errcallback.previous;
@@ -2943,16 +3123,16 @@ next_tuple:
 }
 
 /*
- * A subroutine of CopyFrom, to write the current batch of buffered heap
- * tuples to the heap. Also updates indexes and runs AFTER ROW INSERT
- * triggers.
+ * A subroutine of CopyFrom, to write a batch of buffered heap tuples to the
+ * heap of resultRelInfo's relation. Also updates indexes and runs AFTER ROW
+ * INSERT triggers.
  */
 static void
 CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 					int hi_options, ResultRelInfo *resultRelInfo,
 					TupleTableSlot *myslot, BulkInsertState bistate,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
-					uint64 firstBufferedLineNo)
+					uint64 *bufferedLineNos)
 {
 	MemoryContext oldcontext;
 	int			i;
@@ -2970,7 +3150,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	 * before calling it.
 	 */
 	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	heap_multi_insert(cstate->rel,
+	heap_multi_insert(resultRelInfo->ri_RelationDesc,
 					  bufferedTuples,
 					  nBufferedTuples,
 					  mycid,
@@ -2988,7 +3168,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 		{
 			List	   *recheckIndexes;
 
-			cstate->cur_lineno = firstBufferedLineNo + i;
+			cstate->cur_lineno = bufferedLineNos[i];
 			ExecStoreTuple(bufferedTuples[i], myslot, InvalidBuffer, false);
 			recheckIndexes =
 				ExecInsertIndexTuples(myslot, &(bufferedTuples[i]->t_self),
@@ -3010,7 +3190,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	{
 		for (i = 0; i < nBufferedTuples; i++)
 		{
-			cstate->cur_lineno = firstBufferedLineNo + i;
+			cstate->cur_lineno = bufferedLineNos[i];
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 bufferedTuples[i],
 								 NIL, cstate->transition_capture);
@@ -3021,6 +3201,605 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	cstate->cur_lineno = save_cur_lineno;
 }
 
+/*
+ * Get the buffer for tuples going into resultRelInfo, which is leaf
+ * partition 'index' when routing and the one target relation (index 0)
+ * otherwise.  If it is a partition we hold no tuples for yet, and we hold
+ * tuples for as many partitions as we allow, everything buffered is written
+ * out first.
+ */
+static CopyMultiInsertBuffer *
+CopyMultiInsertGetBuffer(CopyMultiInsertInfo *miinfo,
+						 ResultRelInfo *resultRelInfo, int index)
+{
+	CopyMultiInsertBuffer *buffer = miinfo->partbuffers[index];
+	TupleDesc	tupdesc = RelationGetDescr(resultRelInfo->ri_RelationDesc);
+
+	if (buffer != NULL)
+		return buffer;
+
+	if (miinfo->nbuffers == MAX_PARTITION_BUFFERS)
+		CopyMultiInsertFlush(miinfo);
+
+	/* Buffers are kept once allocated, to be reused after a flush */
+	if (miinfo->nbuffers == miinfo->nallocated)
+	{
+		buffer = palloc(sizeof(CopyMultiInsertBuffer));
+		buffer->slot = ExecInitExtraTupleSlot(miinfo->estate, NULL);
+		miinfo->buffers[miinfo->nallocated++] = buffer;
+	}
+
+	buffer = miinfo->buffers[miinfo->nbuffers++];
+	buffer->resultRelInfo = resultRelInfo;
+	buffer->index = index;
+	buffer->nused = 0;
+	if (buffer->slot->tts_tupleDescriptor != tupdesc)
+		ExecSetSlotDescriptor(buffer->slot, tupdesc);
+
+	miinfo->partbuffers[index] = buffer;
+	return buffer;
+}
+
+/*
+ * Add a tuple read from input line 'lineno' to a buffer, and write out
+ * everything buffered if that makes too many tuples or too many bytes.
+ *
+ * We remember each tuple's line number for error reporting.  They are
+ * consecutive in a serial COPY into a single table, but not when routing to
+ * partitions, nor in a parallel COPY worker, which sees the input as a
+ * series of disjoint chunks.
+ */
+static void
+CopyMultiInsertStore(CopyMultiInsertInfo *miinfo,
+					 CopyMultiInsertBuffer *buffer, HeapTuple tuple,
+					 uint64 lineno)
+{
+	buffer->linenos[buffer->nused] = lineno;
+	buffer->tuples[buffer->nused++] = tuple;
+	miinfo->ntuples++;
+	miinfo->nbytes += tuple->t_len;
+
+	/*
+	 * Flush when the buffers hold MAX_BUFFERED_TUPLES tuples, or when the
+	 * tuples in them become large in total, to avoid using large amounts of
+	 * memory for the buffers when the tuples are exceptionally wide.
+	 */
+	if (miinfo->ntuples == MAX_BUFFERED_TUPLES ||
+		miinfo->nbytes > MAX_BUFFERED_BYTES)
+		CopyMultiInsertFlush(miinfo);
+}
+
+/*
+ * Write out the tuples in all buffers, each buffer with one
+ * heap_multi_insert() call, in the order the buffers were first used.
+ */
+static void
+CopyMultiInsertFlush(CopyMultiInsertInfo *miinfo)
+{
+	EState	   *estate = miinfo->estate;
+	ResultRelInfo *saved_resultRelInfo = estate->es_result_relation_info;
+	int			i;
+
+	for (i = 0; i < miinfo->nbuffers; i++)
+	{
+		CopyMultiInsertBuffer *buffer = miinfo->buffers[i];
+
+		/* The bulk insert state may hold a pin in another partition */
+		if (miinfo->routing)
+			ReleaseBulkInsertStatePin(miinfo->bistate);
+
+		/* For ExecInsertIndexTuples() to work on the partition's indexes */
+		estate->es_result_relation_info = buffer->resultRelInfo;
+
+		CopyFromInsertBatch(miinfo->cstate, estate, miinfo->mycid,
+							miinfo->hi_options, buffer->resultRelInfo,
+							buffer->slot, miinfo->bistate,
+							buffer->nused, buffer->tuples, buffer->linenos);
+
+		buffer->nused = 0;
+		miinfo->partbuffers[buffer->index] = NULL;
+	}
+
+	/* Single inserts into a partition must not find a stale pin either */
+	if (miinfo->routing)
+		ReleaseBulkInsertStatePin(miinfo->bistate);
+
+	estate->es_result_relation_info = saved_resultRelInfo;
+	miinfo->nbuffers = 0;
+	miinfo->ntuples = 0;
+	miinfo->nbytes = 0;
+}
+
+/*
+ * Can this COPY FROM be run by parallel workers?
+ *
+ * The workers insert on behalf of our transaction, so everything they
+ * evaluate must be parallel safe, and nothing may have to happen in the
+ * leader row by row.  That rules out insert triggers of any kind (and so
+ * foreign keys and deferrable unique constraints), foreign and temporary
+ * targets, and defaults such as nextval() for columns missing from the
+ * input.  Binary format, OIDS and FREEZE are left to the serial code.
+ */
+static bool
+CopyFromParallelSafe(CopyState cstate)
+{
+	TupleDesc	tupDesc = RelationGetDescr(cstate->rel);
+	List	   *relids;
+	ListCell   *lc;
+	int			i;
+
+	if (cstate->binary || cstate->oids || cstate->freeze)
+		return false;
+
+	/* Parallel mode does not support serializable isolation */
+	if (IsolationIsSerializable())
+		return false;
+
+	/* Column defaults and input functions are evaluated in the workers */
+	for (i = 0; i < cstate->num_defaults; i++)
+	{
+		Node	   *defexpr = (Node *) cstate->defexprs[i]->expr;
+
+		if (expression_parallel_hazard(defexpr) != PROPARALLEL_SAFE)
+			return false;
+	}
+
+	foreach(lc, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (func_parallel(cstate->in_functions[attnum - 1].fn_oid) !=
+			PROPARALLEL_SAFE)
+			return false;
+		if (DomainHasConstraints(att->atttypid))
+			return false;
+	}
+
+	/*
+	 * Check the target and, if it is partitioned, every partition a tuple
+	 * might be routed to.  Tuple routing would lock them all anyway.
+	 */
+	if (cstate->rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
+		relids = find_all_inheritors(RelationGetRelid(cstate->rel),
+									 RowExclusiveLock, NULL);
+	else
+		relids = list_make1_oid(RelationGetRelid(cstate->rel));
+
+	foreach(lc, relids)
+	{
+		Relation	rel = heap_open(lfirst_oid(lc), NoLock);
+		bool		safe = CopyRelationParallelSafe(rel);
+
+		heap_close(rel, NoLock);
+		if (!safe)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Subroutine of CopyFromParallelSafe: check one target relation.
+ */
+static bool
+CopyRelationParallelSafe(Relation rel)
+{
+	TriggerDesc *trigdesc = rel->trigdesc;
+	TupleConstr *constr = RelationGetDescr(rel)->constr;
+	List	   *indexoids;
+	ListCell   *lc;
+	int			i;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
+		return false;
+
+	/* Workers can't see our local buffers */
+	if (RelationUsesLocalBuffers(rel))
+		return false;
+
+	if (trigdesc != NULL &&
+		(trigdesc->trig_insert_before_row ||
+		 trigdesc->trig_insert_after_row ||
+		 trigdesc->trig_insert_instead_row ||
+		 trigdesc->trig_insert_before_statement ||
+		 trigdesc->trig_insert_after_statement ||
+		 trigdesc->trig_insert_new_table))
+		return false;
+
+	if (constr != NULL)
+	{
+		for (i = 0; i < constr->num_check; i++)
+		{
+			Node	   *ccbin = stringToNode(constr->check[i].ccbin);
+
+			if (expression_parallel_hazard(ccbin) != PROPARALLEL_SAFE)
+				return false;
+		}
+	}
+
+	if (rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
+	{
+		List	   *partexprs;
+
+		partexprs = get_partition_exprs(RelationGetPartitionKey(rel));
+		if (expression_parallel_hazard((Node *) partexprs) !=
+			PROPARALLEL_SAFE)
+			return false;
+	}
+
+	/* Index expressions and predicates are evaluated in the workers too */
+	indexoids = RelationGetIndexList(rel);
+	foreach(lc, indexoids)
+	{
+		Relation	index = index_open(lfirst_oid(lc), RowExclusiveLock);
+		Node	   *exprs = (Node *) RelationGetIndexExpressions(index);
+		Node	   *pred = (Node *) RelationGetIndexPredicate(index);
+		bool		safe;
+
+		safe = (expression_parallel_hazard(exprs) == PROPARALLEL_SAFE &&
+				expression_parallel_hazard(pred) == PROPARALLEL_SAFE);
+		index_close(index, NoLock);
+		if (!safe)
+			return false;
+	}
+	list_free(indexoids);
+
+	return true;
+}
+
+/*
+ * Copy FROM file to relation, using parallel workers.
+ *
+ * The leader only reads and splits the input; see the comments at
+ * ParallelCopyShared.  The workers insert using our transaction ID and
+ * command ID, which they cannot assign themselves, so we make sure both
+ * are assigned before entering parallel mode.  If no worker could be
+ * launched, we fall back to a serial CopyFrom(), having consumed no input.
+ */
+static uint64
+ParallelCopyFrom(CopyState cstate, List *attnamelist, List *options)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *pcshared;
+	char	   *attliststr;
+	char	   *optionsstr;
+	char	   *sharedattlist;
+	char	   *sharedoptions;
+	char	   *sharedquery;
+	char	   *queuespace;
+	int			querylen;
+	shm_mq_handle **mqh;
+	int			nqueues;
+	int			nextqueue = 0;
+	StringInfoData chunk;
+	ErrorContextCallback errcallback;
+	uint64		processed;
+	int			i;
+
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain",
+								 cstate->nworkers, false);
+	if (pcxt->nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return CopyFrom(cstate);
+	}
+
+	/*
+	 * Workers rebuild their CopyState from the statement's own column and
+	 * option lists, so that they agree with us on every detail of the
+	 * format.
+	 */
+	attliststr = nodeToString(attnamelist);
+	optionsstr = nodeToString(options);
+	querylen = strlen(debug_query_string);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(attliststr) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(optionsstr) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 5);
+
+	InitializeParallelDSM(pcxt);
+
+	pcshared = (ParallelCopyShared *)
+		shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyShared));
+	pcshared->relid = RelationGetRelid(cstate->rel);
+	pg_atomic_init_u64(&pcshared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, pcshared);
+
+	sharedattlist = shm_toc_allocate(pcxt->toc, strlen(attliststr) + 1);
+	strcpy(sharedattlist, attliststr);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_ATTLIST, sharedattlist);
+
+	sharedoptions = shm_toc_allocate(pcxt->toc, strlen(optionsstr) + 1);
+	strcpy(sharedoptions, optionsstr);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_OPTIONS, sharedoptions);
+
+	/* One queue per worker, with us as the sender */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_QUEUE_SIZE,
+										   pcxt->nworkers));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queuespace);
+
+	/* Store query string for workers */
+	sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+	memcpy(sharedquery, debug_query_string, querylen + 1);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUERY_TEXT, sharedquery);
+
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, do a serial COPY */
+	if (pcxt->nworkers_launched == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return CopyFrom(cstate);
+	}
+
+	/*
+	 * Attach to the queues of the workers that were launched.  Passing the
+	 * worker handle makes a send fail, rather than hang, if the worker
+	 * dies or never starts.
+	 */
+	nqueues = pcxt->nworkers_launched;
+	mqh = (shm_mq_handle **) palloc(nqueues * sizeof(shm_mq_handle *));
+	for (i = 0; i < nqueues; i++)
+		mqh[i] = shm_mq_attach((shm_mq *) (queuespace +
+										   i * PARALLEL_COPY_QUEUE_SIZE),
+							   pcxt->seg, pcxt->worker[i].bgwhandle);
+
+	/* Set up callback to identify error line number */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/*
+	 * Read lines as NextCopyFromRawFields() would, and pass them on.  Each
+	 * chunk starts with the line number of its first line, followed by the
+	 * lines as length words and data.
+	 */
+	initStringInfo(&chunk);
+	for (;;)
+	{
+		bool		done;
+		uint32		linelen;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* on input just throw the header line away */
+		if (cstate->cur_lineno == 0 && cstate->header_line)
+		{
+			cstate->cur_lineno++;
+			if (CopyReadLine(cstate))
+				break;
+		}
+
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate);
+		if (done && cstate->line_buf.len == 0)
+			break;
+
+		if (chunk.len == 0)
+			appendBinaryStringInfo(&chunk, (char *) &cstate->cur_lineno,
+								   sizeof(uint64));
+		linelen = cstate->line_buf.len;
+		appendBinaryStringInfo(&chunk, (char *) &linelen, sizeof(uint32));
+		appendBinaryStringInfo(&chunk, cstate->line_buf.data, linelen);
+
+		if (chunk.len >= PARALLEL_COPY_CHUNK_SIZE)
+		{
+			ParallelCopySendChunk(mqh, nqueues, &nextqueue, &chunk);
+			resetStringInfo(&chunk);
+		}
+
+		if (done)
+			break;
+	}
+	if (chunk.len > 0)
+		ParallelCopySendChunk(mqh, nqueues, &nextqueue, &chunk);
+
+	error_context_stack = errcallback.previous;
+
+	/*
+	 * In the old protocol, tell pqcomm that we can process normal protocol
+	 * messages again.
+	 */
+	if (cstate->copy_dest == COPY_OLD_FE)
+		pq_endmsgread();
+
+	/* Detaching tells the workers there is no more input */
+	for (i = 0; i < nqueues; i++)
+		shm_mq_detach(mqh[i]);
+
+	/* Wait for the workers to insert the rest; this rethrows their errors */
+	WaitForParallelWorkersToFinish(pcxt);
+	processed = pg_atomic_read_u64(&pcshared->processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	pfree(chunk.data);
+	pfree(mqh);
+
+	return processed;
+}
+
+/*
+ * Send a chunk of lines to the next worker in turn, waiting for room in
+ * its queue if need be.
+ */
+static void
+ParallelCopySendChunk(shm_mq_handle **mqh, int nqueues, int *nextqueue,
+					  StringInfo chunk)
+{
+	shm_mq_result res;
+
+	res = shm_mq_send(mqh[*nextqueue], chunk->len, chunk->data, false);
+	if (res != SHM_MQ_SUCCESS)
+	{
+		/*
+		 * The worker has gone away.  If that's because it failed, it sent
+		 * us its error before detaching, so report that in preference to
+		 * our own.
+		 */
+		HandleParallelMessages();
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("lost connection to parallel COPY worker")));
+	}
+
+	*nextqueue = (*nextqueue + 1) % nqueues;
+}
+
+/*
+ * Entry point for a parallel COPY FROM worker.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *pcshared;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	List	   *attnamelist;
+	List	   *options;
+	ParseState *pstate;
+	RangeTblEntry *rte;
+	Relation	rel;
+	CopyState	cstate;
+	ListCell   *lc;
+	uint64		processed;
+
+	/* Set debug_query_string for individual workers first */
+	debug_query_string = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT,
+										false);
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	pcshared = shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED, false);
+	attnamelist = (List *)
+		stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_ATTLIST, false));
+	options = (List *)
+		stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_OPTIONS, false));
+
+	/* Attach to our queue as its receiver */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* The leader has checked that concurrent inserts are safe here */
+	ParallelWorkerMayInsert = true;
+
+	rel = heap_open(pcshared->relid, RowExclusiveLock);
+
+	/*
+	 * Permissions were checked by the leader.  We still want the same range
+	 * table entry it built, since error messages consult its insertedCols.
+	 */
+	pstate = make_parsestate(NULL);
+	rte = addRangeTableEntryForRelation(pstate, rel, NULL, false, false);
+	rte->requiredPerms = ACL_INSERT;
+	foreach(lc, CopyGetAttnums(RelationGetDescr(rel), rel, attnamelist))
+	{
+		int			attno = lfirst_int(lc) -
+		FirstLowInvalidHeapAttributeNumber;
+
+		rte->insertedCols = bms_add_member(rte->insertedCols, attno);
+	}
+
+	cstate = BeginCopyFrom(pstate, rel, NULL, false, ParallelCopyNoData,
+						   attnamelist, options);
+	cstate->pcopy_mqh = mqh;
+
+	/* The leader skips the header and converts lines to server encoding */
+	cstate->header_line = false;
+	cstate->need_transcoding = false;
+
+	processed = CopyFrom(cstate);
+	pg_atomic_fetch_add_u64(&pcshared->processed, processed);
+
+	EndCopyFrom(cstate);
+	heap_close(rel, NoLock);
+}
+
+/*
+ * CopyReadLine for a parallel COPY FROM worker: hand out the next line of
+ * the current chunk, receiving a new chunk from the leader when it runs
+ * out.  The leader detaching from our queue marks the end of the input.
+ */
+static bool
+ParallelCopyReadLine(CopyState cstate)
+{
+	uint32		linelen;
+
+	resetStringInfo(&cstate->line_buf);
+	cstate->line_buf_valid = false;
+
+	while (cstate->pcopy_pos >= cstate->pcopy_len)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(cstate->pcopy_mqh, &nbytes, &data, false);
+		if (res != SHM_MQ_SUCCESS)
+			return true;
+
+		Assert(nbytes > sizeof(uint64));
+		cstate->pcopy_chunk = (char *) data;
+		cstate->pcopy_len = nbytes;
+		memcpy(&cstate->pcopy_lineno, cstate->pcopy_chunk, sizeof(uint64));
+		cstate->pcopy_pos = sizeof(uint64);
+	}
+
+	memcpy(&linelen, cstate->pcopy_chunk + cstate->pcopy_pos, sizeof(uint32));
+	cstate->pcopy_pos += sizeof(uint32);
+	appendBinaryStringInfo(&cstate->line_buf,
+						   cstate->pcopy_chunk + cstate->pcopy_pos, linelen);
+	cstate->pcopy_pos += linelen;
+	Assert(cstate->pcopy_pos <= cstate->pcopy_len);
+
+	/* Overrides the count kept by NextCopyFromRawFields */
+	cstate->cur_lineno = cstate->pcopy_lineno++;
+	cstate->line_buf_valid = true;
+	cstate->line_buf_converted = true;
+
+	return false;
+}
+
+/*
+ * Data source callback for a parallel COPY FROM worker.  It only keeps
+ * BeginCopyFrom from setting up frontend or file input: workers get their
+ * lines from ParallelCopyReadLine, and never read raw data.
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	elog(ERROR, "parallel COPY worker cannot read raw input");
+	return 0;					/* keep compiler quiet */
+}
+
 /*
  * Setup to read tuples from a file for COPY FROM.
  *
@@ -3264,6 +4043,39 @@ BeginCopyFrom(ParseState *pstate,
 		fmgr_info(in_func_oid, &cstate->oid_in_function);
 	}
 
+	/* set up the bytes that our text and CSV scanning loops look for */
+	if (!cstate->binary)
+	{
+		char		specials[PG_BYTESET_SIZE];
+
+		specials[0] = '\n';
+		specials[1] = '\r';
+		if (cstate->csv_mode)
+		{
+			specials[2] = cstate->quote[0];
+			specials[3] = cstate->escape[0];
+		}
+		else
+		{
+			specials[2] = '\\';
+			specials[3] = '\\';
+		}
+		/* lead bytes of multibyte characters must be looked at too */
+		pg_byteset_init(&cstate->line_specials, specials, 4,
+						cstate->encoding_embeds_ascii);
+
+		specials[0] = cstate->delim[0];
+		specials[1] = cstate->csv_mode ? cstate->quote[0] : '\\';
+		pg_byteset_init(&cstate->field_specials, specials, 2, false);
+
+		if (cstate->csv_mode)
+		{
+			specials[0] = cstate->quote[0];
+			specials[1] = cstate->escape[0];
+			pg_byteset_init(&cstate->quoted_specials, specials, 2, false);
+		}
+	}
+
 	/* create workspace for CopyReadAttributes results */
 	if (!cstate->binary)
 	{
@@ -3604,6 +4416,10 @@ CopyReadLine(CopyState cstate)
 {
 	bool		result;
 
+	/* In a parallel COPY worker, the leader has already split the lines */
+	if (cstate->pcopy_mqh != NULL)
+		return ParallelCopyReadLine(cstate);
+
 	resetStringInfo(&cstate->line_buf);
 	cstate->line_buf_valid = true;
 
@@ -3782,6 +4598,30 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Skip over any run of bytes that need no attention; they simply
+		 * become part of the line.  The first character of a line is always
+		 * examined, since in CSV mode a backslash there may start the
+		 * end-of-copy marker.
+		 */
+		if (!first_char_in_line)
+		{
+			int			skip;
+
+			skip = pg_bytescan(&cstate->line_specials,
+							   copy_raw_buf + raw_buf_ptr,
+							   copy_raw_buf + copy_buf_len) -
+				(copy_raw_buf + raw_buf_ptr);
+			if (skip > 0)
+			{
+				/* none of them was the escape character */
+				last_was_esc = false;
+				raw_buf_ptr += skip;
+				if (raw_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -4150,6 +4990,14 @@ CopyReadAttributesText(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			int			span;
+
+			/* Copy any run of ordinary characters in one go */
+			span = pg_bytescan(&cstate->field_specials, cur_ptr,
+							   line_end_ptr) - cur_ptr;
+			memcpy(output_ptr, cur_ptr, span);
+			output_ptr += span;
+			cur_ptr += span;
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -4376,10 +5224,18 @@ CopyReadAttributesCSV(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			int			span;
 
 			/* Not in quote */
 			for (;;)
 			{
+				/* Copy any run of ordinary characters in one go */
+				span = pg_bytescan(&cstate->field_specials, cur_ptr,
+								   line_end_ptr) - cur_ptr;
+				memcpy(output_ptr, cur_ptr, span);
+				output_ptr += span;
+				cur_ptr += span;
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -4403,6 +5259,12 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* In quote */
 			for (;;)
 			{
+				span = pg_bytescan(&cstate->quoted_specials, cur_ptr,
+								   line_end_ptr) - cur_ptr;
+				memcpy(output_ptr, cur_ptr, span);
+				output_ptr += span;
+				cur_ptr += span;
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -76,6 +76,9 @@ typedef struct
 	Oid			dest_tsoid;		/* tablespace we are trying to move to */
 } movedb_failure_params;
 
+/* Hook for plugins to allow copying a template that is in use */
+createdb_template_in_use_hook_type createdb_template_in_use_hook = NULL;
+
 /* non-export function prototypes */
 static void createdb_failure_callback(int code, Datum arg);
 static void movedb(const char *dbname, const char *tblspcname);
@@ -487,8 +490,13 @@ createdb(ParseState *pstate, const CreatedbStmt *stmt)
 	 * This should be last among the basic error checks, because it involves
 	 * potential waiting; we may as well throw an error first if we're gonna
 	 * throw one.
+	 *
+	 * A plugin that copies the source DB from an existing snapshot of its
+	 * files doesn't care about concurrent changes, so it may waive this.
 	 */
-	if (CountOtherDBBackends(src_dboid, &notherbackends, &npreparedxacts))
+	if (!(createdb_template_in_use_hook &&
+		  (*createdb_template_in_use_hook) (src_dboid)) &&
+		CountOtherDBBackends(src_dboid, &notherbackends, &npreparedxacts))
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_IN_USE),
 				 errmsg("source database \"%s\" is being accessed by other users",
@@ -929,6 +937,9 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/* Likewise, forget the sizes of its relations */
+	DropDatabaseRelSizes(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -1206,6 +1217,9 @@ movedb(const char *dbname, const char *tblspcname)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/* The same goes for the cached sizes of its relations */
+	DropDatabaseRelSizes(db_id);
+
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
 	 * this database that are already in the target tablespace.  We can't
@@ -2111,6 +2125,9 @@ dbase_redo(XLogReaderState *record)
 		 */
 		FlushDatabaseBuffers(xlrec->src_db_id);
 
+		/* The files we're replacing may have had their sizes cached */
+		DropDatabaseRelSizes(xlrec->db_id);
+
 		/*
 		 * Copy this subdirectory to the new location
 		 *
@@ -2147,6 +2164,9 @@ dbase_redo(XLogReaderState *record)
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
 
+		/* And the cached sizes of its relations */
+		DropDatabaseRelSizes(xlrec->db_id);
+
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseFsyncRequests(xlrec->db_id);
 
@@ -79,6 +79,8 @@ static void show_scan_qual(List *qual, const char *qlabel,
 static void show_upper_qual(List *qual, const char *qlabel,
 				PlanState *planstate, List *ancestors,
 				ExplainState *es);
+static void show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es);
 static void show_sort_keys(SortState *sortstate, List *ancestors,
 			   ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
@@ -102,7 +104,12 @@ static void show_sortorder_options(StringInfo buf, Node *sortexpr,
 static void show_tablesample(TableSampleClause *tsc, PlanState *planstate,
 				 List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_memoize_info(MemoizeState *mstate, List *ancestors,
+				  ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 					ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -1137,9 +1144,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Material:
 			pname = sname = "Materialize";
 			break;
+		case T_Memoize:
+			pname = sname = "Memoize";
+			break;
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
+		case T_IncrementalSort:
+			pname = sname = "Incremental Sort";
+			break;
 		case T_Group:
 			pname = sname = "Group";
 			break;
@@ -1518,6 +1531,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((ScanState *) planstate)->ss_hashFilter)
+				show_instrumentation_count("Rows Removed by Bloom Filter", 3,
+										   planstate, es);
 			break;
 		case T_IndexOnlyScan:
 			show_scan_qual(((IndexOnlyScan *) plan)->indexqual,
@@ -1549,6 +1565,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((ScanState *) planstate)->ss_hashFilter)
+				show_instrumentation_count("Rows Removed by Bloom Filter", 3,
+										   planstate, es);
 			if (es->analyze)
 				show_tidbitmap_info((BitmapHeapScanState *) planstate, es);
 			break;
@@ -1567,6 +1586,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((ScanState *) planstate)->ss_hashFilter)
+				show_instrumentation_count("Rows Removed by Bloom Filter", 3,
+										   planstate, es);
 			break;
 		case T_Gather:
 			{
@@ -1754,6 +1776,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			show_hashagg_info(castNode(AggState, planstate), es);
+			if (castNode(AggState, planstate)->batchstate != NULL)
+				ExplainPropertyBool("Batch Mode", true, es);
 			break;
 		case T_Group:
 			show_group_keys(castNode(GroupState, planstate), ancestors, es);
@@ -1766,6 +1791,16 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_sort_keys(castNode(SortState, planstate), ancestors, es);
 			show_sort_info(castNode(SortState, planstate), es);
 			break;
+		case T_IncrementalSort:
+			show_incremental_sort_keys(castNode(IncrementalSortState, planstate),
+									   ancestors, es);
+			show_incremental_sort_info(castNode(IncrementalSortState, planstate),
+									   es);
+			break;
+		case T_Memoize:
+			show_memoize_info(castNode(MemoizeState, planstate), ancestors,
+							  es);
+			break;
 		case T_MergeAppend:
 			show_merge_append_keys(castNode(MergeAppendState, planstate),
 								   ancestors, es);
@@ -2106,6 +2141,28 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 						 ancestors, es);
 }
 
+/*
+ * Show the sort keys for an IncrementalSort node, and which of them are
+ * presorted.
+ */
+static void
+show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es)
+{
+	IncrementalSort *plan = (IncrementalSort *) incrsortstate->ss.ps.plan;
+
+	show_sort_group_keys((PlanState *) incrsortstate, "Sort Key",
+						 plan->sort.numCols, plan->sort.sortColIdx,
+						 plan->sort.sortOperators, plan->sort.collations,
+						 plan->sort.nullsFirst,
+						 ancestors, es);
+	show_sort_group_keys((PlanState *) incrsortstate, "Presorted Key",
+						 plan->nPresortedCols, plan->sort.sortColIdx,
+						 plan->sort.sortOperators, plan->sort.collations,
+						 plan->sort.nullsFirst,
+						 ancestors, es);
+}
+
 /*
  * Likewise, for a MergeAppend node.
  */
@@ -2638,6 +2695,182 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show the sort methods used by an incremental
+ * sort node, how many batches it sorted, and the space the largest one
+ * took.
+ */
+static void
+show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es)
+{
+	IncrementalSortInfo *info = &incrsortstate->incsort_info;
+	List	   *methods = NIL;
+	int			m;
+
+	if (!es->analyze || info->batchCount == 0)
+		return;
+
+	for (m = SORT_TYPE_TOP_N_HEAPSORT; m <= SORT_TYPE_EXTERNAL_MERGE; m++)
+	{
+		if (info->sortMethods & (1 << m))
+			methods = lappend(methods,
+							  (char *) tuplesort_method_name((TuplesortMethod) m));
+	}
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		ListCell   *lc;
+		bool		first = true;
+
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfoString(es->str, "Sort Method: ");
+		foreach(lc, methods)
+		{
+			if (!first)
+				appendStringInfoString(es->str, ", ");
+			appendStringInfoString(es->str, (const char *) lfirst(lc));
+			first = false;
+		}
+		appendStringInfo(es->str, "  Batches: " INT64_FORMAT,
+						 info->batchCount);
+		if (info->maxMemorySpaceUsed > 0)
+			appendStringInfo(es->str, "  Peak Memory: %ldkB",
+							 info->maxMemorySpaceUsed);
+		if (info->maxDiskSpaceUsed > 0)
+			appendStringInfo(es->str, "  Peak Disk: %ldkB",
+							 info->maxDiskSpaceUsed);
+		appendStringInfoChar(es->str, '\n');
+	}
+	else
+	{
+		ExplainPropertyList("Sort Methods Used", methods, es);
+		ExplainPropertyInteger("Sort Batches", NULL, info->batchCount, es);
+		ExplainPropertyInteger("Peak Sort Memory Used", "kB",
+							   info->maxMemorySpaceUsed, es);
+		ExplainPropertyInteger("Peak Sort Disk Used", "kB",
+							   info->maxDiskSpaceUsed, es);
+	}
+
+	list_free(methods);
+}
+
+/*
+ * Show the cache keys of a Memoize node, and if it's EXPLAIN ANALYZE, how
+ * well the cache worked.
+ */
+static void
+show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
+{
+	Plan	   *plan = ((PlanState *) mstate)->plan;
+	ListCell   *lc;
+	List	   *context;
+	StringInfoData keystr;
+	const char *separator = "";
+	bool		useprefix;
+	int64		memPeakKb;
+
+	initStringInfo(&keystr);
+
+	/*
+	 * It's hard to imagine having a memoize node with fewer than 2 RTEs, but
+	 * let's just keep the same useprefix logic as elsewhere in this file.
+	 */
+	useprefix = list_length(es->rtable) > 1 || es->verbose;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) mstate,
+											ancestors);
+
+	foreach(lc, ((Memoize *) plan)->param_exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		appendStringInfoString(&keystr, separator);
+		appendStringInfoString(&keystr, deparse_expression(expr, context,
+														   useprefix, false));
+		separator = ", ";
+	}
+
+	ExplainPropertyText("Cache Key", keystr.data, es);
+	if (es->verbose)
+		ExplainPropertyText("Cache Mode",
+							mstate->binary_mode ? "binary" : "logical", es);
+
+	pfree(keystr.data);
+
+	if (!es->analyze || mstate->stats.cache_misses == 0)
+		return;
+
+	memPeakKb = (Max(mstate->stats.mem_peak, mstate->mem_used) + 1023) / 1024;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Cache Hits", NULL,
+							   mstate->stats.cache_hits, es);
+		ExplainPropertyInteger("Cache Misses", NULL,
+							   mstate->stats.cache_misses, es);
+		ExplainPropertyInteger("Cache Evictions", NULL,
+							   mstate->stats.cache_evictions, es);
+		ExplainPropertyInteger("Cache Overflows", NULL,
+							   mstate->stats.cache_overflows, es);
+		ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT
+						 "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT
+						 "  Memory Usage: " INT64_FORMAT "kB\n",
+						 mstate->stats.cache_hits,
+						 mstate->stats.cache_misses,
+						 mstate->stats.cache_evictions,
+						 mstate->stats.cache_overflows,
+						 memPeakKb);
+	}
+}
+
+/*
+ * If it's EXPLAIN ANALYZE, show memory usage and spilling of hashed
+ * aggregation.
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	long		memPeakKb = (aggstate->hash_mem_peak + 1023) / 1024;
+	long		diskKb = (aggstate->hash_disk_used + 1023) / 1024;
+
+	if (!es->analyze || aggstate->hash_batches_used == 0)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("HashAgg Batches", NULL,
+							   aggstate->hash_batches_used, es);
+		ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+		ExplainPropertyInteger("Spilled Tuples", NULL,
+							   aggstate->hash_spill_tuples, es);
+		ExplainPropertyInteger("Disk Usage", "kB", diskKb, es);
+	}
+	else if (aggstate->hash_batches_used > 1)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Batches: %d  Memory Usage: %ldkB  Spilled Tuples: " INT64_FORMAT "  Disk Usage: %ldkB\n",
+						 aggstate->hash_batches_used, memPeakKb,
+						 aggstate->hash_spill_tuples, diskKb);
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Batches: %d  Memory Usage: %ldkB\n",
+						 aggstate->hash_batches_used, memPeakKb);
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
@@ -2681,7 +2914,9 @@ show_instrumentation_count(const char *qlabel, int which,
 	if (!es->analyze || !planstate->instrument)
 		return;
 
-	if (which == 2)
+	if (which == 3)
+		nfiltered = planstate->instrument->nfiltered3;
+	else if (which == 2)
 		nfiltered = planstate->instrument->nfiltered2;
 	else
 		nfiltered = planstate->instrument->nfiltered1;
@@ -0,0 +1,1043 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Batch-at-a-time execution of sequential scans, simple quals and
+ *	  plain aggregates.
+ *
+ * Normal execution passes one tuple at a time up the plan tree, and pays
+ * for a node dispatch, an expression interpreter dispatch and an aggregate
+ * transition function call for every row.  For the common analytical shape
+ * of a plain aggregate (no GROUP BY) directly over a sequential scan, batch
+ * mode instead has the scan deform up to BATCH_SIZE rows into column
+ * vectors, evaluates the scan quals as one loop per qual over the whole
+ * batch, and advances the aggregates with one loop per aggregate.
+ *
+ * Only a small set of operations is supported, and a plan only runs in
+ * batch mode when all of its quals and aggregates are covered:
+ *
+ *	- columns of type int4, date, int8 and float8;
+ *	- quals comparing a column with a constant using the built-in
+ *	  comparison operators of those types;
+ *	- count(*), count(column), sum() and avg() of int4 columns, and sum()
+ *	  and avg() of float8 expressions built from columns, constants, +, -
+ *	  and *.
+ *
+ * The transition states are built exactly as the regular transition
+ * functions would build them, so the final functions, HAVING and the
+ * result projection all run through the normal nodeAgg.c code, and the
+ * results are identical to tuple-at-a-time execution.  Floating-point
+ * sums are accumulated in input order for the same reason; the integer
+ * loops are branch-free so the compiler can vectorize them.
+ *
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_type.h"
+#include "common/int.h"
+#include "executor/execBatch.h"
+#include "executor/instrument.h"
+#include "executor/nodeSeqscan.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/parsetree.h"
+#include "utils/array.h"
+#include "utils/fmgroids.h"
+
+
+/* GUC parameter */
+bool		enable_batch_execution = false;
+
+/* comparison done by a batch qual */
+typedef enum BatchCompare
+{
+	BATCH_EQ,
+	BATCH_NE,
+	BATCH_LT,
+	BATCH_LE,
+	BATCH_GT,
+	BATCH_GE
+} BatchCompare;
+
+/*
+ * A qual of the form "column <op> constant".
+ */
+typedef struct BatchQual
+{
+	int			column;			/* index into the batch's columns */
+	BatchCompare compare;
+	Datum		constvalue;
+} BatchQual;
+
+/* kinds of float8 expression nodes */
+typedef enum BatchExprKind
+{
+	BEXPR_COLUMN,
+	BEXPR_CONST,
+	BEXPR_ADD,
+	BEXPR_SUB,
+	BEXPR_MUL
+} BatchExprKind;
+
+/*
+ * A float8 aggregate argument.  Arithmetic nodes own vectors for their
+ * results; constants are expanded into a vector once.
+ */
+typedef struct BatchExpr
+{
+	BatchExprKind kind;
+	int			column;			/* BEXPR_COLUMN: index into columns */
+	struct BatchExpr *left;		/* arithmetic operands */
+	struct BatchExpr *right;
+	float8	   *values;			/* result vector, unless a column */
+	bool	   *isnull;
+} BatchExpr;
+
+/* transition functions that batch mode implements */
+typedef enum BatchTransKind
+{
+	BTRANS_COUNT_STAR,			/* int8inc */
+	BTRANS_COUNT,				/* int8inc_any */
+	BTRANS_INT4_SUM,			/* int4_sum */
+	BTRANS_INT4_AVG,			/* int4_avg_accum */
+	BTRANS_FLOAT8_SUM,			/* float8pl */
+	BTRANS_FLOAT8_AVG			/* float8_accum */
+} BatchTransKind;
+
+typedef struct BatchTrans
+{
+	BatchTransKind kind;
+	int			column;			/* COUNT and INT4_*: the input column */
+	BatchExpr  *arg;			/* FLOAT8_*: the input expression */
+} BatchTrans;
+
+struct BatchAggState
+{
+	SeqScanState *scan;			/* the scan feeding the aggregate */
+	TupleBatch	batch;			/* the current batch of input rows */
+	bool	   *selected;		/* rows of the batch that pass the quals */
+	int			nquals;
+	BatchQual  *quals;
+	int			ntrans;			/* one per AggStatePerTrans */
+	BatchTrans *trans;
+};
+
+/*
+ * Transition state of avg(int4); must match Int8TransTypeData in
+ * utils/adt/numeric.c.
+ */
+typedef struct
+{
+	int64		count;
+	int64		sum;
+} BatchInt8TransTypeData;
+
+
+/*
+ * Same overflow check as CHECKFLOATVAL in utils/adt/float.c.
+ */
+static inline void
+batch_check_float8(float8 val, bool inf_is_valid, bool zero_is_valid)
+{
+	if (isinf(val) && !inf_is_valid)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("value out of range: overflow")));
+
+	if (val == 0.0 && !zero_is_valid)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("value out of range: underflow")));
+}
+
+/*
+ * Same ordering as float8_cmp_internal: NaNs are equal to each other and
+ * larger than any other value.
+ */
+static inline int
+batch_float8_cmp(float8 a, float8 b)
+{
+	if (isnan(a))
+		return isnan(b) ? 0 : 1;
+	if (isnan(b))
+		return -1;
+	return (a > b) ? 1 : ((a < b) ? -1 : 0);
+}
+
+/*
+ * Returns the index of the batch column for the given attribute, adding
+ * the column if it is not collected yet.  Returns -1 if the attribute
+ * cannot be collected.
+ */
+static int
+batch_column(TupleBatch *batch, AttrNumber attnum, Oid typid)
+{
+	BatchColumn *column;
+	int			i;
+
+	if (attnum <= 0)
+		return -1;
+
+	if (typid != INT4OID && typid != DATEOID &&
+		typid != INT8OID && typid != FLOAT8OID)
+		return -1;
+
+	for (i = 0; i < batch->ncolumns; i++)
+	{
+		if (batch->columns[i].attnum == attnum)
+			return i;
+	}
+
+	if (batch->ncolumns == 0)
+		batch->columns = (BatchColumn *) palloc(sizeof(BatchColumn));
+	else
+		batch->columns = (BatchColumn *)
+			repalloc(batch->columns,
+					 (batch->ncolumns + 1) * sizeof(BatchColumn));
+
+	column = &batch->columns[batch->ncolumns];
+	column->attnum = attnum;
+	column->typid = typid;
+	column->isnull = (bool *) palloc0(BATCH_SIZE * sizeof(bool));
+	switch (typid)
+	{
+		case INT4OID:
+		case DATEOID:
+			column->values.i32 = (int32 *) palloc0(BATCH_SIZE * sizeof(int32));
+			break;
+		case INT8OID:
+			column->values.i64 = (int64 *) palloc0(BATCH_SIZE * sizeof(int64));
+			break;
+		case FLOAT8OID:
+			column->values.f8 = (float8 *) palloc0(BATCH_SIZE * sizeof(float8));
+			break;
+	}
+
+	batch->maxattnum = Max(batch->maxattnum, attnum);
+
+	return batch->ncolumns++;
+}
+
+/*
+ * Returns the batch column a Var of the scan refers to, or -1.
+ */
+static int
+batch_scan_var(BatchAggState *bstate, Expr *expr)
+{
+	Var		   *var;
+
+	if (!IsA(expr, Var))
+		return -1;
+
+	var = (Var *) expr;
+	if (var->varno != ((Scan *) bstate->scan->ss.ps.plan)->scanrelid ||
+		var->varlevelsup != 0)
+		return -1;
+
+	return batch_column(&bstate->batch, var->varattno, var->vartype);
+}
+
+/*
+ * Returns the batch column an aggregate argument refers to, or -1.  The
+ * argument is a Var of the aggregate's input, which is the scan's
+ * target list.
+ */
+static int
+batch_input_var(BatchAggState *bstate, Expr *expr)
+{
+	TargetEntry *tle;
+	Var		   *var;
+
+	if (!IsA(expr, Var))
+		return -1;
+
+	var = (Var *) expr;
+	if (var->varno != OUTER_VAR)
+		return -1;
+
+	tle = get_tle_by_resno(bstate->scan->ss.ps.plan->targetlist,
+						   var->varattno);
+	if (tle == NULL)
+		return -1;
+
+	return batch_scan_var(bstate, tle->expr);
+}
+
+/*
+ * Maps the function of a comparison operator to the type it compares and
+ * the comparison it does.
+ */
+static bool
+batch_compare_func(Oid funcid, Oid *typid, BatchCompare *compare)
+{
+	switch (funcid)
+	{
+		case F_INT4EQ:
+			*typid = INT4OID;
+			*compare = BATCH_EQ;
+			return true;
+		case F_INT4NE:
+			*typid = INT4OID;
+			*compare = BATCH_NE;
+			return true;
+		case F_INT4LT:
+			*typid = INT4OID;
+			*compare = BATCH_LT;
+			return true;
+		case F_INT4LE:
+			*typid = INT4OID;
+			*compare = BATCH_LE;
+			return true;
+		case F_INT4GT:
+			*typid = INT4OID;
+			*compare = BATCH_GT;
+			return true;
+		case F_INT4GE:
+			*typid = INT4OID;
+			*compare = BATCH_GE;
+			return true;
+		case F_DATE_EQ:
+			*typid = DATEOID;
+			*compare = BATCH_EQ;
+			return true;
+		case F_DATE_NE:
+			*typid = DATEOID;
+			*compare = BATCH_NE;
+			return true;
+		case F_DATE_LT:
+			*typid = DATEOID;
+			*compare = BATCH_LT;
+			return true;
+		case F_DATE_LE:
+			*typid = DATEOID;
+			*compare = BATCH_LE;
+			return true;
+		case F_DATE_GT:
+			*typid = DATEOID;
+			*compare = BATCH_GT;
+			return true;
+		case F_DATE_GE:
+			*typid = DATEOID;
+			*compare = BATCH_GE;
+			return true;
+		case F_INT8EQ:
+			*typid = INT8OID;
+			*compare = BATCH_EQ;
+			return true;
+		case F_INT8NE:
+			*typid = INT8OID;
+			*compare = BATCH_NE;
+			return true;
+		case F_INT8LT:
+			*typid = INT8OID;
+			*compare = BATCH_LT;
+			return true;
+		case F_INT8LE:
+			*typid = INT8OID;
+			*compare = BATCH_LE;
+			return true;
+		case F_INT8GT:
+			*typid = INT8OID;
+			*compare = BATCH_GT;
+			return true;
+		case F_INT8GE:
+			*typid = INT8OID;
+			*compare = BATCH_GE;
+			return true;
+		case F_FLOAT8EQ:
+			*typid = FLOAT8OID;
+			*compare = BATCH_EQ;
+			return true;
+		case F_FLOAT8NE:
+			*typid = FLOAT8OID;
+			*compare = BATCH_NE;
+			return true;
+		case F_FLOAT8LT:
+			*typid = FLOAT8OID;
+			*compare = BATCH_LT;
+			return true;
+		case F_FLOAT8LE:
+			*typid = FLOAT8OID;
+			*compare = BATCH_LE;
+			return true;
+		case F_FLOAT8GT:
+			*typid = FLOAT8OID;
+			*compare = BATCH_GT;
+			return true;
+		case F_FLOAT8GE:
+			*typid = FLOAT8OID;
+			*compare = BATCH_GE;
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Compiles one scan qual.  Returns false if batch mode cannot evaluate it.
+ */
+static bool
+batch_compile_qual(BatchAggState *bstate, Expr *qual, BatchQual *result)
+{
+	OpExpr	   *op;
+	Expr	   *left;
+	Expr	   *right;
+	Const	   *constval;
+	Oid			typid;
+
+	if (!IsA(qual, OpExpr))
+		return false;
+
+	op = (OpExpr *) qual;
+	if (list_length(op->args) != 2 ||
+		!batch_compare_func(op->opfuncid, &typid, &result->compare))
+		return false;
+
+	left = (Expr *) linitial(op->args);
+	right = (Expr *) lsecond(op->args);
+
+	/* put the column on the left, commuting the comparison if needed */
+	if (IsA(left, Const) && IsA(right, Var))
+	{
+		Expr	   *tmp = left;
+
+		left = right;
+		right = tmp;
+
+		switch (result->compare)
+		{
+			case BATCH_LT:
+				result->compare = BATCH_GT;
+				break;
+			case BATCH_LE:
+				result->compare = BATCH_GE;
+				break;
+			case BATCH_GT:
+				result->compare = BATCH_LT;
+				break;
+			case BATCH_GE:
+				result->compare = BATCH_LE;
+				break;
+			default:
+				break;
+		}
+	}
+
+	if (!IsA(right, Const) || exprType((Node *) left) != typid)
+		return false;
+
+	constval = (Const *) right;
+	if (constval->constisnull || constval->consttype != typid)
+		return false;
+
+	result->column = batch_scan_var(bstate, left);
+	result->constvalue = constval->constvalue;
+
+	return result->column >= 0;
+}
+
+/*
+ * Compiles a float8 aggregate argument.  Returns NULL if batch mode
+ * cannot evaluate it.
+ */
+static BatchExpr *
+batch_compile_float8(BatchAggState *bstate, Expr *expr)
+{
+	BatchExpr  *result;
+
+	if (exprType((Node *) expr) != FLOAT8OID)
+		return NULL;
+
+	result = (BatchExpr *) palloc0(sizeof(BatchExpr));
+
+	if (IsA(expr, Var))
+	{
+		result->kind = BEXPR_COLUMN;
+		result->column = batch_input_var(bstate, expr);
+		if (result->column < 0)
+			return NULL;
+	}
+	else if (IsA(expr, Const))
+	{
+		Const	   *constval = (Const *) expr;
+		float8		value;
+		int			i;
+
+		if (constval->constisnull)
+			return NULL;
+
+		value = DatumGetFloat8(constval->constvalue);
+		result->kind = BEXPR_CONST;
+		result->values = (float8 *) palloc(BATCH_SIZE * sizeof(float8));
+		result->isnull = (bool *) palloc0(BATCH_SIZE * sizeof(bool));
+		for (i = 0; i < BATCH_SIZE; i++)
+			result->values[i] = value;
+	}
+	else if (IsA(expr, OpExpr) && list_length(((OpExpr *) expr)->args) == 2)
+	{
+		OpExpr	   *op = (OpExpr *) expr;
+
+		switch (op->opfuncid)
+		{
+			case F_FLOAT8PL:
+				result->kind = BEXPR_ADD;
+				break;
+			case F_FLOAT8MI:
+				result->kind = BEXPR_SUB;
+				break;
+			case F_FLOAT8MUL:
+				result->kind = BEXPR_MUL;
+				break;
+			default:
+				return NULL;
+		}
+
+		result->left = batch_compile_float8(bstate, linitial(op->args));
+		result->right = batch_compile_float8(bstate, lsecond(op->args));
+		if (result->left == NULL || result->right == NULL)
+			return NULL;
+
+		result->values = (float8 *) palloc(BATCH_SIZE * sizeof(float8));
+		result->isnull = (bool *) palloc(BATCH_SIZE * sizeof(bool));
+	}
+	else
+		return NULL;
+
+	return result;
+}
+
+/*
+ * Compiles the transition of one aggregate.  Returns false if batch mode
+ * cannot do it.
+ */
+static bool
+batch_compile_trans(BatchAggState *bstate, AggStatePerTrans pertrans,
+					BatchTrans *result)
+{
+	Aggref	   *aggref = pertrans->aggref;
+	Expr	   *arg = NULL;
+
+	if (aggref->aggkind != AGGKIND_NORMAL || aggref->aggfilter != NULL ||
+		pertrans->numSortCols > 0 || pertrans->numInputs > 1)
+		return false;
+
+	if (pertrans->numInputs == 1)
+		arg = ((TargetEntry *) linitial(aggref->args))->expr;
+
+	result->column = -1;
+	result->arg = NULL;
+
+	switch (pertrans->transfn_oid)
+	{
+		case F_INT8INC:
+			result->kind = BTRANS_COUNT_STAR;
+			return arg == NULL;
+		case F_INT8INC_ANY:
+			result->kind = BTRANS_COUNT;
+			if (arg == NULL)
+				return false;
+			result->column = batch_input_var(bstate, arg);
+			return result->column >= 0;
+		case F_INT4_SUM:
+		case F_INT4_AVG_ACCUM:
+			result->kind = pertrans->transfn_oid == F_INT4_SUM ?
+				BTRANS_INT4_SUM : BTRANS_INT4_AVG;
+			if (arg == NULL || exprType((Node *) arg) != INT4OID)
+				return false;
+			result->column = batch_input_var(bstate, arg);
+			return result->column >= 0;
+		case F_FLOAT8PL:
+		case F_FLOAT8_ACCUM:
+			result->kind = pertrans->transfn_oid == F_FLOAT8PL ?
+				BTRANS_FLOAT8_SUM : BTRANS_FLOAT8_AVG;
+			if (arg == NULL)
+				return false;
+			result->arg = batch_compile_float8(bstate, arg);
+			return result->arg != NULL;
+		default:
+			return false;
+	}
+}
+
+/*
+ * ExecInitBatchAgg
+ *		Sets up batch mode for an Agg node, if it is enabled and the node
+ *		and its input qualify.
+ *
+ * Must be called after the node's transition states and its outer plan
+ * are initialized.  Returns NULL if the node has to run tuple at a time.
+ */
+BatchAggState *
+ExecInitBatchAgg(AggState *aggstate)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	PlanState  *outerPlan = outerPlanState(aggstate);
+	BatchAggState *bstate;
+	ListCell   *lc;
+	int			i;
+
+	if (!enable_batch_execution)
+		return NULL;
+
+	/* plain aggregation over a plain, serial sequential scan only */
+	if (node->aggstrategy != AGG_PLAIN || node->groupingSets != NIL ||
+		node->aggsplit != AGGSPLIT_SIMPLE || aggstate->numtrans == 0)
+		return NULL;
+
+	if (!IsA(outerPlan, SeqScanState) || outerPlan->plan->parallel_aware ||
+		outerPlan->ps_ProjInfo != NULL || outerPlan->state->es_epqTuple != NULL)
+		return NULL;
+
+	bstate = (BatchAggState *) palloc0(sizeof(BatchAggState));
+	bstate->scan = (SeqScanState *) outerPlan;
+	bstate->selected = (bool *) palloc(BATCH_SIZE * sizeof(bool));
+
+	bstate->nquals = list_length(outerPlan->plan->qual);
+	bstate->quals = (BatchQual *) palloc(Max(bstate->nquals, 1) * sizeof(BatchQual));
+	i = 0;
+	foreach(lc, outerPlan->plan->qual)
+	{
+		if (!batch_compile_qual(bstate, (Expr *) lfirst(lc), &bstate->quals[i++]))
+			return NULL;
+	}
+
+	bstate->ntrans = aggstate->numtrans;
+	bstate->trans = (BatchTrans *) palloc(bstate->ntrans * sizeof(BatchTrans));
+	for (i = 0; i < bstate->ntrans; i++)
+	{
+		if (!batch_compile_trans(bstate, &aggstate->pertrans[i],
+								 &bstate->trans[i]))
+			return NULL;
+	}
+
+	return bstate;
+}
+
+/*
+ * Evaluates one qual over the batch, clearing the rows that fail it.
+ */
+static void
+batch_eval_qual(TupleBatch *batch, BatchQual *qual, bool *selected)
+{
+	BatchColumn *column = &batch->columns[qual->column];
+	const bool *isnull = column->isnull;
+	int			nrows = batch->nrows;
+	int			i;
+
+	/*
+	 * One loop per type and comparison, without branches in the loop body.
+	 * A null never passes a comparison.
+	 */
+#define BATCH_QUAL_LOOP(lhs, op, rhs) \
+	for (i = 0; i < nrows; i++) \
+		selected[i] &= !isnull[i] & ((lhs) op (rhs))
+
+#define BATCH_QUAL_CASES(lhs, rhs) \
+	switch (qual->compare) \
+	{ \
+		case BATCH_EQ: \
+			BATCH_QUAL_LOOP(lhs, ==, rhs); \
+			break; \
+		case BATCH_NE: \
+			BATCH_QUAL_LOOP(lhs, !=, rhs); \
+			break; \
+		case BATCH_LT: \
+			BATCH_QUAL_LOOP(lhs, <, rhs); \
+			break; \
+		case BATCH_LE: \
+			BATCH_QUAL_LOOP(lhs, <=, rhs); \
+			break; \
+		case BATCH_GT: \
+			BATCH_QUAL_LOOP(lhs, >, rhs); \
+			break; \
+		case BATCH_GE: \
+			BATCH_QUAL_LOOP(lhs, >=, rhs); \
+			break; \
+	}
+
+	switch (column->typid)
+	{
+		case INT4OID:
+		case DATEOID:
+			{
+				const int32 *v = column->values.i32;
+				int32		c = DatumGetInt32(qual->constvalue);
+
+				BATCH_QUAL_CASES(v[i], c);
+				break;
+			}
+		case INT8OID:
+			{
+				const int64 *v = column->values.i64;
+				int64		c = DatumGetInt64(qual->constvalue);
+
+				BATCH_QUAL_CASES(v[i], c);
+				break;
+			}
+		case FLOAT8OID:
+			{
+				const float8 *v = column->values.f8;
+				float8		c = DatumGetFloat8(qual->constvalue);
+
+				/* NaNs have to compare the way the float8 operators do */
+				BATCH_QUAL_CASES(batch_float8_cmp(v[i], c), 0);
+				break;
+			}
+	}
+
+#undef BATCH_QUAL_CASES
+#undef BATCH_QUAL_LOOP
+}
+
+/*
+ * Evaluates a float8 expression over the batch.  Results are only
+ * meaningful for selected rows, and errors are only raised for those.
+ */
+static void
+batch_eval_float8(TupleBatch *batch, BatchExpr *expr, const bool *selected,
+				  const float8 **values, const bool **isnull)
+{
+	const float8 *lvalues;
+	const float8 *rvalues;
+	const bool *lisnull;
+	const bool *risnull;
+	float8	   *result;
+	int			nrows = batch->nrows;
+	int			i;
+
+	switch (expr->kind)
+	{
+		case BEXPR_COLUMN:
+			*values = batch->columns[expr->column].values.f8;
+			*isnull = batch->columns[expr->column].isnull;
+			return;
+		case BEXPR_CONST:
+			*values = expr->values;
+			*isnull = expr->isnull;
+			return;
+		default:
+			break;
+	}
+
+	batch_eval_float8(batch, expr->left, selected, &lvalues, &lisnull);
+	batch_eval_float8(batch, expr->right, selected, &rvalues, &risnull);
+
+	result = expr->values;
+	for (i = 0; i < nrows; i++)
+		expr->isnull[i] = lisnull[i] | risnull[i];
+
+	switch (expr->kind)
+	{
+		case BEXPR_ADD:
+			for (i = 0; i < nrows; i++)
+				result[i] = lvalues[i] + rvalues[i];
+			for (i = 0; i < nrows; i++)
+			{
+				if (selected[i] && !expr->isnull[i])
+					batch_check_float8(result[i],
+									   isinf(lvalues[i]) || isinf(rvalues[i]),
+									   true);
+			}
+			break;
+		case BEXPR_SUB:
+			for (i = 0; i < nrows; i++)
+				result[i] = lvalues[i] - rvalues[i];
+			for (i = 0; i < nrows; i++)
+			{
+				if (selected[i] && !expr->isnull[i])
+					batch_check_float8(result[i],
+									   isinf(lvalues[i]) || isinf(rvalues[i]),
+									   true);
+			}
+			break;
+		case BEXPR_MUL:
+			for (i = 0; i < nrows; i++)
+				result[i] = lvalues[i] * rvalues[i];
+			for (i = 0; i < nrows; i++)
+			{
+				if (selected[i] && !expr->isnull[i])
+					batch_check_float8(result[i],
+									   isinf(lvalues[i]) || isinf(rvalues[i]),
+									   lvalues[i] == 0 || rvalues[i] == 0);
+			}
+			break;
+		default:
+			elog(ERROR, "unrecognized batch expression kind: %d",
+				 (int) expr->kind);
+	}
+
+	*values = result;
+	*isnull = expr->isnull;
+}
+
+/*
+ * Replaces a transition value.  Must be called in the aggregate context,
+ * where the new value has been built.
+ */
+static void
+batch_set_trans_value(AggStatePerTrans pertrans, AggStatePerGroup pergroup,
+					  Datum value)
+{
+	if (!pertrans->transtypeByVal && !pergroup->transValueIsNull &&
+		DatumGetPointer(value) != DatumGetPointer(pergroup->transValue))
+		pfree(DatumGetPointer(pergroup->transValue));
+
+	pergroup->transValue = value;
+	pergroup->transValueIsNull = false;
+	pergroup->noTransValue = false;
+}
+
+/*
+ * Advances one transition state over the selected rows of the batch.
+ */
+static void
+batch_advance_trans(TupleBatch *batch, BatchTrans *trans,
+					AggStatePerTrans pertrans, AggStatePerGroup pergroup,
+					const bool *selected)
+{
+	int			nrows = batch->nrows;
+	BatchColumn *column = NULL;
+	int64		count = 0;
+	int64		sum = 0;
+	int			i;
+
+	if (trans->column >= 0)
+		column = &batch->columns[trans->column];
+
+	switch (trans->kind)
+	{
+		case BTRANS_COUNT_STAR:
+		case BTRANS_COUNT:
+			{
+				int64		result;
+
+				if (column == NULL)
+				{
+					for (i = 0; i < nrows; i++)
+						count += selected[i];
+				}
+				else
+				{
+					for (i = 0; i < nrows; i++)
+						count += selected[i] & !column->isnull[i];
+				}
+
+				if (pg_add_s64_overflow(DatumGetInt64(pergroup->transValue),
+										count, &result))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("bigint out of range")));
+
+				batch_set_trans_value(pertrans, pergroup,
+									  Int64GetDatum(result));
+				break;
+			}
+
+		case BTRANS_INT4_SUM:
+		case BTRANS_INT4_AVG:
+			{
+				const int32 *v = column->values.i32;
+
+				for (i = 0; i < nrows; i++)
+				{
+					int			use = selected[i] & !column->isnull[i];
+
+					count += use;
+					sum += (int64) v[i] * use;
+				}
+
+				if (count == 0)
+					break;
+
+				if (trans->kind == BTRANS_INT4_SUM)
+				{
+					/* the state stays null until the first non-null input */
+					if (!pergroup->transValueIsNull)
+						sum += DatumGetInt64(pergroup->transValue);
+					batch_set_trans_value(pertrans, pergroup,
+										  Int64GetDatum(sum));
+				}
+				else
+				{
+					ArrayType  *transarray;
+					BatchInt8TransTypeData *transdata;
+
+					transarray = DatumGetArrayTypeP(pergroup->transValue);
+					if (ARR_HASNULL(transarray) ||
+						ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + sizeof(BatchInt8TransTypeData))
+						elog(ERROR, "expected 2-element int8 array");
+
+					transdata = (BatchInt8TransTypeData *) ARR_DATA_PTR(transarray);
+					transdata->count += count;
+					transdata->sum += sum;
+
+					batch_set_trans_value(pertrans, pergroup,
+										  PointerGetDatum(transarray));
+				}
+				break;
+			}
+
+		case BTRANS_FLOAT8_SUM:
+			{
+				const float8 *v;
+				const bool *isnull;
+				float8		state;
+				bool		havestate = !pergroup->transValueIsNull;
+
+				batch_eval_float8(batch, trans->arg, selected, &v, &isnull);
+
+				/*
+				 * float8pl is strict and has no initial value, so the first
+				 * non-null input becomes the state.  Add in input order, so
+				 * that rounding matches tuple-at-a-time execution.
+				 */
+				state = havestate ? DatumGetFloat8(pergroup->transValue) : 0;
+				for (i = 0; i < nrows; i++)
+				{
+					float8		result;
+
+					if (!selected[i] || isnull[i])
+						continue;
+
+					if (!havestate)
+					{
+						state = v[i];
+						havestate = true;
+						continue;
+					}
+
+					result = state + v[i];
+					batch_check_float8(result, isinf(state) || isinf(v[i]), true);
+					state = result;
+				}
+
+				if (havestate)
+					batch_set_trans_value(pertrans, pergroup,
+										  Float8GetDatum(state));
+				break;
+			}
+
+		case BTRANS_FLOAT8_AVG:
+			{
+				const float8 *v;
+				const bool *isnull;
+				ArrayType  *transarray;
+				float8	   *transvalues;
+				float8		N,
+							sumX,
+							sumX2;
+
+				batch_eval_float8(batch, trans->arg, selected, &v, &isnull);
+
+				transarray = DatumGetArrayTypeP(pergroup->transValue);
+				if (ARR_NDIM(transarray) != 1 ||
+					ARR_DIMS(transarray)[0] != 3 ||
+					ARR_HASNULL(transarray) ||
+					ARR_ELEMTYPE(transarray) != FLOAT8OID)
+					elog(ERROR, "%s: expected %d-element float8 array",
+						 "float8_accum", 3);
+				transvalues = (float8 *) ARR_DATA_PTR(transarray);
+
+				N = transvalues[0];
+				sumX = transvalues[1];
+				sumX2 = transvalues[2];
+				for (i = 0; i < nrows; i++)
+				{
+					float8		newX;
+					float8		newX2;
+
+					if (!selected[i] || isnull[i])
+						continue;
+
+					N += 1.0;
+					newX = sumX + v[i];
+					batch_check_float8(newX, isinf(sumX) || isinf(v[i]), true);
+					newX2 = sumX2 + v[i] * v[i];
+					batch_check_float8(newX2, isinf(sumX2) || isinf(v[i]), true);
+					sumX = newX;
+					sumX2 = newX2;
+				}
+				transvalues[0] = N;
+				transvalues[1] = sumX;
+				transvalues[2] = sumX2;
+
+				batch_set_trans_value(pertrans, pergroup,
+									  PointerGetDatum(transarray));
+				break;
+			}
+	}
+}
+
+/*
+ * ExecBatchAdvanceAggregates
+ *		Feeds the whole input of a batch-mode Agg node into its transition
+ *		states.
+ *
+ * The states in pergroup must have been initialized; afterwards they can
+ * be finalized as usual.
+ */
+void
+ExecBatchAdvanceAggregates(AggState *aggstate, AggStatePerGroup pergroup)
+{
+	BatchAggState *bstate = aggstate->batchstate;
+	SeqScanState *scan = bstate->scan;
+	TupleBatch *batch = &bstate->batch;
+	Instrumentation *instr = scan->ss.ps.instrument;
+	MemoryContext oldcontext;
+	bool		done = false;
+	int			nselected;
+	int			i;
+
+	while (!done)
+	{
+		if (instr)
+			InstrStartNode(instr);
+
+		if (ExecSeqScanBatch(scan, batch) == 0)
+		{
+			if (instr)
+				InstrStopNode(instr, 0);
+			break;
+		}
+
+		/*
+		 * A short batch ends the scan.  Don't ask for another one, since the
+		 * heap scan would start over from the beginning.
+		 */
+		done = batch->nrows < BATCH_SIZE;
+
+		memset(bstate->selected, true, batch->nrows * sizeof(bool));
+		for (i = 0; i < bstate->nquals; i++)
+			batch_eval_qual(batch, &bstate->quals[i], bstate->selected);
+
+		nselected = 0;
+		for (i = 0; i < batch->nrows; i++)
+			nselected += bstate->selected[i];
+
+		if (instr)
+		{
+			InstrStopNode(instr, nselected);
+			InstrCountFiltered1(scan, batch->nrows - nselected);
+		}
+
+		if (nselected == 0)
+			continue;
+
+		oldcontext = MemoryContextSwitchTo(aggstate->aggcontexts[0]->ecxt_per_tuple_memory);
+		for (i = 0; i < bstate->ntrans; i++)
+			batch_advance_trans(batch, &bstate->trans[i],
+								&aggstate->pertrans[i], &pergroup[i],
+								bstate->selected);
+		MemoryContextSwitchTo(oldcontext);
+	}
+}
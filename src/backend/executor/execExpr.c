@@ -3113,6 +3113,7 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 					  FunctionCallInfo fcinfo, AggStatePerTrans pertrans,
 					  int transno, int setno, int setoff, bool ishash)
 {
+	int			adjust_nullcheck_jumpnull = -1;
 	int			adjust_init_jumpnull = -1;
 	int			adjust_strict_jumpnull = -1;
 	ExprContext *aggcontext;
@@ -3122,6 +3123,22 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 	else
 		aggcontext = aggstate->aggcontexts[setno];
 
+	/*
+	 * Once a hash table is full, nodeAgg.c spills tuples of new groups to
+	 * disk rather than creating groups for them, leaving the set's pergroup
+	 * pointer NULL.  Skip the transition in that case.
+	 */
+	if (ishash)
+	{
+		scratch->opcode = EEOP_AGG_PLAIN_PERGROUP_NULLCHECK;
+		scratch->d.agg_plain_pergroup_nullcheck.aggstate = aggstate;
+		scratch->d.agg_plain_pergroup_nullcheck.setoff = setoff;
+		scratch->d.agg_plain_pergroup_nullcheck.jumpnull = -1;	/* adjust later */
+		ExprEvalPushStep(state, scratch);
+
+		adjust_nullcheck_jumpnull = state->steps_len - 1;
+	}
+
 	/*
 	 * If the initial value for the transition state doesn't exist in the
 	 * pg_aggregate table then we will let the first non-NULL value returned
@@ -3185,6 +3202,13 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 	ExprEvalPushStep(state, scratch);
 
 	/* adjust jumps so they jump till after transition invocation */
+	if (adjust_nullcheck_jumpnull != -1)
+	{
+		ExprEvalStep *as = &state->steps[adjust_nullcheck_jumpnull];
+
+		Assert(as->d.agg_plain_pergroup_nullcheck.jumpnull == -1);
+		as->d.agg_plain_pergroup_nullcheck.jumpnull = state->steps_len;
+	}
 	if (adjust_init_jumpnull != -1)
 	{
 		ExprEvalStep *as = &state->steps[adjust_init_jumpnull];
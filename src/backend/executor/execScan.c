@@ -19,6 +19,8 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/hashjoin.h"
+#include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 
@@ -125,6 +127,7 @@ ExecScan(ScanState *node,
 	ExprContext *econtext;
 	ExprState  *qual;
 	ProjectionInfo *projInfo;
+	HashJoinScanFilter *filter;
 
 	/*
 	 * Fetch data from node
@@ -132,6 +135,7 @@ ExecScan(ScanState *node,
 	qual = node->ps.qual;
 	projInfo = node->ps.ps_ProjInfo;
 	econtext = node->ps.ps_ExprContext;
+	filter = node->ss_hashFilter;
 
 	/* interrupt checks are in ExecScanFetch */
 
@@ -139,7 +143,7 @@ ExecScan(ScanState *node,
 	 * If we have neither a qual to check nor a projection to do, just skip
 	 * all the overhead and return the raw scan tuple.
 	 */
-	if (!qual && !projInfo)
+	if (!qual && !projInfo && !filter)
 	{
 		ResetExprContext(econtext);
 		return ExecScanFetch(node, accessMtd, recheckMtd);
@@ -189,6 +193,17 @@ ExecScan(ScanState *node,
 		 */
 		if (qual == NULL || ExecQual(qual, econtext))
 		{
+			/*
+			 * If a hash join above us pushed down a bloom filter, skip the
+			 * tuple if it has no join partner.
+			 */
+			if (filter && !ExecHashScanFilterPasses(filter, econtext))
+			{
+				InstrCountFiltered3(node, 1);
+				ResetExprContext(econtext);
+				continue;
+			}
+
 			/*
 			 * Found a satisfactory scan tuple.
 			 */
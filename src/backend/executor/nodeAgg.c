@@ -194,6 +194,23 @@
  *	  transition values.  hashcontext is the single context created to support
  *	  all hash tables.
  *
+ *	  Spilling hashed aggregation to disk:
+ *
+ *	  The planner only chooses hashing if it expects the hash tables to fit in
+ *	  work_mem, but its estimate of the number of groups can be far off.  So
+ *	  we keep track of the memory used by the hash tables, and once it exceeds
+ *	  work_mem we stop creating new groups.  Input tuples of groups that are
+ *	  already in a hash table are still aggregated, the others are written to
+ *	  temporary files, partitioned by their hash value, and their pergroup
+ *	  pointer for that grouping set is left NULL (the transition expression
+ *	  skips hashed grouping sets without one).  After the groups in memory
+ *	  have been returned, each partition is processed as a batch of its own:
+ *	  the hash tables are emptied, and the partition's tuples are aggregated
+ *	  like the original input, spilling again into smaller partitions if
+ *	  needed, using hash bits that earlier passes have not used.  Every pass
+ *	  creates at least one group, so this terminates even if many groups have
+ *	  the same hash value.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -221,6 +238,7 @@
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "miscadmin.h"
@@ -231,7 +249,9 @@
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
 #include "utils/acl.h"
+#include "storage/buffile.h"
 #include "utils/builtins.h"
+#include "utils/dynahash.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
@@ -239,6 +259,43 @@
 #include "utils/datum.h"
 
 
+/*
+ * When a hash table is full, the tuples of new groups are split into a
+ * power-of-two number of partitions, aiming for partitions whose groups fit
+ * into work_mem, with some slack for the estimate of the number of groups.
+ * The write buffers of the partitions' temporary files may use at most a
+ * quarter of work_mem.
+ */
+#define HASHAGG_PARTITION_FACTOR 1.50
+#define HASHAGG_MIN_PARTITIONS 4
+#define HASHAGG_MAX_PARTITIONS 256
+
+/*
+ * Tuples of one hashed grouping set that belong to groups which did not fit
+ * into its hash table, partitioned by their hash value.
+ */
+typedef struct HashAggSpill
+{
+	int			npartitions;	/* number of partitions, 0 if not spilling */
+	BufFile   **partitions;		/* temporary file of each partition */
+	int64	   *ntuples;		/* number of tuples in each partition */
+	uint32		mask;			/* mask to find partition from hash value */
+	int			shift;			/* after masking, shift by this amount */
+	int			used_bits;		/* hash bits used including this spill */
+} HashAggSpill;
+
+/*
+ * A spilled partition of one grouping set, waiting to be aggregated.
+ */
+typedef struct HashAggBatch
+{
+	int			setno;			/* grouping set */
+	int			used_bits;		/* hash bits used to partition the input */
+	BufFile    *input_file;		/* the spilled tuples */
+	int64		input_tuples;	/* number of tuples in input_file */
+} HashAggBatch;
+
+
 static void select_current_set(AggState *aggstate, int setno, bool is_hash);
 static void initialize_phase(AggState *aggstate, int newphase);
 static TupleTableSlot *fetch_input_tuple(AggState *aggstate);
@@ -273,11 +330,24 @@ static TupleTableSlot *project_aggregates(AggState *aggstate);
 static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
+static void hash_agg_check_limits(AggState *aggstate);
+static void hash_agg_enter_spill_mode(AggState *aggstate, Size hash_mem);
+static void hashagg_spill_init(AggState *aggstate, HashAggSpill *spill,
+				   int used_bits, double input_groups);
+static void hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
+					TupleTableSlot *slot, uint32 hash);
+static void hashagg_finish_spills(AggState *aggstate);
+static TupleTableSlot *hashagg_batch_read(HashAggBatch *batch,
+				   TupleTableSlot *slot, uint32 *hash);
+static void hashagg_reset_spill_state(AggState *aggstate);
 static TupleHashEntryData *lookup_hash_entry(AggState *aggstate);
 static void lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_batch(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 						  AggState *aggstate, EState *estate,
@@ -1452,6 +1522,307 @@ hash_agg_entry_size(int numAggs)
 	return entrysize;
 }
 
+/*
+ * Account for the memory used by the hash tables after a new group has been
+ * created, and start spilling once it exceeds work_mem.
+ *
+ * The entries' transition values and representative tuples live in the
+ * hashcontext, the bucket arrays of the tables are counted separately.
+ */
+static void
+hash_agg_check_limits(AggState *aggstate)
+{
+	Size		hash_mem;
+	int			setno;
+
+	hash_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+										 true);
+	for (setno = 0; setno < aggstate->num_hashes; setno++)
+		hash_mem += aggstate->perhash[setno].hashtable->hashtab->size *
+			sizeof(TupleHashEntryData);
+
+	if (hash_mem > aggstate->hash_mem_peak)
+		aggstate->hash_mem_peak = hash_mem;
+
+	/*
+	 * The group that was just created stays in the table, so every pass
+	 * makes progress even if a single group exceeds the limit.
+	 */
+	if (!aggstate->hash_spill_mode &&
+		aggstate->hash_ngroups_current > 0 &&
+		hash_mem > aggstate->hash_mem_limit)
+		hash_agg_enter_spill_mode(aggstate, hash_mem);
+}
+
+/*
+ * Stop creating new groups; from now on, tuples that don't belong to a group
+ * already in the hash tables are spilled to disk.
+ */
+static void
+hash_agg_enter_spill_mode(AggState *aggstate, Size hash_mem)
+{
+	aggstate->hash_spill_mode = true;
+	aggstate->hash_ever_spilled = true;
+	aggstate->hash_entry_size = hash_mem / aggstate->hash_ngroups_current;
+
+	/*
+	 * While reading the outer plan, any of the grouping sets can spill.  When
+	 * processing a batch, agg_refill_hash_table has already set up the spill
+	 * of the batch's grouping set.
+	 */
+	if (aggstate->hash_batches_used <= 1)
+	{
+		int			setno;
+
+		for (setno = 0; setno < aggstate->num_hashes; setno++)
+		{
+			AggStatePerHash perhash = &aggstate->perhash[setno];
+
+			hashagg_spill_init(aggstate, &aggstate->hash_spills[setno], 0,
+							   perhash->aggnode->numGroups);
+		}
+	}
+}
+
+/*
+ * Prepare a spill to partition tuples on the hash bits after the first
+ * used_bits, choosing the number of partitions from the estimated number of
+ * groups in the input that is being spilled.
+ */
+static void
+hashagg_spill_init(AggState *aggstate, HashAggSpill *spill, int used_bits,
+				   double input_groups)
+{
+	MemoryContext oldcontext;
+	double		mem_wanted;
+	int			partition_limit;
+	int			npartitions;
+	int			partition_bits;
+
+	partition_limit = (int) Min(aggstate->hash_mem_limit / 4 / BLCKSZ,
+								HASHAGG_MAX_PARTITIONS);
+
+	mem_wanted = HASHAGG_PARTITION_FACTOR * input_groups *
+		aggstate->hash_entry_size;
+	npartitions = 1 + (int) Min(mem_wanted / aggstate->hash_mem_limit,
+								partition_limit);
+	npartitions = Min(npartitions, partition_limit);
+	npartitions = Max(npartitions, HASHAGG_MIN_PARTITIONS);
+
+	/* there are only so many hash bits to go around */
+	partition_bits = my_log2(npartitions);
+	if (used_bits + partition_bits > 32)
+		partition_bits = 32 - used_bits;
+	npartitions = 1 << partition_bits;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	spill->npartitions = npartitions;
+	spill->partitions = palloc0(sizeof(BufFile *) * npartitions);
+	spill->ntuples = palloc0(sizeof(int64) * npartitions);
+	spill->used_bits = used_bits + partition_bits;
+	if (partition_bits > 0)
+	{
+		spill->shift = 32 - spill->used_bits;
+		spill->mask = (uint32) (npartitions - 1) << spill->shift;
+	}
+	else
+	{
+		spill->shift = 0;
+		spill->mask = 0;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Write a tuple to the partition of the spill its hash value belongs to.
+ */
+static void
+hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
+					TupleTableSlot *slot, uint32 hash)
+{
+	int			partition = (hash & spill->mask) >> spill->shift;
+	BufFile    *file = spill->partitions[partition];
+	MinimalTuple tuple;
+	size_t		written;
+
+	Assert(spill->npartitions > 0);
+
+	if (file == NULL)
+	{
+		MemoryContext oldcontext;
+
+		/* First write to this partition, so open it. */
+		oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+		file = BufFileCreateTemp(false);
+		spill->partitions[partition] = file;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot);
+
+	written = BufFileWrite(file, (void *) &hash, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	spill->ntuples[partition]++;
+	aggstate->hash_spill_tuples++;
+	aggstate->hash_disk_used += sizeof(uint32) + tuple->t_len;
+}
+
+/*
+ * Turn the partitions of all spills into batches to be processed later, once
+ * the current pass over the input is complete.
+ */
+static void
+hashagg_finish_spills(AggState *aggstate)
+{
+	MemoryContext oldcontext;
+	int			setno;
+
+	if (aggstate->hash_spills == NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	for (setno = 0; setno < aggstate->num_hashes; setno++)
+	{
+		HashAggSpill *spill = &aggstate->hash_spills[setno];
+		int			partition;
+
+		for (partition = 0; partition < spill->npartitions; partition++)
+		{
+			BufFile    *file = spill->partitions[partition];
+			HashAggBatch *batch;
+
+			if (file == NULL)
+				continue;
+
+			if (BufFileSeek(file, 0, 0L, SEEK_SET))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+			batch = palloc(sizeof(HashAggBatch));
+			batch->setno = setno;
+			batch->used_bits = spill->used_bits;
+			batch->input_file = file;
+			batch->input_tuples = spill->ntuples[partition];
+
+			/* process the most recent batches first, to keep few files around */
+			aggstate->hash_batches = lcons(batch, aggstate->hash_batches);
+		}
+
+		if (spill->npartitions > 0)
+		{
+			pfree(spill->partitions);
+			pfree(spill->ntuples);
+		}
+		memset(spill, 0, sizeof(HashAggSpill));
+	}
+
+	aggstate->hash_spill_mode = false;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Read the next tuple of a batch into the given slot.  Returns NULL once all
+ * tuples have been read.
+ */
+static TupleTableSlot *
+hashagg_batch_read(HashAggBatch *batch, TupleTableSlot *slot, uint32 *hash)
+{
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/*
+	 * Both the hash value and the MinimalTuple length word are uint32, so we
+	 * can read them in one go, see ExecHashJoinGetSavedTuple().
+	 */
+	nread = BufFileRead(batch->input_file, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+	{
+		ExecClearTuple(slot);
+		return NULL;
+	}
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	*hash = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(batch->input_file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, slot, true);
+}
+
+/*
+ * Close all spill files and forget about pending batches, at the end of the
+ * scan or before a rescan.  The statistics for EXPLAIN are left alone.
+ */
+static void
+hashagg_reset_spill_state(AggState *aggstate)
+{
+	ListCell   *lc;
+	int			setno;
+
+	if (aggstate->hash_spills != NULL)
+	{
+		for (setno = 0; setno < aggstate->num_hashes; setno++)
+		{
+			HashAggSpill *spill = &aggstate->hash_spills[setno];
+			int			partition;
+
+			for (partition = 0; partition < spill->npartitions; partition++)
+			{
+				if (spill->partitions[partition] != NULL)
+					BufFileClose(spill->partitions[partition]);
+			}
+
+			if (spill->npartitions > 0)
+			{
+				pfree(spill->partitions);
+				pfree(spill->ntuples);
+			}
+			memset(spill, 0, sizeof(HashAggSpill));
+		}
+	}
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+
+		BufFileClose(batch->input_file);
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_ever_spilled = false;
+	aggstate->hash_batch_used_bits = 0;
+}
+
 /*
  * Find or create a hashtable entry for the tuple group containing the current
  * tuple (already set in tmpcontext's outertuple slot), in the current grouping
@@ -1467,7 +1838,7 @@ lookup_hash_entry(AggState *aggstate)
 	AggStatePerHash perhash = &aggstate->perhash[aggstate->current_set];
 	TupleTableSlot *hashslot = perhash->hashslot;
 	TupleHashEntryData *entry;
-	bool		isnew;
+	bool		isnew = false;
 	int			i;
 
 	/* transfer just the needed columns into hashslot */
@@ -1483,8 +1854,12 @@ lookup_hash_entry(AggState *aggstate)
 	}
 	ExecStoreVirtualTuple(hashslot);
 
-	/* find or create the hashtable entry using the filtered tuple */
-	entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
+	/*
+	 * Find or create the hashtable entry using the filtered tuple; once the
+	 * hash tables are full, only find it.
+	 */
+	entry = LookupTupleHashEntry(perhash->hashtable, hashslot,
+								 aggstate->hash_spill_mode ? NULL : &isnew);
 
 	if (isnew)
 	{
@@ -1507,6 +1882,9 @@ lookup_hash_entry(AggState *aggstate)
 
 			initialize_aggregate(aggstate, pertrans, pergroupstate);
 		}
+
+		aggstate->hash_ngroups_current++;
+		hash_agg_check_limits(aggstate);
 	}
 
 	return entry;
@@ -1515,6 +1893,7 @@ lookup_hash_entry(AggState *aggstate)
 /*
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
+ * The pointer is NULL for grouping sets to which the tuple has been spilled.
  *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  */
@@ -1527,8 +1906,24 @@ lookup_hash_entries(AggState *aggstate)
 
 	for (setno = 0; setno < numHashes; setno++)
 	{
+		AggStatePerHash perhash = &aggstate->perhash[setno];
+		TupleHashEntryData *entry;
+
 		select_current_set(aggstate, setno, true);
-		pergroup[setno] = lookup_hash_entry(aggstate)->additional;
+		entry = lookup_hash_entry(aggstate);
+
+		if (entry != NULL)
+			pergroup[setno] = entry->additional;
+		else
+		{
+			/* lookup_hash_entry left the grouping columns in hashslot */
+			uint32		hash = TupleHashTableHash(perhash->hashtable,
+												  perhash->hashslot);
+
+			hashagg_spill_tuple(aggstate, &aggstate->hash_spills[setno],
+								aggstate->tmpcontext->ecxt_outertuple, hash);
+			pergroup[setno] = NULL;
+		}
 	}
 }
 
@@ -1567,7 +1962,10 @@ ExecAgg(PlanState *pstate)
 				break;
 			case AGG_PLAIN:
 			case AGG_SORTED:
-				result = agg_retrieve_direct(node);
+				if (node->batchstate != NULL)
+					result = agg_retrieve_batch(node);
+				else
+					result = agg_retrieve_direct(node);
 				break;
 		}
 
@@ -1683,6 +2081,8 @@ agg_retrieve_direct(AggState *aggstate)
 				 */
 				initialize_phase(aggstate, 0);
 				aggstate->table_filled = true;
+				aggstate->hash_batches_used = 1;
+				hashagg_finish_spills(aggstate);
 				ResetTupleHashIterator(aggstate->perhash[0].hashtable,
 									   &aggstate->perhash[0].hashiter);
 				select_current_set(aggstate, 0, true);
@@ -1920,6 +2320,54 @@ agg_retrieve_direct(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * ExecAgg for plain aggregation in batch mode
+ *
+ * Like agg_retrieve_direct for a single group, except that the input is
+ * consumed through execBatch.c a batch of rows at a time.
+ */
+static TupleTableSlot *
+agg_retrieve_batch(AggState *aggstate)
+{
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	TupleTableSlot *firstSlot = aggstate->ss.ss_ScanTupleSlot;
+	TupleTableSlot *result;
+
+	while (!aggstate->agg_done)
+	{
+		ReScanExprContext(econtext);
+		ReScanExprContext(aggstate->aggcontexts[0]);
+
+		/*
+		 * There is no representative input tuple; without grouping columns
+		 * nothing can refer to one.
+		 */
+		ExecClearTuple(firstSlot);
+
+		initialize_aggregates(aggstate, aggstate->pergroups, 1);
+
+		ExecBatchAdvanceAggregates(aggstate, aggstate->pergroups[0]);
+		aggstate->agg_done = true;
+
+		econtext->ecxt_outertuple = firstSlot;
+		aggstate->projected_set = 0;
+
+		prepare_projection_slot(aggstate, firstSlot, 0);
+
+		select_current_set(aggstate, 0, false);
+
+		finalize_aggregates(aggstate,
+							aggstate->peragg,
+							aggstate->pergroups[0]);
+
+		result = project_aggregates(aggstate);
+		if (result)
+			return result;
+	}
+
+	return NULL;
+}
+
 /*
  * ExecAgg for hashed case: read input and build hash table
  */
@@ -1929,6 +2377,8 @@ agg_fill_hash_table(AggState *aggstate)
 	TupleTableSlot *outerslot;
 	ExprContext *tmpcontext = aggstate->tmpcontext;
 
+	aggstate->hash_batches_used = 1;
+
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
 	 * exhaust the outer plan.
@@ -1955,6 +2405,9 @@ agg_fill_hash_table(AggState *aggstate)
 		ResetExprContext(aggstate->tmpcontext);
 	}
 
+	/* the groups that did not fit will be aggregated in later batches */
+	hashagg_finish_spills(aggstate);
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the first hash table */
 	select_current_set(aggstate, 0, true);
@@ -1963,10 +2416,123 @@ agg_fill_hash_table(AggState *aggstate)
 }
 
 /*
- * ExecAgg for hashed case: retrieving groups from hash table
+ * ExecAgg for hashed case: aggregate the next batch of spilled tuples
+ *
+ * The hash tables are emptied, and the batch's tuples are aggregated into
+ * the table of its grouping set, spilling again whatever does not fit.
+ * Returns false if there are no more batches.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	TupleTableSlot *spillslot = aggstate->hash_spill_slot;
+	HashAggBatch *batch;
+	AggStatePerHash perhash;
+	uint32		hash;
+	int			setno;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+
+	/*
+	 * All groups in memory have been returned.  Free them, running any
+	 * shutdown callbacks the aggregates registered, and empty the tables.
+	 * Only the batch's grouping set gets transition values.
+	 */
+	ReScanExprContext(aggstate->hashcontext);
+	for (setno = 0; setno < aggstate->num_hashes; setno++)
+	{
+		ResetTupleHashTable(aggstate->perhash[setno].hashtable);
+		aggstate->hash_pergroup[setno] = NULL;
+	}
+
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_batch_used_bits = batch->used_bits;
+	aggstate->hash_batches_used++;
+
+	/* in case this batch spills too, partition it on the next hash bits */
+	hashagg_spill_init(aggstate, &aggstate->hash_spills[batch->setno],
+					   batch->used_bits, batch->input_tuples);
+
+	perhash = &aggstate->perhash[batch->setno];
+
+	for (;;)
+	{
+		TupleHashEntryData *entry;
+
+		/* not inside TupIsNull(), which evaluates its argument twice */
+		if (hashagg_batch_read(batch, spillslot, &hash) == NULL)
+			break;
+
+		/* set up for lookup_hash_entry and advance_aggregates */
+		tmpcontext->ecxt_outertuple = spillslot;
+
+		select_current_set(aggstate, batch->setno, true);
+		entry = lookup_hash_entry(aggstate);
+
+		if (entry != NULL)
+		{
+			aggstate->hash_pergroup[batch->setno] = entry->additional;
+			advance_aggregates(aggstate);
+		}
+		else
+		{
+			/* the batch's hash values are still valid for this set */
+			hashagg_spill_tuple(aggstate,
+								&aggstate->hash_spills[batch->setno],
+								spillslot, hash);
+		}
+
+		ResetExprContext(tmpcontext);
+	}
+
+	BufFileClose(batch->input_file);
+	pfree(batch);
+
+	hashagg_finish_spills(aggstate);
+
+	/* Initialize to walk the batch's hash table */
+	select_current_set(aggstate, perhash - aggstate->perhash, true);
+	ResetTupleHashIterator(perhash->hashtable, &perhash->hashiter);
+
+	return true;
+}
+
+/*
+ * ExecAgg for hashed case: retrieving groups from hash table, aggregating
+ * spilled batches once the groups in memory are exhausted
  */
 static TupleTableSlot *
 agg_retrieve_hash_table(AggState *aggstate)
+{
+	TupleTableSlot *result = NULL;
+
+	while (result == NULL)
+	{
+		result = agg_retrieve_hash_table_in_memory(aggstate);
+		if (result == NULL && !agg_refill_hash_table(aggstate))
+		{
+			/* No more batches, so done */
+			aggstate->agg_done = true;
+			break;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Retrieve the groups of the current hash table(s).  After the first pass
+ * over the input, that's the tables of all grouping sets; after a batch,
+ * only the table of the batch's grouping set.  Returns NULL when they are
+ * exhausted.
+ */
+static TupleTableSlot *
+agg_retrieve_hash_table_in_memory(AggState *aggstate)
 {
 	ExprContext *econtext;
 	AggStatePerAgg peragg;
@@ -1995,7 +2561,7 @@ agg_retrieve_hash_table(AggState *aggstate)
 	 * We loop retrieving groups until we find one satisfying
 	 * aggstate->ss.ps.qual
 	 */
-	while (!aggstate->agg_done)
+	for (;;)
 	{
 		TupleTableSlot *hashslot = perhash->hashslot;
 		int			i;
@@ -2010,7 +2576,8 @@ agg_retrieve_hash_table(AggState *aggstate)
 		{
 			int			nextset = aggstate->current_set + 1;
 
-			if (nextset < aggstate->num_hashes)
+			if (nextset < aggstate->num_hashes &&
+				aggstate->hash_batches_used <= 1)
 			{
 				/*
 				 * Switch to next grouping set, reinitialize, and restart the
@@ -2026,8 +2593,7 @@ agg_retrieve_hash_table(AggState *aggstate)
 			}
 			else
 			{
-				/* No more hashtables, so done */
-				aggstate->agg_done = true;
+				/* No more hashtables in memory */
 				return NULL;
 			}
 		}
@@ -2079,9 +2645,6 @@ agg_retrieve_hash_table(AggState *aggstate)
 		if (result)
 			return result;
 	}
-
-	/* No more groups */
-	return NULL;
 }
 
 /* -----------------
@@ -2465,6 +3028,11 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		find_hash_columns(aggstate);
 		build_hash_table(aggstate);
 		aggstate->table_filled = false;
+
+		/* set up for spilling hash tables that outgrow work_mem */
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		aggstate->hash_spills = palloc0(sizeof(HashAggSpill) * numHashes);
+		aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate, scanDesc);
 	}
 
 	/*
@@ -2849,11 +3417,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		else if (aggstate->aggstrategy == AGG_MIXED && phaseidx == 0)
 		{
 			/*
-			 * No need to compute a transition function for an AGG_MIXED phase
-			 * 0 - the contents of the hashtables will have been computed
-			 * during phase 1.
+			 * The contents of the hashtables of an AGG_MIXED phase 0 are
+			 * computed during phase 1, except for batches of tuples that
+			 * did not fit into them, which are aggregated in phase 0.
 			 */
-			continue;
+			dohash = true;
+			dosort = false;
 		}
 		else if (phase->aggstrategy == AGG_PLAIN ||
 				 phase->aggstrategy == AGG_SORTED)
@@ -2873,6 +3442,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 	}
 
+	/*
+	 * Plain aggregation directly over a sequential scan may be able to
+	 * consume its input a batch at a time.
+	 */
+	aggstate->batchstate = ExecInitBatchAgg(aggstate);
+
 	return aggstate;
 }
 
@@ -3370,6 +3945,9 @@ ExecEndAgg(AggState *node)
 	if (node->hashcontext)
 		ReScanExprContext(node->hashcontext);
 
+	/* Close the files of spilled hash tables */
+	hashagg_reset_spill_state(node);
+
 	/*
 	 * We don't actually free any ExprContexts here (see comment in
 	 * ExecFreeExprContext), just unlinking the output one from the plan node
@@ -3411,10 +3989,13 @@ ExecReScanAgg(AggState *node)
 		 * If we do have the hash table, and the subplan does not have any
 		 * parameter changes, and none of our own parameter changes affect
 		 * input expressions of the aggregated functions, then we can just
-		 * rescan the existing hash table; no need to build it again.
+		 * rescan the existing hash table; no need to build it again.  That
+		 * doesn't work if the table spilled, since the groups of earlier
+		 * batches are gone.
 		 */
 		if (outerPlan->chgParam == NULL &&
-			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
+			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams) &&
+			!node->hash_ever_spilled)
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
 								   &node->perhash[0].hashiter);
@@ -3474,6 +4055,11 @@ ExecReScanAgg(AggState *node)
 		/* Rebuild an empty hash table */
 		build_hash_table(node);
 		node->table_filled = false;
+		/* Forget about spilled tuples of the previous scan */
+		hashagg_reset_spill_state(node);
+		node->hash_batches_used = 0;
+		node->hash_spill_tuples = 0;
+		node->hash_disk_used = 0;
 		/* iterator will be reset when the table is filled */
 	}
 
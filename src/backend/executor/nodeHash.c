@@ -42,6 +42,20 @@
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 
+/*
+ * Number of tuples a scan tests against a pushed-down bloom filter before
+ * deciding whether to keep using it, and the fraction of them it must have
+ * removed to stay.
+ */
+#define HASH_SCAN_FILTER_SAMPLE			10000
+#define HASH_SCAN_FILTER_MIN_REMOVED	0.1
+
+/*
+ * Largest fraction of the hash table's memory budget that the bloom filters
+ * of its inner hash values may take.
+ */
+#define HASH_BLOOM_FILTER_MAX_FRACTION	0.25
+
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
@@ -78,6 +92,7 @@ static bool ExecParallelHashTuplePrealloc(HashJoinTable hashtable,
 							  int batchno,
 							  size_t size);
 static void ExecParallelHashMergeCounters(HashJoinTable hashtable);
+static void ExecParallelHashMergeBloomFilter(HashJoinTable hashtable);
 static void ExecParallelHashCloseBatchAccessors(HashJoinTable hashtable);
 
 
@@ -172,6 +187,11 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloomFilter)
+				bloom_add_element(hashtable->bloomFilter,
+								  (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -285,7 +305,13 @@ MultiExecParallelHash(HashState *node)
 				if (ExecHashGetHashValue(hashtable, econtext, hashkeys,
 										 false, hashtable->keepNulls,
 										 &hashvalue))
+				{
+					if (hashtable->bloomFilter)
+						bloom_add_element(hashtable->bloomFilter,
+										  (unsigned char *) &hashvalue,
+										  sizeof(hashvalue));
 					ExecParallelHashTableInsert(hashtable, slot, hashvalue);
+				}
 				hashtable->partialTuples++;
 			}
 
@@ -302,6 +328,10 @@ MultiExecParallelHash(HashState *node)
 			 */
 			ExecParallelHashMergeCounters(hashtable);
 
+			/* Add the hash values we saw to the shared bloom filter. */
+			if (hashtable->bloomFilter)
+				ExecParallelHashMergeBloomFilter(hashtable);
+
 			BarrierDetach(&pstate->grow_buckets_barrier);
 			BarrierDetach(&pstate->grow_batches_barrier);
 
@@ -333,6 +363,24 @@ MultiExecParallelHash(HashState *node)
 	hashtable->totalTuples = pstate->total_tuples;
 	ExecParallelHashEnsureBatchAccessors(hashtable);
 
+	/*
+	 * Everyone who hashed has merged their bloom filter by now, so switch to
+	 * the shared one.  We might have arrived too late to add anything to our
+	 * own.
+	 */
+	if (hashtable->bloomFilter)
+	{
+		bloom_free(hashtable->bloomFilter);
+		if (DsaPointerIsValid(pstate->bloom_filter))
+		{
+			hashtable->bloomFilter = (bloom_filter *)
+				dsa_get_address(hashtable->area, pstate->bloom_filter);
+			hashtable->bloomFilterShared = true;
+		}
+		else
+			hashtable->bloomFilter = NULL;
+	}
+
 	/*
 	 * The next synchronization point is in ExecHashJoin's HJ_BUILD_HASHTABLE
 	 * case, which will bring the build phase to PHJ_BUILD_DONE (if it isn't
@@ -509,6 +557,9 @@ ExecHashTableCreate(HashState *state, List *hashOperators, bool keepNulls)
 	hashtable->parallel_state = state->parallel_state;
 	hashtable->area = state->ps.state->es_query_dsa;
 	hashtable->batches = NULL;
+	hashtable->bloomFilter = NULL;
+	hashtable->bloomFilterShared = false;
+	hashtable->bloomFilterSpace = 0;
 
 #ifdef HJDEBUG
 	printf("Hashjoin %p: initial nbatch = %d, nbuckets = %d\n",
@@ -557,6 +608,39 @@ ExecHashTableCreate(HashState *state, List *hashOperators, bool keepNulls)
 		i++;
 	}
 
+	/*
+	 * The bloom filter covers the inner tuples of all batches, so size it by
+	 * the estimated total.  It always uses the same seed, so that the
+	 * participants of a Parallel Hash build compatible filters.
+	 *
+	 * The filter's memory comes out of the hash table's budget.  With
+	 * Parallel Hash, every participant fills a private filter while the
+	 * shared one exists, so all of those copies count.  If the budget can't
+	 * spare room for a useful filter, we do without one.
+	 */
+	if (state->build_bloom_filter)
+	{
+		int			ncopies = 1;
+		Size		bloom_allowed;
+
+		if (state->parallel_state != NULL)
+			ncopies = state->parallel_state->nparticipants + 1;
+		bloom_allowed = space_allowed * HASH_BLOOM_FILTER_MAX_FRACTION / ncopies;
+
+		if (bloom_allowed >= 1024L)
+		{
+			hashtable->bloomFilter = bloom_create((int64) Max(rows, 1.0),
+												 bloom_allowed / 1024L, 0);
+			hashtable->bloomFilterSpace =
+				bloom_size(hashtable->bloomFilter) * ncopies;
+
+			space_allowed -= hashtable->bloomFilterSpace;
+			hashtable->spaceAllowed = space_allowed;
+			hashtable->spaceAllowedSkew =
+				hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
+		}
+	}
+
 	if (nbatch > 1 && hashtable->parallel_state == NULL)
 	{
 		/*
@@ -1095,9 +1179,11 @@ ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable)
 					/*
 					 * We are going from single-batch to multi-batch.  We need
 					 * to switch from one large combined memory budget to the
-					 * regular work_mem budget.
+					 * regular work_mem budget, less this participant's
+					 * share of the bloom filters.
 					 */
-					pstate->space_allowed = work_mem * 1024L;
+					pstate->space_allowed = work_mem * 1024L -
+						hashtable->bloomFilterSpace / pstate->nparticipants;
 
 					/*
 					 * The combined work_mem of all participants wasn't
@@ -1418,6 +1504,31 @@ ExecParallelHashMergeCounters(HashJoinTable hashtable)
 	LWLockRelease(&pstate->lock);
 }
 
+/*
+ * Add the hash values in this backend's bloom filter to the shared one,
+ * creating it from ours if we are the first to get here.
+ */
+static void
+ExecParallelHashMergeBloomFilter(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+
+	LWLockAcquire(&pstate->lock, LW_EXCLUSIVE);
+	if (!DsaPointerIsValid(pstate->bloom_filter))
+	{
+		Size		size = bloom_size(hashtable->bloomFilter);
+
+		pstate->bloom_filter = dsa_allocate(hashtable->area, size);
+		memcpy(dsa_get_address(hashtable->area, pstate->bloom_filter),
+			   hashtable->bloomFilter, size);
+	}
+	else
+		bloom_union((bloom_filter *) dsa_get_address(hashtable->area,
+													 pstate->bloom_filter),
+					hashtable->bloomFilter);
+	LWLockRelease(&pstate->lock);
+}
+
 /*
  * ExecHashIncreaseNumBuckets
  *		increase the original number of buckets in order to reduce
@@ -1848,6 +1959,51 @@ ExecHashGetHashValue(HashJoinTable hashtable,
 	return true;
 }
 
+/*
+ * ExecHashScanFilterPasses
+ *		Test the current scan tuple of econtext against the bloom filter a
+ *		hash join pushed down into its outer scan.
+ *
+ * Returns false if the tuple cannot have a join partner.  The scan keeps
+ * the filter for the whole join, but the hash table decides whether there
+ * is a bloom filter to test against at the moment.  A filter that turns out
+ * to remove almost nothing is not worth the cost of hashing every tuple
+ * twice, so we stop testing after a while in that case.
+ */
+bool
+ExecHashScanFilterPasses(HashJoinScanFilter *filter, ExprContext *econtext)
+{
+	HashJoinTable hashtable = filter->hashtable;
+	uint32		hashvalue;
+	bool		passes;
+
+	if (filter->disabled || hashtable->bloomFilter == NULL)
+		return true;
+
+	/*
+	 * The filter is only pushed down if outer tuples without a join partner
+	 * are not returned, so a null key that a strict hash operator can't
+	 * match means the tuple can go, too.
+	 */
+	if (!ExecHashGetHashValue(hashtable, econtext, filter->hashkeys,
+							  true, false, &hashvalue))
+		passes = false;
+	else
+		passes = !bloom_lacks_element(hashtable->bloomFilter,
+									  (unsigned char *) &hashvalue,
+									  sizeof(hashvalue));
+
+	filter->ntested += 1;
+	if (!passes)
+		filter->nremoved += 1;
+
+	if (filter->ntested == HASH_SCAN_FILTER_SAMPLE &&
+		filter->nremoved < HASH_SCAN_FILTER_SAMPLE * HASH_SCAN_FILTER_MIN_REMOVED)
+		filter->disabled = true;
+
+	return passes;
+}
+
 /*
  * ExecHashGetBucketAndBatch
  *		Determine the bucket number and batch number for a hash value
@@ -2640,7 +2796,8 @@ ExecHashGetInstrumentation(HashInstrumentation *instrument,
 	instrument->nbuckets_original = hashtable->nbuckets_original;
 	instrument->nbatch = hashtable->nbatch;
 	instrument->nbatch_original = hashtable->nbatch_original;
-	instrument->space_peak = hashtable->spacePeak;
+	instrument->space_peak = hashtable->spacePeak +
+		hashtable->bloomFilterSpace;
 }
 
 /*
@@ -3140,6 +3297,18 @@ ExecHashTableDetach(HashJoinTable hashtable)
 				dsa_free(hashtable->area, pstate->batches);
 				pstate->batches = InvalidDsaPointer;
 			}
+			if (DsaPointerIsValid(pstate->bloom_filter))
+			{
+				dsa_free(hashtable->area, pstate->bloom_filter);
+				pstate->bloom_filter = InvalidDsaPointer;
+			}
+		}
+
+		/* The shared bloom filter may be gone now. */
+		if (hashtable->bloomFilterShared)
+		{
+			hashtable->bloomFilter = NULL;
+			hashtable->bloomFilterShared = false;
 		}
 
 		hashtable->parallel_state = NULL;
@@ -113,6 +113,9 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
 #include "utils/memutils.h"
 #include "utils/sharedtuplestore.h"
@@ -133,6 +136,28 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/*
+ * Fraction of the outer tuples that the planner must expect to have no join
+ * partner before we push a bloom filter down into the outer scan.
+ */
+#define HJ_SCAN_FILTER_MIN_REMOVED	0.5
+
+/* GUC parameter */
+bool		enable_hashjoin_bloom_filter = true;
+
+/* context for outer_key_to_scan_mutator */
+typedef struct
+{
+	List	   *targetlist;		/* outer scan's target list */
+	bool		failed;			/* found a reference we can't translate */
+} outer_key_to_scan_context;
+
+static HashJoinScanFilter *ExecHashJoinInitScanFilter(HashJoinState *hjstate,
+						   HashJoin *node);
+static Node *outer_key_to_scan_mutator(Node *node,
+						  outer_key_to_scan_context *context);
+static void ExecHashJoinPushDownFilter(HashJoinState *hjstate);
+static void ExecHashJoinRemoveFilter(HashJoinState *hjstate);
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 						  HashJoinState *hjstate,
 						  uint32 *hashvalue);
@@ -297,6 +322,12 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				if (hashtable->totalTuples == 0 && !HJ_FILL_OUTER(node))
 					return NULL;
 
+				/*
+				 * Let the outer scan skip tuples that cannot have a match.
+				 */
+				if (node->hj_ScanFilter)
+					ExecHashJoinPushDownFilter(node);
+
 				/*
 				 * need to remember whether nbatch has increased since we
 				 * began scanning the outer relation
@@ -743,6 +774,15 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	/* child Hash node needs to evaluate inner hash keys, too */
 	((HashState *) innerPlanState(hjstate))->hashkeys = rclauses;
 
+	/*
+	 * If the outer side is a plain scan, it can test its tuples against a
+	 * bloom filter of the inner hash values, which the Hash node then needs
+	 * to build.
+	 */
+	hjstate->hj_ScanFilter = ExecHashJoinInitScanFilter(hjstate, node);
+	if (hjstate->hj_ScanFilter)
+		((HashState *) innerPlanState(hjstate))->build_bloom_filter = true;
+
 	hjstate->hj_JoinState = HJ_BUILD_HASHTABLE;
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
@@ -764,6 +804,7 @@ ExecEndHashJoin(HashJoinState *node)
 	 */
 	if (node->hj_HashTable)
 	{
+		ExecHashJoinRemoveFilter(node);
 		ExecHashTableDestroy(node->hj_HashTable);
 		node->hj_HashTable = NULL;
 	}
@@ -787,6 +828,129 @@ ExecEndHashJoin(HashJoinState *node)
 	ExecEndNode(innerPlanState(node));
 }
 
+/*
+ * ExecHashJoinInitScanFilter
+ *
+ *		Prepare a bloom filter for the outer scan, if it can use one.
+ *
+ * The filter removes outer tuples whose hash value doesn't occur on the inner
+ * side, so it can only be used if the join doesn't return outer tuples
+ * without a match.  The outer plan must be a scan that evaluates its quals
+ * on the scanned tuple, and the outer hash keys must be computable from that
+ * tuple without side effects.
+ *
+ * Testing a tuple against the filter costs about as much as probing the hash
+ * table with it, so the filter only pays off if the planner expects most
+ * outer tuples to find no partner.  The join's row estimate counts an outer
+ * tuple once per partner, and includes unmatched inner tuples for a right
+ * join, so it errs on the side of not filtering.
+ */
+static HashJoinScanFilter *
+ExecHashJoinInitScanFilter(HashJoinState *hjstate, HashJoin *node)
+{
+	PlanState  *outerState = outerPlanState(hjstate);
+	HashJoinScanFilter *filter;
+	outer_key_to_scan_context context;
+	List	   *hashkeys = NIL;
+	ListCell   *l;
+
+	if (!enable_hashjoin_bloom_filter || HJ_FILL_OUTER(hjstate))
+		return NULL;
+
+	if (node->join.plan.plan_rows >
+		outerPlan(node)->plan_rows * (1.0 - HJ_SCAN_FILTER_MIN_REMOVED))
+		return NULL;
+
+	switch (nodeTag(outerState))
+	{
+		case T_SeqScanState:
+		case T_IndexScanState:
+		case T_BitmapHeapScanState:
+			break;
+		default:
+			return NULL;
+	}
+
+	context.targetlist = outerState->plan->targetlist;
+	context.failed = false;
+	foreach(l, node->hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, l);
+		Node	   *key;
+
+		key = outer_key_to_scan_mutator((Node *) linitial(hclause->args),
+										&context);
+		if (context.failed || contain_volatile_functions(key) ||
+			contain_subplans(key))
+			return NULL;
+
+		hashkeys = lappend(hashkeys, ExecInitExpr((Expr *) key, outerState));
+	}
+
+	filter = (HashJoinScanFilter *) palloc0(sizeof(HashJoinScanFilter));
+	filter->hashkeys = hashkeys;
+
+	return filter;
+}
+
+/*
+ * Replace references to the outer plan's output in an outer hash key by the
+ * expressions the outer scan computes them from.
+ */
+static Node *
+outer_key_to_scan_mutator(Node *node, outer_key_to_scan_context *context)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var) && ((Var *) node)->varno == OUTER_VAR)
+	{
+		TargetEntry *tle = get_tle_by_resno(context->targetlist,
+											((Var *) node)->varattno);
+
+		if (tle == NULL)
+		{
+			context->failed = true;
+			return node;
+		}
+		return (Node *) copyObject(tle->expr);
+	}
+	return expression_tree_mutator(node, outer_key_to_scan_mutator,
+								   (void *) context);
+}
+
+/*
+ * ExecHashJoinPushDownFilter
+ *
+ *		Install the bloom filter of a newly built hash table in the outer scan.
+ */
+static void
+ExecHashJoinPushDownFilter(HashJoinState *hjstate)
+{
+	HashJoinScanFilter *filter = hjstate->hj_ScanFilter;
+
+	filter->hashtable = hjstate->hj_HashTable;
+	filter->ntested = 0;
+	filter->nremoved = 0;
+	filter->disabled = false;
+
+	((ScanState *) outerPlanState(hjstate))->ss_hashFilter = filter;
+}
+
+/*
+ * ExecHashJoinRemoveFilter
+ *
+ *		Stop filtering the outer scan, before the hash table goes away.
+ */
+static void
+ExecHashJoinRemoveFilter(HashJoinState *hjstate)
+{
+	if (hjstate->hj_ScanFilter == NULL)
+		return;
+
+	((ScanState *) outerPlanState(hjstate))->ss_hashFilter = NULL;
+	hjstate->hj_ScanFilter->hashtable = NULL;
+}
+
 /*
  * ExecHashJoinOuterGetTuple
  *
@@ -1328,6 +1492,7 @@ ExecReScanHashJoin(HashJoinState *node)
 		else
 		{
 			/* must destroy and rebuild hash table */
+			ExecHashJoinRemoveFilter(node);
 			ExecHashTableDestroy(node->hj_HashTable);
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
@@ -1459,6 +1624,7 @@ ExecHashJoinInitializeDSM(HashJoinState *state, ParallelContext *pcxt)
 	pg_atomic_init_u32(&pstate->distributor, 0);
 	pstate->nparticipants = pcxt->nworkers + 1;
 	pstate->total_tuples = 0;
+	pstate->bloom_filter = InvalidDsaPointer;
 	LWLockInitialize(&pstate->lock,
 					 LWTRANCHE_PARALLEL_HASH_JOIN);
 	BarrierInit(&pstate->build_barrier, 0);
@@ -0,0 +1,423 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ * DESCRIPTION
+ *
+ *	Incremental sort is an optimized variant of multikey sort for cases
+ *	when the input is already sorted by a prefix of the sort keys.  For
+ *	example, when a sort by (key1, key2 ... keyN) is requested and the
+ *	input is already sorted by (key1, key2 ... keyM), M < N, we can divide
+ *	the input into groups where keys (key1, ... keyM) are equal, and only
+ *	sort on the remaining columns within each group.
+ *
+ *	Consider the following example.  We have input tuples consisting of
+ *	two integers (X, Y) already presorted by X, while it's required to
+ *	sort them by both X and Y.  Let the input tuples be the following.
+ *
+ *	(1, 5)
+ *	(1, 2)
+ *	(2, 9)
+ *	(2, 1)
+ *	(2, 5)
+ *	(3, 3)
+ *	(3, 7)
+ *
+ *	An incremental sort algorithm would split the input into the following
+ *	groups, which have equal X, and then sort them by Y individually:
+ *
+ *		(1, 5) (1, 2)
+ *		(2, 9) (2, 1) (2, 5)
+ *		(3, 3) (3, 7)
+ *
+ *	After sorting these groups and putting them altogether, we would get
+ *	the following result which is sorted by X and Y, as requested:
+ *
+ *	(1, 2)
+ *	(1, 5)
+ *	(2, 1)
+ *	(2, 5)
+ *	(2, 9)
+ *	(3, 3)
+ *	(3, 7)
+ *
+ *	Incremental sort may be more efficient than plain sort, particularly
+ *	on large datasets, as it reduces the amount of data to sort at once,
+ *	making it more likely it fits into work_mem (eliminating the need to
+ *	spill to disk).  But the main advantage of incremental sort is that it
+ *	can start producing rows early, before sorting the whole dataset,
+ *	which is a significant benefit especially for queries with LIMIT.
+ *
+ *	Setting up a tuplesort for every group would be expensive when groups
+ *	are small, so groups are collected into batches of at least
+ *	MIN_BATCH_SIZE tuples.  A batch always ends at a change of the
+ *	presorted keys, so it consists of whole groups and can simply be sorted
+ *	on all the sort keys.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/tuplesort.h"
+
+/*
+ * Minimum number of tuples sorted together as one batch, to amortize the
+ * cost of setting up a tuplesort over several small groups.
+ */
+#define MIN_BATCH_SIZE 32
+
+
+/*
+ * Read the next batch of whole groups from the outer plan into a new
+ * tuplesort and sort it.
+ *
+ * Returns false if the outer plan had no more tuples.
+ */
+static bool
+incsort_load_batch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	Tuplesortstate *tuplesortstate;
+	TuplesortInstrumentation stats;
+	int64		minBatchSize = MIN_BATCH_SIZE;
+	int64		nTuples = 0;
+
+	/*
+	 * A bounded sort never has to return more than the remaining bound, so
+	 * there is no point in collecting more than that before sorting.
+	 */
+	if (node->bounded)
+	{
+		if (node->tuples_returned >= node->bound)
+			return false;
+		minBatchSize = Min(minBatchSize, node->bound - node->tuples_returned);
+	}
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  NULL, false);
+	if (node->bounded)
+		tuplesort_set_bound(tuplesortstate,
+							node->bound - node->tuples_returned);
+	node->tuplesortstate = (void *) tuplesortstate;
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+
+		/* the tuple that ended the previous batch starts this one */
+		if (!TupIsNull(node->transfer_tuple))
+			slot = node->transfer_tuple;
+		else
+			slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->outerNodeDone = true;
+			break;
+		}
+
+		/*
+		 * Once the batch is large enough, end it where the presorted keys
+		 * change.  The tuple that differs is kept for the next batch.
+		 */
+		if (nTuples >= minBatchSize)
+		{
+			econtext->ecxt_innertuple = node->group_pivot;
+			econtext->ecxt_outertuple = slot;
+			if (!ExecQualAndReset(node->presortedEq, econtext))
+			{
+				ExecCopySlot(node->transfer_tuple, slot);
+				break;
+			}
+		}
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+		nTuples++;
+
+		if (nTuples == minBatchSize)
+			ExecCopySlot(node->group_pivot, slot);
+
+		if (slot == node->transfer_tuple)
+			ExecClearTuple(node->transfer_tuple);
+	}
+
+	if (nTuples == 0)
+	{
+		tuplesort_end(tuplesortstate);
+		node->tuplesortstate = NULL;
+		return false;
+	}
+
+	tuplesort_performsort(tuplesortstate);
+
+	/* remember what the batch took, for EXPLAIN ANALYZE */
+	tuplesort_get_stats(tuplesortstate, &stats);
+	node->incsort_info.batchCount++;
+	node->incsort_info.sortMethods |= (1 << stats.sortMethod);
+	if (stats.spaceType == SORT_SPACE_TYPE_DISK)
+		node->incsort_info.maxDiskSpaceUsed =
+			Max(node->incsort_info.maxDiskSpaceUsed, stats.spaceUsed);
+	else
+		node->incsort_info.maxMemorySpaceUsed =
+			Max(node->incsort_info.maxMemorySpaceUsed, stats.spaceUsed);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Reads a batch of tuples sharing their presorted keys from the
+ *		outer subtree, sorts it with tuplesort and returns its tuples
+ *		one per call, before reading the next batch.
+ *
+ *		Conditions:
+ *		  -- none.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	EState	   *estate = node->ss.ps.state;
+	ScanDirection dir = estate->es_direction;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (;;)
+	{
+		if (node->execution_status == INCSORT_READING)
+		{
+			/*
+			 * Note that we only rely on the slot tuple remaining valid until
+			 * the next fetch from the tuplesort.
+			 */
+			if (tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+									   true, false, slot, NULL))
+			{
+				node->tuples_returned++;
+				return slot;
+			}
+
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+			node->tuplesortstate = NULL;
+
+			node->execution_status =
+				node->outerNodeDone ? INCSORT_DONE : INCSORT_LOADING;
+		}
+
+		if (node->execution_status == INCSORT_DONE)
+			return ExecClearTuple(slot);
+
+		SO1_printf("ExecIncrementalSort: %s\n", "sorting next batch");
+
+		/*
+		 * Want to scan subplan in the forward direction while loading the
+		 * batch.
+		 */
+		estate->es_direction = ForwardScanDirection;
+
+		if (incsort_load_batch(node))
+			node->execution_status = INCSORT_READING;
+		else
+			node->execution_status = INCSORT_DONE;
+
+		estate->es_direction = dir;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	TupleDesc	tupDesc;
+	Oid		   *eqOperators;
+	int			i;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing sort node");
+
+	/*
+	 * Incremental sort does not keep the whole output around, so it can
+	 * neither scan backward nor mark and restore its position.
+	 */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+	Assert(node->nPresortedCols > 0 &&
+		   node->nPresortedCols < node->sort.numCols);
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+	incrsortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	incrsortstate->bounded = false;
+	incrsortstate->tuples_returned = 0;
+	incrsortstate->execution_status = INCSORT_LOADING;
+	incrsortstate->outerNodeDone = false;
+	incrsortstate->tuplesortstate = NULL;
+	memset(&incrsortstate->incsort_info, 0, sizeof(IncrementalSortInfo));
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * The expression context is only used to compare the presorted keys of
+	 * two tuples.
+	 */
+	ExecAssignExprContext(estate, &incrsortstate->ss.ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate,
+												 eflags);
+
+	/*
+	 * Initialize scan slot and type.
+	 */
+	ExecCreateScanSlotFromOuterPlan(estate, &incrsortstate->ss);
+
+	/*
+	 * Initialize return slot and type. No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(estate, &incrsortstate->ss.ps);
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Slots for the tuple the current batch ends on and for the first
+	 * tuple of the next batch.
+	 */
+	tupDesc = ExecGetResultType(outerPlanState(incrsortstate));
+	incrsortstate->group_pivot = ExecInitExtraTupleSlot(estate, tupDesc);
+	incrsortstate->transfer_tuple = ExecInitExtraTupleSlot(estate, tupDesc);
+
+	/*
+	 * Precompute the comparison of the presorted keys, using the equality
+	 * operators that go with the sort operators.
+	 */
+	eqOperators = (Oid *) palloc(node->nPresortedCols * sizeof(Oid));
+	for (i = 0; i < node->nPresortedCols; i++)
+	{
+		eqOperators[i] = get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+														 NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "missing equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+
+	incrsortstate->presortedEq =
+		execTuplesMatchPrepare(tupDesc,
+							   node->nPresortedCols,
+							   node->sort.sortColIdx,
+							   eqOperators,
+							   &incrsortstate->ss.ps);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down sort node");
+
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * Incremental sort does not keep its output, so a rescan always has to
+	 * read and sort the subplan's output again.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	node->execution_status = INCSORT_LOADING;
+	node->outerNodeDone = false;
+	node->tuples_returned = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
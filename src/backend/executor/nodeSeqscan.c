@@ -19,6 +19,7 @@
  *		ExecInitSeqScan			creates and initializes a seqscan node.
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
+ *		ExecSeqScanBatch		fills a batch of tuples for batch mode
  *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
@@ -28,8 +29,10 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "catalog/pg_type.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
@@ -259,6 +262,70 @@ ExecReScanSeqScan(SeqScanState *node)
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanBatch
+ *
+ *		Fills the batch with up to BATCH_SIZE of the next tuples of the
+ *		scan, deformed into the batch's column vectors.  The scan's quals
+ *		are not checked and nothing is projected: batch mode evaluates
+ *		the quals over the whole batch itself.
+ *
+ *		Returns the number of rows filled.  Fewer than BATCH_SIZE rows
+ *		means the scan is done, and it must not be called again then.
+ * ----------------------------------------------------------------
+ */
+int
+ExecSeqScanBatch(SeqScanState *node, TupleBatch *batch)
+{
+	int			nrows = 0;
+
+	CHECK_FOR_INTERRUPTS();
+
+	while (nrows < BATCH_SIZE)
+	{
+		TupleTableSlot *slot = SeqNext(node);
+		int			i;
+
+		if (TupIsNull(slot))
+			break;
+
+		slot_getsomeattrs(slot, batch->maxattnum);
+
+		for (i = 0; i < batch->ncolumns; i++)
+		{
+			BatchColumn *column = &batch->columns[i];
+			int			attoff = column->attnum - 1;
+			bool		isnull = slot->tts_isnull[attoff];
+			Datum		value = slot->tts_values[attoff];
+
+			column->isnull[nrows] = isnull;
+
+			switch (column->typid)
+			{
+				case INT4OID:
+				case DATEOID:
+					column->values.i32[nrows] = isnull ? 0 : DatumGetInt32(value);
+					break;
+				case INT8OID:
+					column->values.i64[nrows] = isnull ? 0 : DatumGetInt64(value);
+					break;
+				case FLOAT8OID:
+					column->values.f8[nrows] = isnull ? 0.0 : DatumGetFloat8(value);
+					break;
+				default:
+					elog(ERROR, "unsupported type %u in batch column",
+						 column->typid);
+			}
+		}
+
+		nrows++;
+	}
+
+	batch->nrows = nrows;
+
+	return nrows;
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
  * ----------------------------------------------------------------
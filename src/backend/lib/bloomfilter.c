@@ -39,6 +39,7 @@
 #include "lib/bloomfilter.h"
 
 #define MAX_HASH_FUNCS		10
+#define BLOOM_MIN_BITSET_BYTES	1024
 
 struct bloom_filter
 {
@@ -73,8 +74,9 @@ static inline uint32 mod_m(uint32 a, uint64 m);
  * bits, and the largest possible bitset is 512MB (2^32 bits).  The
  * implementation allocates only enough memory to target its standard false
  * positive rate, using a simple formula with caller's total_elems estimate as
- * an input.  The bitset might be as small as 1MB, even when bloom_work_mem is
- * much higher.
+ * an input.  The bitset might be as small as 1kB, even when bloom_work_mem is
+ * much higher, so callers that expect few elements don't pay for a large
+ * filter.
  *
  * The Bloom filter is seeded using a value provided by the caller.  Using a
  * distinct seed value on every call makes it unlikely that the same false
@@ -99,7 +101,7 @@ bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 	 * false positive rate still won't exceed 2% in almost all cases.
 	 */
 	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
-	bitset_bytes = Max(1024 * 1024, bitset_bytes);
+	bitset_bytes = Max(BLOOM_MIN_BITSET_BYTES, bitset_bytes);
 
 	/*
 	 * Size in bits should be the highest power of two <= target.  bitset_bits
@@ -171,6 +173,39 @@ bloom_lacks_element(bloom_filter *filter, unsigned char *elem, size_t len)
 	return false;
 }
 
+/*
+ * Size of a Bloom filter, including its bitset.
+ *
+ * A Bloom filter contains no pointers, so it can be copied to this many bytes
+ * of other memory, such as shared memory, with memcpy().
+ */
+Size
+bloom_size(bloom_filter *filter)
+{
+	return offsetof(bloom_filter, bitset) + filter->m / BITS_PER_BYTE;
+}
+
+/*
+ * Add all elements of other to filter.
+ *
+ * Both filters must have been created with the same total_elems,
+ * bloom_work_mem and seed, so that they use the same hash functions and
+ * bitset size.
+ */
+void
+bloom_union(bloom_filter *filter, bloom_filter *other)
+{
+	uint64		bitset_bytes = filter->m / BITS_PER_BYTE;
+	uint64		i;
+
+	if (filter->m != other->m || filter->k_hash_funcs != other->k_hash_funcs ||
+		filter->seed != other->seed)
+		elog(ERROR, "cannot form union of incompatible Bloom filters");
+
+	for (i = 0; i < bitset_bytes; i++)
+		filter->bitset[i] |= other->bitset[i];
+}
+
 /*
  * What proportion of bits are currently set?
  *
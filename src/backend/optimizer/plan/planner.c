@@ -4868,8 +4868,9 @@ create_distinct_paths(PlannerInfo *root,
  * Build a new upperrel containing Paths for ORDER BY evaluation.
  *
  * All paths in the result must satisfy the ORDER BY ordering.
- * The only new path we need consider is an explicit sort on the
- * cheapest-total existing path.
+ * The new paths we need consider are an explicit sort on the
+ * cheapest-total existing path, and an incremental sort on any path
+ * that is already sorted by a prefix of the ORDER BY keys.
  *
  * input_rel: contains the source-data Paths
  * target: the output tlist the result Paths must emit
@@ -4908,13 +4909,18 @@ create_ordered_paths(PlannerInfo *root,
 
 	foreach(lc, input_rel->pathlist)
 	{
-		Path	   *path = (Path *) lfirst(lc);
+		Path	   *input_path = (Path *) lfirst(lc);
+		Path	   *path;
 		bool		is_sorted;
+		int			presorted_keys;
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
-		if (path == cheapest_input_path || is_sorted)
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												input_path->pathkeys,
+												&presorted_keys);
+		if (input_path == cheapest_input_path || is_sorted)
 		{
+			path = input_path;
+
 			if (!is_sorted)
 			{
 				/* An explicit sort here can take advantage of LIMIT */
@@ -4932,6 +4938,29 @@ create_ordered_paths(PlannerInfo *root,
 
 			add_path(ordered_rel, path);
 		}
+
+		/*
+		 * A path that is already sorted by a prefix of the requested
+		 * ordering only needs an incremental sort on the remaining keys.
+		 * This is considered for every such path, not just the cheapest
+		 * one, since its low startup cost can win under a LIMIT.
+		 */
+		if (!is_sorted && presorted_keys > 0 && enable_incremental_sort)
+		{
+			path = (Path *) create_incremental_sort_path(root,
+														 ordered_rel,
+														 input_path,
+														 root->sort_pathkeys,
+														 presorted_keys,
+														 limit_tuples);
+
+			/* Add projection step if needed */
+			if (path->pathtarget != target)
+				path = apply_projection_to_path(root, ordered_rel,
+												path, target);
+
+			add_path(ordered_rel, path);
+		}
 	}
 
 	/*
@@ -1077,6 +1077,25 @@ max_parallel_hazard(Query *parse)
 	return context.max_hazard;
 }
 
+/*
+ * expression_parallel_hazard
+ *		Find the worst parallel-hazard level in a standalone expression
+ *
+ * This is for expressions evaluated outside any planned query, such as
+ * column defaults and CHECK constraints applied by a parallel COPY FROM.
+ */
+char
+expression_parallel_hazard(Node *node)
+{
+	max_parallel_hazard_context context;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_UNSAFE;
+	context.safe_param_ids = NIL;
+	(void) max_parallel_hazard_walker(node, &context);
+	return context.max_hazard;
+}
+
 /*
  * is_parallel_safe
  *		Detect whether the given expr contains only parallel-safe functions
@@ -65,6 +65,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "access/gin.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
@@ -2670,6 +2671,9 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_GINCleanPendingList:
+				ginCleanPendingList(workitem->avw_relation);
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -3185,6 +3189,10 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_GINCleanPendingList:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: GIN pending list cleanup");
+			break;
 	}
 
 	/*
@@ -3222,6 +3230,10 @@ AutoVacuumingActive(void)
 /*
  * Request one work item to the next autovacuum run processing our database.
  * Return false if the request can't be recorded.
+ *
+ * An identical request that is still waiting to be processed satisfies the
+ * new one, so callers that request work repeatedly until it gets done (such
+ * as GIN pending list cleanup) don't fill up the list.
  */
 bool
 AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
@@ -3230,6 +3242,31 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 	int			i;
 	bool		result = false;
 
+	/*
+	 * Look for an identical pending request first.  A shared lock is enough
+	 * for that; if we race with someone else adding the same request, the
+	 * worst that happens is that it gets queued twice.
+	 */
+	LWLockAcquire(AutovacuumLock, LW_SHARED);
+	for (i = 0; i < NUM_WORKITEMS; i++)
+	{
+		AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
+
+		if (workitem->avw_used && !workitem->avw_active &&
+			workitem->avw_type == type &&
+			workitem->avw_database == MyDatabaseId &&
+			workitem->avw_relation == relationId &&
+			workitem->avw_blockNumber == blkno)
+		{
+			result = true;
+			break;
+		}
+	}
+	LWLockRelease(AutovacuumLock);
+
+	if (result)
+		return true;
+
 	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
 	/*
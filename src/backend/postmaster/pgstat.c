@@ -2042,6 +2042,31 @@ pgstat_update_heap_dead_tuples(Relation rel, int delta)
 		pgstat_info->t_counts.t_delta_dead_tuples -= delta;
 }
 
+/*
+ * pgstat_count_gin_pending_cleanup - count a GIN pending list cleanup
+ *
+ * npages is the number of pending list pages merged into the main index
+ * structure, usecs the time that took.  Like the other index counters these
+ * are not transactional.  Index insertions don't otherwise set up
+ * pgstat_info, so do that here.
+ */
+void
+pgstat_count_gin_pending_cleanup(Relation rel, PgStat_Counter npages,
+								 PgStat_Counter usecs)
+{
+	PgStat_TableStatus *pgstat_info;
+
+	pgstat_initstats(rel);
+	pgstat_info = rel->pgstat_info;
+
+	if (pgstat_info != NULL)
+	{
+		pgstat_info->t_counts.t_gin_pending_cleanups++;
+		pgstat_info->t_counts.t_gin_pending_pages += npages;
+		pgstat_info->t_counts.t_gin_pending_cleanup_time += usecs;
+	}
+}
+
 
 /* ----------
  * AtEOXact_PgStat
@@ -4689,6 +4714,9 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 		result->changes_since_analyze = 0;
 		result->blocks_fetched = 0;
 		result->blocks_hit = 0;
+		result->gin_pending_cleanups = 0;
+		result->gin_pending_pages = 0;
+		result->gin_pending_cleanup_time = 0;
 		result->vacuum_timestamp = 0;
 		result->vacuum_count = 0;
 		result->autovac_vacuum_timestamp = 0;
@@ -5819,6 +5847,9 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
 			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
+			tabentry->gin_pending_cleanups = tabmsg->t_counts.t_gin_pending_cleanups;
+			tabentry->gin_pending_pages = tabmsg->t_counts.t_gin_pending_pages;
+			tabentry->gin_pending_cleanup_time = tabmsg->t_counts.t_gin_pending_cleanup_time;
 
 			tabentry->vacuum_timestamp = 0;
 			tabentry->vacuum_count = 0;
@@ -5852,6 +5883,9 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
 			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
+			tabentry->gin_pending_cleanups += tabmsg->t_counts.t_gin_pending_cleanups;
+			tabentry->gin_pending_pages += tabmsg->t_counts.t_gin_pending_pages;
+			tabentry->gin_pending_cleanup_time += tabmsg->t_counts.t_gin_pending_cleanup_time;
 		}
 
 		/* Clamp n_live_tuples in case of negative delta_live_tuples */
@@ -196,6 +196,7 @@ static const char *excludeFiles[] =
 static const char *noChecksumFiles[] = {
 	"pg_control",
 	"pg_filenode.map",
+	"pg_init_forks",
 	"pg_internal.init",
 	"PG_VERSION",
 #ifdef EXEC_BACKEND
@@ -90,6 +90,7 @@
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/resowner_private.h"
+#include "utils/timestamp.h"
 
 
 /* Define PG_FLUSH_DATA_WORKS if we have an implementation for pg_flush_data */
@@ -148,6 +149,23 @@ int			max_safe_fds = 32;	/* default if not changed */
 /* Whether it is safe to continue running after fsync() fails. */
 bool		data_sync_retry = false;
 
+/* How to sync the data directory when starting crash recovery. */
+int			recovery_init_sync_method = RECOVERY_INIT_SYNC_METHOD_FSYNC;
+
+/* How often SyncDataDirectory() reports its progress, in milliseconds */
+#define SYNC_PROGRESS_INTERVAL	10000
+
+/* Progress reporting state of SyncDataDirectory() */
+static const char *sync_method_name;
+static TimestampTz sync_start_time;
+static TimestampTz sync_report_time;
+
+#ifdef HAVE_SYNCFS
+/* Devices of the filesystems SyncDataDirectory() has already synced */
+static dev_t *synced_devs;
+static int	num_synced_devs;
+#endif
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -330,6 +348,12 @@ static void walkdir(const char *path,
 static void pre_sync_fname(const char *fname, bool isdir, int elevel);
 #endif
 static void datadir_fsync_fname(const char *fname, bool isdir, int elevel);
+static void begin_sync_progress(const char *method);
+static void report_sync_progress(const char *path);
+#ifdef HAVE_SYNCFS
+static void do_syncfs(const char *path, dev_t dev);
+static void syncfs_mounts(const char *path, bool follow_symlink, int depth);
+#endif
 static void unlink_if_exists_fname(const char *fname, bool isdir, int elevel);
 
 static int	fsync_fname_ext(const char *fname, bool isdir, bool ignore_perm, int elevel);
@@ -2233,6 +2257,99 @@ FileTruncate(File file, off_t offset, uint32 wait_event_info)
 	return returnCode;
 }
 
+/*
+ * Write zeroes to a file, starting at 'offset', for 'amount' bytes.
+ *
+ * Returns 0 on success, or -1 with errno set on failure.  As with FileWrite,
+ * a short write is reported as ENOSPC.
+ */
+int
+FileZero(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+	char	   *zbuffer;
+	int			chunksize;
+	int			returnCode = 0;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileZero %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	if (FileSeek(file, offset, SEEK_SET) != offset)
+		return -1;
+
+	/* Write in chunks of up to 64 pages, to keep the syscall count low */
+	chunksize = (int) Min(amount, (off_t) BLCKSZ * 64);
+	zbuffer = palloc0(Max(chunksize, 1));
+
+	while (amount > 0)
+	{
+		int			thiswrite = (int) Min(amount, (off_t) chunksize);
+		int			nbytes;
+
+		nbytes = FileWrite(file, zbuffer, thiswrite, wait_event_info);
+		if (nbytes != thiswrite)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (nbytes >= 0)
+				errno = ENOSPC;
+			returnCode = -1;
+			break;
+		}
+		amount -= thiswrite;
+	}
+
+	pfree(zbuffer);
+
+	return returnCode;
+}
+
+/*
+ * Make sure that the file has space allocated from 'offset' for 'amount'
+ * bytes, and that any of that range lying beyond the end of the file reads
+ * as zeroes, extending the file as needed.
+ *
+ * This uses posix_fallocate() where available, which reserves the space
+ * with a single call and without writing the data blocks.  If the platform
+ * or the filesystem doesn't support that, we write zeroes instead.
+ *
+ * Returns 0 on success, or -1 with errno set on failure.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileFallocate %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return -1;
+
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+
+	/* posix_fallocate() returns the error rather than setting errno */
+	errno = returnCode;
+
+	/* fall back to writing zeroes only if the operation isn't supported */
+	if (returnCode != EINVAL && returnCode != EOPNOTSUPP)
+		return -1;
+#endif
+
+	return FileZero(file, offset, amount, wait_event_info);
+}
+
 /*
  * Return the pathname associated with an open file.
  *
@@ -3269,13 +3386,20 @@ looks_like_temp_rel_name(const char *name)
 
 
 /*
- * Issue fsync recursively on PGDATA and all its contents.
+ * Issue fsync recursively on PGDATA and all its contents, or with
+ * recovery_init_sync_method = syncfs, issue syncfs on every filesystem
+ * that holds part of it.
  *
  * We fsync regular files and directories wherever they are, but we
  * follow symlinks only for pg_wal and immediately under pg_tblspc.
  * Other symlinks are presumed to point at files we're not responsible
  * for fsyncing, and might not have privileges to write at all.
  *
+ * With many files, typically one directory per cloned database, walking
+ * the whole tree can take a very long time, while syncfs only costs one
+ * call per filesystem.  It also syncs unrelated files that happen to be
+ * on the same filesystems, though.
+ *
  * Errors are logged but not considered fatal; that's because this is used
  * only during database startup, to deal with the possibility that there are
  * issued-but-unsynced writes pending against the data directory.  We want to
@@ -3321,6 +3445,54 @@ SyncDataDirectory(void)
 		xlog_is_symlink = true;
 #endif
 
+#ifdef HAVE_SYNCFS
+	if (recovery_init_sync_method == RECOVERY_INIT_SYNC_METHOD_SYNCFS)
+	{
+		DIR		   *dir;
+		struct dirent *de;
+
+		begin_sync_progress("syncfs");
+
+		/*
+		 * Sync the filesystems of the data directory and of anything mounted
+		 * on the directories directly below it, or on those one level
+		 * further down, such as the per-database directories under base.
+		 */
+		syncfs_mounts(".", false, 2);
+
+		/* pg_wal and the tablespaces may live elsewhere */
+		if (xlog_is_symlink)
+			syncfs_mounts("pg_wal", true, 0);
+
+		dir = AllocateDir("pg_tblspc");
+		while ((de = ReadDirExtended(dir, "pg_tblspc", LOG)) != NULL)
+		{
+			char		path[MAXPGPATH];
+
+			if (strcmp(de->d_name, ".") == 0 ||
+				strcmp(de->d_name, "..") == 0)
+				continue;
+
+			/* Look for mounts down to the tablespace's database dirs */
+			snprintf(path, sizeof(path), "pg_tblspc/%s", de->d_name);
+			syncfs_mounts(path, true, 2);
+		}
+		FreeDir(dir);
+
+		ereport(DEBUG1,
+				(errmsg("synced %d file systems holding the data directory",
+						num_synced_devs)));
+
+		if (synced_devs)
+			pfree(synced_devs);
+		synced_devs = NULL;
+		num_synced_devs = 0;
+		return;
+	}
+#endif
+
+	begin_sync_progress("fsync");
+
 	/*
 	 * If possible, hint to the kernel that we're soon going to fsync the data
 	 * directory and its contents.  Errors in this step are even less
@@ -3462,6 +3634,8 @@ pre_sync_fname(const char *fname, bool isdir, int elevel)
 static void
 datadir_fsync_fname(const char *fname, bool isdir, int elevel)
 {
+	report_sync_progress(fname);
+
 	/*
 	 * We want to silently ignoring errors about unreadable files.  Pass that
 	 * desire on to fsync_fname_ext().
@@ -3469,6 +3643,143 @@ datadir_fsync_fname(const char *fname, bool isdir, int elevel)
 	fsync_fname_ext(fname, isdir, true, elevel);
 }
 
+/*
+ * Start timing SyncDataDirectory() for report_sync_progress().
+ */
+static void
+begin_sync_progress(const char *method)
+{
+	sync_method_name = method;
+	sync_start_time = sync_report_time = GetCurrentTimestamp();
+}
+
+/*
+ * Log how long SyncDataDirectory() has been running, and where it is, at
+ * most once every SYNC_PROGRESS_INTERVAL.  Recovery can't start before the
+ * sync is done, so this shows an administrator why the server is not up yet.
+ */
+static void
+report_sync_progress(const char *path)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	long		secs;
+	int			usecs;
+
+	if (!TimestampDifferenceExceeds(sync_report_time, now,
+									SYNC_PROGRESS_INTERVAL))
+		return;
+
+	sync_report_time = now;
+	TimestampDifference(sync_start_time, now, &secs, &usecs);
+
+	ereport(LOG,
+			(errmsg("syncing data directory (%s), elapsed time: %ld.%02d s, current path: %s",
+					sync_method_name, secs, usecs / 10000, path)));
+}
+
+#ifdef HAVE_SYNCFS
+
+/*
+ * Issue syncfs on the filesystem holding 'path', whose device is 'dev',
+ * unless SyncDataDirectory() has already synced that filesystem.
+ */
+static void
+do_syncfs(const char *path, dev_t dev)
+{
+	int			fd;
+	int			i;
+
+	for (i = 0; i < num_synced_devs; i++)
+	{
+		if (synced_devs[i] == dev)
+			return;
+	}
+
+	if (synced_devs == NULL)
+		synced_devs = palloc(sizeof(dev_t) * 16);
+	else if (num_synced_devs % 16 == 0)
+		synced_devs = repalloc(synced_devs,
+							   sizeof(dev_t) * (num_synced_devs + 16));
+	synced_devs[num_synced_devs++] = dev;
+
+	report_sync_progress(path);
+
+	fd = OpenTransientFile(path, O_RDONLY);
+	if (fd < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+		return;
+	}
+
+	if (syncfs(fd) < 0)
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not synchronize file system for file \"%s\": %m",
+						path)));
+
+	(void) CloseTransientFile(fd);
+}
+
+/*
+ * Issue syncfs on the filesystem of directory 'path' and on those mounted on
+ * its subdirectories, looking at most 'depth' levels down.  Only 'path'
+ * itself is followed if it is a symlink.
+ *
+ * Mount points are recognized by their device numbers, so every ZFS dataset,
+ * for instance one per cloned database, counts as a filesystem of its own.
+ * Files are only stat'd, so this stays cheap as long as 'depth' doesn't
+ * reach into directories holding many relation files.
+ */
+static void
+syncfs_mounts(const char *path, bool follow_symlink, int depth)
+{
+	struct stat st;
+	DIR		   *dir;
+	struct dirent *de;
+	int			sret;
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (follow_symlink)
+		sret = stat(path, &st);
+	else
+		sret = lstat(path, &st);
+
+	if (sret < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+		return;
+	}
+
+	if (!S_ISDIR(st.st_mode))
+		return;
+
+	do_syncfs(path, st.st_dev);
+
+	if (depth <= 0)
+		return;
+
+	dir = AllocateDir(path);
+	while ((de = ReadDirExtended(dir, path, LOG)) != NULL)
+	{
+		char		subpath[MAXPGPATH * 2];
+
+		if (strcmp(de->d_name, ".") == 0 ||
+			strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(subpath, sizeof(subpath), "%s/%s", path, de->d_name);
+		syncfs_mounts(subpath, false, depth - 1);
+	}
+	FreeDir(dir);
+}
+
+#endif							/* HAVE_SYNCFS */
+
 static void
 unlink_if_exists_fname(const char *fname, bool isdir, int elevel)
 {
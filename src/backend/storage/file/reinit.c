@@ -14,24 +14,40 @@
 
 #include "postgres.h"
 
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "common/relpath.h"
+#include "port/pg_crc32c.h"
+#include "storage/block.h"
 #include "storage/copydir.h"
 #include "storage/fd.h"
+#include "storage/lwlock.h"
 #include "storage/reinit.h"
-#include "utils/hsearch.h"
+#include "utils/builtins.h"
 #include "utils/memutils.h"
 
 static void ResetUnloggedRelationsInTablespaceDir(const char *tsdirname,
 									  int op);
 static void ResetUnloggedRelationsInDbspaceDir(const char *dbspacedirname,
 								   int op);
+static Oid *scan_init_forks(const char *dbspacedirname, int *nrelnodes);
+static Oid *read_init_fork_map(const char *dbspacedirname, int *nrelnodes,
+				   int elevel);
+static bool write_init_fork_map(const char *dbspacedirname,
+					Oid *relnodes, int nrelnodes, int elevel);
+static int	sort_unique_oids(Oid *oids, int noids);
 
+/*
+ * One entry of a dbspace's init fork map.  The CRC lets us recognize entries
+ * torn by a crash in the middle of appending them.
+ */
 typedef struct
 {
-	char		oid[OIDCHARS + 1];
-} unlogged_relation_entry;
+	Oid			relnode;
+	pg_crc32c	crc;
+} init_fork_map_entry;
 
 /*
  * Reset unlogged relations from before the last restart.
@@ -41,6 +57,11 @@ typedef struct
  *
  * If op includes UNLOGGED_RELATION_INIT, we copy the "init" fork to the main
  * fork.
+ *
+ * Each per-database directory records which of its relations have an init
+ * fork in its init fork map (see RememberUnloggedRelation), so we only need
+ * to look at those relations, and can skip directories without any entirely.
+ * Directories that lack a usable map are scanned instead, and get one.
  */
 void
 ResetUnloggedRelations(int op)
@@ -148,167 +169,152 @@ ResetUnloggedRelationsInTablespaceDir(const char *tsdirname, int op)
 static void
 ResetUnloggedRelationsInDbspaceDir(const char *dbspacedirname, int op)
 {
-	DIR		   *dbspace_dir;
-	struct dirent *de;
-	char		rm_path[MAXPGPATH * 2];
+	Oid		   *relnodes;
+	int			nrelnodes;
+	int			nlisted;
+	int			i;
+	char		path[MAXPGPATH * 2];
+	char		dstpath[MAXPGPATH * 2];
+	struct stat st;
 
 	/* Caller must specify at least one operation. */
 	Assert((op & (UNLOGGED_RELATION_CLEANUP | UNLOGGED_RELATION_INIT)) != 0);
 
-	/*
-	 * Cleanup is a two-pass operation.  First, we go through and identify all
-	 * the files with init forks.  Then, we go through again and nuke
-	 * everything with the same OID except the init fork.
-	 */
-	if ((op & UNLOGGED_RELATION_CLEANUP) != 0)
+	relnodes = read_init_fork_map(dbspacedirname, &nrelnodes, ERROR);
+	if (relnodes == NULL)
 	{
-		HTAB	   *hash;
-		HASHCTL		ctl;
-
 		/*
-		 * It's possible that someone could create a ton of unlogged relations
-		 * in the same database & tablespace, so we'd better use a hash table
-		 * rather than an array or linked list to keep track of which files
-		 * need to be reset.  Otherwise, this cleanup operation would be
-		 * O(n^2).
+		 * No map yet, or a damaged one.  Find the init forks the hard way and
+		 * record them, so the next startup can skip the scan.
 		 */
-		memset(&ctl, 0, sizeof(ctl));
-		ctl.keysize = sizeof(unlogged_relation_entry);
-		ctl.entrysize = sizeof(unlogged_relation_entry);
-		hash = hash_create("unlogged hash", 32, &ctl, HASH_ELEM);
-
-		/* Scan the directory. */
-		dbspace_dir = AllocateDir(dbspacedirname);
-		while ((de = ReadDir(dbspace_dir, dbspacedirname)) != NULL)
-		{
-			ForkNumber	forkNum;
-			int			oidchars;
-			unlogged_relation_entry ent;
-
-			/* Skip anything that doesn't look like a relation data file. */
-			if (!parse_filename_for_nontemp_relation(de->d_name, &oidchars,
-													 &forkNum))
-				continue;
-
-			/* Also skip it unless this is the init fork. */
-			if (forkNum != INIT_FORKNUM)
-				continue;
-
-			/*
-			 * Put the OID portion of the name into the hash table, if it
-			 * isn't already.
-			 */
-			memset(ent.oid, 0, sizeof(ent.oid));
-			memcpy(ent.oid, de->d_name, oidchars);
-			hash_search(hash, &ent, HASH_ENTER, NULL);
-		}
-
-		/* Done with the first pass. */
-		FreeDir(dbspace_dir);
-
+		relnodes = scan_init_forks(dbspacedirname, &nrelnodes);
+		write_init_fork_map(dbspacedirname, relnodes, nrelnodes, ERROR);
+	}
+	else
+	{
 		/*
-		 * If we didn't find any init forks, there's no point in continuing;
-		 * we can bail out now.
+		 * Dropped relations are normally taken off the map as their init
+		 * fork is removed (see ForgetUnloggedRelation), but a crash can leave
+		 * their entries behind, as well as those of creations that were
+		 * interrupted before the init fork got created.  Weed those out here
+		 * and write back what is left.
 		 */
-		if (hash_get_num_entries(hash) == 0)
+		nlisted = nrelnodes;
+		nrelnodes = 0;
+		for (i = 0; i < nlisted; i++)
 		{
-			hash_destroy(hash);
-			return;
+			snprintf(path, sizeof(path), "%s/%u_%s",
+					 dbspacedirname, relnodes[i], forkNames[INIT_FORKNUM]);
+			if (lstat(path, &st) < 0)
+			{
+				if (errno == ENOENT)
+					continue;
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not stat file \"%s\": %m", path)));
+			}
+			relnodes[nrelnodes++] = relnodes[i];
 		}
 
-		/*
-		 * Now, make a second pass and remove anything that matches.
-		 */
-		dbspace_dir = AllocateDir(dbspacedirname);
-		while ((de = ReadDir(dbspace_dir, dbspacedirname)) != NULL)
+		if (nrelnodes != nlisted)
+			write_init_fork_map(dbspacedirname, relnodes, nrelnodes, ERROR);
+	}
+
+	/* If there are no init forks, there's nothing else to do. */
+	if (nrelnodes == 0)
+	{
+		pfree(relnodes);
+		return;
+	}
+
+	/*
+	 * Cleanup removes all segments of all forks of the relations except their
+	 * init forks.  Segments are removed in ascending order until the first
+	 * one that's missing, the same way mdunlink() does.
+	 */
+	if ((op & UNLOGGED_RELATION_CLEANUP) != 0)
+	{
+		for (i = 0; i < nrelnodes; i++)
 		{
 			ForkNumber	forkNum;
-			int			oidchars;
-			bool		found;
-			unlogged_relation_entry ent;
-
-			/* Skip anything that doesn't look like a relation data file. */
-			if (!parse_filename_for_nontemp_relation(de->d_name, &oidchars,
-													 &forkNum))
-				continue;
-
-			/* We never remove the init fork. */
-			if (forkNum == INIT_FORKNUM)
-				continue;
-
-			/*
-			 * See whether the OID portion of the name shows up in the hash
-			 * table.
-			 */
-			memset(ent.oid, 0, sizeof(ent.oid));
-			memcpy(ent.oid, de->d_name, oidchars);
-			hash_search(hash, &ent, HASH_FIND, &found);
-
-			/* If so, nuke it! */
-			if (found)
+
+			for (forkNum = MAIN_FORKNUM; forkNum <= MAX_FORKNUM; forkNum++)
 			{
-				snprintf(rm_path, sizeof(rm_path), "%s/%s",
-						 dbspacedirname, de->d_name);
-				if (unlink(rm_path) < 0)
-					ereport(ERROR,
-							(errcode_for_file_access(),
-							 errmsg("could not remove file \"%s\": %m",
-									rm_path)));
-				else
-					elog(DEBUG2, "unlinked file \"%s\"", rm_path);
+				BlockNumber segno;
+
+				/* We never remove the init fork. */
+				if (forkNum == INIT_FORKNUM)
+					continue;
+
+				for (segno = 0;; segno++)
+				{
+					if (forkNum == MAIN_FORKNUM)
+						snprintf(path, sizeof(path), "%s/%u",
+								 dbspacedirname, relnodes[i]);
+					else
+						snprintf(path, sizeof(path), "%s/%u_%s",
+								 dbspacedirname, relnodes[i],
+								 forkNames[forkNum]);
+					if (segno > 0)
+						snprintf(path + strlen(path),
+								 sizeof(path) - strlen(path), ".%u", segno);
+
+					if (unlink(path) < 0)
+					{
+						if (errno == ENOENT)
+						{
+							/* The first segment may be gone on its own */
+							if (segno == 0)
+								continue;
+							break;
+						}
+						ereport(ERROR,
+								(errcode_for_file_access(),
+								 errmsg("could not remove file \"%s\": %m",
+										path)));
+					}
+					else
+						elog(DEBUG2, "unlinked file \"%s\"", path);
+				}
 			}
 		}
-
-		/* Cleanup is complete. */
-		FreeDir(dbspace_dir);
-		hash_destroy(hash);
 	}
 
 	/*
-	 * Initialization happens after cleanup is complete: we copy each init
-	 * fork file to the corresponding main fork file.  Note that if we are
-	 * asked to do both cleanup and init, we may never get here: if the
-	 * cleanup code determines that there are no init forks in this dbspace,
-	 * it will return before we get to this point.
+	 * Initialization happens after cleanup is complete: we copy each segment
+	 * of each init fork to the corresponding main fork segment.
 	 */
 	if ((op & UNLOGGED_RELATION_INIT) != 0)
 	{
-		/* Scan the directory. */
-		dbspace_dir = AllocateDir(dbspacedirname);
-		while ((de = ReadDir(dbspace_dir, dbspacedirname)) != NULL)
+		for (i = 0; i < nrelnodes; i++)
 		{
-			ForkNumber	forkNum;
-			int			oidchars;
-			char		oidbuf[OIDCHARS + 1];
-			char		srcpath[MAXPGPATH * 2];
-			char		dstpath[MAXPGPATH];
-
-			/* Skip anything that doesn't look like a relation data file. */
-			if (!parse_filename_for_nontemp_relation(de->d_name, &oidchars,
-													 &forkNum))
-				continue;
-
-			/* Also skip it unless this is the init fork. */
-			if (forkNum != INIT_FORKNUM)
-				continue;
-
-			/* Construct source pathname. */
-			snprintf(srcpath, sizeof(srcpath), "%s/%s",
-					 dbspacedirname, de->d_name);
-
-			/* Construct destination pathname. */
-			memcpy(oidbuf, de->d_name, oidchars);
-			oidbuf[oidchars] = '\0';
-			snprintf(dstpath, sizeof(dstpath), "%s/%s%s",
-					 dbspacedirname, oidbuf, de->d_name + oidchars + 1 +
-					 strlen(forkNames[INIT_FORKNUM]));
-
-			/* OK, we're ready to perform the actual copy. */
-			elog(DEBUG2, "copying %s to %s", srcpath, dstpath);
-			copy_file(srcpath, dstpath);
-		}
+			BlockNumber segno;
 
-		FreeDir(dbspace_dir);
+			for (segno = 0;; segno++)
+			{
+				if (segno == 0)
+				{
+					snprintf(path, sizeof(path), "%s/%u_%s", dbspacedirname,
+							 relnodes[i], forkNames[INIT_FORKNUM]);
+					snprintf(dstpath, sizeof(dstpath), "%s/%u",
+							 dbspacedirname, relnodes[i]);
+				}
+				else
+				{
+					snprintf(path, sizeof(path), "%s/%u_%s.%u", dbspacedirname,
+							 relnodes[i], forkNames[INIT_FORKNUM], segno);
+					snprintf(dstpath, sizeof(dstpath), "%s/%u.%u",
+							 dbspacedirname, relnodes[i], segno);
+				}
+
+				if (segno > 0 && lstat(path, &st) < 0 && errno == ENOENT)
+					break;
+
+				/* OK, we're ready to perform the actual copy. */
+				elog(DEBUG2, "copying %s to %s", path, dstpath);
+				copy_file(path, dstpath);
+			}
+		}
 
 		/*
 		 * copy_file() above has already called pg_flush_data() on the files
@@ -317,34 +323,25 @@ ResetUnloggedRelationsInDbspaceDir(const char *dbspacedirname, int op)
 		 * separate pass to allow the kernel to perform all the flushes
 		 * (especially the metadata ones) at once.
 		 */
-		dbspace_dir = AllocateDir(dbspacedirname);
-		while ((de = ReadDir(dbspace_dir, dbspacedirname)) != NULL)
+		for (i = 0; i < nrelnodes; i++)
 		{
-			ForkNumber	forkNum;
-			int			oidchars;
-			char		oidbuf[OIDCHARS + 1];
-			char		mainpath[MAXPGPATH];
-
-			/* Skip anything that doesn't look like a relation data file. */
-			if (!parse_filename_for_nontemp_relation(de->d_name, &oidchars,
-													 &forkNum))
-				continue;
-
-			/* Also skip it unless this is the init fork. */
-			if (forkNum != INIT_FORKNUM)
-				continue;
-
-			/* Construct main fork pathname. */
-			memcpy(oidbuf, de->d_name, oidchars);
-			oidbuf[oidchars] = '\0';
-			snprintf(mainpath, sizeof(mainpath), "%s/%s%s",
-					 dbspacedirname, oidbuf, de->d_name + oidchars + 1 +
-					 strlen(forkNames[INIT_FORKNUM]));
-
-			fsync_fname(mainpath, false);
-		}
+			BlockNumber segno;
+
+			for (segno = 0;; segno++)
+			{
+				if (segno == 0)
+					snprintf(dstpath, sizeof(dstpath), "%s/%u",
+							 dbspacedirname, relnodes[i]);
+				else
+					snprintf(dstpath, sizeof(dstpath), "%s/%u.%u",
+							 dbspacedirname, relnodes[i], segno);
+
+				if (segno > 0 && lstat(dstpath, &st) < 0 && errno == ENOENT)
+					break;
 
-		FreeDir(dbspace_dir);
+				fsync_fname(dstpath, false);
+			}
+		}
 
 		/*
 		 * Lastly, fsync the database directory itself, ensuring the
@@ -356,6 +353,344 @@ ResetUnloggedRelationsInDbspaceDir(const char *dbspacedirname, int op)
 		 */
 		fsync_fname(dbspacedirname, true);
 	}
+
+	pfree(relnodes);
+}
+
+/*
+ * Record that the relation 'rnode' is about to get an init fork, in the init
+ * fork map of its database directory.
+ *
+ * This must be done, durably, before the init fork is created, so that
+ * ResetUnloggedRelations never misses it.  If the directory has no map, we
+ * do nothing; the next reset will scan the directory and create one.
+ *
+ * Entries are appended in place, so any number of backends can add to a map
+ * at once; we only need to keep ForgetUnloggedRelation from replacing the
+ * file under us, lest our entry end up in the old copy.
+ */
+void
+RememberUnloggedRelation(RelFileNode rnode)
+{
+	char	   *dbpath;
+	char		path[MAXPGPATH];
+	init_fork_map_entry entry;
+	int			fd;
+
+	dbpath = GetDatabasePath(rnode.dbNode, rnode.spcNode);
+	snprintf(path, sizeof(path), "%s/%s", dbpath, INIT_FORK_MAP_FILENAME);
+	pfree(dbpath);
+
+	LWLockAcquire(InitForkMapLock, LW_SHARED);
+
+	fd = OpenTransientFile(path, O_WRONLY | O_APPEND | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+		{
+			LWLockRelease(InitForkMapLock);
+			return;
+		}
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+	}
+
+	entry.relnode = rnode.relNode;
+	INIT_CRC32C(entry.crc);
+	COMP_CRC32C(entry.crc, &entry.relnode, sizeof(entry.relnode));
+	FIN_CRC32C(entry.crc);
+
+	errno = 0;
+	if (write(fd, &entry, sizeof(entry)) != sizeof(entry))
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", path)));
+	}
+
+	if (pg_fsync(fd) != 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", path)));
+
+	if (CloseTransientFile(fd))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", path)));
+
+	LWLockRelease(InitForkMapLock);
+}
+
+/*
+ * Take the relation 'rnode', whose init fork has just been removed, off the
+ * init fork map of its database directory.
+ *
+ * This is called whenever an unlogged relation's storage is dropped, which
+ * includes DROP and TRUNCATE as well as the cleanup after a transaction that
+ * created one aborts, both in normal running and in redo.  That happens
+ * after the point of no return, so failures are only reported as warnings;
+ * an entry we fail to remove is harmless, and is pruned at the next reset
+ * anyway.
+ */
+void
+ForgetUnloggedRelation(RelFileNode rnode)
+{
+	char	   *dbpath;
+	Oid		   *relnodes;
+	int			nrelnodes;
+	int			i;
+	int			n;
+
+	dbpath = GetDatabasePath(rnode.dbNode, rnode.spcNode);
+
+	LWLockAcquire(InitForkMapLock, LW_EXCLUSIVE);
+
+	/* Nothing to do if there's no map, or a damaged one */
+	relnodes = read_init_fork_map(dbpath, &nrelnodes, WARNING);
+	if (relnodes != NULL)
+	{
+		n = 0;
+		for (i = 0; i < nrelnodes; i++)
+		{
+			if (relnodes[i] != rnode.relNode)
+				relnodes[n++] = relnodes[i];
+		}
+
+		if (n != nrelnodes)
+			write_init_fork_map(dbpath, relnodes, n, WARNING);
+		pfree(relnodes);
+	}
+
+	LWLockRelease(InitForkMapLock);
+
+	pfree(dbpath);
+}
+
+/*
+ * Scan a per-dbspace directory for init forks.  Returns the sorted relfilenode
+ * numbers of the relations that have one, as a palloc'd array.
+ */
+static Oid *
+scan_init_forks(const char *dbspacedirname, int *nrelnodes)
+{
+	DIR		   *dbspace_dir;
+	struct dirent *de;
+	Oid		   *relnodes;
+	int			maxrelnodes = 32;
+	int			n = 0;
+
+	relnodes = palloc(sizeof(Oid) * maxrelnodes);
+
+	dbspace_dir = AllocateDir(dbspacedirname);
+	while ((de = ReadDir(dbspace_dir, dbspacedirname)) != NULL)
+	{
+		ForkNumber	forkNum;
+		int			oidchars;
+
+		/* Skip anything that doesn't look like a relation data file. */
+		if (!parse_filename_for_nontemp_relation(de->d_name, &oidchars,
+												 &forkNum))
+			continue;
+
+		/* Also skip it unless this is the init fork. */
+		if (forkNum != INIT_FORKNUM)
+			continue;
+
+		if (n >= maxrelnodes)
+		{
+			maxrelnodes *= 2;
+			relnodes = repalloc(relnodes, sizeof(Oid) * maxrelnodes);
+		}
+		relnodes[n++] = atooid(de->d_name);
+	}
+	FreeDir(dbspace_dir);
+
+	*nrelnodes = sort_unique_oids(relnodes, n);
+	return relnodes;
+}
+
+/*
+ * Read the init fork map of a per-dbspace directory.  Returns the sorted
+ * relfilenode numbers it lists as a palloc'd array, or NULL if there is no
+ * map or it is damaged.  I/O errors are reported at 'elevel'; if that's less
+ * than ERROR, we return NULL for those too.
+ */
+static Oid *
+read_init_fork_map(const char *dbspacedirname, int *nrelnodes, int elevel)
+{
+	char		path[MAXPGPATH * 2];
+	init_fork_map_entry *entries;
+	Oid		   *relnodes;
+	struct stat st;
+	int			fd;
+	int			n;
+	int			i;
+
+	snprintf(path, sizeof(path), "%s/%s", dbspacedirname,
+			 INIT_FORK_MAP_FILENAME);
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno != ENOENT)
+			ereport(elevel,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", path)));
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+		CloseTransientFile(fd);
+		return NULL;
+	}
+
+	/* A partially appended entry means we can't trust the map. */
+	if (st.st_size % sizeof(init_fork_map_entry) != 0)
+	{
+		CloseTransientFile(fd);
+		ereport(LOG,
+				(errmsg("ignoring corrupted file \"%s\"", path)));
+		return NULL;
+	}
+
+	n = st.st_size / sizeof(init_fork_map_entry);
+	entries = palloc(Max(st.st_size, 1));
+	relnodes = palloc(sizeof(Oid) * Max(n, 1));
+
+	if (read(fd, entries, st.st_size) != st.st_size)
+	{
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", path)));
+		CloseTransientFile(fd);
+		pfree(entries);
+		pfree(relnodes);
+		return NULL;
+	}
+
+	CloseTransientFile(fd);
+
+	for (i = 0; i < n; i++)
+	{
+		pg_crc32c	crc;
+
+		INIT_CRC32C(crc);
+		COMP_CRC32C(crc, &entries[i].relnode, sizeof(entries[i].relnode));
+		FIN_CRC32C(crc);
+
+		if (!EQ_CRC32C(crc, entries[i].crc))
+		{
+			ereport(LOG,
+					(errmsg("ignoring corrupted file \"%s\"", path)));
+			pfree(entries);
+			pfree(relnodes);
+			return NULL;
+		}
+		relnodes[i] = entries[i].relnode;
+	}
+	pfree(entries);
+
+	*nrelnodes = sort_unique_oids(relnodes, n);
+	return relnodes;
+}
+
+/*
+ * Replace the init fork map of a per-dbspace directory with one listing
+ * exactly the given relfilenode numbers.  Errors are reported at 'elevel';
+ * returns false if the map couldn't be replaced.
+ */
+static bool
+write_init_fork_map(const char *dbspacedirname, Oid *relnodes, int nrelnodes,
+					int elevel)
+{
+	char		path[MAXPGPATH * 2];
+	char		tmppath[MAXPGPATH * 2];
+	init_fork_map_entry *entries;
+	int			fd;
+	int			i;
+
+	snprintf(path, sizeof(path), "%s/%s", dbspacedirname,
+			 INIT_FORK_MAP_FILENAME);
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+
+	entries = palloc(sizeof(init_fork_map_entry) * Max(nrelnodes, 1));
+	for (i = 0; i < nrelnodes; i++)
+	{
+		entries[i].relnode = relnodes[i];
+		INIT_CRC32C(entries[i].crc);
+		COMP_CRC32C(entries[i].crc, &entries[i].relnode,
+					sizeof(entries[i].relnode));
+		FIN_CRC32C(entries[i].crc);
+	}
+
+	fd = OpenTransientFile(tmppath, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fd < 0)
+	{
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", tmppath)));
+		pfree(entries);
+		return false;
+	}
+
+	errno = 0;
+	if (write(fd, entries, sizeof(init_fork_map_entry) * nrelnodes) !=
+		sizeof(init_fork_map_entry) * nrelnodes)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", tmppath)));
+		CloseTransientFile(fd);
+		pfree(entries);
+		return false;
+	}
+	pfree(entries);
+
+	if (CloseTransientFile(fd))
+	{
+		ereport(elevel,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", tmppath)));
+		return false;
+	}
+
+	/* durable_rename() fsyncs the file and the directory for us */
+	return durable_rename(tmppath, path, elevel) == 0;
+}
+
+/*
+ * Sort an array of OIDs and remove duplicates, returning the new length.
+ */
+static int
+sort_unique_oids(Oid *oids, int noids)
+{
+	int			i;
+	int			n;
+
+	if (noids <= 1)
+		return noids;
+
+	qsort(oids, noids, sizeof(Oid), oid_cmp);
+
+	n = 1;
+	for (i = 1; i < noids; i++)
+	{
+		if (oids[i] != oids[n - 1])
+			oids[n++] = oids[i];
+	}
+
+	return n;
 }
 
 /*
@@ -254,6 +254,15 @@ static HTAB *LockMethodLockHash;
 static HTAB *LockMethodProcLockHash;
 static HTAB *LockMethodLocalHash;
 
+/*
+ * Relation extension and page locks are held only briefly, and the code that
+ * takes them is careful not to wait for other heavyweight locks meanwhile;
+ * LockCheckConflicts() relies on that.  These track whether we hold either
+ * kind, to check the rule in assert-enabled builds.
+ */
+static bool IsRelationExtensionLockHeld PG_USED_FOR_ASSERTS_ONLY = false;
+static bool IsPageLockHeld PG_USED_FOR_ASSERTS_ONLY = false;
+
 
 /* private state for error cleanup */
 static LOCALLOCK *StrongLockInProgress;
@@ -341,6 +350,7 @@ PROCLOCK_PRINT(const char *where, const PROCLOCK *proclockP)
 
 static uint32 proclock_hash(const void *key, Size keysize);
 static void RemoveLocalLock(LOCALLOCK *locallock);
+static void CheckAndSetLockHeld(LOCALLOCK *locallock, bool acquired);
 static PROCLOCK *SetupLockInTable(LockMethod lockMethodTable, PGPROC *proc,
 				 const LOCKTAG *locktag, uint32 hashcode, LOCKMODE lockmode);
 static void GrantLockLocal(LOCALLOCK *locallock, ResourceOwner owner);
@@ -816,6 +826,15 @@ LockAcquireExtended(const LOCKTAG *locktag,
 			return LOCKACQUIRE_ALREADY_HELD;
 	}
 
+	/*
+	 * While holding a relation extension lock we must not acquire any other
+	 * heavyweight lock, and while holding a page lock nothing but a relation
+	 * extension lock.  See LockCheckConflicts().
+	 */
+	Assert(!IsRelationExtensionLockHeld);
+	Assert(!IsPageLockHeld ||
+		   locktag->locktag_type == LOCKTAG_RELATION_EXTEND);
+
 	/*
 	 * Prepare to emit a WAL record if acquisition of this lock needs to be
 	 * replayed in a standby server.
@@ -1273,6 +1292,8 @@ RemoveLocalLock(LOCALLOCK *locallock)
 {
 	int			i;
 
+	CheckAndSetLockHeld(locallock, false);
+
 	for (i = locallock->numLockOwners - 1; i >= 0; i--)
 	{
 		if (locallock->lockOwners[i].owner != NULL)
@@ -1381,6 +1402,29 @@ LockCheckConflicts(LockMethod lockMethodTable,
 		return STATUS_FOUND;
 	}
 
+	/*
+	 * Relation extension and page locks conflict even between members of
+	 * the same lock group.  They protect physical changes that no two
+	 * processes may make at once, and parallel COPY FROM has several group
+	 * members inserting into the same relation.
+	 *
+	 * The deadlock detector doesn't see waits between group members, so
+	 * this is safe only because these locks can't be part of a cycle: the
+	 * holder of a relation extension lock never waits for any other
+	 * heavyweight lock, and the holder of a page lock waits at most for a
+	 * relation extension lock (GIN's pending list cleanup extends the index
+	 * while holding the metapage lock).  Whoever we wait for here therefore
+	 * finishes without waiting for us.  LockAcquireExtended() asserts both
+	 * rules.
+	 */
+	if (lock->tag.locktag_type == LOCKTAG_RELATION_EXTEND ||
+		lock->tag.locktag_type == LOCKTAG_PAGE)
+	{
+		PROCLOCK_PRINT("LockCheckConflicts: conflicting (group)",
+					   proclock);
+		return STATUS_FOUND;
+	}
+
 	/*
 	 * Locks held in conflicting modes by members of our own lock group are
 	 * not real conflicts; we can subtract those out and see if we still have
@@ -1596,6 +1640,23 @@ GrantLockLocal(LOCALLOCK *locallock, ResourceOwner owner)
 	locallock->numLockOwners++;
 	if (owner != NULL)
 		ResourceOwnerRememberLock(owner, locallock);
+
+	CheckAndSetLockHeld(locallock, true);
+}
+
+/*
+ * CheckAndSetLockHeld -- remember whether we hold a relation extension or
+ *		page lock, for the assertions in LockAcquireExtended()
+ */
+static void
+CheckAndSetLockHeld(LOCALLOCK *locallock, bool acquired)
+{
+#ifdef USE_ASSERT_CHECKING
+	if (locallock->tag.lock.locktag_type == LOCKTAG_RELATION_EXTEND)
+		IsRelationExtensionLockHeld = acquired;
+	else if (locallock->tag.lock.locktag_type == LOCKTAG_PAGE)
+		IsPageLockHeld = acquired;
+#endif
 }
 
 /*
@@ -17,11 +17,14 @@
  */
 #include "postgres.h"
 
+#include "access/hash.h"
 #include "commands/tablespace.h"
 #include "lib/ilist.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
 
@@ -48,6 +51,9 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	void		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
@@ -69,7 +75,7 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
+		mdzeroextend, mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
 		mdimmedsync, mdpreckpt, mdsync, mdpostckpt
 	}
 };
@@ -85,8 +91,75 @@ static HTAB *SMgrRelationHash = NULL;
 
 static dlist_head	unowned_relns;
 
+/*
+ * Shared cache of relation fork sizes.
+ *
+ * smgrnblocks() is called very often, by the planner and whenever a scan
+ * starts, and asking the kernel each time costs an lseek() that contends on
+ * the file's inode lock.  So we remember the sizes of recently used forks in
+ * shared memory.  The cache is a set-associative table: a fork can only live
+ * in one set of RELSIZE_CACHE_WAYS entries, chosen by hashing its identity,
+ * so each lookup touches a single set, guarded by its own spinlock.
+ *
+ * Whoever changes a fork's size keeps the cache in step: smgrextend()
+ * advances a cached size, smgrtruncate(), smgrcreate() and the unlink
+ * functions drop it.  That is also what happens during recovery, since WAL
+ * replay goes through the same functions.
+ *
+ * A backend that misses the cache asks md.c and then stores the answer, but
+ * that answer may be outdated by the time it's stored, if the fork was
+ * extended or truncated meanwhile.  To catch that, extending or truncating a
+ * fork that has no cache entry, and removing any entry, bumps the set's
+ * 'nchanges' counter, and a size is only stored if the counter hasn't moved
+ * since before md.c was asked.
+ *
+ * Temporary relations are private to their backend and are not cached.
+ */
+#define RELSIZE_CACHE_WAYS		8
+
+typedef struct RelSizeCacheTag
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} RelSizeCacheTag;
+
+typedef struct RelSizeCacheEntry
+{
+	RelSizeCacheTag tag;
+	BlockNumber nblocks;		/* InvalidBlockNumber if the entry is free */
+	uint32		lastused;		/* value of the set's clock at last use */
+} RelSizeCacheEntry;
+
+typedef struct RelSizeCacheSet
+{
+	slock_t		mutex;			/* protects all of the following */
+	uint32		clock;			/* counts uses, for LRU replacement */
+	uint32		nchanges;		/* see above */
+	RelSizeCacheEntry entries[RELSIZE_CACHE_WAYS];
+} RelSizeCacheSet;
+
+/* GUC variable: number of fork sizes the cache can hold, 0 to disable */
+int			relsize_cache_size = 8192;
+
+static RelSizeCacheSet *RelSizeCache = NULL;
+static int	RelSizeCacheNumSets = 0;
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static int	RelSizeCacheNumSetsFor(int size);
+static RelSizeCacheSet *RelSizeCacheGetSet(SMgrRelation reln,
+				   ForkNumber forknum, RelSizeCacheTag *tag);
+static RelSizeCacheEntry *RelSizeCacheFind(RelSizeCacheSet *set,
+				 RelSizeCacheTag *tag);
+static BlockNumber RelSizeCacheLookup(SMgrRelation reln, ForkNumber forknum,
+				   uint32 *nchanges);
+static void RelSizeCacheStore(SMgrRelation reln, ForkNumber forknum,
+				  BlockNumber nblocks, uint32 nchanges);
+static void RelSizeCacheExtend(SMgrRelation reln, ForkNumber forknum,
+				   BlockNumber nblocks);
+static void RelSizeCacheForget(SMgrRelation reln, ForkNumber forknum);
+static void RelSizeCacheForgetNode(RelFileNodeBackend rnode,
+					   ForkNumber forknum);
 
 
 /*
@@ -127,6 +200,280 @@ smgrshutdown(int code, Datum arg)
 	}
 }
 
+/*
+ * Number of sets in a relation size cache holding 'size' entries
+ */
+static int
+RelSizeCacheNumSetsFor(int size)
+{
+	return (size + RELSIZE_CACHE_WAYS - 1) / RELSIZE_CACHE_WAYS;
+}
+
+/*
+ * Estimate space needed for the relation size cache
+ */
+Size
+RelSizeCacheShmemSize(void)
+{
+	return mul_size(RelSizeCacheNumSetsFor(relsize_cache_size),
+					sizeof(RelSizeCacheSet));
+}
+
+/*
+ * Allocate and initialize the relation size cache
+ */
+void
+RelSizeCacheShmemInit(void)
+{
+	bool		found;
+	int			i;
+	int			j;
+
+	RelSizeCacheNumSets = RelSizeCacheNumSetsFor(relsize_cache_size);
+	if (RelSizeCacheNumSets == 0)
+		return;
+
+	RelSizeCache = (RelSizeCacheSet *)
+		ShmemInitStruct("Relation Size Cache", RelSizeCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		for (i = 0; i < RelSizeCacheNumSets; i++)
+		{
+			RelSizeCacheSet *set = &RelSizeCache[i];
+
+			SpinLockInit(&set->mutex);
+			set->clock = 0;
+			set->nchanges = 0;
+			for (j = 0; j < RELSIZE_CACHE_WAYS; j++)
+				set->entries[j].nblocks = InvalidBlockNumber;
+		}
+	}
+}
+
+/*
+ * Find the cache set a fork belongs to, and fill in its tag.  Returns NULL
+ * if the fork is not to be cached.
+ */
+static RelSizeCacheSet *
+RelSizeCacheGetSet(SMgrRelation reln, ForkNumber forknum,
+				   RelSizeCacheTag *tag)
+{
+	uint32		hashcode;
+
+	if (RelSizeCache == NULL || SmgrIsTemp(reln))
+		return NULL;
+
+	/* zero the padding, if any, as the tag is hashed and compared as bytes */
+	MemSet(tag, 0, sizeof(RelSizeCacheTag));
+	tag->rnode = reln->smgr_rnode.node;
+	tag->forknum = forknum;
+
+	hashcode = DatumGetUInt32(hash_any((unsigned char *) tag,
+									   sizeof(RelSizeCacheTag)));
+	return &RelSizeCache[hashcode % RelSizeCacheNumSets];
+}
+
+/*
+ * Find a fork's entry in its set.  Caller must hold the set's mutex.
+ */
+static RelSizeCacheEntry *
+RelSizeCacheFind(RelSizeCacheSet *set, RelSizeCacheTag *tag)
+{
+	int			i;
+
+	for (i = 0; i < RELSIZE_CACHE_WAYS; i++)
+	{
+		RelSizeCacheEntry *entry = &set->entries[i];
+
+		if (entry->nblocks != InvalidBlockNumber &&
+			memcmp(&entry->tag, tag, sizeof(RelSizeCacheTag)) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/*
+ * Look up the cached size of a fork.  On a miss, returns InvalidBlockNumber
+ * and sets *nchanges for the later RelSizeCacheStore().
+ */
+static BlockNumber
+RelSizeCacheLookup(SMgrRelation reln, ForkNumber forknum, uint32 *nchanges)
+{
+	RelSizeCacheSet *set;
+	RelSizeCacheEntry *entry;
+	RelSizeCacheTag tag;
+	BlockNumber result = InvalidBlockNumber;
+
+	*nchanges = 0;
+	set = RelSizeCacheGetSet(reln, forknum, &tag);
+	if (set == NULL)
+		return InvalidBlockNumber;
+
+	SpinLockAcquire(&set->mutex);
+	entry = RelSizeCacheFind(set, &tag);
+	if (entry != NULL)
+	{
+		entry->lastused = ++set->clock;
+		result = entry->nblocks;
+	}
+	*nchanges = set->nchanges;
+	SpinLockRelease(&set->mutex);
+
+	return result;
+}
+
+/*
+ * Store the size of a fork that RelSizeCacheLookup() didn't find, unless it
+ * might have changed since then.  If the set is full, the least recently
+ * used entry makes room.
+ */
+static void
+RelSizeCacheStore(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks,
+				  uint32 nchanges)
+{
+	RelSizeCacheSet *set;
+	RelSizeCacheEntry *victim = NULL;
+	RelSizeCacheTag tag;
+	int			i;
+
+	set = RelSizeCacheGetSet(reln, forknum, &tag);
+	if (set == NULL || nblocks == InvalidBlockNumber)
+		return;
+
+	SpinLockAcquire(&set->mutex);
+	if (set->nchanges != nchanges || RelSizeCacheFind(set, &tag) != NULL)
+	{
+		SpinLockRelease(&set->mutex);
+		return;
+	}
+
+	for (i = 0; i < RELSIZE_CACHE_WAYS; i++)
+	{
+		RelSizeCacheEntry *entry = &set->entries[i];
+
+		if (entry->nblocks == InvalidBlockNumber)
+		{
+			victim = entry;
+			break;
+		}
+		if (victim == NULL ||
+			(int32) (entry->lastused - victim->lastused) < 0)
+			victim = entry;
+	}
+
+	/* Replacing an entry counts as a change, see the comments at the top */
+	if (victim->nblocks != InvalidBlockNumber)
+		set->nchanges++;
+
+	victim->tag = tag;
+	victim->nblocks = nblocks;
+	victim->lastused = ++set->clock;
+	SpinLockRelease(&set->mutex);
+}
+
+/*
+ * Note that a fork has been extended to at least 'nblocks' blocks.
+ */
+static void
+RelSizeCacheExtend(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
+{
+	RelSizeCacheSet *set;
+	RelSizeCacheEntry *entry;
+	RelSizeCacheTag tag;
+
+	set = RelSizeCacheGetSet(reln, forknum, &tag);
+	if (set == NULL)
+		return;
+
+	SpinLockAcquire(&set->mutex);
+	entry = RelSizeCacheFind(set, &tag);
+	if (entry == NULL)
+		set->nchanges++;
+	else if (entry->nblocks < nblocks)
+		entry->nblocks = nblocks;
+	SpinLockRelease(&set->mutex);
+}
+
+/*
+ * Forget the cached size of a fork, because it is about to change in a way
+ * RelSizeCacheExtend() can't describe, or has just done so.
+ */
+static void
+RelSizeCacheForget(SMgrRelation reln, ForkNumber forknum)
+{
+	RelSizeCacheSet *set;
+	RelSizeCacheEntry *entry;
+	RelSizeCacheTag tag;
+
+	set = RelSizeCacheGetSet(reln, forknum, &tag);
+	if (set == NULL)
+		return;
+
+	SpinLockAcquire(&set->mutex);
+	entry = RelSizeCacheFind(set, &tag);
+	if (entry != NULL)
+		entry->nblocks = InvalidBlockNumber;
+	set->nchanges++;
+	SpinLockRelease(&set->mutex);
+}
+
+/*
+ * Like RelSizeCacheForget(), for callers that have no SMgrRelation.  A
+ * forknum of InvalidForkNumber forgets all forks.
+ */
+static void
+RelSizeCacheForgetNode(RelFileNodeBackend rnode, ForkNumber forknum)
+{
+	SMgrRelationData reln;
+
+	if (RelSizeCache == NULL || RelFileNodeBackendIsTemp(rnode))
+		return;
+
+	/* RelSizeCacheGetSet() only looks at the relation's identity */
+	reln.smgr_rnode = rnode;
+
+	if (forknum != InvalidForkNumber)
+		RelSizeCacheForget(&reln, forknum);
+	else
+	{
+		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+			RelSizeCacheForget(&reln, forknum);
+	}
+}
+
+/*
+ * Forget the cached sizes of all relations of a database, because its files
+ * are about to be removed or moved behind smgr's back.
+ */
+void
+DropDatabaseRelSizes(Oid dbid)
+{
+	int			i;
+	int			j;
+
+	for (i = 0; i < RelSizeCacheNumSets; i++)
+	{
+		RelSizeCacheSet *set = &RelSizeCache[i];
+
+		SpinLockAcquire(&set->mutex);
+		for (j = 0; j < RELSIZE_CACHE_WAYS; j++)
+		{
+			RelSizeCacheEntry *entry = &set->entries[j];
+
+			if (entry->nblocks != InvalidBlockNumber &&
+				entry->tag.rnode.dbNode == dbid)
+			{
+				entry->nblocks = InvalidBlockNumber;
+				set->nchanges++;
+			}
+		}
+		SpinLockRelease(&set->mutex);
+	}
+}
+
 /*
  *	smgropen() -- Return an SMgrRelation object, creating it if need be.
  *
@@ -350,6 +697,12 @@ smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 							isRedo);
 
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
+
+	/*
+	 * The relfilenode may have been used before, or during replay the file
+	 * may have existed already, so don't trust any size we remember.
+	 */
+	RelSizeCacheForget(reln, forknum);
 }
 
 /*
@@ -406,6 +759,8 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	 * xact.
 	 */
 	smgrsw[which].smgr_unlink(rnode, InvalidForkNumber, isRedo);
+
+	RelSizeCacheForgetNode(rnode, InvalidForkNumber);
 }
 
 /*
@@ -484,6 +839,8 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
 			smgrsw[which].smgr_unlink(rnodes[i], forknum, isRedo);
+
+		RelSizeCacheForgetNode(rnodes[i], InvalidForkNumber);
 	}
 
 	pfree(rnodes);
@@ -539,6 +896,8 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * xact.
 	 */
 	smgrsw[which].smgr_unlink(rnode, forknum, isRedo);
+
+	RelSizeCacheForgetNode(rnode, forknum);
 }
 
 /*
@@ -556,6 +915,26 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	smgrsw[reln->smgr_which].smgr_extend(reln, forknum, blocknum,
 										 buffer, skipFsync);
+
+	RelSizeCacheExtend(reln, forknum, blocknum + 1);
+}
+
+/*
+ *	smgrzeroextend() -- Add new zeroed out blocks to a file.
+ *
+ *		Similar to smgrextend(), except the relation is extended by 'nblocks'
+ *		blocks starting at 'blocknum' in one go, and the new blocks read as
+ *		all-zeroes pages.  This is much cheaper than extending block by
+ *		block, so use it to extend by more than a block.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	RelSizeCacheExtend(reln, forknum, blocknum + nblocks);
 }
 
 /*
@@ -621,11 +1000,23 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 /*
  *	smgrnblocks() -- Calculate the number of blocks in the
  *					 supplied relation.
+ *
+ *		The answer comes from the shared relation size cache if possible.
  */
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
-	return smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	BlockNumber nblocks;
+	uint32		nchanges;
+
+	nblocks = RelSizeCacheLookup(reln, forknum, &nchanges);
+	if (nblocks != InvalidBlockNumber)
+		return nblocks;
+
+	nblocks = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	RelSizeCacheStore(reln, forknum, nblocks, nchanges);
+
+	return nblocks;
 }
 
 /*
@@ -655,10 +1046,19 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 */
 	CacheInvalidateSmgr(reln->smgr_rnode);
 
+	/*
+	 * Forget the cached size before truncating, in case we fail partway, and
+	 * again afterwards, so that nobody can store a size that was fetched
+	 * while the truncation was in progress.
+	 */
+	RelSizeCacheForget(reln, forknum);
+
 	/*
 	 * Do the truncation.
 	 */
 	smgrsw[reln->smgr_which].smgr_truncate(reln, forknum, nblocks);
+
+	RelSizeCacheForget(reln, forknum);
 }
 
 /*
@@ -462,6 +462,35 @@ MemoryContextIsEmpty(MemoryContext context)
 	return context->methods->is_empty(context);
 }
 
+/*
+ * MemoryContextMemAllocated
+ *		Return the amount of memory allocated from malloc() for the context,
+ *		optionally including its descendants.
+ *
+ * This is cheap enough to be called for every allocation of a caller that
+ * wants to stay within a memory budget, as long as the context does not
+ * have many children.
+ */
+Size
+MemoryContextMemAllocated(MemoryContext context, bool recurse)
+{
+	Size		total = context->mem_allocated;
+
+	AssertArg(MemoryContextIsValid(context));
+
+	if (recurse)
+	{
+		MemoryContext child;
+
+		for (child = context->firstchild;
+			 child != NULL;
+			 child = child->nextchild)
+			total += MemoryContextMemAllocated(child, true);
+	}
+
+	return total;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
@@ -733,6 +762,7 @@ MemoryContextCreate(MemoryContext node,
 	/* Initialize all standard fields of memory context header */
 	node->type = tag;
 	node->isReset = true;
+	node->mem_allocated = 0;
 	node->methods = methods;
 	node->parent = parent;
 	node->firstchild = NULL;
@@ -96,6 +96,7 @@
 
 #include <limits.h>
 
+#include "access/gin_private.h"
 #include "access/htup_details.h"
 #include "access/nbtree.h"
 #include "access/hash.h"
@@ -450,6 +451,9 @@ struct Tuplesortstate
 	uint32		low_mask;
 	uint32		max_buckets;
 
+	/* This is specific to the index_gin subcase: */
+	GinState   *ginstate;		/* for comparing keys */
+
 	/*
 	 * These variables are specific to the Datum case; they are set by
 	 * tuplesort_begin_datum and used only by the DatumTuple routines.
@@ -630,11 +634,17 @@ static int comparetup_index_btree(const SortTuple *a, const SortTuple *b,
 					   Tuplesortstate *state);
 static int comparetup_index_hash(const SortTuple *a, const SortTuple *b,
 					  Tuplesortstate *state);
+static int comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state);
 static void copytup_index(Tuplesortstate *state, SortTuple *stup, void *tup);
+static void copytup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  void *tup);
 static void writetup_index(Tuplesortstate *state, int tapenum,
 			   SortTuple *stup);
 static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 			  int tapenum, unsigned int len);
+static void readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  int tapenum, unsigned int len);
 static int comparetup_datum(const SortTuple *a, const SortTuple *b,
 				 Tuplesortstate *state);
 static void copytup_datum(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -1095,6 +1105,48 @@ tuplesort_begin_index_hash(Relation heapRel,
 	return state;
 }
 
+/*
+ * Sort GIN entry tuples, as formed by the GIN build code: each holds a key
+ * and a list of heap TIDs.  They are sorted by key, using ginstate's
+ * comparison functions, and then by their first heap TID.
+ */
+Tuplesortstate *
+tuplesort_begin_index_gin(Relation heapRel,
+						  Relation indexRel,
+						  GinState *ginstate,
+						  int workMem,
+						  SortCoordinate coordinate,
+						  bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
+
+	state->comparetup = comparetup_index_gin;
+	state->copytup = copytup_index_gin;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index_gin;
+
+	state->heapRel = heapRel;
+	state->indexRel = indexRel;
+	state->ginstate = ginstate;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag, int workMem,
@@ -1546,6 +1598,24 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Accept one GIN entry tuple while collecting input data for sort.
+ *
+ * Note that the input tuple is always copied; the caller need not save it.
+ */
+void
+tuplesort_putgintuple(Tuplesortstate *state, IndexTuple tuple)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->sortcontext);
+	SortTuple	stup;
+
+	COPYTUP(state, &stup, (void *) tuple);
+
+	puttuple_common(state, &stup);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
 /*
  * Accept one Datum while collecting input data for sort.
  *
@@ -4131,6 +4201,38 @@ comparetup_index_hash(const SortTuple *a, const SortTuple *b,
 	return 0;
 }
 
+static int
+comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	GinState   *ginstate = state->ginstate;
+	IndexTuple	tuple1 = (IndexTuple) a->tuple;
+	IndexTuple	tuple2 = (IndexTuple) b->tuple;
+	Datum		key1;
+	Datum		key2;
+	GinNullCategory category1;
+	GinNullCategory category2;
+	int			compare;
+
+	/* Compare the keys, attribute number first */
+	key1 = gintuple_get_key(ginstate, tuple1, &category1);
+	key2 = gintuple_get_key(ginstate, tuple2, &category2);
+	compare = ginCompareAttEntries(ginstate,
+								   gintuple_get_attrnum(ginstate, tuple1),
+								   key1, category1,
+								   gintuple_get_attrnum(ginstate, tuple2),
+								   key2, category2);
+	if (compare != 0)
+		return compare;
+
+	/*
+	 * Tuples of the same key are sorted by their first heap TID, which lets
+	 * the caller build the key's TID list mostly by appending.
+	 */
+	return ginCompareItemPointers((ItemPointer) GinGetPosting(tuple1),
+								  (ItemPointer) GinGetPosting(tuple2));
+}
+
 static void
 copytup_index(Tuplesortstate *state, SortTuple *stup, void *tup)
 {
@@ -4239,6 +4341,44 @@ readtup_index(Tuplesortstate *state, SortTuple *stup,
 								 &stup->isnull1);
 }
 
+/*
+ * GIN entry tuples are compared as a whole by comparetup_index_gin, so
+ * datum1 is unused.  (The first column of a GIN entry tuple does not even
+ * match the index's own tuple descriptor.)
+ */
+static void
+copytup_index_gin(Tuplesortstate *state, SortTuple *stup, void *tup)
+{
+	IndexTuple	tuple = (IndexTuple) tup;
+	unsigned int tuplen = IndexTupleSize(tuple);
+	IndexTuple	newtuple;
+
+	/* copy the tuple into sort storage */
+	newtuple = (IndexTuple) MemoryContextAlloc(state->tuplecontext, tuplen);
+	memcpy(newtuple, tuple, tuplen);
+	USEMEM(state, GetMemoryChunkSpace(newtuple));
+	stup->tuple = (void *) newtuple;
+	stup->datum1 = (Datum) 0;
+	stup->isnull1 = true;
+}
+
+static void
+readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  int tapenum, unsigned int len)
+{
+	unsigned int tuplen = len - sizeof(unsigned int);
+	IndexTuple	tuple = (IndexTuple) readtup_alloc(state, tuplen);
+
+	LogicalTapeReadExact(state->tapeset, tapenum,
+						 tuple, tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeReadExact(state->tapeset, tapenum,
+							 &tuplen, sizeof(tuplen));
+	stup->tuple = (void *) tuple;
+	stup->datum1 = (Datum) 0;
+	stup->isnull1 = true;
+}
+
 /*
  * Routines specialized for DatumTuple case
  */
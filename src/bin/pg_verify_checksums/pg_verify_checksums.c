@@ -58,6 +58,7 @@ usage(void)
 static const char *const skip[] = {
 	"pg_control",
 	"pg_filenode.map",
+	"pg_init_forks",
 	"pg_internal.init",
 	"PG_VERSION",
 #ifdef EXEC_BACKEND
@@ -1871,15 +1871,17 @@ psql_completion(const char *text, int start, int end)
 		COMPLETE_WITH_CONST("(");
 	/* ALTER INDEX <foo> SET|RESET ( */
 	else if (Matches5("ALTER", "INDEX", MatchAny, "RESET", "("))
-		COMPLETE_WITH_LIST8("fillfactor", "recheck_on_update",
-							"vacuum_cleanup_index_scale_factor",	/* BTREE */
+		COMPLETE_WITH_LIST9("fillfactor", "recheck_on_update",
+							"vacuum_cleanup_index_scale_factor",
+							"deduplicate_items",	/* BTREE */
 							"fastupdate", "gin_pending_list_limit", /* GIN */
 							"buffering",	/* GiST */
 							"pages_per_range", "autosummarize"	/* BRIN */
 			);
 	else if (Matches5("ALTER", "INDEX", MatchAny, "SET", "("))
-		COMPLETE_WITH_LIST8("fillfactor =", "recheck_on_update =",
-							"vacuum_cleanup_index_scale_factor =",	/* BTREE */
+		COMPLETE_WITH_LIST9("fillfactor =", "recheck_on_update =",
+							"vacuum_cleanup_index_scale_factor =",
+							"deduplicate_items =",	/* BTREE */
 							"fastupdate =", "gin_pending_list_limit =", /* GIN */
 							"buffering =",	/* GiST */
 							"pages_per_range =", "autosummarize ="	/* BRIN */
@@ -32,6 +32,16 @@ typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+
+	/*
+	 * Blocks next_free to last_free were added to the relation for this bulk
+	 * insert's exclusive use, and haven't been used yet.  extended_by counts
+	 * the blocks this bulk insert has added to the relation, to ramp up the
+	 * number of blocks set aside next time; see RelationAddExtraBlocks.
+	 */
+	BlockNumber next_free;
+	BlockNumber last_free;
+	uint32		extended_by;
 }			BulkInsertStateData;
 
 
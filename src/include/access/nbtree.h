@@ -206,19 +206,30 @@ typedef struct BTMetaPageData
  * bit is set (we never assume that pivot tuples must explicitly store the
  * number of attributes, and currently do not bother storing the number of
  * attributes unless indnkeyatts actually differs from indnatts).
- * INDEX_ALT_TID_MASK is only used for pivot tuples at present, though it's
- * possible that it will be used within non-pivot tuples in the future.  Do
- * not assume that a tuple with INDEX_ALT_TID_MASK set must be a pivot
- * tuple.
+ * INDEX_ALT_TID_MASK is also used within non-pivot "posting list" tuples
+ * (see below), so do not assume that a tuple with INDEX_ALT_TID_MASK set
+ * must be a pivot tuple.
  *
  * The 12 least significant offset bits are used to represent the number of
  * attributes in INDEX_ALT_TID_MASK tuples, leaving 4 bits that are reserved
  * for future use (BT_RESERVED_OFFSET_MASK bits). BT_N_KEYS_OFFSET_MASK should
  * be large enough to store any number <= INDEX_MAX_KEYS.
+ *
+ * Posting list tuples are leaf tuples that stand in for several tuples with
+ * identical keys, differing only in their heap TIDs.  They are created by
+ * deduplication (see nbtdedup.c), which happens during index builds and
+ * lazily when an insertion would otherwise have to split a leaf page.  A
+ * posting list tuple has INDEX_ALT_TID_MASK set and BT_IS_POSTING set in its
+ * offset field; the rest of the offset field holds the number of heap TIDs,
+ * and the block number field holds the byte offset of the TID array, which
+ * follows the key attributes.  The TIDs are kept in ascending order.  Unique
+ * indexes are never deduplicated, and pivot tuples are never posting list
+ * tuples.
  */
 #define INDEX_ALT_TID_MASK			INDEX_AM_RESERVED_BIT
 #define BT_RESERVED_OFFSET_MASK		0xF000
 #define BT_N_KEYS_OFFSET_MASK		0x0FFF
+#define BT_IS_POSTING				0x2000
 
 /* Get/set downlink block number */
 #define BTreeInnerTupleGetDownLink(itup) \
@@ -246,7 +257,8 @@ typedef struct BTMetaPageData
  */
 #define BTreeTupleGetNAtts(itup, rel)	\
 	( \
-		(itup)->t_info & INDEX_ALT_TID_MASK ? \
+		(itup)->t_info & INDEX_ALT_TID_MASK && \
+		!BTreeTupleIsPosting(itup) ? \
 		( \
 			AssertMacro((ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_RESERVED_OFFSET_MASK) == 0), \
 			ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_N_KEYS_OFFSET_MASK \
@@ -261,6 +273,69 @@ typedef struct BTMetaPageData
 		ItemPointerSetOffsetNumber(&(itup)->t_tid, (n) & BT_N_KEYS_OFFSET_MASK); \
 	} while(0)
 
+/*
+ * Accessors for posting list tuples.  BTreeTupleGetHeapTID and
+ * BTreeTupleGetNHeapTIDs work on any leaf tuple, posting list or not; the
+ * former returns the first (lowest) heap TID.
+ */
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_IS_POSTING) != 0)
+#define BTreeTupleGetNPosting(itup) \
+	( \
+		AssertMacro(BTreeTupleIsPosting(itup)), \
+		(int) (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & BT_N_KEYS_OFFSET_MASK) \
+	)
+#define BTreeTupleGetPostingOffset(itup) \
+	( \
+		AssertMacro(BTreeTupleIsPosting(itup)), \
+		(uint32) ItemPointerGetBlockNumberNoCheck(&(itup)->t_tid) \
+	)
+#define BTreeTupleGetPosting(itup) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)))
+#define BTreeTupleGetPostingN(itup, n) \
+	(BTreeTupleGetPosting(itup) + (n))
+#define BTreeTupleSetPosting(itup, nhtids, off) \
+	do { \
+		Assert((nhtids) > 1 && ((nhtids) & ~BT_N_KEYS_OFFSET_MASK) == 0); \
+		Assert((off) == MAXALIGN(off)); \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		ItemPointerSetOffsetNumber(&(itup)->t_tid, BT_IS_POSTING | (nhtids)); \
+		ItemPointerSetBlockNumber(&(itup)->t_tid, (off)); \
+	} while(0)
+#define BTreeTupleGetHeapTID(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPosting(itup) : &(itup)->t_tid)
+#define BTreeTupleGetNHeapTIDs(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1)
+
+/*
+ * The most heap TIDs a leaf page can reference, which bounds the number of
+ * items a scan can return from a single page.  This is rather more than
+ * MaxIndexTuplesPerPage when posting list tuples are present.
+ */
+#define MaxTIDsPerBTreePage \
+	((int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+			sizeof(ItemPointerData)))
+
+/*
+ * Posting list tuples are limited to half of BTMaxItemSize, so that a page
+ * split never has to deal with an item that can't share a page with the
+ * high key and the incoming tuple.
+ */
+#define BTMaxPostingSize(page) \
+	MAXALIGN_DOWN(BTMaxItemSize(page) / 2)
+
+/*
+ * A run of consecutive leaf items that deduplication merges into a single
+ * posting list tuple, placed at baseoff.  Also used in XLOG_BTREE_DEDUP
+ * records.
+ */
+typedef struct BTDedupInterval
+{
+	OffsetNumber baseoff;		/* first item of the run */
+	uint16		nitems;			/* number of items in the run, >= 2 */
+} BTDedupInterval;
+
 /*
  *	Operator strategy numbers for B-tree have been moved to access/stratnum.h,
  *	because many places need to use them in ScanKeyInit() calls.
@@ -381,12 +456,14 @@ typedef struct BTScanPosData
 	 * array back-to-front, so we start at the last slot and fill downwards.
 	 * Hence we need both a first-valid-entry and a last-valid-entry counter.
 	 * itemIndex is a cursor showing which entry was last returned to caller.
+	 * A posting list tuple contributes one entry per heap TID, in heap TID
+	 * order, all with the same indexOffset.
 	 */
 	int			firstItem;		/* first valid index in items[] */
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -531,6 +608,17 @@ extern bool _bt_doinsert(Relation rel, IndexTuple itup,
 extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, int access);
 extern void _bt_finish_split(Relation rel, Buffer bbuf, BTStack stack);
 
+/*
+ * prototypes for functions in nbtdedup.c
+ */
+extern bool _bt_dedup_enabled(Relation rel);
+extern bool _bt_dedup_keys_equal(IndexTuple a, IndexTuple b);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+extern bool _bt_dedup_one_page(Relation rel, Buffer buf);
+extern Page _bt_dedup_form_page(Page page, BTDedupInterval *intervals,
+					int nintervals);
+
 /*
  * prototypes for functions in nbtpage.c
  */
@@ -552,6 +640,7 @@ extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems,
+					OffsetNumber *updatenos, IndexTuple *updated, int nupdated,
 					BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf);
 
@@ -41,6 +41,8 @@
 										 * FSM */
 #define XLOG_BTREE_META_CLEANUP	0xE0	/* update cleanup-related data in the
 										 * metapage */
+#define XLOG_BTREE_DEDUP		0xF0	/* merge duplicates into posting list
+										 * tuples */
 
 /*
  * All that we need to regenerate the meta-data page
@@ -164,17 +166,40 @@ typedef struct xl_btree_reuse_page
  * starting from the last block vacuumed through until this one. Individual
  * block numbers aren't given.
  *
+ * Posting list tuples that lose some but not all of their heap TIDs are
+ * replaced rather than deleted.  The block data holds the ndeleted offsets
+ * to delete, then the nupdated offsets to overwrite, then the nupdated
+ * replacement tuples, each MAXALIGN'd.  Updates are applied first, so all
+ * offsets refer to the page as it was before this record.
+ *
  * Note that the *last* WAL record in any vacuum of an index is allowed to
- * have a zero length array of offsets. Earlier records must have at least one.
+ * have no deletions or updates at all. Earlier records must have at least
+ * one.
  */
 typedef struct xl_btree_vacuum
 {
 	BlockNumber lastBlockVacuumed;
+	uint16		ndeleted;
+	uint16		nupdated;
 
-	/* TARGET OFFSET NUMBERS FOLLOW */
+	/* DELETED AND UPDATED TARGET OFFSET NUMBERS, AND UPDATED TUPLES, FOLLOW */
 } xl_btree_vacuum;
 
-#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, lastBlockVacuumed) + sizeof(BlockNumber))
+#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, nupdated) + sizeof(uint16))
+
+/*
+ * This is what we need to know about deduplicating a leaf page.  The block
+ * data is an array of nintervals BTDedupInterval entries, in ascending
+ * baseoff order; redo merges each run exactly as _bt_dedup_one_page did.
+ */
+typedef struct xl_btree_dedup
+{
+	uint16		nintervals;
+
+	/* DEDUPLICATION INTERVALS FOLLOW */
+} xl_btree_dedup;
+
+#define SizeOfBtreeDedup	(offsetof(xl_btree_dedup, nintervals) + sizeof(uint16))
 
 /*
  * This is what we need to know about marking an empty branch for deletion.
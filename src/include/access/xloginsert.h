@@ -37,6 +37,24 @@
 #define REGBUF_KEEP_DATA	0x10	/* include data even if a full-page image
 									 * is taken */
 
+/*
+ * Hook for plugins that know a relation is stored where pages cannot be
+ * torn, so that full-page images of it can be skipped outside of online
+ * backups.  It is called inside a critical section, so it must not throw
+ * errors or allocate memory.
+ */
+typedef bool (*torn_page_safe_hook_type) (const RelFileNode *rnode,
+										  ForkNumber forknum);
+extern PGDLLIMPORT torn_page_safe_hook_type torn_page_safe_hook;
+
+/*
+ * Hook called after a record that skipped full-page images because of
+ * torn_page_safe_hook has been inserted, with the number of images skipped.
+ * The same restrictions apply.
+ */
+typedef void (*torn_page_images_skipped_hook_type) (int nimages);
+extern PGDLLIMPORT torn_page_images_skipped_hook_type torn_page_images_skipped_hook;
+
 /* prototypes for public functions in xloginsert.c: */
 extern void XLogBeginInsert(void);
 extern void XLogSetRecordFlags(uint8 flags);
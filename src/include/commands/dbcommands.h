@@ -19,6 +19,15 @@
 #include "lib/stringinfo.h"
 #include "nodes/parsenodes.h"
 
+/*
+ * Hook for plugins that copy the template database from an existing
+ * snapshot of its files rather than from its current files.  Returning
+ * true lets CREATE DATABASE proceed while other sessions are connected to
+ * the template.
+ */
+typedef bool (*createdb_template_in_use_hook_type) (Oid src_dboid);
+extern PGDLLIMPORT createdb_template_in_use_hook_type createdb_template_in_use_hook;
+
 extern Oid	createdb(ParseState *pstate, const CreatedbStmt *stmt);
 extern void dropdb(const char *dbname, bool missing_ok);
 extern ObjectAddress RenameDatabase(const char *oldname, const char *newname);
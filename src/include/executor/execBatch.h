@@ -0,0 +1,62 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Batch-at-a-time execution of sequential scans, simple quals and
+ *	  plain aggregates.
+ *
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "executor/nodeAgg.h"
+#include "nodes/execnodes.h"
+
+/* number of rows collected into one batch */
+#define BATCH_SIZE	1024
+
+/*
+ * One column of a batch.  Values are stored unpacked in an array of the
+ * column's C type, so that loops over a column are plain array loops the
+ * compiler can vectorize.  Null entries hold zero.
+ */
+typedef struct BatchColumn
+{
+	AttrNumber	attnum;			/* column of the scanned relation */
+	Oid			typid;			/* INT4OID, DATEOID, INT8OID or FLOAT8OID */
+	union
+	{
+		int32	   *i32;		/* INT4OID and DATEOID */
+		int64	   *i64;		/* INT8OID */
+		float8	   *f8;			/* FLOAT8OID */
+	}			values;
+	bool	   *isnull;
+} BatchColumn;
+
+/*
+ * A batch of up to BATCH_SIZE rows, stored column by column.
+ */
+typedef struct TupleBatch
+{
+	int			nrows;			/* number of rows filled in */
+	int			ncolumns;		/* number of columns collected */
+	BatchColumn *columns;
+	AttrNumber	maxattnum;		/* highest attnum to deform */
+} TupleBatch;
+
+typedef struct BatchAggState BatchAggState;
+
+/* GUC parameter */
+extern bool enable_batch_execution;
+
+extern BatchAggState *ExecInitBatchAgg(AggState *aggstate);
+extern void ExecBatchAdvanceAggregates(AggState *aggstate,
+						   AggStatePerGroup pergroup);
+
+#endif							/* EXECBATCH_H */
@@ -14,6 +14,7 @@
 #ifndef HASHJOIN_H
 #define HASHJOIN_H
 
+#include "lib/bloomfilter.h"
 #include "nodes/execnodes.h"
 #include "port/atomics.h"
 #include "storage/barrier.h"
@@ -243,6 +244,7 @@ typedef struct ParallelHashJoinState
 	int			nparticipants;
 	size_t		space_allowed;
 	size_t		total_tuples;	/* total number of inner tuples */
+	dsa_pointer bloom_filter;	/* union of the participants' filters */
 	LWLock		lock;			/* lock protecting the above */
 
 	Barrier		build_barrier;	/* synchronization for the build phases */
@@ -356,6 +358,32 @@ typedef struct HashJoinTableData
 	ParallelHashJoinState *parallel_state;
 	ParallelHashJoinBatchAccessor *batches;
 	dsa_pointer current_chunk_shared;
+
+	/*
+	 * Bloom filter of the hash values of all inner tuples, of all batches,
+	 * if the hash join pushes one down into its outer scan.  With Parallel
+	 * Hash each participant first fills a private filter, and this points
+	 * to the shared union of those once the build is done.  The memory all
+	 * copies need is taken out of spaceAllowed, and counted in spacePeak.
+	 */
+	bloom_filter *bloomFilter;
+	bool		bloomFilterShared;	/* bloomFilter points into DSA memory */
+	Size		bloomFilterSpace;	/* memory charged for bloom filters */
 }			HashJoinTableData;
 
+/*
+ * A hash join's bloom filter, as pushed down into the scan that produces the
+ * join's outer tuples.  The scan evaluates the outer hash keys on its own
+ * tuples and drops those whose hash value is not in the filter, because no
+ * inner tuple can match them.  See ExecHashJoinPushDownFilter().
+ */
+typedef struct HashJoinScanFilter
+{
+	HashJoinTable hashtable;	/* hash functions and bloomFilter */
+	List	   *hashkeys;		/* outer hash keys over the scan tuple */
+	double		ntested;		/* # tuples tested against the filter */
+	double		nremoved;		/* # tuples removed by the filter */
+	bool		disabled;		/* true if it removes too few tuples */
+} HashJoinScanFilter;
+
 #endif							/* HASHJOIN_H */
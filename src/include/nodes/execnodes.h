@@ -18,6 +18,7 @@
 #include "access/heapam.h"
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -990,6 +991,11 @@ typedef struct PlanState
 		if (((PlanState *)(node))->instrument) \
 			((PlanState *)(node))->instrument->nfiltered2 += (delta); \
 	} while(0)
+#define InstrCountFiltered3(node, delta) \
+	do { \
+		if (((PlanState *)(node))->instrument) \
+			((PlanState *)(node))->instrument->nfiltered3 += (delta); \
+	} while(0)
 
 /*
  * EPQState is state for executing an EvalPlanQual recheck on a candidate
@@ -1202,6 +1208,8 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	HeapScanDesc ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	struct HashJoinScanFilter *ss_hashFilter;	/* pushed down by a hash
+												 * join, or NULL */
 } ScanState;
 
 /* ----------------
@@ -1801,6 +1809,8 @@ typedef struct HashJoinState
 	List	   *hj_OuterHashKeys;	/* list of ExprState nodes */
 	List	   *hj_InnerHashKeys;	/* list of ExprState nodes */
 	List	   *hj_HashOperators;	/* list of operator OIDs */
+	struct HashJoinScanFilter *hj_ScanFilter;	/* bloom filter for the
+												 * outer scan, or NULL */
 	HashJoinTable hj_HashTable;
 	uint32		hj_CurHashValue;
 	int			hj_CurBucketNo;
@@ -1839,6 +1849,69 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+struct MemoizeEntry;
+struct MemoizeTuple;
+struct MemoizeKey;
+
+/* ----------------
+ *	 MemoizeInstrumentation information
+ * ----------------
+ */
+typedef struct MemoizeInstrumentation
+{
+	uint64		cache_hits;		/* number of rescans where we've found the
+								 * scan parameter values to be cached */
+	uint64		cache_misses;	/* number of rescans where we've not found the
+								 * scan parameter values to be cached. */
+	uint64		cache_evictions;	/* number of cache entries removed due to
+									 * the need to free memory */
+	uint64		cache_overflows;	/* number of times we've had to bypass the
+									 * cache when filling it due to not being
+									 * able to free enough space to store the
+									 * current scan's tuples. */
+	uint64		mem_peak;		/* peak memory usage in bytes */
+} MemoizeInstrumentation;
+
+/* ----------------
+ *	 MemoizeState information
+ *
+ *		memoize nodes are used to cache recent and commonly seen results
+ *		from a parameterized scan.
+ * ----------------
+ */
+typedef struct MemoizeState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			mstatus;		/* value of ExecMemoize state machine */
+	int			nkeys;			/* number of cache keys */
+	struct memoize_hash *hashtable; /* hash table for cache entries */
+	TupleDesc	hashkeydesc;	/* tuple descriptor for cache keys */
+	TupleTableSlot *tableslot;	/* slot for keys of existing cache entries */
+	TupleTableSlot *probeslot;	/* virtual slot used for hash lookups */
+	ExprState  *cache_eq_expr;	/* compares probeslot to tableslot */
+	ExprState **param_exprs;	/* exprs containing the parameters to this
+								 * node */
+	FmgrInfo   *hashfunctions;	/* lookup data for hash funcs nkeys in size */
+	Oid		   *collations;		/* collation for comparisons nkeys in size */
+	uint64		mem_used;		/* bytes of memory used by cache */
+	uint64		mem_limit;		/* memory limit in bytes for the cache */
+	MemoryContext tableContext; /* memory context to store cache data */
+	dlist_head	lru_list;		/* least recently used entry list */
+	struct MemoizeTuple *last_tuple;	/* Used to point to the last tuple
+										 * returned during a cache hit and the
+										 * tuple we last stored when
+										 * populating the cache. */
+	struct MemoizeEntry *entry; /* the entry that 'last_tuple' belongs to or
+								 * NULL if 'last_tuple' is NULL. */
+	bool		singlerow;		/* true if the cache entry is to be marked as
+								 * complete after caching the first tuple. */
+	bool		binary_mode;	/* true when cache key should be compared bit
+								 * by bit, false when using hash equality ops */
+	MemoizeInstrumentation stats;	/* execution statistics */
+	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
+								 * param_exprs */
+} MemoizeState;
+
 /* ----------------
  *	 Shared memory container for per-worker sort information
  * ----------------
@@ -1867,6 +1940,44 @@ typedef struct SortState
 	SharedSortInfo *shared_info;	/* one entry per worker */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *	 The input is read in batches of whole groups of rows that share the
+ *	 presorted key columns; each batch is sorted on its own and returned
+ *	 before the next one is read.
+ * ----------------
+ */
+typedef enum
+{
+	INCSORT_LOADING,			/* reading the next batch from the input */
+	INCSORT_READING,			/* returning tuples of the sorted batch */
+	INCSORT_DONE				/* input and last batch are exhausted */
+} IncrementalSortExecutionStatus;
+
+typedef struct IncrementalSortInfo
+{
+	int64		batchCount;		/* number of batches sorted */
+	bits32		sortMethods;	/* bitmask of TuplesortMethods used */
+	long		maxMemorySpaceUsed; /* peak memory used by a batch, in kB */
+	long		maxDiskSpaceUsed;	/* peak disk used by a batch, in kB */
+} IncrementalSortInfo;
+
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		tuples_returned;	/* tuples returned since (re)scan start */
+	IncrementalSortExecutionStatus execution_status;
+	bool		outerNodeDone;	/* finished fetching tuples from outer node */
+	ExprState  *presortedEq;	/* compares the presorted key columns */
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+	TupleTableSlot *group_pivot;	/* tuple holding the keys the batch ends on */
+	TupleTableSlot *transfer_tuple; /* first tuple of the next batch */
+	IncrementalSortInfo incsort_info;	/* statistics for EXPLAIN ANALYZE */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -1947,6 +2058,22 @@ typedef struct AggState
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
+
+	/* these fields are used to spill AGG_HASHED and AGG_MIXED to disk: */
+	Size		hash_mem_limit; /* spill once the hash tables use more */
+	Size		hash_mem_peak;	/* peak memory used by the hash tables */
+	Size		hash_entry_size;	/* observed memory per group */
+	uint64		hash_ngroups_current;	/* groups in the hash tables */
+	bool		hash_spill_mode;	/* tuples of new groups go to disk */
+	bool		hash_ever_spilled;	/* spilled since the last rescan? */
+	struct HashAggSpill *hash_spills;	/* per-hashed-set spill files */
+	List	   *hash_batches;	/* spilled partitions still to aggregate */
+	int			hash_batch_used_bits;	/* hash bits used by current batch */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;	/* passes over the input, for EXPLAIN */
+	int64		hash_spill_tuples;	/* tuples written, for EXPLAIN */
+	int64		hash_disk_used; /* bytes written, for EXPLAIN */
+	struct BatchAggState *batchstate;	/* batch-mode state, or NULL */
 } AggState;
 
 /* ----------------
@@ -2144,6 +2271,8 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	bool		build_bloom_filter; /* also build a bloom filter? */
 } HashState;
 
 /* ----------------
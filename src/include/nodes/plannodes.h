@@ -751,6 +751,29 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		memoize node
+ *
+ * Caches the tuples returned by its parameterized subplan, keyed on the
+ * values of the parameters, so that a rescan with parameter values that
+ * have been seen before can be answered without rescanning the subplan.
+ * ----------------
+ */
+typedef struct Memoize
+{
+	Plan		plan;
+	int			numKeys;		/* number of cache keys */
+	Oid		   *hashOperators;	/* hash equality operators for each key */
+	Oid		   *collations;		/* collations for each key */
+	List	   *param_exprs;	/* expressions computing the cache keys */
+	bool		singlerow;		/* mark an entry complete after its first
+								 * tuple? */
+	bool		binary_mode;	/* compare cache keys bit by bit, rather than
+								 * with the hash equality operators? */
+	uint32		est_entries;	/* number of entries the planner expects to
+								 * fit in the cache, or 0 if unknown */
+} Memoize;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -765,6 +788,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The first nPresortedCols sort keys are already sorted on the input; the
+ * node only sorts each group of rows sharing them on the remaining keys.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			nPresortedCols; /* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -113,6 +113,10 @@ typedef struct PgStat_TableCounts
 
 	PgStat_Counter t_blocks_fetched;
 	PgStat_Counter t_blocks_hit;
+
+	PgStat_Counter t_gin_pending_cleanups;
+	PgStat_Counter t_gin_pending_pages;
+	PgStat_Counter t_gin_pending_cleanup_time;	/* in microseconds */
 } PgStat_TableCounts;
 
 /* Possible targets for resetting cluster-wide shared values */
@@ -566,7 +570,7 @@ typedef union PgStat_Msg
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9D
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9E
 
 /* ----------
  * PgStat_StatDBEntry			The collector's data per database
@@ -633,6 +637,10 @@ typedef struct PgStat_StatTabEntry
 	PgStat_Counter blocks_fetched;
 	PgStat_Counter blocks_hit;
 
+	PgStat_Counter gin_pending_cleanups;	/* GIN indexes only */
+	PgStat_Counter gin_pending_pages;
+	PgStat_Counter gin_pending_cleanup_time;	/* times in microseconds */
+
 	TimestampTz vacuum_timestamp;	/* user initiated vacuum */
 	PgStat_Counter vacuum_count;
 	TimestampTz autovac_vacuum_timestamp;	/* autovacuum initiated */
@@ -1353,6 +1361,9 @@ extern void pgstat_count_heap_update(Relation rel, bool hot);
 extern void pgstat_count_heap_delete(Relation rel);
 extern void pgstat_count_truncate(Relation rel);
 extern void pgstat_update_heap_dead_tuples(Relation rel, int delta);
+extern void pgstat_count_gin_pending_cleanup(Relation rel,
+								 PgStat_Counter npages,
+								 PgStat_Counter usecs);
 
 extern void pgstat_init_function_usage(FunctionCallInfoData *fcinfo,
 						   PgStat_FunctionCallUsage *fcu);
@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_bytescan.h
+ *	  Routines for finding the next of a few interesting bytes in a buffer.
+ *
+ * COPY FROM spends much of its time stepping over ordinary data looking for
+ * the next newline, delimiter, quote or backslash.  pg_bytescan() does that
+ * search 16 or 32 bytes at a time where the CPU allows: with SSE2 on x86-64,
+ * where it is always available, and with AVX2 when a runtime check finds
+ * it.  Other platforms use a plain loop.
+ *
+ * A pg_byteset holds up to PG_BYTESET_SIZE bytes to look for, and can also
+ * match any byte with the high bit set, which callers need when scanning
+ * text in encodings that can embed ASCII bytes in multibyte characters.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/port/pg_bytescan.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_BYTESCAN_H
+#define PG_BYTESCAN_H
+
+#define PG_BYTESET_SIZE 4
+
+typedef struct pg_byteset
+{
+	char		bytes[PG_BYTESET_SIZE]; /* unused slots repeat bytes[0] */
+	bool		highbit;		/* also match bytes with the high bit set? */
+} pg_byteset;
+
+extern void pg_byteset_init(pg_byteset *set, const char *bytes, int nbytes,
+				bool highbit);
+
+/*
+ * Return a pointer to the first byte in [s, end) that is in the set, or end
+ * if there is none.
+ */
+extern const char *(*pg_bytescan) (const pg_byteset *set, const char *s,
+								   const char *end);
+
+#endif							/* PG_BYTESCAN_H */
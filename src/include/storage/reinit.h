@@ -16,9 +16,18 @@
 #define REINIT_H
 
 #include "common/relpath.h"
+#include "storage/relfilenode.h"
+
+/*
+ * Name of the file in each per-database directory that lists the relations
+ * having an init fork
+ */
+#define INIT_FORK_MAP_FILENAME	"pg_init_forks"
 
 
 extern void ResetUnloggedRelations(int op);
+extern void RememberUnloggedRelation(RelFileNode rnode);
+extern void ForgetUnloggedRelation(RelFileNode rnode);
 extern bool parse_filename_for_nontemp_relation(const char *name,
 									int *oidchars, ForkNumber *fork);
 
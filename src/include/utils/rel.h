@@ -268,6 +268,8 @@ typedef struct StdRdOptions
 	AutoVacOpts autovacuum;		/* autovacuum-related options */
 	bool		user_catalog_table; /* use as an additional catalog relation */
 	int			parallel_workers;	/* max number of parallel workers */
+	bool		deduplicate_items;	/* btree: merge duplicates into posting
+									 * lists? */
 } StdRdOptions;
 
 #define HEAP_MIN_FILLFACTOR			10
@@ -35,6 +35,9 @@
 typedef struct Tuplesortstate Tuplesortstate;
 typedef struct Sharedsort Sharedsort;
 
+/* Defined in access/gin_private.h, needed for sorting GIN entry tuples */
+struct GinState;
+
 /*
  * Tuplesort parallel coordination state, allocated by each participant in
  * local memory.  Participant caller initializes everything.  See usage notes
@@ -209,6 +212,11 @@ extern Tuplesortstate *tuplesort_begin_index_hash(Relation heapRel,
 						   uint32 max_buckets,
 						   int workMem, SortCoordinate coordinate,
 						   bool randomAccess);
+extern Tuplesortstate *tuplesort_begin_index_gin(Relation heapRel,
+						  Relation indexRel,
+						  struct GinState *ginstate,
+						  int workMem, SortCoordinate coordinate,
+						  bool randomAccess);
 extern Tuplesortstate *tuplesort_begin_datum(Oid datumType,
 					  Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag,
@@ -223,6 +231,7 @@ extern void tuplesort_putheaptuple(Tuplesortstate *state, HeapTuple tup);
 extern void tuplesort_putindextuplevalues(Tuplesortstate *state,
 							  Relation rel, ItemPointer self,
 							  Datum *values, bool *isnull);
+extern void tuplesort_putgintuple(Tuplesortstate *state, IndexTuple tuple);
 extern void tuplesort_putdatum(Tuplesortstate *state, Datum val,
 				   bool isNull);
 
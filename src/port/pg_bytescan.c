@@ -0,0 +1,235 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_bytescan.c
+ *	  Find the next of a few interesting bytes in a buffer.
+ *
+ * There are three implementations: a plain loop, an SSE2 one that looks at
+ * 16 bytes per iteration, and an AVX2 one that looks at 32.  SSE2 is part
+ * of the x86-64 baseline, so we use it unconditionally there; AVX2 is used
+ * only if a check on the first call finds that both the CPU and the OS
+ * support it.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/port/pg_bytescan.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#if defined(__x86_64__) || defined(_M_AMD64)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * For AVX2 we need cpuid to check for it at runtime, and a compiler that can
+ * generate AVX2 code for a single function without -mavx2 for the whole
+ * file.
+ */
+#if defined(USE_SSE2) && defined(HAVE__GET_CPUID) && \
+	(defined(__clang__) || __GNUC__ > 4 || \
+	 (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define USE_AVX2_WITH_RUNTIME_CHECK
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "port/pg_bytescan.h"
+
+static const char *pg_bytescan_choose(const pg_byteset *set, const char *s,
+				   const char *end);
+
+const char *(*pg_bytescan) (const pg_byteset *set, const char *s,
+							const char *end) = pg_bytescan_choose;
+
+/*
+ * Set up a byte set matching the nbytes bytes at 'bytes', plus any byte with
+ * the high bit set if 'highbit'.
+ */
+void
+pg_byteset_init(pg_byteset *set, const char *bytes, int nbytes, bool highbit)
+{
+	int			i;
+
+	Assert(nbytes >= 1 && nbytes <= PG_BYTESET_SIZE);
+
+	/* Repeating a byte costs nothing, and keeps the scanners branch-free */
+	for (i = 0; i < PG_BYTESET_SIZE; i++)
+		set->bytes[i] = bytes[i < nbytes ? i : 0];
+	set->highbit = highbit;
+}
+
+static inline bool
+pg_byteset_match(const pg_byteset *set, char c)
+{
+	return c == set->bytes[0] || c == set->bytes[1] ||
+		c == set->bytes[2] || c == set->bytes[3] ||
+		(set->highbit && IS_HIGHBIT_SET(c));
+}
+
+/*
+ * Plain implementation, also used for the tails of the vectorized ones.
+ */
+static const char *
+pg_bytescan_sb(const pg_byteset *set, const char *s, const char *end)
+{
+	for (; s < end; s++)
+	{
+		if (pg_byteset_match(set, *s))
+			return s;
+	}
+	return end;
+}
+
+#ifdef USE_SSE2
+
+/*
+ * Position of the lowest set bit in a nonzero mask.
+ */
+static inline int
+pg_bytescan_first(uint32 mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+	unsigned long result;
+
+	_BitScanForward(&result, mask);
+	return (int) result;
+#else
+	int			result = 0;
+
+	while ((mask & 1) == 0)
+	{
+		mask >>= 1;
+		result++;
+	}
+	return result;
+#endif
+}
+
+static const char *
+pg_bytescan_sse2(const pg_byteset *set, const char *s, const char *end)
+{
+	const __m128i b0 = _mm_set1_epi8(set->bytes[0]);
+	const __m128i b1 = _mm_set1_epi8(set->bytes[1]);
+	const __m128i b2 = _mm_set1_epi8(set->bytes[2]);
+	const __m128i b3 = _mm_set1_epi8(set->bytes[3]);
+
+	while (end - s >= (ptrdiff_t) sizeof(__m128i))
+	{
+		__m128i		chunk = _mm_loadu_si128((const __m128i *) s);
+		__m128i		hits;
+		uint32		mask;
+
+		hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, b0),
+										 _mm_cmpeq_epi8(chunk, b1)),
+							_mm_or_si128(_mm_cmpeq_epi8(chunk, b2),
+										 _mm_cmpeq_epi8(chunk, b3)));
+		mask = (uint32) _mm_movemask_epi8(hits);
+
+		/* movemask of the data itself gives us the high bits directly */
+		if (set->highbit)
+			mask |= (uint32) _mm_movemask_epi8(chunk);
+
+		if (mask != 0)
+			return s + pg_bytescan_first(mask);
+		s += sizeof(__m128i);
+	}
+
+	return pg_bytescan_sb(set, s, end);
+}
+
+#endif							/* USE_SSE2 */
+
+#ifdef USE_AVX2_WITH_RUNTIME_CHECK
+
+__attribute__((target("avx2")))
+static const char *
+pg_bytescan_avx2(const pg_byteset *set, const char *s, const char *end)
+{
+	const __m256i b0 = _mm256_set1_epi8(set->bytes[0]);
+	const __m256i b1 = _mm256_set1_epi8(set->bytes[1]);
+	const __m256i b2 = _mm256_set1_epi8(set->bytes[2]);
+	const __m256i b3 = _mm256_set1_epi8(set->bytes[3]);
+
+	while (end - s >= (ptrdiff_t) sizeof(__m256i))
+	{
+		__m256i		chunk = _mm256_loadu_si256((const __m256i *) s);
+		__m256i		hits;
+		uint32		mask;
+
+		hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, b0),
+											   _mm256_cmpeq_epi8(chunk, b1)),
+							   _mm256_or_si256(_mm256_cmpeq_epi8(chunk, b2),
+											   _mm256_cmpeq_epi8(chunk, b3)));
+		mask = (uint32) _mm256_movemask_epi8(hits);
+		if (set->highbit)
+			mask |= (uint32) _mm256_movemask_epi8(chunk);
+
+		if (mask != 0)
+			return s + pg_bytescan_first(mask);
+		s += sizeof(__m256i);
+	}
+
+	/* Finish with at most one 16-byte step and the plain loop */
+	return pg_bytescan_sse2(set, s, end);
+}
+
+/*
+ * Does the CPU support AVX2, and does the OS save the YMM registers?
+ */
+static bool
+pg_bytescan_avx2_available(void)
+{
+	unsigned int exx[4] = {0, 0, 0, 0};
+	unsigned int xcr0;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__get_cpuid(1, &exx[0], &exx[1], &exx[2], &exx[3]);
+	if ((exx[2] & (1 << 27)) == 0 ||	/* OSXSAVE */
+		(exx[2] & (1 << 28)) == 0)	/* AVX */
+		return false;
+
+	/* XCR0 must have both the SSE and the AVX state enabled */
+	__asm__ __volatile__("xgetbv" : "=a"(xcr0) : "c"(0) : "%edx");
+	if ((xcr0 & 0x6) != 0x6)
+		return false;
+
+	__cpuid_count(7, 0, exx[0], exx[1], exx[2], exx[3]);
+	return (exx[1] & (1 << 5)) != 0;	/* AVX2 */
+}
+
+#endif							/* USE_AVX2_WITH_RUNTIME_CHECK */
+
+/*
+ * This gets called on the first call. It replaces the function pointer
+ * so that subsequent calls are routed directly to the chosen implementation.
+ */
+static const char *
+pg_bytescan_choose(const pg_byteset *set, const char *s, const char *end)
+{
+#if defined(USE_AVX2_WITH_RUNTIME_CHECK)
+	if (pg_bytescan_avx2_available())
+		pg_bytescan = pg_bytescan_avx2;
+	else
+		pg_bytescan = pg_bytescan_sse2;
+#elif defined(USE_SSE2)
+	pg_bytescan = pg_bytescan_sse2;
+#else
+	pg_bytescan = pg_bytescan_sb;
+#endif
+
+	return pg_bytescan(set, s, end);
+}
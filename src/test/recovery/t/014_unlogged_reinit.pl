@@ -7,7 +7,7 @@ use strict;
 use warnings;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 12;
+use Test::More tests => 19;
 
 my $node = get_new_node('main');
 
@@ -79,3 +79,73 @@ ok( !-f "$pgdata/${ts1UnloggedPath}_vm",
 	'vm fork in tablespace removed at startup');
 ok( !-f "$pgdata/${ts1UnloggedPath}_fsm",
 	'fsm fork in tablespace removed at startup');
+
+# The reset above has recorded the relations that have an init fork in the
+# database directory's init fork map.
+my $dbDir = $node->safe_psql('postgres',
+	q{select 'base/' || oid from pg_database where datname = 'postgres'});
+
+ok(in_init_fork_map($dbDir, 'base_unlogged'),
+	'unlogged table listed in init fork map');
+
+# New unlogged relations are added to the map, and leave it again when their
+# init fork is removed.
+$node->safe_psql('postgres', 'CREATE UNLOGGED TABLE map_unlogged (id int)');
+my $mapUnloggedNode = $node->safe_psql('postgres',
+	q{select pg_relation_filenode('map_unlogged')});
+ok(in_init_fork_map($dbDir, $mapUnloggedNode),
+	'new unlogged table added to init fork map');
+
+$node->safe_psql('postgres', 'TRUNCATE map_unlogged');
+ok(!in_init_fork_map($dbDir, $mapUnloggedNode),
+	'truncated relfilenode removed from init fork map');
+$mapUnloggedNode = $node->safe_psql('postgres',
+	q{select pg_relation_filenode('map_unlogged')});
+ok(in_init_fork_map($dbDir, $mapUnloggedNode),
+	'new relfilenode of truncated table added to init fork map');
+
+$node->safe_psql('postgres', 'DROP TABLE map_unlogged');
+ok(!in_init_fork_map($dbDir, $mapUnloggedNode),
+	'dropped table removed from init fork map');
+
+my $abortedNode = $node->safe_psql(
+	'postgres', q{
+	BEGIN;
+	CREATE UNLOGGED TABLE map_aborted (id int);
+	SELECT pg_relation_filenode('map_aborted');
+	ROLLBACK;});
+ok(!in_init_fork_map($dbDir, $abortedNode),
+	'table of aborted transaction removed from init fork map');
+
+# Finally, the contents of an unlogged table are reset by a crash.
+$node->safe_psql('postgres',
+	'INSERT INTO base_unlogged SELECT generate_series(1, 1000)');
+$node->safe_psql('postgres', 'CHECKPOINT');
+$node->stop('immediate');
+$node->start;
+is($node->safe_psql('postgres', 'SELECT count(*) FROM base_unlogged'),
+	'0', 'unlogged table is empty after crash');
+
+# Check whether a relation, given by name or relfilenode, is listed in the
+# init fork map of the given database directory.
+sub in_init_fork_map
+{
+	my ($dbdir, $rel) = @_;
+	my $relfilenode = $rel;
+	my $map;
+
+	$relfilenode = $node->safe_psql('postgres',
+		qq{select pg_relation_filenode('$rel')})
+	  unless $rel =~ /^\d+$/;
+
+	open(my $fh, '<', "$pgdata/$dbdir/pg_init_forks")
+	  or BAIL_OUT("could not open init fork map: $!");
+	binmode $fh;
+	local $/;
+	$map = <$fh>;
+	close $fh;
+
+	# Each entry is a relfilenode followed by its CRC.
+	my @words = unpack('L*', $map);
+	return grep { $_ % 2 == 0 && $words[$_] == $relfilenode } 0 .. $#words;
+}
@@ -973,3 +973,99 @@ select v||'a', case when v||'a' = 'aa' then 1 else 0 end, count(*)
 explain (costs off)
   select 1 from tenk1
    where (hundred, thousand) in (select twothousand, twothousand from onek);
+
+--
+-- Hash Aggregation Spill tests
+--
+-- Build the same tables with a HashAggregate that spills to disk and with
+-- a sort-based aggregate, and check that they match.
+--
+
+-- no statistics, so that the planner expects few enough groups to hash
+create table agg_data_20k with (autovacuum_enabled = off) as
+  select g, g % 1000 as g1000, g % 13 as g13
+  from generate_series(0, 19999) g;
+
+-- hide platform-dependent memory and disk figures
+create function explain_hashagg(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Disk Usage: \d+', 'Disk Usage: N');
+        ln := regexp_replace(ln, 'Batches: \d+', 'Batches: N');
+        ln := regexp_replace(ln, 'Spilled Tuples: \d+', 'Spilled Tuples: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+set enable_sort = off;
+set work_mem = '64kB';
+
+explain (costs off)
+select g1000, sum(g::numeric), count(*), max(g::text)
+  from agg_data_20k group by g1000;
+select explain_hashagg('
+select g1000, sum(g::numeric), count(*), max(g::text)
+  from agg_data_20k group by g1000');
+
+create table agg_hash_1 as
+select g, count(*) as c, sum(g13::numeric) as s, array_agg(g13) as a
+  from agg_data_20k group by g;
+create table agg_hash_2 as
+select g1000, sum(g::numeric) as s, count(*) as c, max(g::text) as m
+  from agg_data_20k group by g1000;
+create table agg_hash_3 as
+select g13, g1000 % 7 as g7, avg(g::numeric) as a, string_agg(g::text, ',') is not null as t
+  from agg_data_20k group by g13, g1000 % 7;
+
+-- DISTINCT and ORDER BY aggregates can't be hashed, even with sorts off
+explain (costs off)
+select g1000, count(distinct g13), array_agg(g order by g desc)
+  from agg_data_20k group by g1000;
+create table agg_hash_4 as
+select g1000, count(distinct g13) as d, array_agg(g order by g desc) as a
+  from agg_data_20k group by g1000;
+
+set enable_sort = on;
+set enable_hashagg = off;
+reset work_mem;
+
+create table agg_group_1 as
+select g, count(*) as c, sum(g13::numeric) as s, array_agg(g13) as a
+  from agg_data_20k group by g;
+create table agg_group_2 as
+select g1000, sum(g::numeric) as s, count(*) as c, max(g::text) as m
+  from agg_data_20k group by g1000;
+create table agg_group_3 as
+select g13, g1000 % 7 as g7, avg(g::numeric) as a, string_agg(g::text, ',') is not null as t
+  from agg_data_20k group by g13, g1000 % 7;
+create table agg_group_4 as
+select g1000, count(distinct g13) as d, array_agg(g order by g desc) as a
+  from agg_data_20k group by g1000;
+
+reset enable_hashagg;
+
+(select * from agg_hash_1 except select * from agg_group_1)
+  union all
+(select * from agg_group_1 except select * from agg_hash_1);
+(select * from agg_hash_2 except select * from agg_group_2)
+  union all
+(select * from agg_group_2 except select * from agg_hash_2);
+(select * from agg_hash_3 except select * from agg_group_3)
+  union all
+(select * from agg_group_3 except select * from agg_hash_3);
+(select * from agg_hash_4 except select * from agg_group_4)
+  union all
+(select * from agg_group_4 except select * from agg_hash_4);
+
+drop table agg_data_20k, agg_hash_1, agg_hash_2, agg_hash_3, agg_hash_4,
+  agg_group_1, agg_group_2, agg_group_3, agg_group_4;
+drop function explain_hashagg(text);
@@ -0,0 +1,139 @@
+--
+-- Batch-at-a-time execution of plain aggregates over sequential scans
+--
+-- Every query runs once in batch mode and once a tuple at a time, and
+-- both runs must give the same results and raise the same errors.
+--
+
+-- more than one batch, with a partial last batch, nulls and a NaN
+create table batch_data (i int4, d date, b int8, f float8, x float8);
+insert into batch_data
+  select case when g % 17 = 0 then null else g - 2500 end,
+         date '2000-01-01' + g % 400,
+         g * 1000000000::int8,
+         case when g % 23 = 0 then null else g / 7.0 end,
+         case when g = 4000 then 'NaN' else (g % 10) / 4.0 end
+  from generate_series(1, 5000) g;
+analyze batch_data;
+
+-- run a query in both modes, and return its result if they agree
+create function batch_compare(query text) returns text
+language plpgsql as
+$$
+declare
+    batch_result text;
+    row_result text;
+begin
+    perform set_config('enable_batch_execution', 'on', true);
+    execute format('select array_agg(q::text) from (%s) q', query)
+        into batch_result;
+    perform set_config('enable_batch_execution', 'off', true);
+    execute format('select array_agg(q::text) from (%s) q', query)
+        into row_result;
+    if batch_result is distinct from row_result then
+        raise exception 'batch mode gave %, tuple mode gave %',
+            batch_result, row_result;
+    end if;
+    return row_result;
+end;
+$$;
+
+set enable_batch_execution = on;
+
+explain (costs off)
+select count(*), count(i), count(f), sum(i), avg(i) from batch_data;
+select batch_compare('
+select count(*), count(i), count(f), sum(i), avg(i) from batch_data');
+
+explain (costs off)
+select count(*), sum(i), avg(f), sum(f * x - 1.5) from batch_data
+ where i > 0 and d < date '2000-06-01' and b >= 3000000000;
+select batch_compare('
+select count(*), sum(i), avg(f), sum(f * x - 1.5) from batch_data
+ where i > 0 and d < date ''2000-06-01'' and b >= 3000000000');
+
+-- the constant on the left, and the other comparison operators
+select batch_compare('
+select count(*), sum(i) from batch_data where 1000 > i');
+select batch_compare('
+select count(*), sum(i) from batch_data where i <> 7 and i <= 100');
+select batch_compare('
+select count(*), sum(i) from batch_data where d = date ''2000-02-01''');
+select batch_compare('
+select count(*), sum(i) from batch_data where b < 12345678901');
+
+-- float8 comparisons put NaN above everything else
+select batch_compare('
+select count(*), count(x), sum(x) from batch_data where x > 2');
+select batch_compare('
+select count(*), sum(f) from batch_data where x = ''NaN''');
+select batch_compare('
+select count(*), avg(f) from batch_data where x <= 1.25 and x <> 0.5');
+
+-- float8 arithmetic, including nulls and the NaN
+select batch_compare('
+select sum(f + x), sum(f - 2 * x), avg(x * x), sum(2.5 * f * f) from batch_data');
+
+-- no rows pass the quals
+select batch_compare('
+select count(*), count(i), sum(i), avg(i), sum(f), avg(f) from batch_data
+ where i > 100000');
+
+-- HAVING and the result projection still run as usual
+select batch_compare('
+select count(*) + 1, sum(i) * 2 from batch_data where i < 0 having count(*) > 10');
+
+-- a rescanned aggregate
+explain (costs off)
+select s.* from (values (1), (2)) v(n),
+  lateral (select v.n, count(*), sum(i) from batch_data where i > 0) s;
+select batch_compare('
+select s.* from (values (1), (2)) v(n),
+  lateral (select v.n, count(*), sum(i) from batch_data where i > 0) s');
+
+-- queries that batch mode can't run
+explain (costs off)
+select sum(b) from batch_data;
+explain (costs off)
+select count(*) from batch_data where i > 0 or x > 1;
+explain (costs off)
+select count(*) filter (where i > 0) from batch_data;
+explain (costs off)
+select avg(i) from batch_data group by d;
+
+-- a whole number of batches
+create table batch_big (f float8);
+insert into batch_big select 1e308 from generate_series(1, 2048);
+select batch_compare('
+select count(*), count(f) from batch_big');
+
+-- overflows raise the same errors in both modes
+set enable_batch_execution = on;
+explain (costs off)
+select sum(f * 10) from batch_big;
+select sum(f) from batch_big;
+select avg(f) from batch_big;
+select sum(f * 10) from batch_big;
+select sum(f + f) from batch_big where f > 0;
+select count(*), sum(f - f) from batch_big;
+
+set enable_batch_execution = off;
+select sum(f) from batch_big;
+select avg(f) from batch_big;
+select sum(f * 10) from batch_big;
+select sum(f + f) from batch_big where f > 0;
+select count(*), sum(f - f) from batch_big;
+
+-- an overflowing row that the quals filter out doesn't raise an error
+insert into batch_big values (1);
+
+set enable_batch_execution = on;
+select sum(f * 10) from batch_big where f < 1e300;
+
+set enable_batch_execution = off;
+select sum(f * 10) from batch_big where f < 1e300;
+
+reset enable_batch_execution;
+
+drop table batch_data, batch_big;
+drop function batch_compare(text);
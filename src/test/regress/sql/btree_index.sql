@@ -111,3 +111,68 @@ create index btree_idx_err on btree_test(a) with (vacuum_cleanup_index_scale_fac
 -- Simple ALTER INDEX
 alter index btree_idx1 set (vacuum_cleanup_index_scale_factor = 70.0);
 select reloptions from pg_class WHERE oid = 'btree_idx1'::regclass;
+
+--
+-- Test B-tree deduplication
+--
+create table btree_dedup_tbl (a int4, b text);
+-- posting list tuples formed by the index build
+insert into btree_dedup_tbl select g % 10, 'build' from generate_series(1, 10000) g;
+create index btree_dedup_idx on btree_dedup_tbl (a);
+create index btree_nodedup_idx on btree_dedup_tbl (a)
+  with (deduplicate_items = off);
+-- ... and by insertions into full leaf pages
+insert into btree_dedup_tbl select g % 10, 'insert' from generate_series(1, 10000) g;
+select pg_relation_size('btree_dedup_idx') * 2 <
+       pg_relation_size('btree_nodedup_idx') as deduplicated;
+drop index btree_nodedup_idx;
+vacuum analyze btree_dedup_tbl;
+
+set enable_seqscan to false;
+set enable_indexscan to true;
+set enable_bitmapscan to false;
+
+-- every heap TID must be returned once, in either scan direction
+explain (costs off)
+select count(*), count(distinct ctid) from
+  (select ctid from btree_dedup_tbl where a = 3 order by a) ss;
+select count(*), count(distinct ctid) from
+  (select ctid from btree_dedup_tbl where a = 3 order by a) ss;
+explain (costs off)
+select count(*), count(distinct ctid) from
+  (select ctid from btree_dedup_tbl where a >= 3 and a < 4 order by a desc) ss;
+select count(*), count(distinct ctid) from
+  (select ctid from btree_dedup_tbl where a >= 3 and a < 4 order by a desc) ss;
+select a from btree_dedup_tbl where a between 4 and 6 order by a offset 1998 limit 4;
+explain (costs off)
+select a from btree_dedup_tbl where a between 4 and 6 order by a desc offset 1998 limit 4;
+select a from btree_dedup_tbl where a between 4 and 6 order by a desc offset 1998 limit 4;
+explain (costs off)
+select a, count(*) from btree_dedup_tbl where a < 3 group by a order by a;
+select a, count(*) from btree_dedup_tbl where a < 3 group by a order by a;
+
+-- VACUUM removes some, or all, of the heap TIDs of posting list tuples
+delete from btree_dedup_tbl where a = 5 and b = 'build';
+delete from btree_dedup_tbl where a = 7;
+vacuum btree_dedup_tbl;
+select a, count(*) from btree_dedup_tbl where a between 4 and 8 group by a order by a;
+select count(*), count(distinct ctid) from
+  (select ctid from btree_dedup_tbl where a >= 5 and a < 6 order by a desc) ss;
+
+reset enable_seqscan;
+reset enable_indexscan;
+reset enable_bitmapscan;
+
+-- deduplication can be turned off and on again
+alter index btree_dedup_idx set (deduplicate_items = off);
+select reloptions from pg_class where oid = 'btree_dedup_idx'::regclass;
+insert into btree_dedup_tbl select 7, 'off' from generate_series(1, 1000) g;
+alter index btree_dedup_idx reset (deduplicate_items);
+insert into btree_dedup_tbl select 7, 'on' from generate_series(1, 1000) g;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select b, count(*) from btree_dedup_tbl where a = 7 group by b order by b;
+reset enable_seqscan;
+reset enable_bitmapscan;
+create index btree_idx_err on btree_dedup_tbl (a) with (deduplicate_items = 'maybe');
+drop table btree_dedup_tbl;
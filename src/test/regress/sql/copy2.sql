@@ -427,6 +427,237 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- Test COPY into a partitioned table with more partitions than it keeps
+-- buffers for, so that it has to write them out to start new ones
+CREATE TABLE parted_copy (a int, b int, c int) PARTITION BY RANGE (a);
+DO $$
+BEGIN
+  FOR i IN 0..39 LOOP
+    IF i <> 3 THEN
+      EXECUTE format('CREATE TABLE parted_copy_%s PARTITION OF parted_copy
+                      FOR VALUES FROM (%s) TO (%s)', i, i * 10, i * 10 + 10);
+    END IF;
+  END LOOP;
+END;
+$$;
+-- a partition whose rowtype differs from the parent's
+CREATE TABLE parted_copy_3 (c int, dropped int, b int, a int);
+ALTER TABLE parted_copy_3 DROP COLUMN dropped;
+ALTER TABLE parted_copy ATTACH PARTITION parted_copy_3 FOR VALUES FROM (30) TO (40);
+CREATE UNIQUE INDEX ON parted_copy (a);
+
+-- AFTER ROW triggers on all partitions record where each row went
+CREATE TABLE parted_copy_log (tab text, a int, b int, c int);
+CREATE FUNCTION parted_copy_log_row() RETURNS trigger AS $$
+BEGIN
+  INSERT INTO parted_copy_log VALUES (TG_TABLE_NAME, NEW.a, NEW.b, NEW.c);
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER parted_copy_log AFTER INSERT ON parted_copy
+  FOR EACH ROW EXECUTE PROCEDURE parted_copy_log_row();
+
+-- A BEFORE ROW trigger makes its partition's rows go in one at a time.
+-- The rows before them must be written out first, so the trigger counts
+-- one row per earlier input line.
+CREATE FUNCTION parted_copy_count_rows() RETURNS trigger AS $$
+BEGIN
+  NEW.c := (SELECT count(*) FROM parted_copy);
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER parted_copy_count_rows BEFORE INSERT ON parted_copy_7
+  FOR EACH ROW EXECUTE PROCEDURE parted_copy_count_rows();
+
+-- consecutive lines go to different partitions
+COPY parted_copy (a, b) FROM stdin;
+37	1
+74	2
+111	3
+148	4
+185	5
+222	6
+259	7
+296	8
+333	9
+370	10
+7	11
+44	12
+81	13
+118	14
+155	15
+192	16
+229	17
+266	18
+303	19
+340	20
+377	21
+14	22
+51	23
+88	24
+125	25
+162	26
+199	27
+236	28
+273	29
+310	30
+347	31
+384	32
+21	33
+58	34
+95	35
+132	36
+169	37
+206	38
+243	39
+280	40
+317	41
+354	42
+391	43
+28	44
+65	45
+102	46
+139	47
+176	48
+213	49
+250	50
+287	51
+324	52
+361	53
+398	54
+35	55
+72	56
+109	57
+146	58
+183	59
+220	60
+257	61
+294	62
+331	63
+368	64
+5	65
+42	66
+79	67
+116	68
+153	69
+190	70
+227	71
+264	72
+301	73
+338	74
+375	75
+12	76
+49	77
+86	78
+123	79
+160	80
+197	81
+234	82
+271	83
+308	84
+345	85
+382	86
+19	87
+56	88
+93	89
+130	90
+167	91
+204	92
+241	93
+278	94
+315	95
+352	96
+389	97
+26	98
+63	99
+100	100
+\.
+
+SELECT count(*), count(DISTINCT tableoid), sum(a), sum(b) FROM parted_copy;
+SELECT tableoid::regclass, count(*) FROM parted_copy
+  WHERE tableoid::regclass::text <> 'parted_copy_' || a / 10
+  GROUP BY 1;
+SELECT * FROM parted_copy_3 ORDER BY b;
+SELECT * FROM parted_copy_7 ORDER BY b;
+-- the triggers saw the rows as they were stored
+SELECT count(*) FROM parted_copy_log;
+(SELECT 'parted_copy_' || a / 10, a, b, c FROM parted_copy
+ EXCEPT SELECT * FROM parted_copy_log)
+UNION ALL
+(SELECT * FROM parted_copy_log
+ EXCEPT SELECT 'parted_copy_' || a / 10, a, b, c FROM parted_copy);
+
+-- an error in a buffered row reports its own input line (38)
+TRUNCATE parted_copy, parted_copy_log;
+COPY parted_copy (a, b) FROM stdin;
+37	1
+74	2
+111	3
+148	4
+185	5
+222	6
+259	7
+296	8
+333	9
+370	10
+7	11
+44	12
+81	13
+118	14
+155	15
+192	16
+229	17
+266	18
+303	19
+340	20
+377	21
+14	22
+51	23
+88	24
+125	25
+162	26
+199	27
+236	28
+273	29
+310	30
+347	31
+384	32
+21	33
+58	34
+95	35
+132	36
+169	37
+185	38
+243	39
+280	40
+\.
+SELECT count(*) FROM parted_copy;
+
+-- With transition tables to capture, rows are inserted one at a time
+CREATE FUNCTION parted_copy_new_rows() RETURNS trigger AS $$
+BEGIN
+  RAISE NOTICE 'new rows: %',
+    (SELECT string_agg(format('(%s,%s,%s)', a, b, c), ' ' ORDER BY b)
+     FROM new_rows);
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER parted_copy_new_rows AFTER INSERT ON parted_copy
+  REFERENCING NEW TABLE AS new_rows
+  FOR EACH STATEMENT EXECUTE PROCEDURE parted_copy_new_rows();
+
+COPY parted_copy (a, b) FROM stdin;
+37	1
+74	2
+111	3
+148	4
+35	55
+72	56
+109	57
+\.
+SELECT tableoid::regclass, * FROM parted_copy ORDER BY b;
+SELECT * FROM parted_copy_log ORDER BY b;
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -441,3 +672,7 @@ DROP TABLE instead_of_insert_tbl;
 DROP VIEW instead_of_insert_tbl_view;
 DROP VIEW instead_of_insert_tbl_view_2;
 DROP FUNCTION fun_instead_of_insert_tbl();
+DROP TABLE parted_copy, parted_copy_log;
+DROP FUNCTION parted_copy_log_row();
+DROP FUNCTION parted_copy_count_rows();
+DROP FUNCTION parted_copy_new_rows();
@@ -34,3 +34,72 @@ insert into gin_test_tbl select array[1, 3, g] from generate_series(1, 1000) g;
 
 delete from gin_test_tbl where i @> array[2];
 vacuum gin_test_tbl;
+
+-- Test parallel index builds against a serial build of the same index
+create table gin_par_tbl (i int4, a int4[])
+  with (autovacuum_enabled = off, parallel_workers = 2);
+insert into gin_par_tbl
+  select g, array[-1, g % 3, 10 + g % 50, 1000 + g % 1000, 100000 + g]
+  from generate_series(1, 100000) g;
+insert into gin_par_tbl
+  select g, case when g % 2 = 0 then null else '{}'::int4[] end
+  from generate_series(100001, 100100) g;
+
+-- the keys to look up, and which rows contain them
+create table gin_par_keys as
+  select k from generate_series(-1, 59) k
+  union all select generate_series(1000, 1999)
+  union all select generate_series(100000, 200000, 997);
+create table gin_par_expected as
+  select k, count(i), sum(i) from gin_par_tbl, unnest(a) k
+  where k in (select k from gin_par_keys)
+  group by k;
+
+set enable_seqscan = off;
+set enable_indexscan = off;
+
+set max_parallel_maintenance_workers = 0;
+set client_min_messages = debug1;
+create index gin_par_idx on gin_par_tbl using gin (a);
+reset client_min_messages;
+
+explain (costs off)
+select count(*) from gin_par_tbl where a @> array[-1];
+
+create table gin_par_serial as
+  select k, count(i), sum(i) from gin_par_keys,
+    lateral (select i from gin_par_tbl where a @> array[k]) s
+  group by k;
+drop index gin_par_idx;
+
+-- A small maintenance_work_mem makes each participant dump its keys many
+-- times, so the TID lists of the common keys are split over many runs from
+-- different participants.  The key -1 is in every row, and its list is long
+-- enough that the leader inserts it in several parts.
+set max_parallel_maintenance_workers = 2;
+set maintenance_work_mem = '1MB';
+set client_min_messages = debug1;
+create index gin_par_idx on gin_par_tbl using gin (a);
+reset client_min_messages;
+
+create table gin_par_parallel as
+  select k, count(i), sum(i) from gin_par_keys,
+    lateral (select i from gin_par_tbl where a @> array[k]) s
+  group by k;
+
+select count(*) from gin_par_serial;
+(select * from gin_par_expected except select * from gin_par_serial)
+  union all
+(select * from gin_par_serial except select * from gin_par_expected);
+(select * from gin_par_serial except select * from gin_par_parallel)
+  union all
+(select * from gin_par_parallel except select * from gin_par_serial);
+select count(*) from gin_par_tbl where a = '{}';
+
+reset enable_seqscan;
+reset enable_indexscan;
+reset max_parallel_maintenance_workers;
+reset maintenance_work_mem;
+
+drop table gin_par_tbl, gin_par_keys, gin_par_expected, gin_par_serial,
+  gin_par_parallel;
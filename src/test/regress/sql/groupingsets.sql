@@ -429,4 +429,92 @@ select v||'a', case when grouping(v||'a') = 1 then 1 else 0 end, count(*)
   from unnest(array[1,1], array['a','b']) u(i,v)
  group by rollup(i, v||'a') order by 1,3;
 
+
+--
+-- Hash Aggregation Spill tests
+--
+
+-- no statistics, so that the planner expects few enough groups to hash
+create table gs_data_20k with (autovacuum_enabled = off) as
+  select g % 1000 as g1000, g % 100 as g100, g % 10 as g10, g
+  from generate_series(0, 19999) g;
+
+-- did the HashAggregate or MixedAggregate at the top of the plan spill?
+create function gs_hashagg_spilled(query text) returns boolean
+language plpgsql as
+$$
+declare
+    plan json;
+begin
+    execute 'explain (analyze, costs off, timing off, format json) ' || query
+        into plan;
+    return (plan->0->'Plan'->>'HashAgg Batches')::int > 1;
+end;
+$$;
+
+set work_mem = '64kB';
+
+-- all grouping sets hashed
+set enable_sort = off;
+
+explain (costs off)
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g1000), (g100), (g10));
+select gs_hashagg_spilled('
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g1000), (g100), (g10))');
+
+create table gs_hash_1 as
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g1000), (g100), (g10));
+
+-- one grouping set hashed, the others sorted
+set enable_sort = on;
+
+explain (costs off)
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g10), (g10, g100), (g1000), ());
+select gs_hashagg_spilled('
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g10), (g10, g100), (g1000), ())');
+
+create table gs_hash_2 as
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g10), (g10, g100), (g1000), ());
+
+-- DISTINCT and ORDER BY aggregates are never hashed
+explain (costs off)
+select g1000, g10, count(distinct g100), array_agg(g order by g desc)
+  from gs_data_20k group by grouping sets ((g1000), (g10));
+
+set enable_hashagg = off;
+reset work_mem;
+
+create table gs_group_1 as
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g1000), (g100), (g10));
+create table gs_group_2 as
+select g1000, g100, g10, grouping(g1000, g100, g10) as gp,
+       sum(g), count(*), max(g)
+  from gs_data_20k group by grouping sets ((g10), (g10, g100), (g1000), ());
+
+reset enable_hashagg;
+
+(select * from gs_hash_1 except select * from gs_group_1)
+  union all
+(select * from gs_group_1 except select * from gs_hash_1);
+(select * from gs_hash_2 except select * from gs_group_2)
+  union all
+(select * from gs_group_2 except select * from gs_hash_2);
+
+drop table gs_data_20k, gs_hash_1, gs_hash_2, gs_group_1, gs_group_2;
+drop function gs_hashagg_spilled(text);
+
 -- end
@@ -0,0 +1,107 @@
+--
+-- Test incremental sort, which sorts input that is presorted on a prefix of
+-- the sort keys one group at a time
+--
+
+-- Most groups are small, so that an incremental sort pays off, but a few
+-- have sizes around the minimum batch size of 32 tuples, or are large.
+-- Values of b come in pairs, so that there are duplicate sort keys.
+create table incsort_t (a int, b int, c text);
+insert into incsort_t
+  select n / 10, (n / 2 * 7919) % 1009, 'x' || n from generate_series(0, 9999) n;
+insert into incsort_t
+  select g.a, (n * 7919) % 1009, 'y' || n
+  from (values (1001, 1), (1002, 31), (1003, 32), (1004, 33), (1005, 2000)) g(a, cnt),
+       generate_series(1, g.cnt) n;
+create index incsort_t_a on incsort_t (a);
+analyze incsort_t;
+
+-- The memory used varies between platforms, so hide it.
+create function explain_analyze_without_memory(query text)
+returns setof text language plpgsql as
+$$
+declare
+  ln text;
+begin
+  for ln in
+    execute format('explain (analyze, costs off, summary off, timing off) %s',
+      query)
+  loop
+    ln := regexp_replace(ln, 'Peak Memory: \d+', 'Peak Memory: N');
+    return next ln;
+  end loop;
+end;
+$$;
+
+explain (costs off)
+select * from incsort_t order by a, b;
+select explain_analyze_without_memory('select * from incsort_t order by a, b');
+explain (costs off)
+select * from incsort_t order by a, b desc, c;
+explain (costs off)
+select * from incsort_t order by a, b limit 40;
+select explain_analyze_without_memory('select * from incsort_t order by a, b limit 40');
+
+-- Not used if disabled
+set enable_incremental_sort = off;
+explain (costs off)
+select * from incsort_t order by a, b;
+reset enable_incremental_sort;
+
+-- Check the output order against a full sort
+create temp table incsort_result as
+  select row_number() over () as rn, a, b, c
+  from (select * from incsort_t order by a, b desc, c) s;
+set enable_incremental_sort = off;
+select count(*) as mismatches
+from incsort_result r full join
+  (select row_number() over () as rn, a, b, c
+   from (select * from incsort_t order by a, b desc, c) s) e using (rn)
+where (r.a, r.b, r.c) is distinct from (e.a, e.b, e.c);
+reset enable_incremental_sort;
+drop table incsort_result;
+
+-- Bounded sorts, with the limit falling inside and across groups
+select a, b from incsort_t where a >= 1001 order by a, b limit 40 offset 28;
+select a, b from incsort_t where a >= 1004 order by a, b desc limit 5 offset 30;
+select a, b from incsort_t where a >= 1005 order by a, b limit 3;
+
+-- Rescans, with a changed parameter below the incremental sort
+explain (costs off)
+select * from (values (1), (1003)) v(x),
+  lateral (select a, b from incsort_t where a >= v.x order by a, b limit 3) s;
+select * from (values (1), (1003)) v(x),
+  lateral (select a, b from incsort_t where a >= v.x order by a, b limit 3) s;
+
+-- and with an unchanged one
+explain (costs off)
+select * from (values (2), (5)) v(x),
+  lateral (select a, b from incsort_t where a > 1000 order by a, b limit v.x) s;
+select * from (values (2), (5)) v(x),
+  lateral (select a, b from incsort_t where a > 1000 order by a, b limit v.x) s;
+
+-- Incremental sort can't mark and restore its position, so a merge join
+-- needs to materialize its output to use it as the inner side.  The
+-- duplicate keys make the join restore the inner side's position.
+set enable_hashjoin = off;
+set enable_nestloop = off;
+explain (costs off)
+select count(*)
+from (select * from incsort_t order by a, b offset 0) t1
+  join (select * from incsort_t where a < 100 order by a, b) t2
+  on t1.a = t2.a and t1.b = t2.b;
+select count(*)
+from (select * from incsort_t order by a, b offset 0) t1
+  join (select * from incsort_t where a < 100 order by a, b) t2
+  on t1.a = t2.a and t1.b = t2.b;
+reset enable_hashjoin;
+reset enable_nestloop;
+set enable_mergejoin = off;
+select count(*)
+from (select * from incsort_t order by a, b offset 0) t1
+  join (select * from incsort_t where a < 100 order by a, b) t2
+  on t1.a = t2.a and t1.b = t2.b;
+reset enable_mergejoin;
+
+drop function explain_analyze_without_memory(text);
+drop table incsort_t;
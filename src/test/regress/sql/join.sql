@@ -2493,4 +2493,85 @@ $$
 $$);
 rollback to settings;
 
+-- bloom filters pushed down into the outer scan.  With only three inner
+-- rows the filter practically can't return false positives, so the number
+-- of rows it removes is stable.
+create table join_bloom as select generate_series(1, 3) as id;
+analyze join_bloom;
+
+-- hide the hash table's memory usage, which varies between platforms
+create or replace function explain_bloom(query text)
+returns setof text language plpgsql
+as
+$$
+declare
+  ln text;
+begin
+  for ln in
+    execute 'explain (analyze, costs off, summary off, timing off) ' || query
+  loop
+    ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+    return next ln;
+  end loop;
+end;
+$$;
+
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local enable_nestloop = off;
+set local enable_mergejoin = off;
+select explain_bloom('
+  select count(*) from simple r join join_bloom s using (id)');
+select count(*) from simple r join join_bloom s using (id);
+-- the filter is tested after the scan's own quals
+select explain_bloom('
+  select count(*) from simple r join join_bloom s using (id) where r.id % 2 = 1');
+select count(*) from simple r join join_bloom s using (id) where r.id % 2 = 1;
+select explain_bloom('
+  select count(*) from simple r where id in (select id from join_bloom)');
+select count(*) from simple r where id in (select id from join_bloom);
+-- not if the join returns unmatched outer rows
+select explain_bloom('
+  select count(*) from simple r left join join_bloom s using (id)');
+select count(*) from simple r left join join_bloom s using (id);
+-- nor if the planner expects most outer rows to have a partner
+select explain_bloom('
+  select count(*) from simple r join simple s using (id)');
+-- nor if disabled
+set local enable_hashjoin_bloom_filter = off;
+select explain_bloom('
+  select count(*) from simple r join join_bloom s using (id)');
+rollback to settings;
+
+-- a multi-batch join, whose filter must cover the inner rows of all batches
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local enable_nestloop = off;
+set local enable_mergejoin = off;
+set local work_mem = '64kB';
+explain (costs off)
+  select count(*) from simple r
+    join (select id from simple where id % 5 = 0) s using (id);
+select count(*) from simple r
+  join (select id from simple where id % 5 = 0) s using (id);
+select final > 1 as multibatch
+  from hash_join_batches(
+$$
+  select count(*) from simple r
+    join (select id from simple where id % 5 = 0) s using (id);
+$$);
+rollback to settings;
+
+-- parallel with parallel-aware hash join, where the participants' filters
+-- are merged
+savepoint settings;
+set local max_parallel_workers_per_gather = 2;
+set local enable_parallel_hash = on;
+set local enable_nestloop = off;
+set local enable_mergejoin = off;
+explain (costs off)
+  select count(*) from simple r join simple s using (id) where s.id % 100 = 0;
+select count(*) from simple r join simple s using (id) where s.id % 100 = 0;
+rollback to settings;
+
 rollback;
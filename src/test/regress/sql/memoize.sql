@@ -0,0 +1,149 @@
+-- Perform tests on the Memoize node.
+
+-- The cache hits/misses/evictions from the Memoize node can vary between
+-- machines.  Let's just replace the number with an 'N'.  In order to allow us
+-- to perform validation when the measure was zero, we replace a zero value
+-- with "Zero".  All other numbers are replaced with 'N'.
+create function explain_memoize(query text, hide_hitmiss bool) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        if hide_hitmiss = true then
+            ln := regexp_replace(ln, 'Hits: 0', 'Hits: Zero');
+            ln := regexp_replace(ln, 'Hits: \d+', 'Hits: N');
+            ln := regexp_replace(ln, 'Misses: 0', 'Misses: Zero');
+            ln := regexp_replace(ln, 'Misses: \d+', 'Misses: N');
+        end if;
+        ln := regexp_replace(ln, 'Evictions: 0', 'Evictions: Zero');
+        ln := regexp_replace(ln, 'Evictions: \d+', 'Evictions: N');
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        ln := regexp_replace(ln, 'loops=\d+', 'loops=N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- Ensure we get a memoize node on the inner side of the nested loop
+SET enable_hashjoin TO off;
+SET enable_bitmapscan TO off;
+SET max_parallel_workers_per_gather TO 0;
+
+SELECT explain_memoize('
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;
+
+-- Try with LATERAL joins
+SELECT explain_memoize('
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;
+
+-- Reduce work_mem so that we see some cache evictions
+SET work_mem TO '64kB';
+SET enable_mergejoin TO off;
+-- Ensure we get some evictions.  We're unable to validate the hits and misses
+-- here as the number of entries that fit in the cache at once will vary
+-- between different machines.
+SELECT explain_memoize('
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.thousand
+WHERE t2.unique1 < 1200;', true);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.thousand
+WHERE t2.unique1 < 1200;
+
+RESET enable_mergejoin;
+RESET work_mem;
+
+-- Test binary mode.  Values that are equal according to the type's equality
+-- operator but have different images must not share a cache entry when the
+-- parameter comes from a lateral reference.
+CREATE TABLE memoize_num (n numeric);
+INSERT INTO memoize_num SELECT '1.0' FROM generate_series(1,50);
+INSERT INTO memoize_num SELECT '1.00' FROM generate_series(1,50);
+ANALYZE memoize_num;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT n, s FROM memoize_num,
+LATERAL (SELECT n::text AS s FROM tenk1 WHERE unique1 = 1 OFFSET 0) ss;
+
+SELECT explain_memoize('
+SELECT n, s FROM memoize_num,
+LATERAL (SELECT n::text AS s FROM tenk1 WHERE unique1 = 1 OFFSET 0) ss;', false);
+
+-- Each value must see its own rendering
+SELECT n::text, s, COUNT(*) FROM memoize_num,
+LATERAL (SELECT n::text AS s FROM tenk1 WHERE unique1 = 1 OFFSET 0) ss
+GROUP BY 1, 2 ORDER BY 1, 2;
+
+-- Likewise for float8 zero and negative zero
+CREATE TABLE memoize_flt (f float8);
+INSERT INTO memoize_flt SELECT '0' FROM generate_series(1,50);
+INSERT INTO memoize_flt SELECT '-0' FROM generate_series(1,50);
+ANALYZE memoize_flt;
+
+SELECT f::text, s, COUNT(*) FROM memoize_flt,
+LATERAL (SELECT f::text AS s FROM tenk1 WHERE unique1 = 1 OFFSET 0) ss
+GROUP BY 1, 2 ORDER BY 1, 2;
+
+-- A plain join parameter only feeds the inner rel's equality quals, so the
+-- cache keys are compared with the type's equality operator.
+CREATE TABLE memoize_num_inner (n numeric PRIMARY KEY);
+INSERT INTO memoize_num_inner VALUES (1), (2);
+ANALYZE memoize_num_inner;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM memoize_num o
+INNER JOIN memoize_num_inner i ON i.n = o.n;
+
+SELECT explain_memoize('
+SELECT * FROM memoize_num o
+INNER JOIN memoize_num_inner i ON i.n = o.n;', false);
+
+DROP TABLE memoize_num, memoize_num_inner, memoize_flt;
+
+RESET max_parallel_workers_per_gather;
+RESET enable_bitmapscan;
+RESET enable_hashjoin;
+
+-- Exercise Memoize code that flushes the cache when a parameter changes which
+-- is not part of the cache key.
+
+-- Ensure we get a Memoize plan
+EXPLAIN (COSTS OFF)
+SELECT unique1 FROM tenk1 t0
+WHERE unique1 < 3
+  AND EXISTS (
+	SELECT 1 FROM tenk1 t1
+	INNER JOIN tenk1 t2 ON t1.unique1 = t2.hundred
+	WHERE t0.ten = t1.twenty AND t0.two <> t2.four OFFSET 0);
+
+-- Ensure the above query returns the correct result
+SELECT unique1 FROM tenk1 t0
+WHERE unique1 < 3
+  AND EXISTS (
+	SELECT 1 FROM tenk1 t1
+	INNER JOIN tenk1 t2 ON t1.unique1 = t2.hundred
+	WHERE t0.ten = t1.twenty AND t0.two <> t2.four OFFSET 0);
+
+DROP FUNCTION explain_memoize(text, bool);
@@ -135,6 +135,14 @@ TRUNCATE trunc_stats_test4;
 INSERT INTO trunc_stats_test4 DEFAULT VALUES;
 ROLLBACK;
 
+-- with autovacuum disabled for the table, inserting backends clean up GIN
+-- pending lists themselves, so the list never grows much past its limit
+CREATE TABLE gin_stats_test(a int[]) WITH (autovacuum_enabled = off);
+CREATE INDEX gin_stats_test_idx ON gin_stats_test USING gin (a)
+  WITH (fastupdate = on, gin_pending_list_limit = 64);
+INSERT INTO gin_stats_test SELECT array[g, g + 1] FROM generate_series(1, 10000) g;
+SELECT gin_clean_pending_list('gin_stats_test_idx') < 10 AS bounded;
+
 -- do a seqscan
 SELECT count(*) FROM tenk2;
 -- do an indexscan
@@ -171,9 +179,16 @@ SELECT st.heap_blks_read + st.heap_blks_hit >= pr.heap_blks + cl.relpages,
   FROM pg_statio_user_tables AS st, pg_class AS cl, prevstats AS pr
  WHERE st.relname='tenk2' AND cl.relname='tenk2';
 
+SELECT gin_pending_cleanups > 1,
+       gin_pending_pages > gin_pending_cleanups,
+       gin_pending_cleanup_time > 0
+  FROM pg_stat_user_indexes
+ WHERE indexrelname = 'gin_stats_test_idx';
+
 SELECT pr.snap_ts < pg_stat_get_snapshot_timestamp() as snapshot_newer
 FROM prevstats AS pr;
 
 DROP TABLE trunc_stats_test, trunc_stats_test1, trunc_stats_test2, trunc_stats_test3, trunc_stats_test4;
+DROP TABLE gin_stats_test;
 DROP TABLE prevstats;
 -- End of Stats Test